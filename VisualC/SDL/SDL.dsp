@@ -196,6 +196,10 @@ SOURCE=..\..\src\video\windib\SDL_dibvideo.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\video\SDL_dirtyrect.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\audio\disk\SDL_diskaudio.c
 # End Source File
 # Begin Source File
@@ -312,10 +316,6 @@ SOURCE=..\..\src\audio\SDL_mixer.c
 # End Source File
 # Begin Source File
 
-SOURCE=..\..\src\audio\SDL_mixer_MMX_VC.c
-# End Source File
-# Begin Source File
-
 SOURCE=..\..\src\joystick\win32\SDL_mmjoystick.c
 # End Source File
 # Begin Source File
@@ -376,6 +376,10 @@ SOURCE=..\..\src\video\SDL_RLEaccel_c.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\file\SDL_rwasync.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\file\SDL_rwops.c
 # End Source File
 # Begin Source File
@@ -524,6 +528,10 @@ SOURCE=..\..\src\video\SDL_yuv.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\video\SDL_yuv_simd.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\video\SDL_yuv_sw.c
 # End Source File
 # Begin Source File
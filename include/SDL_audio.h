@@ -103,8 +103,11 @@ typedef struct SDL_AudioSpec {
 #define AUDIO_S16LSB	0x8010	/**< Signed 16-bit samples */
 #define AUDIO_U16MSB	0x1010	/**< As above, but big-endian byte order */
 #define AUDIO_S16MSB	0x9010	/**< As above, but big-endian byte order */
+#define AUDIO_F32LSB	0x8120	/**< 32-bit floating point samples, -1.0 to 1.0 */
+#define AUDIO_F32MSB	0x9120	/**< As above, but big-endian byte order */
 #define AUDIO_U16	AUDIO_U16LSB
 #define AUDIO_S16	AUDIO_S16LSB
+#define AUDIO_F32	AUDIO_F32LSB
 
 /**
  *  @name Native audio byte ordering
@@ -113,9 +116,11 @@ typedef struct SDL_AudioSpec {
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 #define AUDIO_U16SYS	AUDIO_U16LSB
 #define AUDIO_S16SYS	AUDIO_S16LSB
+#define AUDIO_F32SYS	AUDIO_F32LSB
 #else
 #define AUDIO_U16SYS	AUDIO_U16MSB
 #define AUDIO_S16SYS	AUDIO_S16MSB
+#define AUDIO_F32SYS	AUDIO_F32MSB
 #endif
 /*@}*/
 
@@ -223,6 +228,39 @@ extern DECLSPEC SDL_AudioSpec * SDLCALL SDL_LoadWAV_RW(SDL_RWops *src, int frees
  */
 extern DECLSPEC void SDLCALL SDL_FreeWAV(Uint8 *audio_buf);
 
+/** @name WAVE streaming
+ *  These functions decode a WAVE file a piece at a time, instead of
+ *  loading all of it like SDL_LoadWAV_RW(), so long files can be played
+ *  without holding them in memory.  Raw, MS-ADPCM and IMA-ADPCM WAVE
+ *  files are supported, and the data source must be able to seek.
+ *
+ *  SDL_OpenWAV_RW() reads the WAVE header from 'src', fills in 'spec'
+ *  the same way as SDL_LoadWAV_RW(), and returns a stream positioned
+ *  at the start of the audio data, or NULL on error.  'src' is closed
+ *  with the stream, or on error, if 'freesrc' is non-zero.
+ *
+ *  SDL_ReadWAV() decodes up to 'len' bytes of audio into 'buf', and
+ *  returns the number of bytes decoded, a whole number of sample frames,
+ *  0 at the end of the data, or -1 on error.  It can be called from the
+ *  audio callback to feed the audio device directly.
+ *
+ *  SDL_SeekWAV() moves the stream to a sample frame, and SDL_TellWAV()
+ *  and SDL_WAVLength() return the current sample frame and the number
+ *  of sample frames in the stream.
+ */
+/*@{*/
+typedef struct SDL_WAVStream SDL_WAVStream;
+
+extern DECLSPEC SDL_WAVStream * SDLCALL SDL_OpenWAV_RW(SDL_RWops *src, int freesrc, SDL_AudioSpec *spec);
+#define SDL_OpenWAV(file, spec) \
+	SDL_OpenWAV_RW(SDL_RWFromFile(file, "rb"),1, spec)
+extern DECLSPEC int SDLCALL SDL_ReadWAV(SDL_WAVStream *stream, Uint8 *buf, int len);
+extern DECLSPEC int SDLCALL SDL_SeekWAV(SDL_WAVStream *stream, Uint32 frame);
+extern DECLSPEC Uint32 SDLCALL SDL_TellWAV(SDL_WAVStream *stream);
+extern DECLSPEC Uint32 SDLCALL SDL_WAVLength(SDL_WAVStream *stream);
+extern DECLSPEC void SDLCALL SDL_CloseWAV(SDL_WAVStream *stream);
+/*@}*/
+
 /**
  * This function takes a source format and rate and a destination format
  * and rate, and initializes the 'cvt' structure with information needed
@@ -246,6 +284,56 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
  */
 extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
 
+/**
+ * An audio stream converts audio data that arrives in pieces of any size.
+ * It keeps the resampling state between pieces, so there are no seams
+ * where they join, and queues the output until it's read.
+ */
+typedef struct _SDL_AudioStream SDL_AudioStream;
+
+/**
+ * Create an audio stream converting from one format, channel count and
+ * rate to another.
+ *
+ * @return The new stream, or NULL if there was an error.
+ */
+extern DECLSPEC SDL_AudioStream * SDLCALL SDL_NewAudioStream(
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate);
+
+/**
+ * Add len bytes of audio data in the source format to the stream.
+ * Incomplete sample frames are kept until the rest arrives.
+ *
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len);
+
+/**
+ * Read up to len bytes of converted audio data, in whole sample frames.
+ *
+ * @return The number of bytes read, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len);
+
+/** Get the number of converted bytes ready to be read */
+extern DECLSPEC int SDLCALL SDL_AudioStreamAvailable(SDL_AudioStream *stream);
+
+/**
+ * Convert whatever data is held back for resampling, as if the input
+ * were followed by silence.  Call this at the end of the input; further
+ * data is treated as the start of a new stream.
+ *
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamFlush(SDL_AudioStream *stream);
+
+/** Throw away any data in the stream, ready to start again */
+extern DECLSPEC void SDLCALL SDL_AudioStreamClear(SDL_AudioStream *stream);
+
+/** Free an audio stream */
+extern DECLSPEC void SDLCALL SDL_FreeAudioStream(SDL_AudioStream *stream);
+
 
 #define SDL_MIX_MAXVOLUME 128
 /**
@@ -180,4 +180,12 @@ typedef unsigned int uintptr_t;
 #define SDL_ASSEMBLY_ROUTINES	1
 #endif
 
+/* Enable SSE2 and AVX2 intrinsics blitters (checked at runtime) */
+#if defined(_MSC_VER) && (_MSC_VER >= 1400) && (defined(_M_IX86) || defined(_M_X64))
+#define SDL_SSE2_INTRINSICS	1
+#if (_MSC_VER >= 1700)
+#define SDL_AVX2_INTRINSICS	1
+#endif
+#endif
+
 #endif /* _SDL_config_win32_h */
@@ -36,6 +36,15 @@
 extern "C" {
 #endif
 
+/**
+ *  @name CPU Features
+ *  The SDL_CPU_DISABLE environment variable, a comma separated list of
+ *  mmx, mmxext, 3dnow, 3dnowext, sse, sse2, altivec and avx2, makes these
+ *  functions return false for those features, to test and benchmark the
+ *  code SDL uses on CPUs without them.
+ */
+/*@{*/
+
 /** This function returns true if the CPU has the RDTSC instruction */
 extern DECLSPEC SDL_bool SDLCALL SDL_HasRDTSC(void);
 
@@ -60,6 +69,11 @@ extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE2(void);
 /** This function returns true if the CPU has AltiVec features */
 extern DECLSPEC SDL_bool SDLCALL SDL_HasAltiVec(void);
 
+/** This function returns true if the CPU and OS support AVX2 features */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX2(void);
+
+/*@}*/
+
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
@@ -283,6 +283,16 @@ extern DECLSPEC int SDLCALL SDL_PeepEvents(SDL_Event *events, int numevents,
  */
 extern DECLSPEC int SDLCALL SDL_PollEvent(SDL_Event *event);
 
+/** Pumps the event loop once and removes all pending events matching 'mask'
+ *  from the queue, up to 'maxevents', storing them in the 'events' array.
+ *  This is much faster than calling SDL_PollEvent() for each event when
+ *  there are many of them, for example high rate mouse motion.
+ *
+ *  @return The number of events stored, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_PollEvents(SDL_Event *events, int maxevents,
+								Uint32 mask);
+
 /** Waits indefinitely for the next available event, returning 1, or 0 if there
  *  was an error while waiting for events.  If 'event' is not NULL, the next
  *  event is removed from the queue and stored in that area.
@@ -292,9 +302,18 @@ extern DECLSPEC int SDLCALL SDL_WaitEvent(SDL_Event *event);
 /** Add an event to the event queue.
  *  This function returns 0 on success, or -1 if the event queue was full
  *  or there was some other error.
+ *  This function is thread-safe, and doesn't block on platforms with
+ *  atomic operations.
  */
 extern DECLSPEC int SDLCALL SDL_PushEvent(SDL_Event *event);
 
+/** Returns the number of events which were dropped because the event
+ *  queue was full, since the event subsystem was initialized.
+ *  The size of the queue can be set with the SDL_EVENT_QUEUE_SIZE
+ *  environment variable before initializing the video subsystem.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetDroppedEvents(void);
+
 /** @name Event Filtering */
 /*@{*/
 typedef int (SDLCALL *SDL_EventFilter)(const SDL_Event *event);
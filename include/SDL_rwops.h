@@ -105,6 +105,25 @@ extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromFP(FILE *fp, int autoclose);
 extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromMem(void *mem, int size);
 extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromConstMem(const void *mem, int size);
 
+/** Map a file into memory for reading.
+ *  Reads from the returned SDL_RWops are plain memory copies, files
+ *  larger than 2 GB can be accessed with SDL_RWseek64(), and
+ *  SDL_RWborrow() gives direct access to the file contents.
+ *  Returns NULL if the file couldn't be opened or mapped.
+ */
+extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromMappedFile(const char *file);
+
+/** Read and write another SDL_RWops through a buffer of 'size' bytes,
+ *  or a default size if 'size' is 0, so small reads and writes don't
+ *  reach the data source one at a time.
+ *  Writes are passed on when the buffer fills, on seeks and on close.
+ *  Closing the returned SDL_RWops leaves 'src' positioned after the last
+ *  byte read or written, and closes it if 'freesrc' is nonzero.
+ *  Returns NULL if 'src' is NULL or out of memory, in which case 'src'
+ *  is closed if 'freesrc' is nonzero.
+ */
+extern DECLSPEC SDL_RWops * SDLCALL SDL_BufferRW(SDL_RWops *src, int size, int freesrc);
+
 extern DECLSPEC SDL_RWops * SDLCALL SDL_AllocRW(void);
 extern DECLSPEC void SDLCALL SDL_FreeRW(SDL_RWops *area);
 
@@ -126,6 +145,67 @@ extern DECLSPEC void SDLCALL SDL_FreeRW(SDL_RWops *area);
 #define SDL_RWclose(ctx)		(ctx)->close(ctx)
 /*@}*/
 
+/** @name 64-bit offsets
+ *  These work like SDL_RWseek() and SDL_RWtell() with 64-bit offsets,
+ *  for the data sources created by SDL.  Other data sources are limited
+ *  to the offsets their 'seek' function can handle.
+ *  SDL_RWsize64() returns the size of the data source, or -1 if it
+ *  can't be found.
+ */
+/*@{*/
+extern DECLSPEC Sint64 SDLCALL SDL_RWseek64(SDL_RWops *context, Sint64 offset, int whence);
+#define SDL_RWtell64(ctx)		SDL_RWseek64(ctx, 0, RW_SEEK_CUR)
+extern DECLSPEC Sint64 SDLCALL SDL_RWsize64(SDL_RWops *context);
+/*@}*/
+
+/** Borrow a pointer to the next 'size' bytes of a memory based data
+ *  source, from SDL_RWFromMem(), SDL_RWFromConstMem() or
+ *  SDL_RWFromMappedFile(), and advance past them.  The data must not be
+ *  modified and is valid until the SDL_RWops is closed.
+ *  Returns NULL, without moving, if the data source isn't memory based
+ *  or has less than 'size' bytes left; use SDL_RWread() in that case.
+ */
+extern DECLSPEC const void * SDLCALL SDL_RWborrow(SDL_RWops *context, int size);
+
+/** @name Asynchronous reads
+ *  SDL_RWreadAsync() queues a read of 'size' bytes at 'offset' into 'ptr'
+ *  and returns immediately.  The reads are done by a pool of I/O threads,
+ *  SDL_RWASYNC_THREADS from the environment or 2 by default, which are
+ *  started by the first request and stopped by SDL_Quit().  Requests for
+ *  the same data source are taken together and read in offset order by
+ *  one thread, so a data source is never used by two threads at once.
+ *  The data source must stay open, and must not be used directly, while
+ *  it has requests pending.
+ *
+ *  When a request finishes, 'callback' is called on the I/O thread with
+ *  the number of bytes read, or -1 on error, and must not wait on the
+ *  request.  If 'callback' is NULL, an SDL_USEREVENT is pushed instead,
+ *  with a code of SDL_RWASYNC_EVENT, data1 set to the request and data2
+ *  set to 'userdata'.
+ *
+ *  Every request must be released with SDL_RWwaitAsync(), which waits for
+ *  it to finish and returns its result.  SDL_RWpollAsync() returns the
+ *  result without waiting, or SDL_RWASYNC_PENDING.  SDL_RWcancelAsync()
+ *  stops a request that hasn't started yet, without calling its callback,
+ *  and returns 0, or -1 if it is too late.  The result of a cancelled
+ *  request is SDL_RWASYNC_CANCELLED.
+ *
+ *  Without thread support the read is done by SDL_RWreadAsync() itself.
+ */
+/*@{*/
+typedef struct SDL_RWasync SDL_RWasync;
+typedef void (SDLCALL *SDL_RWasyncCallback)(void *userdata, SDL_RWasync *request, int result);
+
+#define SDL_RWASYNC_EVENT	0x52574153	/**< "RWAS" */
+#define SDL_RWASYNC_CANCELLED	-2
+#define SDL_RWASYNC_PENDING	-3
+
+extern DECLSPEC SDL_RWasync * SDLCALL SDL_RWreadAsync(SDL_RWops *context, Sint64 offset, void *ptr, int size, SDL_RWasyncCallback callback, void *userdata);
+extern DECLSPEC int SDLCALL SDL_RWpollAsync(SDL_RWasync *request);
+extern DECLSPEC int SDLCALL SDL_RWwaitAsync(SDL_RWasync *request);
+extern DECLSPEC int SDLCALL SDL_RWcancelAsync(SDL_RWasync *request);
+/*@}*/
+
 /** @name Read an item of the specified endianness and return in native format */
 /*@{*/
 extern DECLSPEC Uint16 SDLCALL SDL_ReadLE16(SDL_RWops *src);
@@ -51,6 +51,23 @@ extern DECLSPEC Uint32 SDLCALL SDL_GetTicks(void);
 /** Wait a specified number of milliseconds before returning */
 extern DECLSPEC void SDLCALL SDL_Delay(Uint32 ms);
 
+/**
+ * Get the number of nanoseconds since the SDL library initialization.
+ * This comes from a monotonic clock where the platform has one, so it
+ * isn't affected by changes to the system time, and it doesn't wrap.
+ */
+extern DECLSPEC Uint64 SDLCALL SDL_GetTicksNS(void);
+
+/** Wait a specified number of nanoseconds before returning */
+extern DECLSPEC void SDLCALL SDL_DelayNS(Uint64 ns);
+
+/**
+ * Wait until SDL_GetTicksNS() reaches the given value.
+ * Waiting for an absolute deadline, e.g. the start of the next frame,
+ * keeps a series of delays from drifting.
+ */
+extern DECLSPEC void SDLCALL SDL_DelayUntilNS(Uint64 deadline);
+
 /** Function prototype for the timer callback function */
 typedef Uint32 (SDLCALL *SDL_TimerCallback)(Uint32 interval);
 
@@ -108,6 +125,14 @@ typedef struct _SDL_TimerID *SDL_TimerID;
  */
 extern DECLSPEC SDL_TimerID SDLCALL SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *param);
 
+/** Add a new timer whose interval is given in microseconds.
+ *  The callback is passed and returns the interval in microseconds,
+ *  and the interval is not rounded to the timer resolution.
+ *  Returns a timer ID which can be passed to SDL_RemoveTimer(),
+ *  or NULL when an error occurs.
+ */
+extern DECLSPEC SDL_TimerID SDLCALL SDL_AddPreciseTimer(Uint32 interval, SDL_NewTimerCallback callback, void *param);
+
 /**
  * Remove one of the multiple timers knowing its ID.
  * Returns a boolean value indicating success.
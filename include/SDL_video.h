@@ -401,6 +401,25 @@ extern DECLSPEC void SDLCALL SDL_UpdateRect
 		(SDL_Surface *screen, Sint32 x, Sint32 y, Uint32 w, Uint32 h);
 /*@}*/
 
+/** @name Dirty Rectangles
+ * Instead of updating each part of the screen as it's drawn, the changes
+ * made in a frame can be collected with SDL_AddDirtyRect() and
+ * SDL_AddDirtyRects(), and updated together with SDL_UpdateDirtyRects().
+ * Overlapping and nearby rectangles are merged when they are updated, and
+ * the rest are trimmed so no part of the screen is updated twice.  If
+ * most of the screen has changed, all of it is updated at once.
+ * The rectangles are clipped to the screen, and a NULL rectangle
+ * marks the whole screen as dirty.
+ */
+/*@{*/
+extern DECLSPEC void SDLCALL SDL_AddDirtyRect
+		(SDL_Surface *screen, const SDL_Rect *rect);
+extern DECLSPEC void SDLCALL SDL_AddDirtyRects
+		(SDL_Surface *screen, int numrects, const SDL_Rect *rects);
+/** Pass the dirty rectangles to SDL_UpdateRects() and forget them */
+extern DECLSPEC void SDLCALL SDL_UpdateDirtyRects(SDL_Surface *screen);
+/*@}*/
+
 /**
  * On hardware that supports double-buffering, this function sets up a flip
  * and returns.  The hardware will wait for vertical retrace, and then swap
@@ -755,6 +774,57 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 			(SDL_Surface *src, SDL_Rect *srcrect,
 			 SDL_Surface *dst, SDL_Rect *dstrect);
 
+/** Returns the name of the function SDL_LowerBlit() uses to blit 'src'
+ *  onto 'dst', such as "BlitNtoN", "SDL_RLEBlit" or "hardware", for
+ *  benchmarks and debugging, or NULL if they can't be blitted.
+ */
+extern DECLSPEC const char * SDLCALL SDL_GetBlitName
+			(SDL_Surface *src, SDL_Surface *dst);
+
+/** Filters used by SDL_StretchSurface() */
+typedef enum {
+	SDL_SCALE_NEAREST,	/**< The nearest pixel, fast and sharp */
+	SDL_SCALE_BILINEAR,	/**< Linear between the nearest 2x2 pixels */
+	SDL_SCALE_BOX		/**< The average of the pixels covered, for shrinking */
+} SDL_ScaleMode;
+
+/**
+ * This function copies 'srcrect' of 'src' to 'dstrect' of 'dst', scaling
+ * it to the size of 'dstrect' with the given filter.  The surfaces must
+ * have the same pixel format, of 8 bits per pixel or more, and must not
+ * overlap.  8-bit surfaces are always scaled with SDL_SCALE_NEAREST.
+ * Colorkey and alpha are not used, the pixels are copied as they are.
+ *
+ * If either rectangle is NULL, the whole surface is used.  The source
+ * rectangle is clipped to the source surface, and the target rectangle
+ * to the clip rectangle of 'dst' without changing the scaling.  The
+ * final target rectangle is saved in 'dstrect'.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_StretchSurface
+			(SDL_Surface *src, SDL_Rect *srcrect,
+			 SDL_Surface *dst, SDL_Rect *dstrect, SDL_ScaleMode mode);
+
+/**
+ * This performs a scaled blit from 'srcrect' of 'src' to 'dstrect' of
+ * 'dst', where unlike SDL_BlitSurface() the width and height of 'dstrect'
+ * give the size to scale to.  The source is scaled with the given filter,
+ * and converted and blended onto 'dst' as SDL_BlitSurface() would, in a
+ * single pass without a temporary surface.  Surfaces with a colorkey are
+ * always scaled with SDL_SCALE_NEAREST so that the colorkey stays exact.
+ * The source must have 8 bits per pixel or more, and the surfaces must
+ * not overlap.
+ *
+ * The rectangles are handled as by SDL_StretchSurface(), and the final
+ * blit rectangle is saved in 'dstrect' after clipping is performed.
+ * This function returns 0 on success, or -1 on error.
+ */
+#define SDL_BlitScaled SDL_UpperBlitScaled
+
+extern DECLSPEC int SDLCALL SDL_UpperBlitScaled
+			(SDL_Surface *src, SDL_Rect *srcrect,
+			 SDL_Surface *dst, SDL_Rect *dstrect, SDL_ScaleMode mode);
+
 /**
  * This function performs a fast fill of the given rectangle with 'color'
  * The given rectangle is clipped to the destination surface clip area
@@ -767,6 +837,16 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 extern DECLSPEC int SDLCALL SDL_FillRect
 		(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color);
 
+/**
+ * This function fills 'numrects' rectangles with 'color', locking the
+ * surface once for all of them.  Each rectangle is clipped to the
+ * destination surface clip area, but the clipped rectangles are not
+ * passed back.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_FillRects
+		(SDL_Surface *dst, const SDL_Rect *rects, int numrects, Uint32 color);
+
 /**
  * This function takes a surface and copies it to a new surface of the
  * pixel format and colors of the video framebuffer, suitable for fast
@@ -822,6 +902,24 @@ extern DECLSPEC int SDLCALL SDL_DisplayYUVOverlay(SDL_Overlay *overlay, SDL_Rect
 /** Free a video overlay */
 extern DECLSPEC void SDLCALL SDL_FreeYUVOverlay(SDL_Overlay *overlay);
 
+/** A function called after a software overlay is converted for display,
+ *  with the time the conversion took in nanoseconds and the number of
+ *  threads that did it.
+ */
+typedef void (SDLCALL *SDL_YUVConvertHook)(void *userdata,
+				SDL_Overlay *overlay, Uint64 ns, int threads);
+
+/** Set a function to be called each time SDL_DisplayYUVOverlay() converts
+ *  a software overlay, or NULL for none.  It is called on the thread that
+ *  displays the overlay.  Hardware overlays don't call it.
+ *
+ *  Large software overlays are converted by several threads when the
+ *  SDL_YUV_THREADS environment variable is set to the number of threads
+ *  to use when the video subsystem is initialized.
+ */
+extern DECLSPEC void SDLCALL SDL_SetYUVConvertHook(SDL_YUVConvertHook hook,
+				void *userdata);
+
 /*@}*/
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -47,6 +47,7 @@ extern void SDL_StartTicks(void);
 extern int  SDL_TimerInit(void);
 extern void SDL_TimerQuit(void);
 #endif
+extern void SDL_RWasyncQuit(void);
 
 /* The current SDL version */
 static SDL_version version = 
@@ -219,6 +220,9 @@ void SDL_Quit(void)
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : Enter! Calling QuitSubSystem()\n"); fflush(stdout);
 #endif
+	/* Finish asynchronous reads while they can still push events */
+	SDL_RWasyncQuit();
+
 	SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
 
 #ifdef CHECK_LEAKS
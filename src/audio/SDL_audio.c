@@ -180,37 +180,75 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	/* Loop, filling the audio buffers */
 	while ( audio->enabled ) {
 
-		/* Fill the current buffer with sound */
-		if ( audio->convert.needed ) {
-			if ( audio->convert.buf ) {
-				stream = audio->convert.buf;
-			} else {
-				continue;
+		/* Resampling gives a varying amount of data per callback */
+		if ( audio->stream ) {
+			int len;
+
+			while ( SDL_AudioStreamAvailable(audio->stream) < audio->spec.size ) {
+				SDL_memset(audio->convert.buf, silence, stream_len);
+				if ( ! audio->paused ) {
+					SDL_mutexP(audio->mixer_lock);
+					(*fill)(udata, audio->convert.buf, stream_len);
+					SDL_mutexV(audio->mixer_lock);
+				}
+				if ( SDL_AudioStreamPut(audio->stream, audio->convert.buf, stream_len) < 0 ) {
+					break;
+				}
 			}
-		} else {
 			stream = audio->GetAudioBuf(audio);
 			if ( stream == NULL ) {
 				stream = audio->fake_stream;
 			}
-		}
+			len = SDL_AudioStreamGet(audio->stream, stream, audio->spec.size);
+			if ( len < 0 ) {
+				len = 0;
+			}
+			if ( len < (int)audio->spec.size ) {
+				SDL_memset(stream+len, audio->spec.silence,
+				           audio->spec.size-len);
+			}
+		} else {
+			/* Fill the current buffer with sound */
+			if ( audio->convert.needed ) {
+				if ( audio->convert.buf ) {
+					stream = audio->convert.buf;
+				} else {
+					continue;
+				}
+			} else {
+				stream = audio->GetAudioBuf(audio);
+				if ( stream == NULL ) {
+					stream = audio->fake_stream;
+				}
+			}
 
-		SDL_memset(stream, silence, stream_len);
+			SDL_memset(stream, silence, stream_len);
 
-		if ( ! audio->paused ) {
-			SDL_mutexP(audio->mixer_lock);
-			(*fill)(udata, stream, stream_len);
-			SDL_mutexV(audio->mixer_lock);
-		}
+			if ( ! audio->paused ) {
+				SDL_mutexP(audio->mixer_lock);
+				(*fill)(udata, stream, stream_len);
+				SDL_mutexV(audio->mixer_lock);
+			}
 
-		/* Convert the audio if necessary */
-		if ( audio->convert.needed ) {
-			SDL_ConvertAudio(&audio->convert);
-			stream = audio->GetAudioBuf(audio);
-			if ( stream == NULL ) {
-				stream = audio->fake_stream;
+			/* Convert the audio if necessary */
+			if ( audio->convert.needed ) {
+				SDL_ConvertAudio(&audio->convert);
+				stream = audio->GetAudioBuf(audio);
+				if ( stream == NULL ) {
+					stream = audio->fake_stream;
+				}
+				/* Resampling may not give exactly a buffer's worth */
+				if ( audio->convert.len_cvt >= audio->spec.size ) {
+					SDL_memcpy(stream, audio->convert.buf,
+					               audio->spec.size);
+				} else {
+					SDL_memcpy(stream, audio->convert.buf,
+					               audio->convert.len_cvt);
+					SDL_memset(stream+audio->convert.len_cvt,
+					           audio->spec.silence,
+					           audio->spec.size-audio->convert.len_cvt);
+				}
 			}
-			SDL_memcpy(stream, audio->convert.buf,
-			               audio->convert.len_cvt);
 		}
 
 		/* Ready current buffer for play and change current buffer */
@@ -268,6 +306,10 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 		++string;
 		format |= 0x8000;
 		break;
+	    case 'F':
+		++string;
+		format |= 0x8100;
+		break;
 	    default:
 		return 0;
 	}
@@ -277,8 +319,9 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 		format |= 8;
 		break;
 	    case 16:
+	    case 32:
+		format |= SDL_atoi(string);
 		string += 2;
-		format |= 16;
 		if ( SDL_strcmp(string, "LSB") == 0
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 		     || SDL_strcmp(string, "SYS") == 0
@@ -297,6 +340,10 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 	    default:
 		return 0;
 	}
+	/* Only floating point samples are 32 bits */
+	if ( ((format & 0x0100) != 0) != ((format & 0xFF) == 32) ) {
+		return 0;
+	}
 	return format;
 }
 
@@ -495,6 +542,7 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	/* Open the audio subsystem */
 	SDL_memcpy(&audio->spec, desired, sizeof(audio->spec));
 	audio->convert.needed = 0;
+	audio->stream = NULL;
 	audio->enabled = 1;
 	audio->paused  = 1;
 
@@ -535,8 +583,14 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 			return(-1);
 		}
 		if ( audio->convert.needed ) {
+			int framesize = (desired->format&0xFF)/8 *
+			                desired->channels;
+
+			/* Round up to whole sample frames */
 			audio->convert.len = (int) ( ((double) audio->spec.size) /
                                           audio->convert.len_ratio );
+			audio->convert.len += framesize - 1;
+			audio->convert.len -= audio->convert.len % framesize;
 			audio->convert.buf =(Uint8 *)SDL_AllocAudioMem(
 			   audio->convert.len*audio->convert.len_mult);
 			if ( audio->convert.buf == NULL ) {
@@ -544,6 +598,14 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 				SDL_OutOfMemory();
 				return(-1);
 			}
+			/* Keep the resampler going across callbacks */
+			if ( desired->freq != audio->spec.freq ) {
+				audio->stream = SDL_NewAudioStream(
+					desired->format, desired->channels,
+					desired->freq,
+					audio->spec.format, audio->spec.channels,
+					audio->spec.freq);
+			}
 		}
 	}
 
@@ -641,6 +703,9 @@ void SDL_AudioQuit(void)
 			SDL_FreeAudioMem(audio->convert.buf);
 
 		}
+		if ( audio->stream ) {
+			SDL_FreeAudioStream(audio->stream);
+		}
 		if ( audio->opened ) {
 			audio->CloseAudio(audio);
 			audio->opened = 0;
@@ -649,18 +714,21 @@ void SDL_AudioQuit(void)
 		audio->free(audio);
 		current_audio = NULL;
 	}
+	SDL_FreeResamplers();
 }
 
-#define NUM_FORMATS	6
+#define NUM_FORMATS	8
 static int format_idx;
 static int format_idx_sub;
 static Uint16 format_list[NUM_FORMATS][NUM_FORMATS] = {
- { AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB },
- { AUDIO_S8, AUDIO_U8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB },
- { AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_S8, AUDIO_U8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_U8, AUDIO_S8 },
 };
 
 Uint16 SDL_FirstAudioFormat(Uint16 format)
@@ -30,6 +30,9 @@ extern Uint16 SDL_NextAudioFormat(void);
 /* Function to calculate the size and silence for a SDL_AudioSpec */
 extern void SDL_CalculateAudioSpec(SDL_AudioSpec *spec);
 
+/* Free the unused resampler tables, from SDL_audiocvt.c */
+extern void SDL_FreeResamplers(void);
+
 /* The actual mixing thread function */
 extern int SDLCALL SDL_RunAudio(void *audiop);
 
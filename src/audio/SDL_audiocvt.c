@@ -24,6 +24,10 @@
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
 #include "SDL_audio.h"
+#include "SDL_timer.h"
+#include "SDL_audio_c.h"
+#include "../cpuinfo/SDL_simd.h"
+#include "../thread/SDL_atomic_c.h"
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -35,7 +39,7 @@ void SDLCALL SDL_ConvertMono(SDL_AudioCVT *cvt, Uint16 format)
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting to mono\n");
 #endif
-	switch (format&0x8018) {
+	switch (format&0x8138) {
 
 		case AUDIO_U8: {
 			Uint8 *src, *dst;
@@ -126,6 +130,19 @@ void SDLCALL SDL_ConvertMono(SDL_AudioCVT *cvt, Uint16 format)
 			}
 		}
 		break;
+
+		case AUDIO_F32: {
+			float *src, *dst;
+
+			src = (float *)cvt->buf;
+			dst = (float *)cvt->buf;
+			for ( i=cvt->len_cvt/8; i; --i ) {
+				*dst = (src[0] + src[1]) * 0.5f;
+				src += 2;
+				dst += 1;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -142,7 +159,7 @@ void SDLCALL SDL_ConvertStrip(SDL_AudioCVT *cvt, Uint16 format)
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting down to stereo\n");
 #endif
-	switch (format&0x8018) {
+	switch (format&0x8138) {
 
 		case AUDIO_U8: {
 			Uint8 *src, *dst;
@@ -241,6 +258,20 @@ void SDLCALL SDL_ConvertStrip(SDL_AudioCVT *cvt, Uint16 format)
 			}
 		}
 		break;
+
+		case AUDIO_F32: {
+			float *src, *dst;
+
+			src = (float *)cvt->buf;
+			dst = (float *)cvt->buf;
+			for ( i=cvt->len_cvt/24; i; --i ) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				src += 6;
+				dst += 2;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt /= 3;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -258,7 +289,7 @@ void SDLCALL SDL_ConvertStrip_2(SDL_AudioCVT *cvt, Uint16 format)
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting 6 down to quad\n");
 #endif
-	switch (format&0x8018) {
+	switch (format&0x8138) {
 
 		case AUDIO_U8: {
 			Uint8 *src, *dst;
@@ -357,6 +388,20 @@ void SDLCALL SDL_ConvertStrip_2(SDL_AudioCVT *cvt, Uint16 format)
 			}
 		}
 		break;
+
+		case AUDIO_F32: {
+			float *src, *dst;
+
+			src = (float *)cvt->buf;
+			dst = (float *)cvt->buf;
+			for ( i=cvt->len_cvt/16; i; --i ) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				src += 4;
+				dst += 2;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -383,6 +428,17 @@ void SDLCALL SDL_ConvertStereo(SDL_AudioCVT *cvt, Uint16 format)
 			dst[0] = src[0];
 			dst[1] = src[0];
 		}
+	} else if ( (format & 0xFF) == 32 ) {
+		Uint32 *src, *dst;
+
+		src = (Uint32 *)(cvt->buf+cvt->len_cvt);
+		dst = (Uint32 *)(cvt->buf+cvt->len_cvt*2);
+		for ( i=cvt->len_cvt/4; i; --i ) {
+			dst -= 2;
+			src -= 1;
+			dst[0] = src[0];
+			dst[1] = src[0];
+		}
 	} else {
 		Uint8 *src, *dst;
 
@@ -410,7 +466,7 @@ void SDLCALL SDL_ConvertSurround(SDL_AudioCVT *cvt, Uint16 format)
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting stereo to surround\n");
 #endif
-	switch (format&0x8018) {
+	switch (format&0x8138) {
 
 		case AUDIO_U8: {
 			Uint8 *src, *dst, lf, rf, ce;
@@ -571,6 +627,27 @@ void SDLCALL SDL_ConvertSurround(SDL_AudioCVT *cvt, Uint16 format)
 			}
 		}
 		break;
+
+		case AUDIO_F32: {
+			float *src, *dst, lf, rf, ce;
+
+			src = (float *)(cvt->buf+cvt->len_cvt);
+			dst = (float *)(cvt->buf+cvt->len_cvt*3);
+			for ( i=cvt->len_cvt/8; i; --i ) {
+				dst -= 6;
+				src -= 2;
+				lf = src[0];
+				rf = src[1];
+				ce = (lf + rf) * 0.5f;
+				dst[0] = lf;
+				dst[1] = rf;
+				dst[2] = rf - ce;
+				dst[3] = lf - ce;
+				dst[4] = ce;
+				dst[5] = ce;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt *= 3;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -587,7 +664,7 @@ void SDLCALL SDL_ConvertSurround_4(SDL_AudioCVT *cvt, Uint16 format)
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting stereo to quad\n");
 #endif
-	switch (format&0x8018) {
+	switch (format&0x8138) {
 
 		case AUDIO_U8: {
 			Uint8 *src, *dst, lf, rf, ce;
@@ -724,6 +801,25 @@ void SDLCALL SDL_ConvertSurround_4(SDL_AudioCVT *cvt, Uint16 format)
 			}
 		}
 		break;
+
+		case AUDIO_F32: {
+			float *src, *dst, lf, rf, ce;
+
+			src = (float *)(cvt->buf+cvt->len_cvt);
+			dst = (float *)(cvt->buf+cvt->len_cvt*2);
+			for ( i=cvt->len_cvt/8; i; --i ) {
+				dst -= 4;
+				src -= 2;
+				lf = src[0];
+				rf = src[1];
+				ce = (lf + rf) * 0.5f;
+				dst[0] = lf;
+				dst[1] = rf;
+				dst[2] = rf - ce;
+				dst[3] = lf - ce;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -856,6 +952,184 @@ void SDLCALL SDL_ConvertEndian(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* 32 bit float samples are converted through native signed 16 bit */
+typedef union {
+	Uint32 u32;
+	float f;
+} SDL_FloatBits;
+
+static __inline__ float SDL_LoadFloat(const Uint8 *data, Uint16 format)
+{
+	SDL_FloatBits bits;
+
+	if ( format & 0x1000 ) {
+		bits.u32 = ((Uint32)data[0] << 24) | ((Uint32)data[1] << 16) |
+		           ((Uint32)data[2] << 8) | data[3];
+	} else {
+		bits.u32 = ((Uint32)data[3] << 24) | ((Uint32)data[2] << 16) |
+		           ((Uint32)data[1] << 8) | data[0];
+	}
+	return(bits.f);
+}
+
+static __inline__ void SDL_StoreFloat(Uint8 *data, float value, Uint16 format)
+{
+	SDL_FloatBits bits;
+
+	bits.f = value;
+	if ( format & 0x1000 ) {
+		data[0] = (Uint8)(bits.u32 >> 24);
+		data[1] = (Uint8)(bits.u32 >> 16);
+		data[2] = (Uint8)(bits.u32 >> 8);
+		data[3] = (Uint8)bits.u32;
+	} else {
+		data[0] = (Uint8)bits.u32;
+		data[1] = (Uint8)(bits.u32 >> 8);
+		data[2] = (Uint8)(bits.u32 >> 16);
+		data[3] = (Uint8)(bits.u32 >> 24);
+	}
+}
+
+#if SDL_SSE2_INTRINSICS
+static int SDL_TARGET_SSE2 SDL_ConvertFloatToS16SSE2(const float *src, Sint16 *dst, int samples)
+{
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	const __m128 maxval = _mm_set1_ps(32767.0f);
+	const __m128 minval = _mm_set1_ps(-32768.0f);
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128 x, y;
+	int i;
+
+	/* The output is behind the input, so this works in place.
+	   Clamp and round half away from zero, like the C version.
+	 */
+	for ( i = 0; i + 8 <= samples; i += 8 ) {
+		x = _mm_mul_ps(_mm_loadu_ps(src+i), scale);
+		y = _mm_mul_ps(_mm_loadu_ps(src+i+4), scale);
+		x = _mm_add_ps(x, _mm_or_ps(half, _mm_and_ps(x, sign)));
+		y = _mm_add_ps(y, _mm_or_ps(half, _mm_and_ps(y, sign)));
+		x = _mm_max_ps(_mm_min_ps(x, maxval), minval);
+		y = _mm_max_ps(_mm_min_ps(y, maxval), minval);
+		_mm_storeu_si128((__m128i *)(dst+i),
+		        _mm_packs_epi32(_mm_cvttps_epi32(x), _mm_cvttps_epi32(y)));
+	}
+	return(i);
+}
+
+static void SDL_TARGET_SSE2 SDL_ConvertS16ToFloatSSE2(const Sint16 *src, float *dst, int samples)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+	int i;
+
+	/* The output is ahead of the input, so go backwards */
+	for ( i = samples - 8; i >= 0; i -= 8 ) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src+i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+		_mm_storeu_ps(dst+i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dst+i+4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+/* Convert 32 bit float to native signed 16 bit */
+void SDLCALL SDL_ConvertFloatToS16(SDL_AudioCVT *cvt, Uint16 format)
+{
+	int i, samples;
+	Sint16 *dst;
+	Uint8 *src;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float to 16-bit\n");
+#endif
+	samples = cvt->len_cvt / 4;
+	src = cvt->buf;
+	dst = (Sint16 *)cvt->buf;
+	i = 0;
+#if SDL_SSE2_INTRINSICS
+	if ( format == AUDIO_F32SYS && SDL_HasSSE2() ) {
+		i = SDL_ConvertFloatToS16SSE2((const float *)src, dst, samples);
+	}
+#endif
+	for ( ; i < samples; ++i ) {
+		float sample = SDL_LoadFloat(src + i*4, format) * 32768.0f;
+		if ( sample >= 32767.0f ) {
+			dst[i] = 32767;
+		} else if ( sample <= -32768.0f ) {
+			dst[i] = -32768;
+		} else {
+			dst[i] = (Sint16)(sample < 0.0f ? sample - 0.5f : sample + 0.5f);
+		}
+	}
+	cvt->len_cvt /= 2;
+	format = AUDIO_S16SYS;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Convert native signed 16 bit to 32 bit float, in the target byte order */
+void SDLCALL SDL_ConvertS16ToFloat(SDL_AudioCVT *cvt, Uint16 format)
+{
+	int i, samples;
+	Sint16 *src;
+	Uint8 *dst;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting 16-bit to float\n");
+#endif
+	format = (cvt->dst_format & 0x1000) | AUDIO_F32LSB;
+	samples = cvt->len_cvt / 2;
+	src = (Sint16 *)cvt->buf;
+	dst = cvt->buf;
+	i = samples;
+#if SDL_SSE2_INTRINSICS
+	if ( format == AUDIO_F32SYS && SDL_HasSSE2() ) {
+		/* Do the odd samples at the end first, since we go backwards */
+		int tail = samples % 8;
+		while ( tail-- ) {
+			--i;
+			((float *)dst)[i] = src[i] / 32768.0f;
+		}
+		SDL_ConvertS16ToFloatSSE2(src, (float *)dst, i);
+		i = 0;
+	}
+#endif
+	while ( i-- ) {
+		SDL_StoreFloat(dst + i*4, src[i] / 32768.0f, format);
+	}
+	cvt->len_cvt *= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Toggle endianness of 32 bit samples */
+void SDLCALL SDL_ConvertEndian32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	int i;
+	Uint8 *data, tmp;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting 32-bit audio endianness\n");
+#endif
+	data = cvt->buf;
+	for ( i=cvt->len_cvt/4; i; --i ) {
+		tmp = data[0];
+		data[0] = data[3];
+		data[3] = tmp;
+		tmp = data[1];
+		data[1] = data[2];
+		data[2] = tmp;
+		data += 4;
+	}
+	format = (format ^ 0x1000);
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
 /* Convert rate up by multiple of 2 */
 void SDLCALL SDL_RateMUL2(SDL_AudioCVT *cvt, Uint16 format)
 {
@@ -886,6 +1160,14 @@ void SDLCALL SDL_RateMUL2(SDL_AudioCVT *cvt, Uint16 format)
 				dst[3] = src[1];
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/4; i; --i ) {
+				src -= 4;
+				dst -= 8;
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[1] = ((Uint32 *)src)[0];
+			}
+			break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -930,6 +1212,16 @@ void SDLCALL SDL_RateMUL2_c2(SDL_AudioCVT *cvt, Uint16 format)
 				dst[7] = src[3];
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/8; i; --i ) {
+				src -= 8;
+				dst -= 16;
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[1] = ((Uint32 *)src)[1];
+				((Uint32 *)dst)[2] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[3] = ((Uint32 *)src)[1];
+			}
+			break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -985,6 +1277,20 @@ void SDLCALL SDL_RateMUL2_c4(SDL_AudioCVT *cvt, Uint16 format)
 				dst[15] = src[7];
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/16; i; --i ) {
+				src -= 16;
+				dst -= 32;
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[1] = ((Uint32 *)src)[1];
+				((Uint32 *)dst)[2] = ((Uint32 *)src)[2];
+				((Uint32 *)dst)[3] = ((Uint32 *)src)[3];
+				((Uint32 *)dst)[4] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[5] = ((Uint32 *)src)[1];
+				((Uint32 *)dst)[6] = ((Uint32 *)src)[2];
+				((Uint32 *)dst)[7] = ((Uint32 *)src)[3];
+			}
+			break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1053,6 +1359,24 @@ void SDLCALL SDL_RateMUL2_c6(SDL_AudioCVT *cvt, Uint16 format)
 				dst[23] = src[11];
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/24; i; --i ) {
+				src -= 24;
+				dst -= 48;
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[1] = ((Uint32 *)src)[1];
+				((Uint32 *)dst)[2] = ((Uint32 *)src)[2];
+				((Uint32 *)dst)[3] = ((Uint32 *)src)[3];
+				((Uint32 *)dst)[4] = ((Uint32 *)src)[4];
+				((Uint32 *)dst)[5] = ((Uint32 *)src)[5];
+				((Uint32 *)dst)[6] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[7] = ((Uint32 *)src)[1];
+				((Uint32 *)dst)[8] = ((Uint32 *)src)[2];
+				((Uint32 *)dst)[9] = ((Uint32 *)src)[3];
+				((Uint32 *)dst)[10] = ((Uint32 *)src)[4];
+				((Uint32 *)dst)[11] = ((Uint32 *)src)[5];
+			}
+			break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1087,6 +1411,13 @@ void SDLCALL SDL_RateDIV2(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 2;
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/8; i; --i ) {
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				src += 8;
+				dst += 4;
+			}
+			break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1125,6 +1456,14 @@ void SDLCALL SDL_RateDIV2_c2(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 4;
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/16; i; --i ) {
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[1] = ((Uint32 *)src)[1];
+				src += 16;
+				dst += 8;
+			}
+			break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1169,6 +1508,16 @@ void SDLCALL SDL_RateDIV2_c4(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 8;
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/32; i; --i ) {
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[1] = ((Uint32 *)src)[1];
+				((Uint32 *)dst)[2] = ((Uint32 *)src)[2];
+				((Uint32 *)dst)[3] = ((Uint32 *)src)[3];
+				src += 32;
+				dst += 16;
+			}
+			break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1218,6 +1567,18 @@ void SDLCALL SDL_RateDIV2_c6(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 12;
 			}
 			break;
+		case 32:
+			for ( i=cvt->len_cvt/48; i; --i ) {
+				((Uint32 *)dst)[0] = ((Uint32 *)src)[0];
+				((Uint32 *)dst)[1] = ((Uint32 *)src)[1];
+				((Uint32 *)dst)[2] = ((Uint32 *)src)[2];
+				((Uint32 *)dst)[3] = ((Uint32 *)src)[3];
+				((Uint32 *)dst)[4] = ((Uint32 *)src)[4];
+				((Uint32 *)dst)[5] = ((Uint32 *)src)[5];
+				src += 48;
+				dst += 24;
+			}
+			break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1300,6 +1661,660 @@ void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* Polyphase resampling for arbitrary rate ratios.
+
+   Output frame j is taken from input position j*M/L, where L/M is the
+   reduced output/input rate ratio.  The fractional part of the position
+   selects one of the filter phases, each a windowed sinc of RESAMPLER_TAPS
+   (or more, when downsampling) 1.14 fixed point coefficients, with a
+   float copy for float samples.
+
+   The tables are shared by everything converting at the same ratio, and
+   looked up again each time a conversion runs, since an SDL_AudioCVT has
+   no way to hold on to one.  Up to MAX_RESAMPLERS unused tables are kept
+   for the next conversion; older ones are freed, as are all the unused
+   ones when audio is shut down.  A conversion whose table was freed
+   builds it again.
+ */
+#define RESAMPLER_TAPS		16
+#define RESAMPLER_MAX_TAPS	64
+#define RESAMPLER_MAX_PHASES	256
+#define RESAMPLER_SHIFT		14
+#define MAX_RESAMPLERS		32
+
+typedef struct SDL_Resampler {
+	double rate_incr;	/* The SDL_AudioCVT rate_incr it's for */
+	Uint32 L, M;		/* Reduced output and input rates */
+	int phases;
+	int taps;
+	Sint16 *coeffs;		/* phases * taps coefficients */
+	float *fcoeffs;		/* The same, for float samples */
+	int refcount;		/* Conversions and streams using it */
+	struct SDL_Resampler *next;
+} SDL_Resampler;
+
+/* Most recently used first, protected by SDL_resamplers_lock */
+static SDL_Resampler *SDL_resamplers = NULL;
+static int SDL_resamplers_lock = 0;
+
+static void SDL_LockResamplers(void)
+{
+	while ( !SDL_AtomicCAS(&SDL_resamplers_lock, 0, 1) ) {
+		SDL_Delay(0);
+	}
+}
+
+static void SDL_UnlockResamplers(void)
+{
+	SDL_MemoryBarrier();
+	SDL_resamplers_lock = 0;
+}
+
+/* sin(pi*x), so we don't need the math library */
+static double SDL_SinPi(double x)
+{
+	double term, sum, x2;
+	int n;
+
+	/* Reduce to [-0.5, 0.5] using symmetry */
+	x -= 2.0 * (double)(Sint64)(x / 2.0);
+	if ( x > 1.0 ) {
+		x -= 2.0;
+	} else if ( x < -1.0 ) {
+		x += 2.0;
+	}
+	if ( x > 0.5 ) {
+		x = 1.0 - x;
+	} else if ( x < -0.5 ) {
+		x = -1.0 - x;
+	}
+	x *= 3.14159265358979323846;
+	x2 = x * x;
+	term = x;
+	sum = x;
+	for ( n = 2; n < 24; n += 2 ) {
+		term *= -x2 / (n * (n+1));
+		sum += term;
+	}
+	return(sum);
+}
+
+static double SDL_ResamplerTap(double d, double scale, double half)
+{
+	double x, sinc, window;
+
+	/* Blackman window over the width of the filter */
+	x = d / half;
+	if ( x <= -1.0 || x >= 1.0 ) {
+		return(0.0);
+	}
+	window = 0.42 + 0.5 * SDL_SinPi(x + 0.5) + 0.08 * SDL_SinPi(2.0*x + 0.5);
+	if ( d == 0.0 ) {
+		sinc = 1.0;
+	} else {
+		sinc = SDL_SinPi(scale * d) / (3.14159265358979323846 * scale * d);
+	}
+	return(scale * sinc * window);
+}
+
+/* Find the reduced M/L that SDL_BuildAudioCVT() divided to get rate_incr.
+   Both rates are integers well below 2^26, so one of the continued
+   fraction convergents gives exactly the same double.
+ */
+static int SDL_ResamplerRatio(double rate_incr, Uint32 *L, Uint32 *M)
+{
+	double x = rate_incr;
+	Uint32 h1 = 1, h2 = 0, k1 = 0, k2 = 1;
+	int i;
+
+	for ( i = 0; i < 64 && x >= 0.0 && x < 4294967295.0; ++i ) {
+		Uint32 a = (Uint32)x;
+		Uint64 h = (Uint64)a * h1 + h2;
+		Uint64 k = (Uint64)a * k1 + k2;
+
+		if ( h > 0x7FFFFFFF || k > 0x7FFFFFFF ) {
+			break;
+		}
+		if ( k && (double)h / (double)k == rate_incr ) {
+			*M = (Uint32)h;
+			*L = (Uint32)k;
+			return(1);
+		}
+		h2 = h1;
+		h1 = (Uint32)h;
+		k2 = k1;
+		k1 = (Uint32)k;
+		if ( x == (double)a ) {
+			break;
+		}
+		x = 1.0 / (x - a);
+	}
+	return(0);
+}
+
+static void SDL_FreeResampler(SDL_Resampler *r)
+{
+	SDL_free(r->coeffs);
+	SDL_free(r->fcoeffs);
+	SDL_free(r);
+}
+
+static SDL_Resampler *SDL_BuildResampler(double rate_incr)
+{
+	SDL_Resampler *r;
+	double scale, half;
+	int p, k;
+
+	r = (SDL_Resampler *)SDL_malloc(sizeof(*r));
+	if ( r == NULL ) {
+		return(NULL);
+	}
+	if ( !SDL_ResamplerRatio(rate_incr, &r->L, &r->M) ) {
+		SDL_free(r);
+		return(NULL);
+	}
+	r->rate_incr = rate_incr;
+	r->phases = (r->L < RESAMPLER_MAX_PHASES) ? r->L : RESAMPLER_MAX_PHASES;
+
+	/* Lower the cutoff when downsampling, widening the filter to match */
+	if ( r->L < r->M ) {
+		scale = (double)r->L / r->M;
+		r->taps = ((int)(RESAMPLER_TAPS / scale) + 7) & ~7;
+		if ( r->taps > RESAMPLER_MAX_TAPS ) {
+			r->taps = RESAMPLER_MAX_TAPS;
+		}
+	} else {
+		scale = 1.0;
+		r->taps = RESAMPLER_TAPS;
+	}
+	half = r->taps / 2;
+
+	r->coeffs = (Sint16 *)SDL_malloc(r->phases*r->taps*sizeof(Sint16));
+	r->fcoeffs = (float *)SDL_malloc(r->phases*r->taps*sizeof(float));
+	if ( r->coeffs == NULL || r->fcoeffs == NULL ) {
+		SDL_FreeResampler(r);
+		return(NULL);
+	}
+	for ( p = 0; p < r->phases; ++p ) {
+		double taps[RESAMPLER_MAX_TAPS];
+		double sum = 0.0;
+		int total = 0, peak = 0;
+		Sint16 *coeffs = &r->coeffs[p*r->taps];
+		float *fcoeffs = &r->fcoeffs[p*r->taps];
+
+		/* Tap k is applied to input sample (position - half + 1 + k) */
+		for ( k = 0; k < r->taps; ++k ) {
+			double d = (k - half + 1) - (double)p / r->phases;
+			taps[k] = SDL_ResamplerTap(d, scale, half);
+			sum += taps[k];
+		}
+		/* Normalize to unity gain, including the rounding error */
+		for ( k = 0; k < r->taps; ++k ) {
+			double c = taps[k] / sum * (1 << RESAMPLER_SHIFT);
+			fcoeffs[k] = (float)(taps[k] / sum);
+			coeffs[k] = (Sint16)(c < 0.0 ? c - 0.5 : c + 0.5);
+			total += coeffs[k];
+			if ( coeffs[k] > coeffs[peak] ) {
+				peak = k;
+			}
+		}
+		coeffs[peak] += (1 << RESAMPLER_SHIFT) - total;
+	}
+
+	r->refcount = 0;
+	r->next = NULL;
+	return(r);
+}
+
+/* Get the table for a rate ratio, building it if needed.  Returns NULL
+   if it can't be built.
+ */
+static SDL_Resampler *SDL_AcquireResampler(double rate_incr)
+{
+	SDL_Resampler *r, *prev, *unused;
+	int count;
+
+	SDL_LockResamplers();
+	prev = NULL;
+	for ( r = SDL_resamplers; r; r = r->next ) {
+		if ( r->rate_incr == rate_incr ) {
+			break;
+		}
+		prev = r;
+	}
+	if ( r ) {
+		if ( prev ) {
+			prev->next = r->next;
+			r->next = SDL_resamplers;
+			SDL_resamplers = r;
+		}
+		++r->refcount;
+		SDL_UnlockResamplers();
+		return(r);
+	}
+	SDL_UnlockResamplers();
+
+	/* Building it takes a while, so don't hold the lock.  Another thread
+	   may add the same table meanwhile, which only costs a little memory
+	   until the spare one is dropped from the end of the list.
+	 */
+	r = SDL_BuildResampler(rate_incr);
+	if ( r == NULL ) {
+		return(NULL);
+	}
+	unused = NULL;
+	SDL_LockResamplers();
+	r->refcount = 1;
+	r->next = SDL_resamplers;
+	SDL_resamplers = r;
+	count = 0;
+	for ( prev = r; prev->next; ) {
+		SDL_Resampler *next = prev->next;
+		if ( ++count >= MAX_RESAMPLERS && next->refcount == 0 ) {
+			prev->next = next->next;
+			next->next = unused;
+			unused = next;
+		} else {
+			prev = next;
+		}
+	}
+	SDL_UnlockResamplers();
+
+	while ( unused ) {
+		prev = unused;
+		unused = unused->next;
+		SDL_FreeResampler(prev);
+	}
+	return(r);
+}
+
+static void SDL_ReleaseResampler(SDL_Resampler *r)
+{
+	SDL_LockResamplers();
+	--r->refcount;
+	SDL_UnlockResamplers();
+}
+
+/* Free the tables nothing is using, called when audio is shut down */
+void SDL_FreeResamplers(void)
+{
+	SDL_Resampler *r, **prev, *unused = NULL;
+
+	SDL_LockResamplers();
+	prev = &SDL_resamplers;
+	while ( (r = *prev) != NULL ) {
+		if ( r->refcount == 0 ) {
+			*prev = r->next;
+			r->next = unused;
+			unused = r;
+		} else {
+			prev = &r->next;
+		}
+	}
+	SDL_UnlockResamplers();
+
+	while ( unused ) {
+		r = unused;
+		unused = unused->next;
+		SDL_FreeResampler(r);
+	}
+}
+
+static __inline__ Sint16 SDL_ResamplerClamp(Sint32 sample)
+{
+	sample = (sample + (1 << (RESAMPLER_SHIFT-1))) >> RESAMPLER_SHIFT;
+	if ( sample > 32767 ) {
+		sample = 32767;
+	} else if ( sample < -32768 ) {
+		sample = -32768;
+	}
+	return((Sint16)sample);
+}
+
+/* Filter one channel from planar input into interleaved output, starting
+   at the given phase.  Returns the number of input samples consumed.
+ */
+static int SDL_Resample(const SDL_Resampler *r, const Sint16 *src,
+                        Sint16 *dst, int frames, int channels, Uint32 *phase)
+{
+	const Sint16 *start = src;
+	Uint32 step = r->M / r->L;
+	Uint32 frac_step = r->M % r->L;
+	Uint32 frac = *phase;
+	int i, k;
+
+	for ( i = frames; i; --i ) {
+		const Sint16 *coeffs;
+		Sint32 sum = 0;
+
+		coeffs = &r->coeffs[((Uint64)frac * r->phases / r->L) * r->taps];
+		for ( k = 0; k < r->taps; ++k ) {
+			sum += src[k] * coeffs[k];
+		}
+		*dst = SDL_ResamplerClamp(sum);
+		dst += channels;
+
+		src += step;
+		frac += frac_step;
+		if ( frac >= r->L ) {
+			frac -= r->L;
+			++src;
+		}
+	}
+	*phase = frac;
+	return (int)(src - start);
+}
+
+#if SDL_SSE2_INTRINSICS
+static int SDL_TARGET_SSE2 SDL_ResampleSSE2(const SDL_Resampler *r,
+           const Sint16 *src, Sint16 *dst, int frames, int channels, Uint32 *phase)
+{
+	const Sint16 *start = src;
+	Uint32 step = r->M / r->L;
+	Uint32 frac_step = r->M % r->L;
+	Uint32 frac = *phase;
+	int i, k;
+
+	for ( i = frames; i; --i ) {
+		const Sint16 *coeffs;
+		__m128i sum = _mm_setzero_si128();
+
+		coeffs = &r->coeffs[((Uint64)frac * r->phases / r->L) * r->taps];
+		for ( k = 0; k < r->taps; k += 8 ) {
+			__m128i x = _mm_loadu_si128((const __m128i *)&src[k]);
+			__m128i h = _mm_loadu_si128((const __m128i *)&coeffs[k]);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(x, h));
+		}
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+		*dst = SDL_ResamplerClamp(_mm_cvtsi128_si32(sum));
+		dst += channels;
+
+		src += step;
+		frac += frac_step;
+		if ( frac >= r->L ) {
+			frac -= r->L;
+			++src;
+		}
+	}
+	*phase = frac;
+	return (int)(src - start);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+static int SDL_ResampleChannel(const SDL_Resampler *r, const Sint16 *src,
+                        Sint16 *dst, int frames, int channels, Uint32 *phase)
+{
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		return SDL_ResampleSSE2(r, src, dst, frames, channels, phase);
+	}
+#endif
+	return SDL_Resample(r, src, dst, frames, channels, phase);
+}
+
+/* The same for float samples, using the float coefficients */
+static int SDL_ResampleFloat(const SDL_Resampler *r, const float *src,
+                        float *dst, int frames, int channels, Uint32 *phase)
+{
+	const float *start = src;
+	Uint32 step = r->M / r->L;
+	Uint32 frac_step = r->M % r->L;
+	Uint32 frac = *phase;
+	int i, k;
+
+	for ( i = frames; i; --i ) {
+		const float *coeffs;
+		float sum = 0.0f;
+
+		coeffs = &r->fcoeffs[((Uint64)frac * r->phases / r->L) * r->taps];
+		for ( k = 0; k < r->taps; ++k ) {
+			sum += src[k] * coeffs[k];
+		}
+		*dst = sum;
+		dst += channels;
+
+		src += step;
+		frac += frac_step;
+		if ( frac >= r->L ) {
+			frac -= r->L;
+			++src;
+		}
+	}
+	*phase = frac;
+	return (int)(src - start);
+}
+
+#if SDL_SSE2_INTRINSICS
+static int SDL_TARGET_SSE2 SDL_ResampleFloatSSE2(const SDL_Resampler *r,
+           const float *src, float *dst, int frames, int channels, Uint32 *phase)
+{
+	const float *start = src;
+	Uint32 step = r->M / r->L;
+	Uint32 frac_step = r->M % r->L;
+	Uint32 frac = *phase;
+	int i, k;
+
+	for ( i = frames; i; --i ) {
+		const float *coeffs;
+		__m128 sum = _mm_setzero_ps();
+
+		coeffs = &r->fcoeffs[((Uint64)frac * r->phases / r->L) * r->taps];
+		for ( k = 0; k < r->taps; k += 4 ) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&src[k]),
+			                                 _mm_loadu_ps(&coeffs[k])));
+		}
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+		*dst = _mm_cvtss_f32(sum);
+		dst += channels;
+
+		src += step;
+		frac += frac_step;
+		if ( frac >= r->L ) {
+			frac -= r->L;
+			++src;
+		}
+	}
+	*phase = frac;
+	return (int)(src - start);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+static int SDL_ResampleChannelFloat(const SDL_Resampler *r, const float *src,
+                        float *dst, int frames, int channels, Uint32 *phase)
+{
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		return SDL_ResampleFloatSSE2(r, src, dst, frames, channels, phase);
+	}
+#endif
+	return SDL_ResampleFloat(r, src, dst, frames, channels, phase);
+}
+
+/* Read a sample in any 8 or 16 bit format as signed native 16 bit */
+static __inline__ Sint16 SDL_ResamplerLoad(const Uint8 *src, Uint16 format)
+{
+	Uint16 sample;
+
+	if ( (format & 0xFF) == 8 ) {
+		sample = (Uint16)src[0] << 8;
+	} else if ( format & 0x1000 ) {
+		sample = ((Uint16)src[0] << 8) | src[1];
+	} else {
+		sample = ((Uint16)src[1] << 8) | src[0];
+	}
+	if ( !(format & 0x8000) ) {
+		sample ^= 0x8000;
+	}
+	return((Sint16)sample);
+}
+
+static __inline__ void SDL_ResamplerStore(Uint8 *dst, Sint16 value, Uint16 format)
+{
+	Uint16 sample = (Uint16)value;
+
+	if ( !(format & 0x8000) ) {
+		sample ^= 0x8000;
+	}
+	if ( (format & 0xFF) == 8 ) {
+		dst[0] = (Uint8)(sample >> 8);
+	} else if ( format & 0x1000 ) {
+		dst[0] = (Uint8)(sample >> 8);
+		dst[1] = (Uint8)sample;
+	} else {
+		dst[0] = (Uint8)sample;
+		dst[1] = (Uint8)(sample >> 8);
+	}
+}
+
+/* Resample native float samples, which don't go through 16 bit */
+static int SDL_RatePolyFloat(SDL_AudioCVT *cvt, const SDL_Resampler *r,
+                             int channels, int srcframes, int dstframes)
+{
+	int i, c, left, padded;
+	Uint32 phase;
+	float *work, *planar, *output, *src;
+
+	left = r->taps/2 - 1;
+	padded = left + srcframes + r->taps/2 + 1 + (int)(r->M / r->L);
+	work = (float *)SDL_malloc((padded + dstframes) * channels * sizeof(float));
+	if ( work == NULL ) {
+		return(-1);
+	}
+	output = work + padded * channels;
+	for ( c = 0; c < channels; ++c ) {
+		float first, last;
+
+		planar = work + c * padded;
+		src = (float *)cvt->buf + c;
+		for ( i = 0; i < srcframes; ++i ) {
+			planar[left+i] = *src;
+			src += channels;
+		}
+		first = planar[left];
+		last = planar[left+srcframes-1];
+		for ( i = 0; i < left; ++i ) {
+			planar[i] = first;
+		}
+		for ( i = left+srcframes; i < padded; ++i ) {
+			planar[i] = last;
+		}
+
+		phase = 0;
+		SDL_ResampleChannelFloat(r, planar, output + c, dstframes, channels, &phase);
+	}
+
+	SDL_memcpy(cvt->buf, output, dstframes * channels * sizeof(float));
+	SDL_free(work);
+	return(0);
+}
+
+static void SDL_RatePoly_cN(SDL_AudioCVT *cvt, Uint16 format, int channels)
+{
+	SDL_Resampler *r;
+	int bytes, framesize, srcframes, dstframes, padded;
+	int i, c, left;
+	Uint32 phase;
+	Sint16 *work, *planar, *output;
+	Uint8 *buf;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting audio rate * %4.4f (polyphase)\n", 1.0/cvt->rate_incr);
+#endif
+	bytes = (format & 0xFF) / 8;
+	framesize = bytes * channels;
+	srcframes = cvt->len_cvt / framesize;
+	r = NULL;
+	if ( srcframes > 0 ) {
+		r = SDL_AcquireResampler(cvt->rate_incr);
+	}
+	if ( r == NULL ) {
+		/* Leave the rate alone rather than fail in the audio thread */
+		goto done;
+	}
+	dstframes = (int)(((Uint64)srcframes * r->L) / r->M);
+
+	/* Float samples are only ever resampled in native byte order */
+	if ( (format & 0xFF) == 32 ) {
+		if ( SDL_RatePolyFloat(cvt, r, channels, srcframes, dstframes) == 0 ) {
+			cvt->len_cvt = dstframes * framesize;
+		}
+		goto done;
+	}
+
+	/* Copy each channel out with enough edge samples for the filter */
+	left = r->taps/2 - 1;
+	padded = left + srcframes + r->taps/2 + 1 + (int)(r->M / r->L);
+	work = (Sint16 *)SDL_malloc((padded + dstframes) * channels * sizeof(Sint16));
+	if ( work == NULL ) {
+		/* Leave the rate alone rather than fail in the audio thread */
+		goto done;
+	}
+	output = work + padded * channels;
+	for ( c = 0; c < channels; ++c ) {
+		Sint16 first, last;
+
+		planar = work + c * padded;
+		buf = cvt->buf + c * bytes;
+		for ( i = 0; i < srcframes; ++i ) {
+			planar[left+i] = SDL_ResamplerLoad(buf, format);
+			buf += framesize;
+		}
+		first = planar[left];
+		last = planar[left+srcframes-1];
+		for ( i = 0; i < left; ++i ) {
+			planar[i] = first;
+		}
+		for ( i = left+srcframes; i < padded; ++i ) {
+			planar[i] = last;
+		}
+
+		phase = 0;
+		SDL_ResampleChannel(r, planar, output + c, dstframes, channels, &phase);
+	}
+
+	buf = cvt->buf;
+	for ( i = dstframes * channels; i; --i ) {
+		SDL_ResamplerStore(buf, *output++, format);
+		buf += bytes;
+	}
+	SDL_free(work);
+	cvt->len_cvt = dstframes * framesize;
+
+done:
+	if ( r ) {
+		SDL_ReleaseResampler(r);
+	}
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Convert rate by an arbitrary ratio, for mono */
+void SDLCALL SDL_RatePoly(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RatePoly_cN(cvt, format, 1);
+}
+
+/* Convert rate by an arbitrary ratio, for stereo */
+void SDLCALL SDL_RatePoly_c2(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RatePoly_cN(cvt, format, 2);
+}
+
+/* Convert rate by an arbitrary ratio, for quad */
+void SDLCALL SDL_RatePoly_c4(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RatePoly_cN(cvt, format, 4);
+}
+
+/* Convert rate by an arbitrary ratio, for 5.1 */
+void SDLCALL SDL_RatePoly_c6(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RatePoly_cN(cvt, format, 6);
+}
+
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 {
 	/* Make sure there's data to convert */
@@ -1330,6 +2345,10 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 {
 /*printf("Build format %04x->%04x, channels %u->%u, rate %d->%d\n",
 		src_format, dst_format, src_channels, dst_channels, src_rate, dst_rate);*/
+	Uint16 cvt_src_format = src_format;
+	Uint16 cvt_dst_format = dst_format;
+	int to_float = 0, swap_float = 0;
+
 	/* Start off with no conversion necessary */
 	cvt->needed = 0;
 	cvt->filter_index = 0;
@@ -1337,6 +2356,36 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	cvt->len_mult = 1;
 	cvt->len_ratio = 1.0;
 
+	/* Float to float stays in native float, so the channel and rate
+	   filters work on the float samples directly.  Otherwise floating
+	   point data is converted through native 16 bit samples, since the
+	   other end has no more precision than that.
+	 */
+	if ( (src_format & 0x0100) && (dst_format & 0x0100) ) {
+		if ( (src_channels == dst_channels) &&
+		     ((src_rate/100) == (dst_rate/100)) ) {
+			if ( src_format != dst_format ) {
+				cvt->filters[cvt->filter_index++] = SDL_ConvertEndian32;
+			}
+		} else {
+			if ( src_format != AUDIO_F32SYS ) {
+				cvt->filters[cvt->filter_index++] = SDL_ConvertEndian32;
+			}
+			swap_float = (dst_format != AUDIO_F32SYS);
+		}
+		src_format = dst_format = AUDIO_F32SYS;
+	} else {
+		if ( src_format & 0x0100 ) {
+			cvt->filters[cvt->filter_index++] = SDL_ConvertFloatToS16;
+			cvt->len_ratio /= 2;
+			src_format = AUDIO_S16SYS;
+		}
+		if ( dst_format & 0x0100 ) {
+			to_float = 1;
+			dst_format = AUDIO_S16SYS;
+		}
+	}
+
 	/* First filter:  Endian conversion from src to dst */
 	if ( (src_format & 0x1000) != (dst_format & 0x1000)
 	     && ((src_format & 0xff) == 16) && ((dst_format & 0xff) == 16)) {
@@ -1436,7 +2485,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	/* Do rate conversion */
 	cvt->rate_incr = 0.0;
 	if ( (src_rate/100) != (dst_rate/100) ) {
-		Uint32 hi_rate, lo_rate;
+		Uint32 hi_rate, lo_rate, rate;
 		int len_mult;
 		double len_ratio;
 		void (SDLCALL *rate_cvt)(SDL_AudioCVT *cvt, Uint16 format);
@@ -1467,44 +2516,526 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 			len_ratio = 2.0;
 		}
 		/* If hi_rate = lo_rate*2^x then conversion is easy */
-		while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
-			cvt->filters[cvt->filter_index++] = rate_cvt;
-			cvt->len_mult *= len_mult;
-			lo_rate *= 2;
-			cvt->len_ratio *= len_ratio;
-		}
-		/* We may need a slow conversion here to finish up */
-		if ( (lo_rate/100) != (hi_rate/100) ) {
-#if 1
-			/* The problem with this is that if the input buffer is
-			   say 1K, and the conversion rate is say 1.1, then the
-			   output buffer is 1.1K, which may not be an acceptable
-			   buffer size for the audio driver (not a power of 2)
+		rate = lo_rate;
+		while ( ((rate*2)/100) <= (hi_rate/100) ) {
+			rate *= 2;
+		}
+		if ( (rate/100) == (hi_rate/100) ) {
+			while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
+				cvt->filters[cvt->filter_index++] = rate_cvt;
+				cvt->len_mult *= len_mult;
+				lo_rate *= 2;
+				cvt->len_ratio *= len_ratio;
+			}
+		} else {
+			/* Otherwise use the polyphase filter, which gets longer
+			   the more it downsamples, so halve the rate first
+			   if it's a lot.
 			*/
-			/* For now, punt and hope the rate distortion isn't great.
+			Uint32 in_rate = src_rate, out_rate = dst_rate;
+			void (SDLCALL *step_cvt)(SDL_AudioCVT *cvt, Uint16 format);
+			SDL_Resampler *r;
+
+			while ( in_rate >= out_rate*4 ) {
+				cvt->filters[cvt->filter_index++] = rate_cvt;
+				cvt->len_ratio *= len_ratio;
+				out_rate *= 2;
+			}
+			step_cvt = rate_cvt;
+			switch (src_channels) {
+				case 1: rate_cvt = SDL_RatePoly; break;
+				case 2: rate_cvt = SDL_RatePoly_c2; break;
+				case 4: rate_cvt = SDL_RatePoly_c4; break;
+				case 6: rate_cvt = SDL_RatePoly_c6; break;
+			}
+			cvt->rate_incr = (double)in_rate/out_rate;
+			/* If the filter table can't be built, get as close as
+			   the x2 and /2 filters can and hope the rate distortion
+			   isn't great.  The table is kept for SDL_ConvertAudio()
+			   to find.
 			*/
-#else
-			if ( src_rate < dst_rate ) {
-				cvt->rate_incr = (double)lo_rate/hi_rate;
-				cvt->len_mult *= 2;
+			r = SDL_AcquireResampler(cvt->rate_incr);
+			if ( r ) {
+				SDL_ReleaseResampler(r);
+				cvt->filters[cvt->filter_index++] = rate_cvt;
+				cvt->len_mult *= (out_rate + in_rate - 1) / in_rate;
 				cvt->len_ratio /= cvt->rate_incr;
 			} else {
-				cvt->rate_incr = (double)hi_rate/lo_rate;
-				cvt->len_ratio *= cvt->rate_incr;
+				cvt->rate_incr = 0.0;
+				while ( in_rate*2 >= out_rate*3 ) {
+					cvt->filters[cvt->filter_index++] = step_cvt;
+					cvt->len_ratio *= len_ratio;
+					out_rate *= 2;
+				}
+				while ( out_rate*2 >= in_rate*3 ) {
+					cvt->filters[cvt->filter_index++] = step_cvt;
+					cvt->len_mult *= len_mult;
+					cvt->len_ratio *= len_ratio;
+					in_rate *= 2;
+				}
 			}
-			cvt->filters[cvt->filter_index++] = SDL_RateSLOW;
-#endif
 		}
 	}
 
+	/* Last filter:  Convert to floating point, or to its byte order */
+	if ( swap_float ) {
+		cvt->filters[cvt->filter_index++] = SDL_ConvertEndian32;
+	} else if ( to_float ) {
+		cvt->filters[cvt->filter_index++] = SDL_ConvertS16ToFloat;
+		cvt->len_mult *= 2;
+		cvt->len_ratio *= 2;
+	}
+
 	/* Set up the filter information */
 	if ( cvt->filter_index != 0 ) {
 		cvt->needed = 1;
-		cvt->src_format = src_format;
-		cvt->dst_format = dst_format;
+		cvt->src_format = cvt_src_format;
+		cvt->dst_format = cvt_dst_format;
 		cvt->len = 0;
 		cvt->buf = NULL;
 		cvt->filters[cvt->filter_index] = NULL;
 	}
 	return(cvt->needed);
 }
+
+/* Audio streams convert data pushed in arbitrary amounts, keeping the
+   resampler history between calls so there are no seams between buffers.
+
+   Data is converted to signed 16 bit, or to native float if either end
+   is float, with the target channels at the source rate, resampled from
+   a planar history buffer, then converted to the target format and
+   queued.  Without a rate change, or without a
+   filter table for it, it's converted straight to the target format.
+ */
+#define STREAM_CHUNK_FRAMES	4096
+
+struct _SDL_AudioStream {
+	SDL_AudioCVT cvt_before;	/* Source to 16 bit or float, or straight to target */
+	SDL_AudioCVT cvt_after;		/* 16 bit or float to target format */
+	int src_framesize;
+	int dst_framesize;
+	int channels;			/* Target channels */
+
+	/* Incomplete source frame left over from the last put */
+	Uint8 partial[32];
+	int partial_len;
+
+	/* Scratch space for conversion */
+	Uint8 *work;
+	int work_max;
+
+	/* Resampler state, only used with a rate change */
+	SDL_Resampler *resampler;
+	Uint16 format;			/* AUDIO_S16SYS or AUDIO_F32SYS */
+	int samplesize;			/* Bytes per sample in that format */
+	Uint8 *history;			/* Planar, history_max frames per channel */
+	int history_len;
+	int history_max;
+	Uint32 phase;
+	Uint64 total_in;
+	Uint64 total_out;
+
+	/* Converted data ready to be read */
+	Uint8 *queue;
+	int queue_head;
+	int queue_len;
+	int queue_max;
+};
+
+static int SDL_StreamReserve(Uint8 **buf, int *max, int len)
+{
+	if ( len > *max ) {
+		Uint8 *mem = (Uint8 *)SDL_realloc(*buf, len);
+		if ( mem == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		*buf = mem;
+		*max = len;
+	}
+	return(0);
+}
+
+static int SDL_StreamQueue(SDL_AudioStream *stream, const Uint8 *data, int len)
+{
+	if ( stream->queue_head > 0 ) {
+		SDL_memmove(stream->queue, stream->queue + stream->queue_head,
+		            stream->queue_len);
+		stream->queue_head = 0;
+	}
+	if ( SDL_StreamReserve(&stream->queue, &stream->queue_max,
+	                       stream->queue_len + len) < 0 ) {
+		return(-1);
+	}
+	SDL_memcpy(stream->queue + stream->queue_len, data, len);
+	stream->queue_len += len;
+	return(0);
+}
+
+/* The history of one channel */
+static __inline__ Uint8 *SDL_StreamHistory(SDL_AudioStream *stream, int c)
+{
+	return stream->history + c * stream->history_max * stream->samplesize;
+}
+
+static int SDL_StreamReserveHistory(SDL_AudioStream *stream, int frames)
+{
+	Uint8 *history;
+	int c, max;
+
+	if ( frames <= stream->history_max ) {
+		return(0);
+	}
+	max = stream->history_max * 2;
+	if ( max < frames ) {
+		max = frames;
+	}
+	history = (Uint8 *)SDL_malloc(max * stream->channels * stream->samplesize);
+	if ( history == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	if ( stream->history ) {
+		for ( c = 0; c < stream->channels; ++c ) {
+			SDL_memcpy(history + c * max * stream->samplesize,
+			           SDL_StreamHistory(stream, c),
+			           stream->history_len * stream->samplesize);
+		}
+		SDL_free(stream->history);
+	}
+	stream->history = history;
+	stream->history_max = max;
+	return(0);
+}
+
+/* Append interleaved samples, or silence if samples is NULL */
+static int SDL_StreamAddHistory(SDL_AudioStream *stream, const Uint8 *samples, int frames)
+{
+	int i, c;
+
+	if ( SDL_StreamReserveHistory(stream, stream->history_len + frames) < 0 ) {
+		return(-1);
+	}
+	for ( c = 0; c < stream->channels; ++c ) {
+		Uint8 *dst = SDL_StreamHistory(stream, c) +
+		             stream->history_len * stream->samplesize;
+		if ( samples == NULL ) {
+			/* Zero bits are silence in both formats */
+			SDL_memset(dst, 0, frames * stream->samplesize);
+		} else if ( stream->format == AUDIO_F32SYS ) {
+			const float *src = (const float *)samples + c;
+			float *fdst = (float *)dst;
+			for ( i = frames; i; --i ) {
+				*fdst++ = *src;
+				src += stream->channels;
+			}
+		} else {
+			const Sint16 *src = (const Sint16 *)samples + c;
+			Sint16 *sdst = (Sint16 *)dst;
+			for ( i = frames; i; --i ) {
+				*sdst++ = *src;
+				src += stream->channels;
+			}
+		}
+	}
+	stream->history_len += frames;
+	return(0);
+}
+
+/* Resample as much of the history as possible, up to max_frames */
+static int SDL_StreamResample(SDL_AudioStream *stream, Uint64 max_frames)
+{
+	SDL_Resampler *r = stream->resampler;
+	Sint64 avail;
+	int frames, consumed, c;
+	Uint32 phase;
+	Uint8 *output;
+	int len;
+
+	/* Output j needs input samples up to (phase + j*M)/L + taps - 1 */
+	avail = (Sint64)(stream->history_len - r->taps + 1) * r->L - stream->phase;
+	if ( avail <= 0 ) {
+		return(0);
+	}
+	avail = (avail + r->M - 1) / r->M;
+	if ( (Uint64)avail > max_frames ) {
+		avail = (Sint64)max_frames;
+	}
+	frames = (int)avail;
+	if ( frames == 0 ) {
+		return(0);
+	}
+
+	len = frames * stream->channels * stream->samplesize;
+	if ( SDL_StreamReserve(&stream->work, &stream->work_max,
+	                       len * stream->cvt_after.len_mult) < 0 ) {
+		return(-1);
+	}
+	output = stream->work;
+	consumed = 0;
+	phase = stream->phase;
+	for ( c = 0; c < stream->channels; ++c ) {
+		phase = stream->phase;
+		if ( stream->format == AUDIO_F32SYS ) {
+			consumed = SDL_ResampleChannelFloat(r,
+				(const float *)SDL_StreamHistory(stream, c),
+				(float *)output + c, frames, stream->channels, &phase);
+		} else {
+			consumed = SDL_ResampleChannel(r,
+				(const Sint16 *)SDL_StreamHistory(stream, c),
+				(Sint16 *)output + c, frames, stream->channels, &phase);
+		}
+	}
+	stream->phase = phase;
+	stream->total_out += frames;
+
+	/* Drop the history that won't be needed again */
+	stream->history_len -= consumed;
+	for ( c = 0; c < stream->channels; ++c ) {
+		Uint8 *history = SDL_StreamHistory(stream, c);
+		SDL_memmove(history, history + consumed * stream->samplesize,
+		            stream->history_len * stream->samplesize);
+	}
+
+	if ( stream->cvt_after.needed ) {
+		stream->cvt_after.buf = output;
+		stream->cvt_after.len = len;
+		SDL_ConvertAudio(&stream->cvt_after);
+		len = stream->cvt_after.len_cvt;
+	}
+	return SDL_StreamQueue(stream, output, len);
+}
+
+static int SDL_StreamPutFrames(SDL_AudioStream *stream, const Uint8 *data, int frames)
+{
+	int len = frames * stream->src_framesize;
+	int mult = stream->cvt_before.len_mult;
+
+	if ( SDL_StreamReserve(&stream->work, &stream->work_max, len * mult) < 0 ) {
+		return(-1);
+	}
+	SDL_memcpy(stream->work, data, len);
+	if ( stream->cvt_before.needed ) {
+		stream->cvt_before.buf = stream->work;
+		stream->cvt_before.len = len;
+		SDL_ConvertAudio(&stream->cvt_before);
+		len = stream->cvt_before.len_cvt;
+	}
+	if ( ! stream->resampler ) {
+		return SDL_StreamQueue(stream, stream->work, len);
+	}
+
+	if ( SDL_StreamAddHistory(stream, stream->work,
+	             len / (stream->channels * stream->samplesize)) < 0 ) {
+		return(-1);
+	}
+	stream->total_in += frames;
+	return SDL_StreamResample(stream, (Uint64)-1);
+}
+
+static void SDL_StreamReset(SDL_AudioStream *stream)
+{
+	stream->partial_len = 0;
+	stream->queue_head = 0;
+	stream->queue_len = 0;
+	if ( stream->resampler ) {
+		/* Start with silence before the first sample */
+		stream->history_len = 0;
+		SDL_StreamAddHistory(stream, NULL, stream->resampler->taps/2 - 1);
+		stream->phase = 0;
+		stream->total_in = 0;
+		stream->total_out = 0;
+	}
+}
+
+SDL_AudioStream *SDL_NewAudioStream(Uint16 src_format, Uint8 src_channels,
+                                    int src_rate, Uint16 dst_format,
+                                    Uint8 dst_channels, int dst_rate)
+{
+	SDL_AudioStream *stream;
+
+	if ( src_rate <= 0 || dst_rate <= 0 ||
+	     !src_channels || src_channels > 6 ||
+	     !dst_channels || dst_channels > 6 ) {
+		SDL_SetError("Invalid audio stream parameters");
+		return(NULL);
+	}
+	stream = (SDL_AudioStream *)SDL_malloc(sizeof(*stream));
+	if ( stream == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(stream, 0, sizeof(*stream));
+	stream->src_framesize = ((src_format & 0xFF) / 8) * src_channels;
+	stream->dst_framesize = ((dst_format & 0xFF) / 8) * dst_channels;
+	stream->channels = dst_channels;
+
+	if ( src_rate != dst_rate ) {
+		stream->resampler = SDL_AcquireResampler((double)src_rate/dst_rate);
+	}
+	if ( stream->resampler == NULL ) {
+		/* Without a filter table, SDL_BuildAudioCVT() falls back to
+		   the x2 and /2 filters, which work on any amount of data.
+		 */
+		if ( SDL_BuildAudioCVT(&stream->cvt_before,
+		                       src_format, src_channels, src_rate,
+		                       dst_format, dst_channels, dst_rate) < 0 ) {
+			SDL_FreeAudioStream(stream);
+			return(NULL);
+		}
+	} else {
+		/* Keep float samples in float, so they aren't cut to 16 bit */
+		if ( (src_format | dst_format) & 0x0100 ) {
+			stream->format = AUDIO_F32SYS;
+			stream->samplesize = 4;
+		} else {
+			stream->format = AUDIO_S16SYS;
+			stream->samplesize = 2;
+		}
+		if ( SDL_BuildAudioCVT(&stream->cvt_before,
+		                       src_format, src_channels, src_rate,
+		                       stream->format, dst_channels, src_rate) < 0 ||
+		     SDL_BuildAudioCVT(&stream->cvt_after,
+		                       stream->format, dst_channels, dst_rate,
+		                       dst_format, dst_channels, dst_rate) < 0 ) {
+			SDL_FreeAudioStream(stream);
+			return(NULL);
+		}
+	}
+	SDL_StreamReset(stream);
+	return(stream);
+}
+
+int SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len)
+{
+	const Uint8 *data = (const Uint8 *)buf;
+	int frames;
+
+	if ( stream == NULL || (buf == NULL && len > 0) || len < 0 ) {
+		SDL_SetError("Invalid audio stream data");
+		return(-1);
+	}
+
+	/* Finish a frame started by the last put */
+	if ( stream->partial_len > 0 ) {
+		int needed = stream->src_framesize - stream->partial_len;
+		if ( needed > len ) {
+			needed = len;
+		}
+		SDL_memcpy(stream->partial + stream->partial_len, data, needed);
+		stream->partial_len += needed;
+		data += needed;
+		len -= needed;
+		if ( stream->partial_len < stream->src_framesize ) {
+			return(0);
+		}
+		stream->partial_len = 0;
+		if ( SDL_StreamPutFrames(stream, stream->partial, 1) < 0 ) {
+			return(-1);
+		}
+	}
+
+	frames = len / stream->src_framesize;
+	while ( frames > 0 ) {
+		int chunk = frames;
+		if ( chunk > STREAM_CHUNK_FRAMES ) {
+			chunk = STREAM_CHUNK_FRAMES;
+		}
+		if ( SDL_StreamPutFrames(stream, data, chunk) < 0 ) {
+			return(-1);
+		}
+		data += chunk * stream->src_framesize;
+		len -= chunk * stream->src_framesize;
+		frames -= chunk;
+	}
+
+	if ( len > 0 ) {
+		SDL_memcpy(stream->partial, data, len);
+		stream->partial_len = len;
+	}
+	return(0);
+}
+
+int SDL_AudioStreamFlush(SDL_AudioStream *stream)
+{
+	SDL_Resampler *r;
+	Uint64 wanted;
+
+	if ( stream == NULL ) {
+		SDL_SetError("Invalid audio stream");
+		return(-1);
+	}
+	stream->partial_len = 0;
+	r = stream->resampler;
+	if ( r ) {
+		/* Pad with silence to get the output for the last samples */
+		wanted = (stream->total_in * r->L) / r->M;
+		if ( wanted > stream->total_out ) {
+			if ( SDL_StreamAddHistory(stream, NULL, r->taps) < 0 ||
+			     SDL_StreamResample(stream, wanted - stream->total_out) < 0 ) {
+				return(-1);
+			}
+		}
+		/* Further data starts a new stream */
+		stream->history_len = 0;
+		SDL_StreamAddHistory(stream, NULL, r->taps/2 - 1);
+		stream->phase = 0;
+		stream->total_in = 0;
+		stream->total_out = 0;
+	}
+	return(0);
+}
+
+int SDL_AudioStreamAvailable(SDL_AudioStream *stream)
+{
+	if ( stream == NULL ) {
+		return(0);
+	}
+	return(stream->queue_len);
+}
+
+int SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len)
+{
+	if ( stream == NULL || buf == NULL || len < 0 ) {
+		SDL_SetError("Invalid audio stream data");
+		return(-1);
+	}
+	if ( len > stream->queue_len ) {
+		len = stream->queue_len;
+	}
+	/* Only whole frames */
+	len -= len % stream->dst_framesize;
+	SDL_memcpy(buf, stream->queue + stream->queue_head, len);
+	stream->queue_head += len;
+	stream->queue_len -= len;
+	if ( stream->queue_len == 0 ) {
+		stream->queue_head = 0;
+	}
+	return(len);
+}
+
+void SDL_AudioStreamClear(SDL_AudioStream *stream)
+{
+	if ( stream ) {
+		SDL_StreamReset(stream);
+	}
+}
+
+void SDL_FreeAudioStream(SDL_AudioStream *stream)
+{
+	if ( stream ) {
+		if ( stream->work ) {
+			SDL_free(stream->work);
+		}
+		if ( stream->history ) {
+			SDL_free(stream->history);
+		}
+		if ( stream->queue ) {
+			SDL_free(stream->queue);
+		}
+		if ( stream->resampler ) {
+			SDL_ReleaseResampler(stream->resampler);
+		}
+		SDL_free(stream);
+	}
+}
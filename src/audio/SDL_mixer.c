@@ -27,9 +27,8 @@
 #include "SDL_timer.h"
 #include "SDL_audio.h"
 #include "SDL_sysaudio.h"
-#include "SDL_mixer_MMX.h"
-#include "SDL_mixer_MMX_VC.h"
 #include "SDL_mixer_m68k.h"
+#include "../cpuinfo/SDL_simd.h"
 
 /* This table is used to add two sound values together and pin
  * the value to avoid overflow.  (used with permission from ARDI)
@@ -90,6 +89,109 @@ static const Uint8 mix8[] =
 #define ADJUST_VOLUME(s, v)	(s = (s*v)/SDL_MIX_MAXVOLUME)
 #define ADJUST_VOLUME_U8(s, v)	(s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
+/* 32 bit float samples, loaded and stored in either byte order */
+typedef union {
+	Uint32 u32;
+	float f;
+} SDL_MixFloat;
+
+static __inline__ float SDL_MixLoadFloat(const Uint8 *data, int big_endian)
+{
+	SDL_MixFloat bits;
+
+	if ( big_endian ) {
+		bits.u32 = ((Uint32)data[0] << 24) | ((Uint32)data[1] << 16) |
+		           ((Uint32)data[2] << 8) | data[3];
+	} else {
+		bits.u32 = ((Uint32)data[3] << 24) | ((Uint32)data[2] << 16) |
+		           ((Uint32)data[1] << 8) | data[0];
+	}
+	return(bits.f);
+}
+
+static __inline__ void SDL_MixStoreFloat(Uint8 *data, float value, int big_endian)
+{
+	SDL_MixFloat bits;
+
+	bits.f = value;
+	if ( big_endian ) {
+		data[0] = (Uint8)(bits.u32 >> 24);
+		data[1] = (Uint8)(bits.u32 >> 16);
+		data[2] = (Uint8)(bits.u32 >> 8);
+		data[3] = (Uint8)bits.u32;
+	} else {
+		data[0] = (Uint8)bits.u32;
+		data[1] = (Uint8)(bits.u32 >> 8);
+		data[2] = (Uint8)(bits.u32 >> 16);
+		data[3] = (Uint8)(bits.u32 >> 24);
+	}
+}
+
+#if SDL_SSE2_INTRINSICS
+/* These give exactly the same results as the C loops below: the volume
+   is applied with a multiply and a divide rounding toward zero, and the
+   sum is clipped with saturating adds.  They return the bytes mixed.
+ */
+static Uint32 SDL_TARGET_SSE2 SDL_MixAudio_SSE2_S8(Sint8 *dst, const Sint8 *src, Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i round = _mm_set1_epi16(SDL_MIX_MAXVOLUME-1);
+	__m128i s, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i + 16 <= len; i += 16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		lo = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpacklo_epi8(s, s), 8), vol);
+		hi = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpackhi_epi8(s, s), 8), vol);
+		lo = _mm_add_epi16(lo, _mm_and_si128(_mm_srai_epi16(lo, 15), round));
+		hi = _mm_add_epi16(hi, _mm_and_si128(_mm_srai_epi16(hi, 15), round));
+		s = _mm_packs_epi16(_mm_srai_epi16(lo, 7), _mm_srai_epi16(hi, 7));
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_adds_epi8(
+			_mm_loadu_si128((const __m128i *)(dst+i)), s));
+	}
+	return(i);
+}
+
+static Uint32 SDL_TARGET_SSE2 SDL_MixAudio_SSE2_S16LSB(Sint16 *dst, const Sint16 *src, Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi32(volume);
+	const __m128i round = _mm_set1_epi32(SDL_MIX_MAXVOLUME-1);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i s, lo, hi;
+	Uint32 i;
+
+	len /= 2;
+	for ( i = 0; i + 8 <= len; i += 8 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		lo = _mm_madd_epi16(_mm_unpacklo_epi16(s, zero), vol);
+		hi = _mm_madd_epi16(_mm_unpackhi_epi16(s, zero), vol);
+		lo = _mm_add_epi32(lo, _mm_and_si128(_mm_srai_epi32(lo, 31), round));
+		hi = _mm_add_epi32(hi, _mm_and_si128(_mm_srai_epi32(hi, 31), round));
+		s = _mm_packs_epi32(_mm_srai_epi32(lo, 7), _mm_srai_epi32(hi, 7));
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_adds_epi16(
+			_mm_loadu_si128((const __m128i *)(dst+i)), s));
+	}
+	return(i*2);
+}
+
+static Uint32 SDL_TARGET_SSE2 SDL_MixAudio_SSE2_F32LSB(float *dst, const float *src, Uint32 len, float volume)
+{
+	const __m128 vol = _mm_set1_ps(volume);
+	const __m128 maxval = _mm_set1_ps(1.0f);
+	const __m128 minval = _mm_set1_ps(-1.0f);
+	__m128 x;
+	Uint32 i;
+
+	len /= 4;
+	for ( i = 0; i + 4 <= len; i += 4 ) {
+		x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src+i), vol),
+		               _mm_loadu_ps(dst+i));
+		_mm_storeu_ps(dst+i, _mm_max_ps(_mm_min_ps(x, maxval), minval));
+	}
+	return(i*4);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
 void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 {
 	Uint16 format;
@@ -128,22 +230,14 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		break;
 
 		case AUDIO_S8: {
-#if defined(SDL_BUGGY_MMX_MIXERS) /* buggy, so we're disabling them. --ryan. */
-#if defined(__GNUC__) && defined(__i386__) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
-			{
-				SDL_MixAudio_MMX_S8((char*)dst,(char*)src,(unsigned int)len,(int)volume);
-			}
-			else
-#elif ((defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
-			{
-				SDL_MixAudio_MMX_S8_VC((char*)dst,(char*)src,(unsigned int)len,(int)volume);
+#if SDL_SSE2_INTRINSICS
+			if ( volume <= SDL_MIX_MAXVOLUME && SDL_HasSSE2() ) {
+				Uint32 done = SDL_MixAudio_SSE2_S8((Sint8 *)dst, (const Sint8 *)src, len, volume);
+				dst += done;
+				src += done;
+				len -= done;
 			}
-			else
-#endif
 #endif
-
 #if defined(__GNUC__) && (defined(__m68k__) && !defined(__mcoldfire__)) && defined(SDL_ASSEMBLY_ROUTINES)
 			SDL_MixAudio_m68k_S8((char*)dst,(char*)src,(unsigned long)len,(long)volume);
 #else
@@ -177,22 +271,14 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		break;
 
 		case AUDIO_S16LSB: {
-#if defined(SDL_BUGGY_MMX_MIXERS) /* buggy, so we're disabling them. --ryan. */
-#if defined(__GNUC__) && defined(__i386__) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
-			{
-				SDL_MixAudio_MMX_S16((char*)dst,(char*)src,(unsigned int)len,(int)volume);
-			}
-                        else
-#elif ((defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
-			{
-				SDL_MixAudio_MMX_S16_VC((char*)dst,(char*)src,(unsigned int)len,(int)volume);
+#if SDL_SSE2_INTRINSICS
+			if ( volume <= SDL_MIX_MAXVOLUME && SDL_HasSSE2() ) {
+				Uint32 done = SDL_MixAudio_SSE2_S16LSB((Sint16 *)dst, (const Sint16 *)src, len, volume);
+				dst += done;
+				src += done;
+				len -= done;
 			}
-			else
 #endif
-#endif
-
 #if defined(__GNUC__) && (defined(__m68k__) && !defined(__mcoldfire__)) && defined(SDL_ASSEMBLY_ROUTINES)
 			SDL_MixAudio_m68k_S16LSB((short*)dst,(short*)src,(unsigned long)len,(long)volume);
 #else
@@ -256,6 +342,37 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		}
 		break;
 
+		case AUDIO_F32LSB:
+		case AUDIO_F32MSB: {
+			const int big_endian = (format == AUDIO_F32MSB);
+			const float fvolume = (float)volume / SDL_MIX_MAXVOLUME;
+			float dst_sample;
+
+#if SDL_SSE2_INTRINSICS
+			if ( !big_endian && SDL_HasSSE2() ) {
+				Uint32 done = SDL_MixAudio_SSE2_F32LSB((float *)dst, (const float *)src, len, fvolume);
+				dst += done;
+				src += done;
+				len -= done;
+			}
+#endif
+			len /= 4;
+			while ( len-- ) {
+				dst_sample = SDL_MixLoadFloat(src, big_endian) * fvolume +
+				             SDL_MixLoadFloat(dst, big_endian);
+				if ( dst_sample > 1.0f ) {
+					dst_sample = 1.0f;
+				} else
+				if ( dst_sample < -1.0f ) {
+					dst_sample = -1.0f;
+				}
+				SDL_MixStoreFloat(dst, dst_sample, big_endian);
+				src += 4;
+				dst += 4;
+			}
+		}
+		break;
+
 		default: /* If this happens... FIXME! */
 			SDL_SetError("SDL_MixAudio(): unknown audio format");
 			return;
@@ -70,6 +70,9 @@ struct SDL_AudioDevice {
 	/* An audio conversion block for audio format emulation */
 	SDL_AudioCVT convert;
 
+	/* A stream for rate conversion, used by SDL_RunAudio() */
+	SDL_AudioStream *stream;
+
 	/* Current state flags */
 	int enabled;
 	int paused;
@@ -24,235 +24,225 @@
 /* Microsoft WAVE file loading routines */
 
 #include "SDL_audio.h"
+#include "SDL_thread.h"
 #include "SDL_wave.h"
+#include "../thread/SDL_atomic_c.h"
 
 
-static int ReadChunk(SDL_RWops *src, Chunk *chunk);
+static int ReadChunk(SDL_RWops *src, Chunk *chunk, int *lent);
 
-struct MS_ADPCM_decodestate {
-	Uint8 hPredictor;
-	Uint16 iDelta;
-	Sint16 iSamp1;
-	Sint16 iSamp2;
-};
-static struct MS_ADPCM_decoder {
+/* The decoders only keep the format of the file, so they can be used on
+   any number of blocks at once.
+*/
+struct ADPCM_decoder {
 	WaveFMT wavefmt;
 	Uint16 wSamplesPerBlock;
-	Uint16 wNumCoef;
-	Sint16 aCoeff[7][2];
-	/* * * */
-	struct MS_ADPCM_decodestate state[2];
-} MS_ADPCM_state;
+	Uint16 wNumCoef;		/* MS ADPCM only */
+	Sint16 aCoeff[7][2];		/* MS ADPCM only */
+
+	/* Decode one block into wSamplesPerBlock sample frames */
+	int (*decode_block)(const struct ADPCM_decoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded);
+};
+
+#define ADPCM_MAX_AUDIOVAL	((1<<(16-1))-1)
+#define ADPCM_MIN_AUDIOVAL	(-(1<<(16-1)))
+
+/* Store a sample as little endian 16-bit audio */
+#define ADPCM_STORE(decoded, sample)			\
+{							\
+	(decoded)[0] = (Uint8)((sample)&0xFF);		\
+	(decoded)[1] = (Uint8)(((sample)>>8)&0xFF);	\
+}
+
+static void InitADPCM(struct ADPCM_decoder *decoder, WaveFMT *format)
+{
+	decoder->wavefmt.encoding = SDL_SwapLE16(format->encoding);
+	decoder->wavefmt.channels = SDL_SwapLE16(format->channels);
+	decoder->wavefmt.frequency = SDL_SwapLE32(format->frequency);
+	decoder->wavefmt.byterate = SDL_SwapLE32(format->byterate);
+	decoder->wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
+	decoder->wavefmt.bitspersample = SDL_SwapLE16(format->bitspersample);
+}
+
+struct MS_ADPCM_decodestate {
+	Sint32 iDelta;
+	Sint32 iSamp1;
+	Sint32 iSamp2;
+	Sint32 iCoef1;
+	Sint32 iCoef2;
+};
+
+static const Sint32 MS_ADPCM_adaptive[16] = {
+	230, 230, 230, 230, 307, 409, 512, 614,
+	768, 614, 512, 409, 307, 230, 230, 230
+};
 
-static int InitMS_ADPCM(WaveFMT *format)
+/* The nibbles are 4-bit two's complement values */
+static const Sint32 MS_ADPCM_signed[16] = {
+	0, 1, 2, 3, 4, 5, 6, 7, -8, -7, -6, -5, -4, -3, -2, -1
+};
+
+static int MS_ADPCM_decode_block(const struct ADPCM_decoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded);
+
+static int InitMS_ADPCM(struct ADPCM_decoder *decoder,
+				WaveFMT *format, Uint32 fmtlen)
 {
 	Uint8 *rogue_feel;
-	int i;
+	int i, channels, nibbles;
 
 	/* Set the rogue pointer to the MS_ADPCM specific data */
-	MS_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-	MS_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-	MS_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-	MS_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-	MS_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-	MS_ADPCM_state.wavefmt.bitspersample =
-					 SDL_SwapLE16(format->bitspersample);
+	InitADPCM(decoder, format);
+	if ( fmtlen < sizeof(*format)+3*sizeof(Uint16) ) {
+		SDL_SetError("Truncated MS_ADPCM format chunk");
+		return(-1);
+	}
 	rogue_feel = (Uint8 *)format+sizeof(*format);
 	if ( sizeof(*format) == 16 ) {
 		rogue_feel += sizeof(Uint16);
 	}
-	MS_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	decoder->wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
 	rogue_feel += sizeof(Uint16);
-	MS_ADPCM_state.wNumCoef = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	decoder->wNumCoef = ((rogue_feel[1]<<8)|rogue_feel[0]);
 	rogue_feel += sizeof(Uint16);
-	if ( MS_ADPCM_state.wNumCoef != 7 ) {
+	if ( decoder->wNumCoef != 7 ||
+	     fmtlen < sizeof(*format)+3*sizeof(Uint16)+7*2*sizeof(Sint16) ) {
 		SDL_SetError("Unknown set of MS_ADPCM coefficients");
 		return(-1);
 	}
-	for ( i=0; i<MS_ADPCM_state.wNumCoef; ++i ) {
-		MS_ADPCM_state.aCoeff[i][0] = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	for ( i=0; i<decoder->wNumCoef; ++i ) {
+		decoder->aCoeff[i][0] = ((rogue_feel[1]<<8)|rogue_feel[0]);
 		rogue_feel += sizeof(Uint16);
-		MS_ADPCM_state.aCoeff[i][1] = ((rogue_feel[1]<<8)|rogue_feel[0]);
+		decoder->aCoeff[i][1] = ((rogue_feel[1]<<8)|rogue_feel[0]);
 		rogue_feel += sizeof(Uint16);
 	}
+
+	/* Make sure a block holds the samples it claims to */
+	channels = decoder->wavefmt.channels;
+	nibbles = (decoder->wSamplesPerBlock-2)*channels;
+	if ( channels < 1 || channels > 2 || decoder->wSamplesPerBlock < 2 ||
+	     (nibbles % 2) != 0 ||
+	     7*channels+nibbles/2 > decoder->wavefmt.blockalign ) {
+		SDL_SetError("Invalid MS_ADPCM block size");
+		return(-1);
+	}
+	decoder->decode_block = MS_ADPCM_decode_block;
 	return(0);
 }
 
-static Sint32 MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
-					Uint8 nybble, Sint16 *coeff)
+static __inline__ Sint32 MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
+					int nybble)
 {
-	const Sint32 max_audioval = ((1<<(16-1))-1);
-	const Sint32 min_audioval = -(1<<(16-1));
-	const Sint32 adaptive[] = {
-		230, 230, 230, 230, 307, 409, 512, 614,
-		768, 614, 512, 409, 307, 230, 230, 230
-	};
 	Sint32 new_sample, delta;
 
-	new_sample = ((state->iSamp1 * coeff[0]) +
-		      (state->iSamp2 * coeff[1]))/256;
-	if ( nybble & 0x08 ) {
-		new_sample += state->iDelta * (nybble-0x10);
-	} else {
-		new_sample += state->iDelta * nybble;
+	new_sample = ((state->iSamp1 * state->iCoef1) +
+		      (state->iSamp2 * state->iCoef2))/256;
+	new_sample += state->iDelta * MS_ADPCM_signed[nybble];
+	if ( new_sample < ADPCM_MIN_AUDIOVAL ) {
+		new_sample = ADPCM_MIN_AUDIOVAL;
 	}
-	if ( new_sample < min_audioval ) {
-		new_sample = min_audioval;
-	} else
-	if ( new_sample > max_audioval ) {
-		new_sample = max_audioval;
+	if ( new_sample > ADPCM_MAX_AUDIOVAL ) {
+		new_sample = ADPCM_MAX_AUDIOVAL;
 	}
-	delta = ((Sint32)state->iDelta * adaptive[nybble])/256;
+	delta = (state->iDelta * MS_ADPCM_adaptive[nybble]) >> 8;
 	if ( delta < 16 ) {
 		delta = 16;
 	}
 	state->iDelta = (Uint16)delta;
 	state->iSamp2 = state->iSamp1;
-	state->iSamp1 = (Sint16)new_sample;
+	state->iSamp1 = new_sample;
 	return(new_sample);
 }
 
-static int MS_ADPCM_decode(Uint8 **audio_buf, Uint32 *audio_len)
+static int MS_ADPCM_decode_block(const struct ADPCM_decoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded)
 {
-	struct MS_ADPCM_decodestate *state[2];
-	Uint8 *freeable, *encoded, *decoded;
-	Sint32 encoded_len, samplesleft;
-	Sint8 nybble, stereo;
-	Sint16 *coeff[2];
+	struct MS_ADPCM_decodestate state[2];
+	int c, channels, i, predictor;
 	Sint32 new_sample;
+	Uint8 nybbles;
 
-	/* Allocate the proper sized output buffer */
-	encoded_len = *audio_len;
-	encoded = *audio_buf;
-	freeable = *audio_buf;
-	*audio_len = (encoded_len/MS_ADPCM_state.wavefmt.blockalign) * 
-				MS_ADPCM_state.wSamplesPerBlock*
-				MS_ADPCM_state.wavefmt.channels*sizeof(Sint16);
-	*audio_buf = (Uint8 *)SDL_malloc(*audio_len);
-	if ( *audio_buf == NULL ) {
-		SDL_Error(SDL_ENOMEM);
-		return(-1);
-	}
-	decoded = *audio_buf;
-
-	/* Get ready... Go! */
-	stereo = (MS_ADPCM_state.wavefmt.channels == 2);
-	state[0] = &MS_ADPCM_state.state[0];
-	state[1] = &MS_ADPCM_state.state[stereo];
-	while ( encoded_len >= MS_ADPCM_state.wavefmt.blockalign ) {
-		/* Grab the initial information for this block */
-		state[0]->hPredictor = *encoded++;
-		if ( stereo ) {
-			state[1]->hPredictor = *encoded++;
+	/* Grab the initial information for this block */
+	channels = decoder->wavefmt.channels;
+	for ( c=0; c<channels; ++c ) {
+		predictor = encoded[c];
+		if ( predictor >= decoder->wNumCoef ) {
+			return(-1);
 		}
-		state[0]->iDelta = ((encoded[1]<<8)|encoded[0]);
+		state[c].iCoef1 = decoder->aCoeff[predictor][0];
+		state[c].iCoef2 = decoder->aCoeff[predictor][1];
+	}
+	encoded += channels;
+	for ( c=0; c<channels; ++c ) {
+		state[c].iDelta = ((encoded[1]<<8)|encoded[0]);
 		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iDelta = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		state[0]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
+	}
+	for ( c=0; c<channels; ++c ) {
+		state[c].iSamp1 = (Sint16)((encoded[1]<<8)|encoded[0]);
 		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		state[0]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
+	}
+	for ( c=0; c<channels; ++c ) {
+		state[c].iSamp2 = (Sint16)((encoded[1]<<8)|encoded[0]);
 		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		coeff[0] = MS_ADPCM_state.aCoeff[state[0]->hPredictor];
-		coeff[1] = MS_ADPCM_state.aCoeff[state[1]->hPredictor];
+	}
 
-		/* Store the two initial samples we start with */
-		decoded[0] = state[0]->iSamp2&0xFF;
-		decoded[1] = state[0]->iSamp2>>8;
+	/* Store the two initial samples we start with */
+	for ( c=0; c<channels; ++c ) {
+		ADPCM_STORE(decoded, state[c].iSamp2);
 		decoded += 2;
-		if ( stereo ) {
-			decoded[0] = state[1]->iSamp2&0xFF;
-			decoded[1] = state[1]->iSamp2>>8;
-			decoded += 2;
-		}
-		decoded[0] = state[0]->iSamp1&0xFF;
-		decoded[1] = state[0]->iSamp1>>8;
+	}
+	for ( c=0; c<channels; ++c ) {
+		ADPCM_STORE(decoded, state[c].iSamp1);
 		decoded += 2;
-		if ( stereo ) {
-			decoded[0] = state[1]->iSamp1&0xFF;
-			decoded[1] = state[1]->iSamp1>>8;
-			decoded += 2;
-		}
+	}
 
-		/* Decode and store the other samples in this block */
-		samplesleft = (MS_ADPCM_state.wSamplesPerBlock-2)*
-					MS_ADPCM_state.wavefmt.channels;
-		while ( samplesleft > 0 ) {
-			nybble = (*encoded)>>4;
-			new_sample = MS_ADPCM_nibble(state[0],nybble,coeff[0]);
-			decoded[0] = new_sample&0xFF;
-			new_sample >>= 8;
-			decoded[1] = new_sample&0xFF;
-			decoded += 2;
-
-			nybble = (*encoded)&0x0F;
-			new_sample = MS_ADPCM_nibble(state[1],nybble,coeff[1]);
-			decoded[0] = new_sample&0xFF;
-			new_sample >>= 8;
-			decoded[1] = new_sample&0xFF;
-			decoded += 2;
-
-			++encoded;
-			samplesleft -= 2;
+	/* Decode and store the other samples in this block, the high nibble
+	   comes first and goes to the left channel of stereo data.
+	 */
+	if ( channels == 2 ) {
+		for ( i=decoder->wSamplesPerBlock-2; i; --i ) {
+			nybbles = *encoded++;
+			new_sample = MS_ADPCM_nibble(&state[0], nybbles>>4);
+			ADPCM_STORE(decoded, new_sample);
+			new_sample = MS_ADPCM_nibble(&state[1], nybbles&0x0F);
+			ADPCM_STORE(decoded+2, new_sample);
+			decoded += 4;
+		}
+	} else {
+		for ( i=(decoder->wSamplesPerBlock-2)/2; i; --i ) {
+			nybbles = *encoded++;
+			new_sample = MS_ADPCM_nibble(&state[0], nybbles>>4);
+			ADPCM_STORE(decoded, new_sample);
+			new_sample = MS_ADPCM_nibble(&state[0], nybbles&0x0F);
+			ADPCM_STORE(decoded+2, new_sample);
+			decoded += 4;
 		}
-		encoded_len -= MS_ADPCM_state.wavefmt.blockalign;
 	}
-	SDL_free(freeable);
 	return(0);
 }
 
 struct IMA_ADPCM_decodestate {
 	Sint32 sample;
-	Sint8 index;
+	int index;
 };
-static struct IMA_ADPCM_decoder {
-	WaveFMT wavefmt;
-	Uint16 wSamplesPerBlock;
-	/* * * */
-	struct IMA_ADPCM_decodestate state[2];
-} IMA_ADPCM_state;
-
-static int InitIMA_ADPCM(WaveFMT *format)
-{
-	Uint8 *rogue_feel;
 
-	/* Set the rogue pointer to the IMA_ADPCM specific data */
-	IMA_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-	IMA_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-	IMA_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-	IMA_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-	IMA_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-	IMA_ADPCM_state.wavefmt.bitspersample =
-					 SDL_SwapLE16(format->bitspersample);
-	rogue_feel = (Uint8 *)format+sizeof(*format);
-	if ( sizeof(*format) == 16 ) {
-		rogue_feel += sizeof(Uint16);
-	}
-	IMA_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
-	return(0);
-}
+/* The change in the sample and the next step index for every step index
+   and nibble, so decoding a nibble is two lookups and a clamp.
+ */
+static Sint32 IMA_ADPCM_diff[89][16];
+static Uint8 IMA_ADPCM_next[89][16];
+static volatile int IMA_ADPCM_tables = 0;
 
-static Sint32 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,Uint8 nybble)
+static void InitIMA_ADPCM_tables(void)
 {
-	const Sint32 max_audioval = ((1<<(16-1))-1);
-	const Sint32 min_audioval = -(1<<(16-1));
-	const int index_table[16] = {
+	static const int index_table[16] = {
 		-1, -1, -1, -1,
 		 2,  4,  6,  8,
 		-1, -1, -1, -1,
 		 2,  4,  6,  8
 	};
-	const Sint32 step_table[89] = {
+	static const Sint32 step_table[89] = {
 		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
 		34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
 		143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
@@ -263,130 +253,356 @@ static Sint32 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,Uint8 nybble)
 		22385, 24623, 27086, 29794, 32767
 	};
 	Sint32 delta, step;
+	int index, nybble, next;
+
+	if ( IMA_ADPCM_tables ) {
+		SDL_MemoryBarrier();
+		return;
+	}
+	for ( index=0; index<89; ++index ) {
+		step = step_table[index];
+		for ( nybble=0; nybble<16; ++nybble ) {
+			/* Compute difference and new sample value */
+			delta = step >> 3;
+			if ( nybble & 0x04 ) delta += step;
+			if ( nybble & 0x02 ) delta += (step >> 1);
+			if ( nybble & 0x01 ) delta += (step >> 2);
+			if ( nybble & 0x08 ) delta = -delta;
+			IMA_ADPCM_diff[index][nybble] = delta;
+
+			/* Update index value */
+			next = index + index_table[nybble];
+			if ( next > 88 ) {
+				next = 88;
+			} else
+			if ( next < 0 ) {
+				next = 0;
+			}
+			IMA_ADPCM_next[index][nybble] = (Uint8)next;
+		}
+	}
+	SDL_MemoryBarrier();
+	IMA_ADPCM_tables = 1;
+}
+
+static int IMA_ADPCM_decode_block(const struct ADPCM_decoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded);
+
+static int InitIMA_ADPCM(struct ADPCM_decoder *decoder,
+				WaveFMT *format, Uint32 fmtlen)
+{
+	Uint8 *rogue_feel;
+	int channels;
+
+	/* Set the rogue pointer to the IMA_ADPCM specific data */
+	InitADPCM(decoder, format);
+	if ( fmtlen < sizeof(*format)+2*sizeof(Uint16) ) {
+		SDL_SetError("Truncated IMA_ADPCM format chunk");
+		return(-1);
+	}
+	rogue_feel = (Uint8 *)format+sizeof(*format);
+	if ( sizeof(*format) == 16 ) {
+		rogue_feel += sizeof(Uint16);
+	}
+	decoder->wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
+
+	/* Check to make sure we have enough variables in the state array */
+	channels = decoder->wavefmt.channels;
+	if ( channels < 1 || channels > 2 ) {
+		SDL_SetError("IMA ADPCM decoder can only handle %d channels", 2);
+		return(-1);
+	}
+	/* Samples come in groups of 8 per channel after the first one */
+	if ( decoder->wSamplesPerBlock < 1 ||
+	     ((decoder->wSamplesPerBlock-1) % 8) != 0 ||
+	     4*channels+(decoder->wSamplesPerBlock-1)*channels/2 >
+					decoder->wavefmt.blockalign ) {
+		SDL_SetError("Invalid IMA_ADPCM block size");
+		return(-1);
+	}
+	InitIMA_ADPCM_tables();
+	decoder->decode_block = IMA_ADPCM_decode_block;
+	return(0);
+}
 
-	/* Compute difference and new sample value */
-	step = step_table[state->index];
-	delta = step >> 3;
-	if ( nybble & 0x04 ) delta += step;
-	if ( nybble & 0x02 ) delta += (step >> 1);
-	if ( nybble & 0x01 ) delta += (step >> 2);
-	if ( nybble & 0x08 ) delta = -delta;
-	state->sample += delta;
-
-	/* Update index value */
-	state->index += index_table[nybble];
-	if ( state->index > 88 ) {
-		state->index = 88;
-	} else
-	if ( state->index < 0 ) {
-		state->index = 0;
-	}
-
-	/* Clamp output sample */
-	if ( state->sample > max_audioval ) {
-		state->sample = max_audioval;
-	} else
-	if ( state->sample < min_audioval ) {
-		state->sample = min_audioval;
-	}
-	return(state->sample);
+static __inline__ Sint32 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,
+					int nybble)
+{
+	Sint32 sample;
+
+	sample = state->sample + IMA_ADPCM_diff[state->index][nybble];
+	if ( sample > ADPCM_MAX_AUDIOVAL ) {
+		sample = ADPCM_MAX_AUDIOVAL;
+	}
+	if ( sample < ADPCM_MIN_AUDIOVAL ) {
+		sample = ADPCM_MIN_AUDIOVAL;
+	}
+	state->index = IMA_ADPCM_next[state->index][nybble];
+	state->sample = sample;
+	return(sample);
 }
 
-/* Fill the decode buffer with a channel block of data (8 samples) */
-static void Fill_IMA_ADPCM_block(Uint8 *decoded, Uint8 *encoded,
-	int channel, int numchannels, struct IMA_ADPCM_decodestate *state)
+static int IMA_ADPCM_decode_block(const struct ADPCM_decoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded)
 {
-	int i;
-	Sint8 nybble;
+	struct IMA_ADPCM_decodestate state[2];
+	int c, channels, i, groups, stride;
 	Sint32 new_sample;
+	Uint32 nybbles;
+	Uint8 *channel_decoded;
 
-	decoded += (channel * 2);
-	for ( i=0; i<4; ++i ) {
-		nybble = (*encoded)&0x0F;
-		new_sample = IMA_ADPCM_nibble(state, nybble);
-		decoded[0] = new_sample&0xFF;
-		new_sample >>= 8;
-		decoded[1] = new_sample&0xFF;
-		decoded += 2 * numchannels;
+	/* Grab the initial information for this block */
+	channels = decoder->wavefmt.channels;
+	for ( c=0; c<channels; ++c ) {
+		/* Fill the state information for this block */
+		state[c].sample = (Sint16)((encoded[1]<<8)|encoded[0]);
+		state[c].index = encoded[2];
+		if ( state[c].index > 88 ) {
+			return(-1);
+		}
+		/* encoded[3] is reserved, it should be 0 */
+		encoded += 4;
 
-		nybble = (*encoded)>>4;
-		new_sample = IMA_ADPCM_nibble(state, nybble);
-		decoded[0] = new_sample&0xFF;
-		new_sample >>= 8;
-		decoded[1] = new_sample&0xFF;
-		decoded += 2 * numchannels;
+		/* Store the initial sample we start with */
+		ADPCM_STORE(decoded, state[c].sample);
+		decoded += 2;
+	}
 
-		++encoded;
+	/* Each channel has 4 bytes of nibbles in turn, low nibble first,
+	   which decode to 8 samples of that channel.
+	 */
+	stride = channels*2;
+	for ( groups=(decoder->wSamplesPerBlock-1)/8; groups; --groups ) {
+		for ( c=0; c<channels; ++c ) {
+			nybbles = ((Uint32)encoded[3]<<24)|
+			          ((Uint32)encoded[2]<<16)|
+			          ((Uint32)encoded[1]<<8)|encoded[0];
+			encoded += 4;
+			channel_decoded = decoded + c*2;
+			for ( i=0; i<8; ++i ) {
+				new_sample = IMA_ADPCM_nibble(&state[c], nybbles&0x0F);
+				ADPCM_STORE(channel_decoded, new_sample);
+				channel_decoded += stride;
+				nybbles >>= 4;
+			}
+		}
+		decoded += 8*stride;
 	}
+	return(0);
 }
 
-static int IMA_ADPCM_decode(Uint8 **audio_buf, Uint32 *audio_len)
+#if !SDL_THREADS_DISABLED
+/* Large amounts of ADPCM data can be decoded by several threads, each
+   taking a range of blocks.  This is disabled unless the SDL_WAVE_THREADS
+   environment variable is set to the number of threads to use (including
+   the calling thread).  Each thread gets at least SDL_WAVE_THREAD_BLOCKS
+   blocks to decode.
+*/
+#define SDL_MAX_WAVE_THREADS	16
+#define SDL_WAVE_THREAD_BLOCKS	64
+
+typedef struct {
+	const struct ADPCM_decoder *decoder;
+	const Uint8 *encoded;
+	Uint8 *decoded;
+	int blocks;
+	int result;
+	SDL_Thread *thread;
+} ADPCM_job;
+#endif
+
+/* Decode a run of blocks, returns -1 if any of them is corrupt */
+static int ADPCM_decode_blocks(const struct ADPCM_decoder *decoder,
+			const Uint8 *encoded, Uint8 *decoded, int blocks)
 {
-	struct IMA_ADPCM_decodestate *state;
-	Uint8 *freeable, *encoded, *decoded;
-	Sint32 encoded_len, samplesleft;
-	unsigned int c, channels;
+	int blocksize;
 
-	/* Check to make sure we have enough variables in the state array */
-	channels = IMA_ADPCM_state.wavefmt.channels;
-	if ( channels > SDL_arraysize(IMA_ADPCM_state.state) ) {
-		SDL_SetError("IMA ADPCM decoder can only handle %d channels",
-					SDL_arraysize(IMA_ADPCM_state.state));
-		return(-1);
+	blocksize = decoder->wSamplesPerBlock*
+				decoder->wavefmt.channels*sizeof(Sint16);
+	while ( blocks-- ) {
+		if ( decoder->decode_block(decoder, encoded, decoded) < 0 ) {
+			return(-1);
+		}
+		encoded += decoder->wavefmt.blockalign;
+		decoded += blocksize;
+	}
+	return(0);
+}
+
+#if !SDL_THREADS_DISABLED
+static int ADPCM_decode_thread(void *data)
+{
+	ADPCM_job *job = (ADPCM_job *)data;
+
+	job->result = ADPCM_decode_blocks(job->decoder,
+				job->encoded, job->decoded, job->blocks);
+	return(0);
+}
+
+/* Split the blocks between threads, the calling thread doing the first
+   range, returns -1 if any of them is corrupt.
+ */
+static int ADPCM_decode_threaded(const struct ADPCM_decoder *decoder,
+			const Uint8 *encoded, Uint8 *decoded, int blocks)
+{
+	ADPCM_job jobs[SDL_MAX_WAVE_THREADS];
+	const char *env;
+	int nthreads, blocksize;
+	int i, first, result;
+
+	env = SDL_getenv("SDL_WAVE_THREADS");
+	nthreads = env ? SDL_atoi(env) : 0;
+	if ( nthreads > SDL_MAX_WAVE_THREADS ) {
+		nthreads = SDL_MAX_WAVE_THREADS;
+	}
+	if ( nthreads > blocks / SDL_WAVE_THREAD_BLOCKS ) {
+		nthreads = blocks / SDL_WAVE_THREAD_BLOCKS;
+	}
+	if ( nthreads <= 1 ) {
+		return ADPCM_decode_blocks(decoder, encoded, decoded, blocks);
+	}
+
+	blocksize = decoder->wSamplesPerBlock*
+				decoder->wavefmt.channels*sizeof(Sint16);
+	first = 0;
+	for ( i=0; i<nthreads; ++i ) {
+		ADPCM_job *job = &jobs[i];
+
+		job->decoder = decoder;
+		job->encoded = encoded + first*decoder->wavefmt.blockalign;
+		job->decoded = decoded + first*blocksize;
+		job->blocks = blocks/nthreads + (i < blocks%nthreads);
+		job->result = 0;
+		job->thread = NULL;
+		first += job->blocks;
+	}
+
+	/* If a thread can't be started, its blocks are decoded here */
+	for ( i=1; i<nthreads; ++i ) {
+		jobs[i].thread = SDL_CreateThread(ADPCM_decode_thread, &jobs[i]);
+	}
+	ADPCM_decode_thread(&jobs[0]);
+	result = jobs[0].result;
+	for ( i=1; i<nthreads; ++i ) {
+		if ( jobs[i].thread ) {
+			SDL_WaitThread(jobs[i].thread, NULL);
+		} else {
+			ADPCM_decode_thread(&jobs[i]);
+		}
+		if ( jobs[i].result < 0 ) {
+			result = -1;
+		}
 	}
-	state = IMA_ADPCM_state.state;
+	return(result);
+}
+#endif /* !SDL_THREADS_DISABLED */
+
+static int ADPCM_decode(const struct ADPCM_decoder *decoder,
+			Uint8 **audio_buf, Uint32 *audio_len, int freesrc)
+{
+	Uint8 *freeable, *encoded;
+	int blocks, result;
 
 	/* Allocate the proper sized output buffer */
-	encoded_len = *audio_len;
 	encoded = *audio_buf;
 	freeable = *audio_buf;
-	*audio_len = (encoded_len/IMA_ADPCM_state.wavefmt.blockalign) * 
-				IMA_ADPCM_state.wSamplesPerBlock*
-				IMA_ADPCM_state.wavefmt.channels*sizeof(Sint16);
+	blocks = *audio_len / decoder->wavefmt.blockalign;
+	*audio_len = blocks * decoder->wSamplesPerBlock*
+				decoder->wavefmt.channels*sizeof(Sint16);
 	*audio_buf = (Uint8 *)SDL_malloc(*audio_len);
 	if ( *audio_buf == NULL ) {
 		SDL_Error(SDL_ENOMEM);
-		return(-1);
+		result = -1;
+	} else {
+		/* Get ready... Go! */
+#if !SDL_THREADS_DISABLED
+		result = ADPCM_decode_threaded(decoder,
+					encoded, *audio_buf, blocks);
+#else
+		result = ADPCM_decode_blocks(decoder,
+					encoded, *audio_buf, blocks);
+#endif
+		if ( result < 0 ) {
+			SDL_SetError("Corrupt ADPCM data");
+			SDL_free(*audio_buf);
+			*audio_buf = NULL;
+		}
 	}
-	decoded = *audio_buf;
+	if ( freesrc ) {
+		SDL_free(freeable);
+	}
+	return(result);
+}
 
-	/* Get ready... Go! */
-	while ( encoded_len >= IMA_ADPCM_state.wavefmt.blockalign ) {
-		/* Grab the initial information for this block */
-		for ( c=0; c<channels; ++c ) {
-			/* Fill the state information for this block */
-			state[c].sample = ((encoded[1]<<8)|encoded[0]);
-			encoded += 2;
-			if ( state[c].sample & 0x8000 ) {
-				state[c].sample -= 0x10000;
+/* Check the format chunk, set up the ADPCM decoder if there is one, and
+   fill in the audio spec the data decodes to.
+   Returns the encoding, or -1 if it isn't supported.
+ */
+static int InitWAVFormat(WaveFMT *format, Uint32 fmtlen, SDL_AudioSpec *spec,
+				struct ADPCM_decoder *ADPCM_state)
+{
+	int encoding;
+
+	if ( fmtlen < sizeof(*format) ) {
+		SDL_SetError("Truncated WAVE format chunk");
+		return(-1);
+	}
+	encoding = SDL_SwapLE16(format->encoding);
+	switch (encoding) {
+		case PCM_CODE:
+			/* We can understand this */
+			break;
+		case MS_ADPCM_CODE:
+			/* Try to understand this */
+			if ( InitMS_ADPCM(ADPCM_state, format, fmtlen) < 0 ) {
+				return(-1);
 			}
-			state[c].index = *encoded++;
-			/* Reserved byte in buffer header, should be 0 */
-			if ( *encoded++ != 0 ) {
-				/* Uh oh, corrupt data?  Buggy code? */;
+			break;
+		case IMA_ADPCM_CODE:
+			/* Try to understand this */
+			if ( InitIMA_ADPCM(ADPCM_state, format, fmtlen) < 0 ) {
+				return(-1);
 			}
-
-			/* Store the initial sample we start with */
-			decoded[0] = (Uint8)(state[c].sample&0xFF);
-			decoded[1] = (Uint8)(state[c].sample>>8);
-			decoded += 2;
-		}
-
-		/* Decode and store the other samples in this block */
-		samplesleft = (IMA_ADPCM_state.wSamplesPerBlock-1)*channels;
-		while ( samplesleft > 0 ) {
-			for ( c=0; c<channels; ++c ) {
-				Fill_IMA_ADPCM_block(decoded, encoded,
-						c, channels, &state[c]);
-				encoded += 4;
-				samplesleft -= 8;
+			break;
+		case MP3_CODE:
+			SDL_SetError("MPEG Layer 3 data not supported");
+			return(-1);
+		default:
+			SDL_SetError("Unknown WAVE data format: 0x%.4x", encoding);
+			return(-1);
+	}
+	SDL_memset(spec, 0, (sizeof *spec));
+	spec->freq = SDL_SwapLE32(format->frequency);
+	switch (SDL_SwapLE16(format->bitspersample)) {
+		case 4:
+			if ( encoding != PCM_CODE ) {
+				spec->format = AUDIO_S16;
+			} else {
+				encoding = -1;
 			}
-			decoded += (channels * 8 * 2);
-		}
-		encoded_len -= IMA_ADPCM_state.wavefmt.blockalign;
+			break;
+		case 8:
+			spec->format = AUDIO_U8;
+			break;
+		case 16:
+			spec->format = AUDIO_S16;
+			break;
+		default:
+			encoding = -1;
+			break;
 	}
-	SDL_free(freeable);
-	return(0);
+	if ( encoding < 0 ) {
+		SDL_SetError("Unknown %d-bit PCM data format",
+			SDL_SwapLE16(format->bitspersample));
+		return(-1);
+	}
+	spec->channels = (Uint8)SDL_SwapLE16(format->channels);
+	if ( spec->channels == 0 ) {
+		SDL_SetError("WAVE file has no audio channels");
+		return(-1);
+	}
+	spec->samples = 4096;		/* Good default buffer size */
+	return(encoding);
 }
 
 SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
@@ -395,8 +611,10 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 	int was_error;
 	Chunk chunk;
 	int lenread;
-	int MS_ADPCM_encoded, IMA_ADPCM_encoded;
+	int encoding, ADPCM_encoded;
+	struct ADPCM_decoder ADPCM_state;
 	int samplesize;
+	int lent = 0;
 
 	/* WAV magic header */
 	Uint32 RIFFchunk;
@@ -413,6 +631,15 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 		was_error = 1;
 		goto done;
 	}
+
+	/* Read sources we own through a buffer, unless they're in memory */
+	if ( freesrc && !SDL_RWborrow(src, 0) ) {
+		src = SDL_BufferRW(src, 0, 1);
+		if ( src == NULL ) {
+			was_error = 1;
+			goto done;
+		}
+	}
 		
 	/* Check the magic header */
 	RIFFchunk	= SDL_ReadLE32(src);
@@ -438,7 +665,7 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 			SDL_free(chunk.data);
 			chunk.data = NULL;
 		}
-		lenread = ReadChunk(src, &chunk);
+		lenread = ReadChunk(src, &chunk, NULL);
 		if ( lenread < 0 ) {
 			was_error = 1;
 			goto done;
@@ -454,65 +681,12 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 		was_error = 1;
 		goto done;
 	}
-	MS_ADPCM_encoded = IMA_ADPCM_encoded = 0;
-	switch (SDL_SwapLE16(format->encoding)) {
-		case PCM_CODE:
-			/* We can understand this */
-			break;
-		case MS_ADPCM_CODE:
-			/* Try to understand this */
-			if ( InitMS_ADPCM(format) < 0 ) {
-				was_error = 1;
-				goto done;
-			}
-			MS_ADPCM_encoded = 1;
-			break;
-		case IMA_ADPCM_CODE:
-			/* Try to understand this */
-			if ( InitIMA_ADPCM(format) < 0 ) {
-				was_error = 1;
-				goto done;
-			}
-			IMA_ADPCM_encoded = 1;
-			break;
-		case MP3_CODE:
-			SDL_SetError("MPEG Layer 3 data not supported",
-					SDL_SwapLE16(format->encoding));
-			was_error = 1;
-			goto done;
-		default:
-			SDL_SetError("Unknown WAVE data format: 0x%.4x",
-					SDL_SwapLE16(format->encoding));
-			was_error = 1;
-			goto done;
-	}
-	SDL_memset(spec, 0, (sizeof *spec));
-	spec->freq = SDL_SwapLE32(format->frequency);
-	switch (SDL_SwapLE16(format->bitspersample)) {
-		case 4:
-			if ( MS_ADPCM_encoded || IMA_ADPCM_encoded ) {
-				spec->format = AUDIO_S16;
-			} else {
-				was_error = 1;
-			}
-			break;
-		case 8:
-			spec->format = AUDIO_U8;
-			break;
-		case 16:
-			spec->format = AUDIO_S16;
-			break;
-		default:
-			was_error = 1;
-			break;
-	}
-	if ( was_error ) {
-		SDL_SetError("Unknown %d-bit PCM data format",
-			SDL_SwapLE16(format->bitspersample));
+	encoding = InitWAVFormat(format, chunk.length, spec, &ADPCM_state);
+	if ( encoding < 0 ) {
+		was_error = 1;
 		goto done;
 	}
-	spec->channels = (Uint8)SDL_SwapLE16(format->channels);
-	spec->samples = 4096;		/* Good default buffer size */
+	ADPCM_encoded = (encoding != PCM_CODE);
 
 	/* Read the audio data chunk */
 	*audio_buf = NULL;
@@ -521,7 +695,9 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 			SDL_free(*audio_buf);
 			*audio_buf = NULL;
 		}
-		lenread = ReadChunk(src, &chunk);
+		/* Compressed data is decoded in place from memory sources */
+		lenread = ReadChunk(src, &chunk,
+		                    ADPCM_encoded ? &lent : NULL);
 		if ( lenread < 0 ) {
 			was_error = 1;
 			goto done;
@@ -532,14 +708,8 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 	} while ( chunk.magic != DATA );
 	headerDiff += 2 * sizeof(Uint32); /* for the data chunk and len */
 
-	if ( MS_ADPCM_encoded ) {
-		if ( MS_ADPCM_decode(audio_buf, audio_len) < 0 ) {
-			was_error = 1;
-			goto done;
-		}
-	}
-	if ( IMA_ADPCM_encoded ) {
-		if ( IMA_ADPCM_decode(audio_buf, audio_len) < 0 ) {
+	if ( ADPCM_encoded ) {
+		if ( ADPCM_decode(&ADPCM_state, audio_buf, audio_len, !lent) < 0 ) {
 			was_error = 1;
 			goto done;
 		}
@@ -577,10 +747,308 @@ void SDL_FreeWAV(Uint8 *audio_buf)
 	}
 }
 
-static int ReadChunk(SDL_RWops *src, Chunk *chunk)
+/* A WAVE file being decoded a block at a time */
+struct SDL_WAVStream {
+	SDL_RWops *src;
+	int freesrc;
+	int encoding;
+	struct ADPCM_decoder ADPCM_state;
+	Sint64 data_start;	/* Offset of the audio data in the source */
+	int framesize;		/* Bytes in a decoded sample frame */
+	int blockalign;		/* Bytes in an encoded block */
+	int blockframes;	/* Sample frames in an encoded block */
+	Uint32 frames;		/* Sample frames in the data chunk */
+	Uint32 position;	/* The current sample frame */
+	Uint8 *encoded;		/* One encoded block */
+	Uint8 *decoded;		/* One decoded block */
+	int decoded_pos;	/* Bytes of the decoded block already read */
+	int decoded_len;	/* Bytes in the decoded block */
+};
+
+static int DecodeWAVBlock(SDL_WAVStream *stream, Uint8 *decoded)
+{
+	if ( SDL_RWread(stream->src, stream->encoded,
+	                stream->blockalign, 1) != 1 ) {
+		SDL_Error(SDL_EFREAD);
+		return(-1);
+	}
+	if ( stream->ADPCM_state.decode_block(&stream->ADPCM_state,
+	                                      stream->encoded, decoded) < 0 ) {
+		SDL_SetError("Corrupt ADPCM data");
+		return(-1);
+	}
+	return(0);
+}
+
+SDL_WAVStream * SDL_OpenWAV_RW(SDL_RWops *src, int freesrc, SDL_AudioSpec *spec)
+{
+	SDL_WAVStream *stream;
+	Uint32 header[3];
+	Uint32 magic, length;
+	WaveFMT *format = NULL;
+	Uint32 fmtlen = 0;
+	Sint64 size;
+
+	if ( src == NULL ) {
+		return(NULL);
+	}
+
+	/* Read sources we own through a buffer, unless they're in memory */
+	if ( freesrc && !SDL_RWborrow(src, 0) ) {
+		src = SDL_BufferRW(src, 0, 1);
+		if ( src == NULL ) {
+			return(NULL);
+		}
+	}
+
+	stream = (SDL_WAVStream *)SDL_malloc(sizeof(*stream));
+	if ( stream == NULL ) {
+		SDL_OutOfMemory();
+		goto error;
+	}
+	SDL_memset(stream, 0, sizeof(*stream));
+	stream->src = src;
+	stream->freesrc = freesrc;
+
+	/* Check the magic header */
+	if ( SDL_RWread(src, header, sizeof(header), 1) != 1 ||
+	     SDL_SwapLE32(header[0]) != RIFF ||
+	     SDL_SwapLE32(header[2]) != WAVE ) {
+		SDL_SetError("Unrecognized file type (not WAVE)");
+		goto error;
+	}
+
+	/* Find the format and the audio data, skipping other chunks */
+	for ( ; ; ) {
+		if ( SDL_RWread(src, header, 2*sizeof(Uint32), 1) != 1 ) {
+			SDL_SetError("WAVE file has no audio data");
+			goto error;
+		}
+		magic = SDL_SwapLE32(header[0]);
+		length = SDL_SwapLE32(header[1]);
+		if ( magic == DATA ) {
+			break;
+		}
+		if ( magic == FMT && format == NULL ) {
+			format = (WaveFMT *)SDL_malloc(length);
+			if ( format == NULL ) {
+				SDL_OutOfMemory();
+				goto error;
+			}
+			if ( SDL_RWread(src, format, length, 1) != 1 ) {
+				SDL_Error(SDL_EFREAD);
+				goto error;
+			}
+			fmtlen = length;
+			/* Chunks are padded to an even length */
+			length &= 1;
+		} else {
+			length += (length & 1);
+		}
+		if ( length && SDL_RWseek64(src, length, RW_SEEK_CUR) < 0 ) {
+			goto error;
+		}
+	}
+	if ( format == NULL ) {
+		SDL_SetError("WAVE file has no format chunk");
+		goto error;
+	}
+	stream->encoding = InitWAVFormat(format, fmtlen, spec,
+					&stream->ADPCM_state);
+	if ( stream->encoding < 0 ) {
+		goto error;
+	}
+	SDL_free(format);
+	format = NULL;
+
+	/* Files written while recording may not have the real data length */
+	stream->data_start = SDL_RWtell64(src);
+	if ( stream->data_start < 0 ) {
+		goto error;
+	}
+	size = SDL_RWsize64(src);
+	if ( size >= stream->data_start && size-stream->data_start < length ) {
+		length = (Uint32)(size-stream->data_start);
+	}
+
+	stream->framesize = ((spec->format & 0xFF)/8)*spec->channels;
+	if ( stream->encoding == PCM_CODE ) {
+		stream->blockalign = stream->framesize;
+		stream->blockframes = 1;
+	} else {
+		stream->blockalign = stream->ADPCM_state.wavefmt.blockalign;
+		stream->blockframes = stream->ADPCM_state.wSamplesPerBlock;
+		stream->encoded = (Uint8 *)SDL_malloc(stream->blockalign);
+		stream->decoded = (Uint8 *)SDL_malloc(stream->blockframes *
+		                                      stream->framesize);
+		if ( !stream->encoded || !stream->decoded ) {
+			SDL_OutOfMemory();
+			goto error;
+		}
+	}
+	stream->frames = (length / stream->blockalign) * stream->blockframes;
+	return(stream);
+
+error:
+	if ( format != NULL ) {
+		SDL_free(format);
+	}
+	if ( stream != NULL ) {
+		stream->freesrc = 0;
+		SDL_CloseWAV(stream);
+	}
+	if ( freesrc ) {
+		SDL_RWclose(src);
+	}
+	return(NULL);
+}
+
+int SDL_ReadWAV(SDL_WAVStream *stream, Uint8 *buf, int len)
+{
+	int total, amount, blocksize;
+
+	if ( stream == NULL || buf == NULL || len < 0 ) {
+		SDL_SetError("Invalid WAVE stream read parameters");
+		return(-1);
+	}
+	len -= (len % stream->framesize);
+	if ( (Uint32)(len / stream->framesize) > stream->frames-stream->position ) {
+		len = (stream->frames-stream->position) * stream->framesize;
+	}
+
+	/* Raw data is read straight into the buffer */
+	if ( stream->encoding == PCM_CODE ) {
+		total = 0;
+		while ( total < len ) {
+			amount = SDL_RWread(stream->src, buf+total, 1, len-total);
+			if ( amount <= 0 ) {
+				break;
+			}
+			total += amount;
+		}
+		if ( total < len ) {
+			/* The file is shorter than it says, stop here */
+			if ( total == 0 && amount < 0 ) {
+				return(-1);
+			}
+			total -= (total % stream->framesize);
+			stream->frames = stream->position +
+			                 total / stream->framesize;
+		}
+		stream->position += total / stream->framesize;
+		return(total);
+	}
+
+	/* Whole blocks are decoded straight into the buffer */
+	blocksize = stream->blockframes * stream->framesize;
+	total = 0;
+	while ( total < len ) {
+		if ( stream->decoded_pos < stream->decoded_len ) {
+			amount = stream->decoded_len - stream->decoded_pos;
+			if ( amount > len-total ) {
+				amount = len-total;
+			}
+			SDL_memcpy(buf+total,
+			           stream->decoded+stream->decoded_pos, amount);
+			stream->decoded_pos += amount;
+			total += amount;
+		} else if ( len-total >= blocksize ) {
+			if ( DecodeWAVBlock(stream, buf+total) < 0 ) {
+				break;
+			}
+			total += blocksize;
+		} else {
+			if ( DecodeWAVBlock(stream, stream->decoded) < 0 ) {
+				break;
+			}
+			stream->decoded_pos = 0;
+			stream->decoded_len = blocksize;
+		}
+	}
+	stream->position += total / stream->framesize;
+	if ( total == 0 && len > 0 ) {
+		return(-1);
+	}
+	return(total);
+}
+
+int SDL_SeekWAV(SDL_WAVStream *stream, Uint32 frame)
+{
+	Uint32 block;
+
+	if ( stream == NULL ) {
+		SDL_SetError("Passed a NULL WAVE stream");
+		return(-1);
+	}
+	if ( frame > stream->frames ) {
+		SDL_SetError("Seek past the end of the WAVE data");
+		return(-1);
+	}
+	block = frame / stream->blockframes;
+	if ( SDL_RWseek64(stream->src,
+	                  stream->data_start + (Sint64)block*stream->blockalign,
+	                  RW_SEEK_SET) < 0 ) {
+		return(-1);
+	}
+	stream->position = frame;
+	stream->decoded_pos = stream->decoded_len = 0;
+
+	/* Decode the block we're in the middle of now */
+	if ( frame % stream->blockframes ) {
+		if ( DecodeWAVBlock(stream, stream->decoded) < 0 ) {
+			return(-1);
+		}
+		stream->decoded_pos = (frame % stream->blockframes) *
+		                      stream->framesize;
+		stream->decoded_len = stream->blockframes * stream->framesize;
+	}
+	return(0);
+}
+
+Uint32 SDL_TellWAV(SDL_WAVStream *stream)
+{
+	if ( stream == NULL ) {
+		return(0);
+	}
+	return(stream->position);
+}
+
+Uint32 SDL_WAVLength(SDL_WAVStream *stream)
+{
+	if ( stream == NULL ) {
+		return(0);
+	}
+	return(stream->frames);
+}
+
+void SDL_CloseWAV(SDL_WAVStream *stream)
+{
+	if ( stream != NULL ) {
+		if ( stream->freesrc ) {
+			SDL_RWclose(stream->src);
+		}
+		if ( stream->encoded ) {
+			SDL_free(stream->encoded);
+		}
+		if ( stream->decoded ) {
+			SDL_free(stream->decoded);
+		}
+		SDL_free(stream);
+	}
+}
+
+/* If 'lent' is set, the data chunk may be borrowed from the source */
+static int ReadChunk(SDL_RWops *src, Chunk *chunk, int *lent)
 {
 	chunk->magic	= SDL_ReadLE32(src);
 	chunk->length	= SDL_ReadLE32(src);
+	if ( lent && chunk->magic == DATA && (int)chunk->length >= 0 ) {
+		chunk->data = (Uint8 *)SDL_RWborrow(src, chunk->length);
+		if ( chunk->data != NULL ) {
+			*lent = 1;
+			return(chunk->length);
+		}
+	}
 	chunk->data = (Uint8 *)SDL_malloc(chunk->length);
 	if ( chunk->data == NULL ) {
 		SDL_Error(SDL_ENOMEM);
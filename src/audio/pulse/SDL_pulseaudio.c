@@ -443,6 +443,12 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 			case AUDIO_S16MSB:
 				paspec.format = PA_SAMPLE_S16BE;
 				break;
+			case AUDIO_F32LSB:
+				paspec.format = PA_SAMPLE_FLOAT32LE;
+				break;
+			case AUDIO_F32MSB:
+				paspec.format = PA_SAMPLE_FLOAT32BE;
+				break;
 		}
 		if ( paspec.format != PA_SAMPLE_INVALID )
 			break;
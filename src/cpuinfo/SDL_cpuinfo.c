@@ -25,6 +25,7 @@
 
 #include "SDL.h"
 #include "SDL_cpuinfo.h"
+#include "SDL_cpuinfo_c.h"
 
 #if defined(__MACOSX__) && (defined(__ppc__) || defined(__ppc64__))
 #include <sys/sysctl.h> /* For AltiVec check */
@@ -32,6 +33,10 @@
 #include <signal.h>
 #include <setjmp.h>
 #endif
+#if defined(_MSC_VER) && (_MSC_VER >= 1600) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#include <immintrin.h> /* For _xgetbv() */
+#endif
 
 #define CPU_HAS_RDTSC	0x00000001
 #define CPU_HAS_MMX	0x00000002
@@ -41,6 +46,8 @@
 #define CPU_HAS_SSE	0x00000040
 #define CPU_HAS_SSE2	0x00000080
 #define CPU_HAS_ALTIVEC	0x00000100
+#define CPU_HAS_AVX2	0x00000200
+#define CPU_HAS_INVARIANT_TSC	0x00000400
 
 #if SDL_ALTIVEC_BLITTERS && HAVE_SETJMP && !__MACOSX__
 /* This is the brute force way of detecting instruction sets...
@@ -356,6 +363,95 @@ static __inline__ int CPU_haveSSE2(void)
 	return 0;
 }
 
+#if defined(__GNUC__) && (defined(i386) || defined(__x86_64__))
+/* %ebx may be the PIC register, so preserve it in %esi */
+#if defined(__x86_64__)
+#define cpuid(func, a, b, c, d) \
+	__asm__ __volatile__ ( \
+"        movq    %%rbx, %%rsi        \n" \
+"        cpuid                       \n" \
+"        xchgq   %%rbx, %%rsi        \n" \
+	: "=a" (a), "=S" (b), "=c" (c), "=d" (d) : "a" (func), "c" (0))
+#else
+#define cpuid(func, a, b, c, d) \
+	__asm__ __volatile__ ( \
+"        movl    %%ebx, %%esi        \n" \
+"        cpuid                       \n" \
+"        xchgl   %%ebx, %%esi        \n" \
+	: "=a" (a), "=S" (b), "=c" (c), "=d" (d) : "a" (func), "c" (0))
+#endif
+#endif
+
+static __inline__ int CPU_haveAVX2(void)
+{
+	int has_AVX2 = 0;
+#if defined(__GNUC__) && (defined(i386) || defined(__x86_64__))
+	unsigned int a, b, c, d;
+	unsigned int xcr0 = 0;
+
+	if ( !CPU_haveCPUID() ) {
+		return 0;
+	}
+	cpuid(0, a, b, c, d);
+	if ( a >= 7 ) {
+		cpuid(1, a, b, c, d);
+		/* Need AVX and OSXSAVE, so the OS saves the YMM registers */
+		if ( (c & 0x18000000) == 0x18000000 ) {
+			__asm__ __volatile__ (
+"        .byte   0x0f, 0x01, 0xd0    # xgetbv                          \n"
+			: "=a" (xcr0), "=d" (d) : "c" (0));
+			if ( (xcr0 & 0x06) == 0x06 ) {
+				cpuid(7, a, b, c, d);
+				has_AVX2 = (b & 0x00000020);
+			}
+		}
+	}
+#elif defined(_MSC_VER) && (_MSC_VER >= 1600) && (defined(_M_IX86) || defined(_M_X64))
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if ( regs[0] >= 7 ) {
+		__cpuid(regs, 1);
+		/* Need AVX and OSXSAVE, so the OS saves the YMM registers */
+		if ( (regs[2] & 0x18000000) == 0x18000000 &&
+		     (_xgetbv(0) & 0x06) == 0x06 ) {
+			__cpuidex(regs, 7, 0);
+			has_AVX2 = (regs[1] & 0x00000020);
+		}
+	}
+#endif
+	return has_AVX2;
+}
+
+static __inline__ int CPU_haveInvariantTSC(void)
+{
+	int has_InvariantTSC = 0;
+#if defined(__GNUC__) && (defined(i386) || defined(__x86_64__))
+	unsigned int a, b, c, d;
+
+	if ( !CPU_haveRDTSC() ) {
+		return 0;
+	}
+	cpuid(0x80000000, a, b, c, d);
+	if ( a >= 0x80000007 ) {
+		cpuid(0x80000007, a, b, c, d);
+		has_InvariantTSC = (d & 0x00000100);
+	}
+#elif defined(_MSC_VER) && (_MSC_VER >= 1600) && (defined(_M_IX86) || defined(_M_X64))
+	int regs[4];
+
+	if ( !CPU_haveRDTSC() ) {
+		return 0;
+	}
+	__cpuid(regs, 0x80000000);
+	if ( (unsigned int)regs[0] >= 0x80000007 ) {
+		__cpuid(regs, 0x80000007);
+		has_InvariantTSC = (regs[3] & 0x00000100);
+	}
+#endif
+	return has_InvariantTSC;
+}
+
 static __inline__ int CPU_haveAltiVec(void)
 {
 	volatile int altivec = 0;
@@ -383,6 +479,47 @@ static __inline__ int CPU_haveAltiVec(void)
 
 static Uint32 SDL_CPUFeatures = 0xFFFFFFFF;
 
+/* Features that can be turned off with SDL_CPU_DISABLE */
+static const struct {
+	const char *name;
+	Uint32 feature;
+} SDL_CPUFeatureNames[] = {
+	{ "mmx", CPU_HAS_MMX },
+	{ "mmxext", CPU_HAS_MMXEXT },
+	{ "3dnow", CPU_HAS_3DNOW },
+	{ "3dnowext", CPU_HAS_3DNOWEXT },
+	{ "sse", CPU_HAS_SSE },
+	{ "sse2", CPU_HAS_SSE2 },
+	{ "altivec", CPU_HAS_ALTIVEC },
+	{ "avx2", CPU_HAS_AVX2 }
+};
+
+static Uint32 SDL_GetDisabledCPUFeatures(void)
+{
+	const char *list = SDL_getenv("SDL_CPU_DISABLE");
+	Uint32 disabled = 0;
+	size_t len;
+	int i;
+
+	while ( list && *list ) {
+		len = 0;
+		while ( list[len] && list[len] != ',' ) {
+			++len;
+		}
+		for ( i=0; i<(int)SDL_arraysize(SDL_CPUFeatureNames); ++i ) {
+			if ( SDL_strlen(SDL_CPUFeatureNames[i].name) == len &&
+			     SDL_strncasecmp(list, SDL_CPUFeatureNames[i].name, len) == 0 ) {
+				disabled |= SDL_CPUFeatureNames[i].feature;
+			}
+		}
+		list += len;
+		if ( *list == ',' ) {
+			++list;
+		}
+	}
+	return disabled;
+}
+
 static Uint32 SDL_GetCPUFeatures(void)
 {
 	if ( SDL_CPUFeatures == 0xFFFFFFFF ) {
@@ -411,6 +548,13 @@ static Uint32 SDL_GetCPUFeatures(void)
 		if ( CPU_haveAltiVec() ) {
 			SDL_CPUFeatures |= CPU_HAS_ALTIVEC;
 		}
+		if ( CPU_haveAVX2() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX2;
+		}
+		if ( CPU_haveInvariantTSC() ) {
+			SDL_CPUFeatures |= CPU_HAS_INVARIANT_TSC;
+		}
+		SDL_CPUFeatures &= ~SDL_GetDisabledCPUFeatures();
 	}
 	return SDL_CPUFeatures;
 }
@@ -423,6 +567,14 @@ SDL_bool SDL_HasRDTSC(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasInvariantTSC(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_INVARIANT_TSC ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
 SDL_bool SDL_HasMMX(void)
 {
 	if ( SDL_GetCPUFeatures() & CPU_HAS_MMX ) {
@@ -479,6 +631,14 @@ SDL_bool SDL_HasAltiVec(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasAVX2(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX2 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
 #ifdef TEST_MAIN
 
 #include <stdio.h>
@@ -493,6 +653,7 @@ int main()
 	printf("SSE: %d\n", SDL_HasSSE());
 	printf("SSE2: %d\n", SDL_HasSSE2());
 	printf("AltiVec: %d\n", SDL_HasAltiVec());
+	printf("AVX2: %d\n", SDL_HasAVX2());
 	return 0;
 }
 
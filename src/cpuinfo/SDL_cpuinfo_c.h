@@ -21,18 +21,14 @@
 */
 #include "SDL_config.h"
 
+#ifndef _SDL_cpuinfo_c_h
+#define _SDL_cpuinfo_c_h
 
-#if defined(SDL_BUGGY_MMX_MIXERS) /* buggy, so we're disabling them. --ryan. */
-#if ((defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)) && defined(SDL_ASSEMBLY_ROUTINES)
-/* headers for MMX assembler version of SDL_MixAudio
-   Copyright 2002 Stephane Marchesin (stephane.marchesin@wanadoo.fr)
-   Converted to Intel ASM notation by Cth
-   This code is licensed under the LGPL (see COPYING for details)
-   
-   Assumes buffer size in bytes is a multiple of 16
-   Assumes SDL_MIX_MAXVOLUME = 128
-*/
-void SDL_MixAudio_MMX_S16_VC(char* ,char* ,unsigned int ,int );
-void SDL_MixAudio_MMX_S8_VC(char* ,char* ,unsigned int ,int );
-#endif
-#endif
+#include "SDL_stdinc.h"
+
+/* This function returns true if the CPU time stamp counter runs at a
+   constant rate in all power states, so it can be used as a clock.
+ */
+extern SDL_bool SDL_HasInvariantTSC(void);
+
+#endif /* _SDL_cpuinfo_c_h */
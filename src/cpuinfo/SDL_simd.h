@@ -0,0 +1,53 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_simd_h
+#define _SDL_simd_h
+
+/* Helpers for code using SSE2 and AVX2 compiler intrinsics.
+
+   The intrinsics are compiled in whenever the compiler supports them,
+   but the functions using them must only be called after checking
+   SDL_HasSSE2() or SDL_HasAVX2(), since the rest of SDL is built for
+   the baseline instruction set.
+*/
+
+#include "SDL_cpuinfo.h"
+
+#if SDL_SSE2_INTRINSICS
+#include <emmintrin.h>
+#endif
+#if SDL_AVX2_INTRINSICS
+#include <immintrin.h>
+#endif
+
+/* Mark a function as using a given instruction set */
+#if defined(__GNUC__)
+#define SDL_TARGET_SSE2	__attribute__((target("sse2")))
+#define SDL_TARGET_AVX2	__attribute__((target("avx2")))
+#else
+#define SDL_TARGET_SSE2
+#define SDL_TARGET_AVX2
+#endif
+
+#endif /* _SDL_simd_h */
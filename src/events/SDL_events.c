@@ -28,6 +28,7 @@
 #include "SDL_sysevents.h"
 #include "SDL_events_c.h"
 #include "../timer/SDL_timer_c.h"
+#include "../thread/SDL_atomic_c.h"
 #if !SDL_JOYSTICK_DISABLED
 #include "../joystick/SDL_joystick_c.h"
 #endif
@@ -37,16 +38,43 @@ SDL_EventFilter SDL_EventOK = NULL;
 Uint8 SDL_ProcessEvents[SDL_NUMEVENTS];
 static Uint32 SDL_eventstate = 0;
 
-/* Private data -- event queue */
+/* Private data -- event queue
+
+   The queue is a ring of slots, each carrying a sequence number which
+   tells whether the slot is free or holds an event for a given position.
+   Events are added without locking: a thread claims a position by
+   advancing the tail, fills the slot and then publishes it by updating
+   the slot sequence.  Readers are serialized by the queue lock; events
+   removed from the middle of the queue (when filtering with a mask) are
+   marked as cut, and their slots are recycled once they reach the head.
+   If events are left in front of them, the remaining events are moved
+   up over the cut ones, so that the cut slots do reach the head.
+
+   The events themselves are kept in a separate array from the slot
+   state, so that runs of consecutive events can be copied out at once.
+
+   The size of the queue can be set with the SDL_EVENT_QUEUE_SIZE
+   environment variable, and is rounded up to a power of two.
+*/
 #define MAXEVENTS	128
+#define MAXEVENTS_LIMIT	(1<<20)
+
+typedef struct {
+	volatile Uint32 sequence;
+	int cut;
+} SDL_EventSlot;
+
 static struct {
 	SDL_mutex *lock;
-	int active;
-	int head;
-	int tail;
-	SDL_Event event[MAXEVENTS];
-	int wmmsg_next;
-	struct SDL_SysWMmsg wmmsg[MAXEVENTS];
+	volatile int active;
+	Uint32 head;
+	volatile Uint32 tail;
+	Uint32 size;
+	SDL_EventSlot *slots;
+	SDL_Event *event;
+	struct SDL_SysWMmsg *wmmsg;
+	volatile Uint32 dropped;
+	Uint32 cut;		/* slots marked as cut, under the queue lock */
 } SDL_EventQ;
 
 /* Private data -- event locking structure */
@@ -218,9 +246,57 @@ void SDL_StopEventLoop(void)
 	SDL_QuitQuit();
 
 	/* Clean out EventQ */
+	if ( SDL_EventQ.slots ) {
+		SDL_free(SDL_EventQ.slots);
+		SDL_EventQ.slots = NULL;
+	}
+	if ( SDL_EventQ.event ) {
+		SDL_free(SDL_EventQ.event);
+		SDL_EventQ.event = NULL;
+	}
+	if ( SDL_EventQ.wmmsg ) {
+		SDL_free(SDL_EventQ.wmmsg);
+		SDL_EventQ.wmmsg = NULL;
+	}
+	SDL_EventQ.size = 0;
 	SDL_EventQ.head = 0;
 	SDL_EventQ.tail = 0;
-	SDL_EventQ.wmmsg_next = 0;
+}
+
+/* Allocate an empty event queue of the requested size */
+static int SDL_AllocEventQueue(void)
+{
+	const char *env;
+	Uint32 size;
+	Uint32 i;
+
+	size = MAXEVENTS;
+	env = SDL_getenv("SDL_EVENT_QUEUE_SIZE");
+	if ( env && SDL_atoi(env) > 0 ) {
+		int wanted = SDL_atoi(env);
+
+		for ( size = 2; size < (Uint32)wanted && size < MAXEVENTS_LIMIT; ) {
+			size <<= 1;
+		}
+	}
+	SDL_EventQ.slots = (SDL_EventSlot *)SDL_malloc(size*sizeof(SDL_EventSlot));
+	SDL_EventQ.event = (SDL_Event *)SDL_malloc(size*sizeof(SDL_Event));
+	SDL_EventQ.wmmsg = (struct SDL_SysWMmsg *)
+			SDL_malloc(size*sizeof(struct SDL_SysWMmsg));
+	if ( !SDL_EventQ.slots || !SDL_EventQ.event || !SDL_EventQ.wmmsg ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	for ( i = 0; i < size; ++i ) {
+		SDL_EventQ.slots[i].sequence = i;
+		SDL_EventQ.slots[i].cut = 0;
+	}
+	SDL_EventQ.size = size;
+	SDL_EventQ.head = 0;
+	SDL_EventQ.tail = 0;
+	SDL_EventQ.dropped = 0;
+	SDL_EventQ.cut = 0;
+	return(0);
 }
 
 /* This function (and associated calls) may be called more than once */
@@ -252,7 +328,11 @@ int SDL_StartEventLoop(Uint32 flags)
 		return(-1);
 	}
 
-	/* Create the lock and event thread */
+	/* Create the queue, the lock and event thread */
+	if ( SDL_AllocEventQueue() < 0 ) {
+		SDL_StopEventLoop();
+		return(-1);
+	}
 	if ( SDL_StartEventThread(flags) < 0 ) {
 		SDL_StopEventLoop();
 		return(-1);
@@ -261,58 +341,162 @@ int SDL_StartEventLoop(Uint32 flags)
 }
 
 
-/* Add an event to the event queue -- called with the queue locked */
+/* Add an event to the event queue -- safe to call from any thread
+   (with the queue locked on platforms without atomic operations) */
 static int SDL_AddEvent(SDL_Event *event)
 {
-	int tail, added;
+	SDL_EventSlot *slot;
+	Uint32 pos, spot;
+	int delta;
+
+	pos = SDL_EventQ.tail;
+	for ( ; ; ) {
+		spot = pos & (SDL_EventQ.size-1);
+		slot = &SDL_EventQ.slots[spot];
+		delta = (int)(slot->sequence - pos);
+		if ( delta == 0 ) {
+			/* The slot is free, try to claim this position */
+			if ( SDL_AtomicCAS(&SDL_EventQ.tail, pos, pos+1) ) {
+				break;
+			}
+		} else if ( delta < 0 ) {
+			/* Overflow, drop event */
+			SDL_AtomicAdd(&SDL_EventQ.dropped, 1);
+			return(0);
+		}
+		/* Another thread got there first, try again */
+		pos = SDL_EventQ.tail;
+	}
 
-	tail = (SDL_EventQ.tail+1)%MAXEVENTS;
-	if ( tail == SDL_EventQ.head ) {
-		/* Overflow, drop event */
-		added = 0;
-	} else {
-		SDL_EventQ.event[SDL_EventQ.tail] = *event;
-		if (event->type == SDL_SYSWMEVENT) {
-			/* Note that it's possible to lose an event */
-			int next = SDL_EventQ.wmmsg_next;
-			SDL_EventQ.wmmsg[next] = *event->syswm.msg;
-		        SDL_EventQ.event[SDL_EventQ.tail].syswm.msg =
-						&SDL_EventQ.wmmsg[next];
-			SDL_EventQ.wmmsg_next = (next+1)%MAXEVENTS;
+	SDL_EventQ.event[spot] = *event;
+	slot->cut = 0;
+	if (event->type == SDL_SYSWMEVENT) {
+		/* Note that the message is lost when the slot is reused */
+		SDL_EventQ.wmmsg[spot] = *event->syswm.msg;
+		SDL_EventQ.event[spot].syswm.msg = &SDL_EventQ.wmmsg[spot];
+	}
+
+	/* Publish the event to readers */
+	SDL_MemoryBarrier();
+	slot->sequence = pos+1;
+	return(1);
+}
+
+/* Recycle cut events at the head of the queue -- called with the queue locked */
+static void SDL_ReclaimEvents(void)
+{
+	for ( ; ; ) {
+		Uint32 pos = SDL_EventQ.head;
+		SDL_EventSlot *slot = &SDL_EventQ.slots[pos & (SDL_EventQ.size-1)];
+
+		if ( slot->sequence != pos+1 ) {
+			break;
+		}
+		SDL_MemoryBarrier();
+		if ( ! slot->cut ) {
+			break;
 		}
-		SDL_EventQ.tail = tail;
-		added = 1;
+		SDL_EventQ.head = pos+1;
+		--SDL_EventQ.cut;
+		SDL_MemoryBarrier();
+		slot->sequence = pos+SDL_EventQ.size;
 	}
-	return(added);
 }
 
-/* Cut an event, and return the next valid spot, or the tail */
-/*                           -- called with the queue locked */
-static int SDL_CutEvent(int spot)
+/* Move the published events that are left towards the tail, over the cut
+   ones, so that all the cut slots end up at the head -- called with the
+   queue locked.  Slots which aren't published yet belong to the threads
+   adding events, and are left alone.
+*/
+static void SDL_CompactEvents(void)
 {
-	if ( spot == SDL_EventQ.head ) {
-		SDL_EventQ.head = (SDL_EventQ.head+1)%MAXEVENTS;
-		return(SDL_EventQ.head);
-	} else
-	if ( (spot+1)%MAXEVENTS == SDL_EventQ.tail ) {
-		SDL_EventQ.tail = spot;
-		return(SDL_EventQ.tail);
-	} else
-	/* We cut the middle -- shift everything over */
-	{
-		int here, next;
-
-		/* This can probably be optimized with SDL_memcpy() -- careful! */
-		if ( --SDL_EventQ.tail < 0 ) {
-			SDL_EventQ.tail = MAXEVENTS-1;
+	const Uint32 mask = SDL_EventQ.size-1;
+	Uint32 end, from, to;
+
+	end = SDL_EventQ.head;
+	while ( SDL_EventQ.slots[end & mask].sequence == end+1 ) {
+		++end;
+	}
+	SDL_MemoryBarrier();
+
+	to = end;
+	for ( from = end; from != SDL_EventQ.head; ) {
+		--from;
+		if ( SDL_EventQ.slots[from & mask].cut ) {
+			continue;
 		}
-		for ( here=spot; here != SDL_EventQ.tail; here = next ) {
-			next = (here+1)%MAXEVENTS;
-			SDL_EventQ.event[here] = SDL_EventQ.event[next];
+		--to;
+		if ( to != from ) {
+			SDL_Event *event = &SDL_EventQ.event[to & mask];
+
+			*event = SDL_EventQ.event[from & mask];
+			if ( event->type == SDL_SYSWMEVENT ) {
+				SDL_EventQ.wmmsg[to & mask] =
+					SDL_EventQ.wmmsg[from & mask];
+				event->syswm.msg = &SDL_EventQ.wmmsg[to & mask];
+			}
+			SDL_EventQ.slots[to & mask].cut = 0;
 		}
-		return(spot);
 	}
-	/* NOTREACHED */
+	for ( from = SDL_EventQ.head; from != to; ++from ) {
+		SDL_EventQ.slots[from & mask].cut = 1;
+	}
+	SDL_ReclaimEvents();
+}
+
+/* Copy up to 'numevents' events matching 'mask' from the front of the queue,
+   removing them if requested -- called with the queue locked */
+static int SDL_CopyEvents(SDL_Event *events, int numevents, Uint32 mask,
+							int remove)
+{
+	Uint32 spot, first, last;
+	int used, stop, skip;
+
+	used = 0;
+	spot = SDL_EventQ.head;
+	while ( used < numevents ) {
+		/* Look for a run of matching events, up to the end of the ring */
+		first = last = spot & (SDL_EventQ.size-1);
+		stop = skip = 0;
+		while ( used+(int)(last-first) < numevents &&
+		        last < SDL_EventQ.size ) {
+			SDL_EventSlot *slot = &SDL_EventQ.slots[last];
+
+			if ( slot->sequence != spot+(last-first)+1 ) {
+				/* No more events have been published */
+				stop = 1;
+				break;
+			}
+			SDL_MemoryBarrier();
+			if ( slot->cut ||
+			     !(mask & SDL_EVENTMASK(SDL_EventQ.event[last].type)) ) {
+				skip = 1;
+				break;
+			}
+			if ( remove ) {
+				slot->cut = 1;
+				++SDL_EventQ.cut;
+			}
+			++last;
+		}
+		if ( last > first ) {
+			SDL_memcpy(&events[used], &SDL_EventQ.event[first],
+					(last-first)*sizeof(SDL_Event));
+			used += (last-first);
+			spot += (last-first);
+		}
+		if ( stop ) {
+			break;
+		}
+		spot += skip;
+	}
+	if ( remove ) {
+		SDL_ReclaimEvents();
+		if ( SDL_EventQ.cut ) {
+			SDL_CompactEvents();
+		}
+	}
+	return(used);
 }
 
 /* Lock the event queue, take a peep at it, and unlock it */
@@ -325,8 +509,17 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 	if ( ! SDL_EventQ.active ) {
 		return(-1);
 	}
-	/* Lock the event queue */
 	used = 0;
+#if SDL_HAVE_ATOMICS
+	/* Adding events doesn't need the queue lock */
+	if ( action == SDL_ADDEVENT ) {
+		for ( i=0; i<numevents; ++i ) {
+			used += SDL_AddEvent(&events[i]);
+		}
+		return(used);
+	}
+#endif
+	/* Lock the event queue */
 	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
 		if ( action == SDL_ADDEVENT ) {
 			for ( i=0; i<numevents; ++i ) {
@@ -334,7 +527,6 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 			}
 		} else {
 			SDL_Event tmpevent;
-			int spot;
 
 			/* If 'events' is NULL, just see if they exist */
 			if ( events == NULL ) {
@@ -342,19 +534,8 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 				numevents = 1;
 				events = &tmpevent;
 			}
-			spot = SDL_EventQ.head;
-			while ((used < numevents)&&(spot != SDL_EventQ.tail)) {
-				if ( mask & SDL_EVENTMASK(SDL_EventQ.event[spot].type) ) {
-					events[used++] = SDL_EventQ.event[spot];
-					if ( action == SDL_GETEVENT ) {
-						spot = SDL_CutEvent(spot);
-					} else {
-						spot = (spot+1)%MAXEVENTS;
-					}
-				} else {
-					spot = (spot+1)%MAXEVENTS;
-				}
-			}
+			used = SDL_CopyEvents(events, numevents, mask,
+						(action == SDL_GETEVENT));
 		}
 		SDL_mutexV(SDL_EventQ.lock);
 	} else {
@@ -400,6 +581,26 @@ int SDL_PollEvent (SDL_Event *event)
 	return 1;
 }
 
+int SDL_PollEvents (SDL_Event *events, int maxevents, Uint32 mask)
+{
+	int used;
+
+	SDL_PumpEvents();
+
+	/* Don't look after we've quit */
+	if ( ! SDL_EventQ.active ) {
+		return(-1);
+	}
+	used = -1;
+	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
+		used = SDL_CopyEvents(events, maxevents, mask, 1);
+		SDL_mutexV(SDL_EventQ.lock);
+	} else {
+		SDL_SetError("Couldn't lock event queue");
+	}
+	return(used);
+}
+
 int SDL_WaitEvent (SDL_Event *event)
 {
 	while ( 1 ) {
@@ -419,6 +620,47 @@ int SDL_PushEvent(SDL_Event *event)
 	return 0;
 }
 
+int SDL_CoalesceMouseMotion(const SDL_Event *event)
+{
+	int merged;
+
+	/* Don't look after we've quit */
+	if ( ! SDL_EventQ.active ) {
+		return(0);
+	}
+	/* The queue lock keeps readers from copying the event we modify */
+	merged = 0;
+	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
+		Uint32 pos = SDL_EventQ.tail-1;
+		Uint32 spot = pos & (SDL_EventQ.size-1);
+		SDL_EventSlot *slot = &SDL_EventQ.slots[spot];
+
+		/* The last event must be published and not removed yet */
+		if ( slot->sequence == pos+1 ) {
+			SDL_MemoryBarrier();
+			if ( !slot->cut &&
+			     SDL_EventQ.event[spot].type == SDL_MOUSEMOTION ) {
+				SDL_MouseMotionEvent *motion;
+
+				motion = &SDL_EventQ.event[spot].motion;
+				motion->state = event->motion.state;
+				motion->x = event->motion.x;
+				motion->y = event->motion.y;
+				motion->xrel += event->motion.xrel;
+				motion->yrel += event->motion.yrel;
+				merged = 1;
+			}
+		}
+		SDL_mutexV(SDL_EventQ.lock);
+	}
+	return(merged);
+}
+
+Uint32 SDL_GetDroppedEvents(void)
+{
+	return(SDL_EventQ.dropped);
+}
+
 void SDL_SetEventFilter (SDL_EventFilter filter)
 {
 	SDL_Event bitbucket;
@@ -64,6 +64,11 @@ extern int SDL_PrivateExpose(void);
 extern int SDL_PrivateQuit(void);
 extern int SDL_PrivateSysWMEvent(SDL_SysWMmsg *message);
 
+/* Used by the mouse code to merge a motion event into a motion event at
+   the end of the queue.  Returns 1 if the event was merged.
+ */
+extern int SDL_CoalesceMouseMotion(const SDL_Event *event);
+
 /* Used to clamp the mouse coordinates separately from the video surface */
 extern void SDL_SetMouseRange(int maxX, int maxY);
 
@@ -37,6 +37,7 @@ static Sint16 SDL_DeltaY = 0;
 static Sint16 SDL_MouseMaxX = 0;
 static Sint16 SDL_MouseMaxY = 0;
 static Uint8  SDL_ButtonState = 0;
+static int    SDL_MouseCoalesce = 0;
 
 
 /* Public functions */
@@ -51,6 +52,12 @@ int SDL_MouseInit(void)
 	SDL_MouseMaxY = 0;
 	SDL_ButtonState = 0;
 
+	/* Merge consecutive motion events in the queue, if requested */
+	SDL_MouseCoalesce = 0;
+	if ( SDL_getenv("SDL_MOUSE_COALESCE_MOTION") ) {
+		SDL_MouseCoalesce = SDL_atoi(SDL_getenv("SDL_MOUSE_COALESCE_MOTION"));
+	}
+
 	/* That's it! */
 	return(0);
 }
@@ -188,7 +195,10 @@ printf("Mouse event didn't change state - dropped!\n");
 		event.motion.yrel = Yrel;
 		if ( (SDL_EventOK == NULL) || (*SDL_EventOK)(&event) ) {
 			posted = 1;
-			SDL_PushEvent(&event);
+			if ( !SDL_MouseCoalesce ||
+			     !SDL_CoalesceMouseMotion(&event) ) {
+				SDL_PushEvent(&event);
+			}
 		}
 	}
 	return(posted);
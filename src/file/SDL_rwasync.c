@@ -0,0 +1,469 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Asynchronous reads from SDL_RWops, serviced by a pool of I/O threads */
+
+#include "SDL_rwops.h"
+#include "SDL_events.h"
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
+#include "SDL_timer.h"
+#include "../thread/SDL_atomic_c.h"
+
+#define SDL_RWASYNC_THREADS	2
+#define SDL_MAX_RWASYNC_THREADS	8
+
+/* Request states */
+#define RWASYNC_QUEUED	0	/* Waiting in the pool queue */
+#define RWASYNC_BATCHED	1	/* Taken by an I/O thread, not started */
+#define RWASYNC_RUNNING	2	/* Being read */
+#define RWASYNC_DONE	3	/* Finished, 'result' is valid */
+
+struct SDL_RWasync {
+	SDL_RWops *context;
+	Sint64 offset;
+	void *ptr;
+	int size;
+	SDL_RWasyncCallback callback;
+	void *userdata;
+	int state;
+	int cancelled;
+	int result;
+	struct SDL_RWasync *next;
+};
+
+/* Read the request data, returning the number of bytes read or -1 */
+static int SDL_RWasyncRead(SDL_RWasync *request, Sint64 *position)
+{
+	SDL_RWops *context = request->context;
+	Uint8 *ptr = (Uint8 *)request->ptr;
+	int total, amount;
+
+	if ( request->offset != *position ) {
+		*position = SDL_RWseek64(context, request->offset, RW_SEEK_SET);
+		if ( *position != request->offset ) {
+			*position = -1;
+			return(-1);
+		}
+	}
+	total = 0;
+	amount = 0;
+	while ( total < request->size ) {
+		amount = SDL_RWread(context, ptr+total, 1, request->size-total);
+		if ( amount <= 0 ) {
+			break;
+		}
+		total += amount;
+	}
+	if ( amount < 0 && total == 0 ) {
+		*position = -1;
+		return(-1);
+	}
+	*position += total;
+	return(total);
+}
+
+/* Let the application know a request has been read */
+static void SDL_RWasyncNotify(SDL_RWasync *request)
+{
+	if ( request->callback ) {
+		request->callback(request->userdata, request, request->result);
+	} else {
+		SDL_Event event;
+
+		event.type = SDL_USEREVENT;
+		event.user.code = SDL_RWASYNC_EVENT;
+		event.user.data1 = request;
+		event.user.data2 = request->userdata;
+		SDL_PushEvent(&event);
+	}
+}
+
+#if !SDL_THREADS_DISABLED
+
+typedef struct {
+	SDL_Thread *thread;
+	SDL_RWops *context;	/* The data source being read, or NULL */
+} SDL_RWasyncWorker;
+
+static struct {
+	volatile int starting;
+	int nworkers;
+	int quit;
+	SDL_mutex *lock;
+	SDL_cond *work;		/* Signaled when requests are queued */
+	SDL_cond *done;		/* Broadcast when requests finish */
+	SDL_RWasync *head;
+	SDL_RWasync *tail;
+	SDL_RWasyncWorker workers[SDL_MAX_RWASYNC_THREADS];
+} SDL_RWasyncPool;
+
+/* Find a queued request for a data source no other thread is reading */
+static SDL_RWops *SDL_RWasyncNextContext(void)
+{
+	SDL_RWasync *request;
+	int i;
+
+	for ( request = SDL_RWasyncPool.head; request; request = request->next ) {
+		for ( i = 0; i < SDL_RWasyncPool.nworkers; ++i ) {
+			if ( SDL_RWasyncPool.workers[i].context == request->context ) {
+				break;
+			}
+		}
+		if ( i == SDL_RWasyncPool.nworkers ) {
+			return(request->context);
+		}
+	}
+	return(NULL);
+}
+
+/* Take all the queued requests for a data source, sorted by offset */
+static SDL_RWasync *SDL_RWasyncTakeBatch(SDL_RWops *context)
+{
+	SDL_RWasync *batch, *request, *prev, *next;
+	SDL_RWasync **where;
+
+	batch = NULL;
+	prev = NULL;
+	for ( request = SDL_RWasyncPool.head; request; request = next ) {
+		next = request->next;
+		if ( request->context != context ) {
+			prev = request;
+			continue;
+		}
+		if ( prev ) {
+			prev->next = next;
+		} else {
+			SDL_RWasyncPool.head = next;
+		}
+		if ( SDL_RWasyncPool.tail == request ) {
+			SDL_RWasyncPool.tail = prev;
+		}
+
+		/* Keep requests at the same offset in the order they came */
+		where = &batch;
+		while ( *where && (*where)->offset <= request->offset ) {
+			where = &(*where)->next;
+		}
+		request->next = *where;
+		request->state = RWASYNC_BATCHED;
+		*where = request;
+	}
+	return(batch);
+}
+
+static int SDL_RWasyncThread(void *data)
+{
+	SDL_RWasyncWorker *worker = (SDL_RWasyncWorker *)data;
+	SDL_RWasync *request, *next;
+	SDL_RWops *context;
+	Sint64 position;
+
+	SDL_mutexP(SDL_RWasyncPool.lock);
+	for ( ; ; ) {
+		context = NULL;
+		while ( !SDL_RWasyncPool.quit &&
+		        (context = SDL_RWasyncNextContext()) == NULL ) {
+			SDL_CondWait(SDL_RWasyncPool.work, SDL_RWasyncPool.lock);
+		}
+		if ( SDL_RWasyncPool.quit ) {
+			break;
+		}
+		worker->context = context;
+		position = -1;
+		for ( request = SDL_RWasyncTakeBatch(context); request; request = next ) {
+			/* The request may be released as soon as it's done */
+			next = request->next;
+			if ( request->cancelled || SDL_RWasyncPool.quit ) {
+				request->result = SDL_RWASYNC_CANCELLED;
+			} else {
+				request->state = RWASYNC_RUNNING;
+				SDL_mutexV(SDL_RWasyncPool.lock);
+				request->result = SDL_RWasyncRead(request, &position);
+				SDL_RWasyncNotify(request);
+				SDL_mutexP(SDL_RWasyncPool.lock);
+			}
+			request->state = RWASYNC_DONE;
+			SDL_CondBroadcast(SDL_RWasyncPool.done);
+		}
+		worker->context = NULL;
+	}
+	SDL_mutexV(SDL_RWasyncPool.lock);
+	return(0);
+}
+
+/* Start the I/O threads, returns 0 if they couldn't be started */
+static int SDL_RWasyncInit(void)
+{
+	const char *env;
+	int nthreads;
+	int i;
+
+	if ( SDL_RWasyncPool.nworkers > 0 ) {
+		return(1);
+	}
+
+	/* Only one thread gets to start the pool */
+	while ( !SDL_AtomicCAS(&SDL_RWasyncPool.starting, 0, 1) ) {
+		SDL_Delay(0);
+	}
+	if ( SDL_RWasyncPool.nworkers > 0 ) {
+		SDL_RWasyncPool.starting = 0;
+		return(1);
+	}
+
+	env = SDL_getenv("SDL_RWASYNC_THREADS");
+	nthreads = env ? SDL_atoi(env) : SDL_RWASYNC_THREADS;
+	if ( nthreads < 1 ) {
+		nthreads = 1;
+	}
+	if ( nthreads > SDL_MAX_RWASYNC_THREADS ) {
+		nthreads = SDL_MAX_RWASYNC_THREADS;
+	}
+
+	SDL_RWasyncPool.quit = 0;
+	SDL_RWasyncPool.lock = SDL_CreateMutex();
+	SDL_RWasyncPool.work = SDL_CreateCond();
+	SDL_RWasyncPool.done = SDL_CreateCond();
+	if ( SDL_RWasyncPool.lock && SDL_RWasyncPool.work && SDL_RWasyncPool.done ) {
+		/* If we can't get all the threads we asked for, use what we have.
+		   The workers don't look at the pool until they get the lock.
+		 */
+		SDL_mutexP(SDL_RWasyncPool.lock);
+		for ( i = 0; i < nthreads; ++i ) {
+			SDL_RWasyncWorker *worker = &SDL_RWasyncPool.workers[i];
+
+			worker->context = NULL;
+			worker->thread = SDL_CreateThread(SDL_RWasyncThread, worker);
+			if ( worker->thread == NULL ) {
+				break;
+			}
+			++SDL_RWasyncPool.nworkers;
+		}
+		SDL_mutexV(SDL_RWasyncPool.lock);
+	}
+	if ( SDL_RWasyncPool.nworkers == 0 ) {
+		if ( SDL_RWasyncPool.done ) {
+			SDL_DestroyCond(SDL_RWasyncPool.done);
+			SDL_RWasyncPool.done = NULL;
+		}
+		if ( SDL_RWasyncPool.work ) {
+			SDL_DestroyCond(SDL_RWasyncPool.work);
+			SDL_RWasyncPool.work = NULL;
+		}
+		if ( SDL_RWasyncPool.lock ) {
+			SDL_DestroyMutex(SDL_RWasyncPool.lock);
+			SDL_RWasyncPool.lock = NULL;
+		}
+	}
+	SDL_MemoryBarrier();
+	SDL_RWasyncPool.starting = 0;
+	return(SDL_RWasyncPool.nworkers > 0);
+}
+
+/* Stop the I/O threads, cancelling any requests still queued */
+void SDL_RWasyncQuit(void)
+{
+	SDL_RWasync *request, *next;
+	int i;
+
+	if ( SDL_RWasyncPool.nworkers == 0 ) {
+		return;
+	}
+
+	SDL_mutexP(SDL_RWasyncPool.lock);
+	SDL_RWasyncPool.quit = 1;
+	for ( request = SDL_RWasyncPool.head; request; request = next ) {
+		next = request->next;
+		request->result = SDL_RWASYNC_CANCELLED;
+		request->state = RWASYNC_DONE;
+	}
+	SDL_RWasyncPool.head = SDL_RWasyncPool.tail = NULL;
+	SDL_CondBroadcast(SDL_RWasyncPool.work);
+	SDL_CondBroadcast(SDL_RWasyncPool.done);
+	SDL_mutexV(SDL_RWasyncPool.lock);
+
+	for ( i = 0; i < SDL_RWasyncPool.nworkers; ++i ) {
+		SDL_WaitThread(SDL_RWasyncPool.workers[i].thread, NULL);
+		SDL_RWasyncPool.workers[i].thread = NULL;
+	}
+	SDL_RWasyncPool.nworkers = 0;
+
+	SDL_DestroyCond(SDL_RWasyncPool.done);
+	SDL_RWasyncPool.done = NULL;
+	SDL_DestroyCond(SDL_RWasyncPool.work);
+	SDL_RWasyncPool.work = NULL;
+	SDL_DestroyMutex(SDL_RWasyncPool.lock);
+	SDL_RWasyncPool.lock = NULL;
+}
+
+#else
+
+void SDL_RWasyncQuit(void)
+{
+}
+
+#endif /* !SDL_THREADS_DISABLED */
+
+SDL_RWasync *SDL_RWreadAsync(SDL_RWops *context, Sint64 offset, void *ptr, int size, SDL_RWasyncCallback callback, void *userdata)
+{
+	SDL_RWasync *request;
+
+	if ( !context || !ptr || offset < 0 || size < 0 ) {
+		SDL_SetError("Invalid asynchronous read parameters");
+		return(NULL);
+	}
+	request = (SDL_RWasync *)SDL_malloc(sizeof(*request));
+	if ( request == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	request->context = context;
+	request->offset = offset;
+	request->ptr = ptr;
+	request->size = size;
+	request->callback = callback;
+	request->userdata = userdata;
+	request->state = RWASYNC_QUEUED;
+	request->cancelled = 0;
+	request->result = SDL_RWASYNC_PENDING;
+	request->next = NULL;
+
+#if !SDL_THREADS_DISABLED
+	if ( SDL_RWasyncInit() ) {
+		SDL_mutexP(SDL_RWasyncPool.lock);
+		if ( SDL_RWasyncPool.tail ) {
+			SDL_RWasyncPool.tail->next = request;
+		} else {
+			SDL_RWasyncPool.head = request;
+		}
+		SDL_RWasyncPool.tail = request;
+		SDL_CondSignal(SDL_RWasyncPool.work);
+		SDL_mutexV(SDL_RWasyncPool.lock);
+		return(request);
+	}
+#endif
+	/* No I/O threads, do the read now */
+	{
+		Sint64 position = -1;
+
+		request->state = RWASYNC_RUNNING;
+		request->result = SDL_RWasyncRead(request, &position);
+		SDL_RWasyncNotify(request);
+		request->state = RWASYNC_DONE;
+	}
+	return(request);
+}
+
+int SDL_RWpollAsync(SDL_RWasync *request)
+{
+	int result;
+
+	if ( !request ) {
+		SDL_SetError("Passed a NULL request");
+		return(-1);
+	}
+#if !SDL_THREADS_DISABLED
+	if ( SDL_RWasyncPool.lock ) {
+		SDL_mutexP(SDL_RWasyncPool.lock);
+	}
+#endif
+	if ( request->state == RWASYNC_DONE ) {
+		result = request->result;
+	} else {
+		result = SDL_RWASYNC_PENDING;
+	}
+#if !SDL_THREADS_DISABLED
+	if ( SDL_RWasyncPool.lock ) {
+		SDL_mutexV(SDL_RWasyncPool.lock);
+	}
+#endif
+	return(result);
+}
+
+int SDL_RWwaitAsync(SDL_RWasync *request)
+{
+	int result;
+
+	if ( !request ) {
+		SDL_SetError("Passed a NULL request");
+		return(-1);
+	}
+#if !SDL_THREADS_DISABLED
+	/* The pool lock is gone if the request finished before SDL_Quit() */
+	if ( SDL_RWasyncPool.lock ) {
+		SDL_mutexP(SDL_RWasyncPool.lock);
+		while ( request->state != RWASYNC_DONE ) {
+			SDL_CondWait(SDL_RWasyncPool.done, SDL_RWasyncPool.lock);
+		}
+		SDL_mutexV(SDL_RWasyncPool.lock);
+	}
+#endif
+	result = request->result;
+	SDL_free(request);
+	return(result);
+}
+
+int SDL_RWcancelAsync(SDL_RWasync *request)
+{
+	int retval = -1;
+
+	if ( !request ) {
+		SDL_SetError("Passed a NULL request");
+		return(-1);
+	}
+#if !SDL_THREADS_DISABLED
+	if ( SDL_RWasyncPool.lock ) {
+		SDL_mutexP(SDL_RWasyncPool.lock);
+		if ( request->state == RWASYNC_QUEUED ) {
+			SDL_RWasync *prev = NULL;
+			SDL_RWasync *here;
+
+			for ( here = SDL_RWasyncPool.head; here != request; here = here->next ) {
+				prev = here;
+			}
+			if ( prev ) {
+				prev->next = request->next;
+			} else {
+				SDL_RWasyncPool.head = request->next;
+			}
+			if ( SDL_RWasyncPool.tail == request ) {
+				SDL_RWasyncPool.tail = prev;
+			}
+			request->result = SDL_RWASYNC_CANCELLED;
+			request->state = RWASYNC_DONE;
+			SDL_CondBroadcast(SDL_RWasyncPool.done);
+			retval = 0;
+		} else if ( request->state == RWASYNC_BATCHED ) {
+			/* The I/O thread will skip it */
+			request->cancelled = 1;
+			retval = 0;
+		}
+		SDL_mutexV(SDL_RWasyncPool.lock);
+	}
+#endif
+	if ( retval < 0 ) {
+		SDL_SetError("Request has already started or finished");
+	}
+	return(retval);
+}
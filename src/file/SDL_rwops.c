@@ -19,6 +19,8 @@
     Sam Lantinga
     slouken@libsdl.org
 */
+/* Need this so Linux systems define fseeko64(), ftello64() and off64_t */
+#define _LARGEFILE64_SOURCE
 #include "SDL_config.h"
 
 /* This file provides a general interface for SDL to read and write
@@ -28,6 +30,23 @@
 #include "SDL_endian.h"
 #include "SDL_rwops.h"
 
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* The 'seek' function can only return offsets up to 2 GB */
+static int SDL_RWoffset32(Sint64 offset)
+{
+	if ( offset > 0x7FFFFFFF ) {
+		SDL_SetError("Offset is past 2 GB, use SDL_RWseek64()");
+		return(-1);
+	}
+	return((int)offset);
+}
 
 #if defined(__WIN32__) && !defined(__SYMBIAN32__)
 
@@ -183,10 +202,11 @@ static int SDLCALL win32_file_open(SDL_RWops *context, const char *filename, con
 
 	return 0; /* ok */
 }
-static int SDLCALL win32_file_seek(SDL_RWops *context, int offset, int whence)
+static Sint64 win32_file_seek64(SDL_RWops *context, Sint64 offset, int whence)
 {
 	DWORD win32whence;
-	int   file_pos;
+	DWORD file_pos;
+	LONG  file_pos_high;
 	
 	if (!context || context->hidden.win32io.h == INVALID_HANDLE_VALUE) {
 		SDL_SetError("win32_file_seek: invalid context/file not opened");
@@ -211,14 +231,19 @@ static int SDLCALL win32_file_seek(SDL_RWops *context, int offset, int whence)
 			return -1;
 	}
 
-	file_pos = SetFilePointer(context->hidden.win32io.h,offset,NULL,win32whence);
+	file_pos_high = (LONG)(offset >> 32);
+	file_pos = SetFilePointer(context->hidden.win32io.h,(LONG)offset,&file_pos_high,win32whence);
 
-	if ( file_pos != INVALID_SET_FILE_POINTER )
-		return file_pos; /* success */
+	if ( file_pos != INVALID_SET_FILE_POINTER || GetLastError() == NO_ERROR )
+		return ((Sint64)file_pos_high << 32) | file_pos; /* success */
 	
 	SDL_Error(SDL_EFSEEK);
 	return -1; /* error */
 }
+static int SDLCALL win32_file_seek(SDL_RWops *context, int offset, int whence)
+{
+	return SDL_RWoffset32(win32_file_seek64(context, offset, whence));
+}
 static int SDLCALL win32_file_read(SDL_RWops *context, void *ptr, int size, int maxnum)
 {
 	int		total_need; 
@@ -320,14 +345,28 @@ static int SDLCALL win32_file_close(SDL_RWops *context)
 
 /* Functions to read/write stdio file pointers */
 
-static int SDLCALL stdio_seek(SDL_RWops *context, int offset, int whence)
+static Sint64 stdio_seek64(SDL_RWops *context, Sint64 offset, int whence)
 {
-	if ( fseek(context->hidden.stdio.fp, offset, whence) == 0 ) {
+#if defined(HAVE_FSEEKO64)
+	if ( fseeko64(context->hidden.stdio.fp, (off64_t)offset, whence) == 0 ) {
+		return(ftello64(context->hidden.stdio.fp));
+	}
+#elif defined(HAVE_FSEEKO)
+	if ( fseeko(context->hidden.stdio.fp, (off_t)offset, whence) == 0 ) {
+		return(ftello(context->hidden.stdio.fp));
+	}
+#else
+	if ( offset == (long)offset &&
+	     fseek(context->hidden.stdio.fp, (long)offset, whence) == 0 ) {
 		return(ftell(context->hidden.stdio.fp));
-	} else {
-		SDL_Error(SDL_EFSEEK);
-		return(-1);
 	}
+#endif
+	SDL_Error(SDL_EFSEEK);
+	return(-1);
+}
+static int SDLCALL stdio_seek(SDL_RWops *context, int offset, int whence)
+{
+	return SDL_RWoffset32(stdio_seek64(context, offset, whence));
 }
 static int SDLCALL stdio_read(SDL_RWops *context, void *ptr, int size, int maxnum)
 {
@@ -364,32 +403,37 @@ static int SDLCALL stdio_close(SDL_RWops *context)
 
 /* Functions to read/write memory pointers */
 
-static int SDLCALL mem_seek(SDL_RWops *context, int offset, int whence)
+static Sint64 mem_seek64(SDL_RWops *context, Sint64 offset, int whence)
 {
-	Uint8 *newpos;
+	Sint64 newpos;
+	Sint64 size = (context->hidden.mem.stop-context->hidden.mem.base);
 
 	switch (whence) {
 		case RW_SEEK_SET:
-			newpos = context->hidden.mem.base+offset;
+			newpos = offset;
 			break;
 		case RW_SEEK_CUR:
-			newpos = context->hidden.mem.here+offset;
+			newpos = (context->hidden.mem.here-context->hidden.mem.base)+offset;
 			break;
 		case RW_SEEK_END:
-			newpos = context->hidden.mem.stop+offset;
+			newpos = size+offset;
 			break;
 		default:
 			SDL_SetError("Unknown value for 'whence'");
 			return(-1);
 	}
-	if ( newpos < context->hidden.mem.base ) {
-		newpos = context->hidden.mem.base;
+	if ( newpos < 0 ) {
+		newpos = 0;
 	}
-	if ( newpos > context->hidden.mem.stop ) {
-		newpos = context->hidden.mem.stop;
+	if ( newpos > size ) {
+		newpos = size;
 	}
-	context->hidden.mem.here = newpos;
-	return(context->hidden.mem.here-context->hidden.mem.base);
+	context->hidden.mem.here = context->hidden.mem.base+(size_t)newpos;
+	return(newpos);
+}
+static int SDLCALL mem_seek(SDL_RWops *context, int offset, int whence)
+{
+	return SDL_RWoffset32(mem_seek64(context, offset, whence));
 }
 static int SDLCALL mem_read(SDL_RWops *context, void *ptr, int size, int maxnum)
 {
@@ -433,6 +477,224 @@ static int SDLCALL mem_close(SDL_RWops *context)
 	return(0);
 }
 
+#ifdef HAVE_MMAP
+/* Memory mapped files are read like constant memory */
+
+static int SDLCALL mapped_close(SDL_RWops *context)
+{
+	if ( context ) {
+		if ( context->hidden.mem.base ) {
+			munmap(context->hidden.mem.base,
+			       context->hidden.mem.stop-context->hidden.mem.base);
+		}
+		SDL_FreeRW(context);
+	}
+	return(0);
+}
+#endif /* HAVE_MMAP */
+
+/* Functions to read/write through a buffer in front of another SDL_RWops */
+
+#define RW_BUFFER_SIZE	4096
+
+typedef struct SDL_RWbuffer {
+	SDL_RWops *src;
+	int freesrc;
+	int seekable;
+	Uint8 *data;
+	int size;
+	int pos;	/* The next byte to read */
+	int len;	/* The end of the data read ahead */
+	int dirty;	/* The number of bytes waiting to be written */
+	int mode;	/* Whether the source was last read or written */
+	Sint64 offset;	/* The position of the source */
+} SDL_RWbuffer;
+
+#define RW_BUFFER_READING	1
+#define RW_BUFFER_WRITING	2
+
+#define RW_BUFFER(context)	((SDL_RWbuffer *)(context)->hidden.unknown.data1)
+
+/* There is never data read ahead and waiting to be written at once */
+static int buffered_flush(SDL_RWbuffer *buffer)
+{
+	if ( buffer->dirty > 0 ) {
+		if ( SDL_RWwrite(buffer->src, buffer->data, 1, buffer->dirty)
+							!= buffer->dirty ) {
+			return(-1);
+		}
+		buffer->offset += buffer->dirty;
+		buffer->dirty = 0;
+		buffer->mode = RW_BUFFER_WRITING;
+	}
+	return(0);
+}
+/* Put the source at the position the buffer has reached.  This always
+   seeks after using the source, since stdio needs that when switching
+   between reading and writing.
+ */
+static int buffered_sync(SDL_RWbuffer *buffer)
+{
+	Sint64 pos;
+
+	if ( buffered_flush(buffer) < 0 ) {
+		return(-1);
+	}
+	if ( buffer->mode ) {
+		pos = SDL_RWseek64(buffer->src,
+		                   -(Sint64)(buffer->len - buffer->pos),
+		                   RW_SEEK_CUR);
+		if ( pos >= 0 ) {
+			buffer->offset = pos;
+		} else if ( buffer->pos < buffer->len ) {
+			/* The data read ahead can't be put back */
+			return(-1);
+		}
+		buffer->mode = 0;
+	}
+	buffer->pos = 0;
+	buffer->len = 0;
+	return(0);
+}
+static Sint64 buffered_seek64(SDL_RWops *context, Sint64 offset, int whence)
+{
+	SDL_RWbuffer *buffer = RW_BUFFER(context);
+	Sint64 start, pos;
+
+	/* Seeks within the data read ahead don't need the source */
+	if ( buffer->dirty == 0 && (whence == RW_SEEK_CUR ||
+	     (whence == RW_SEEK_SET && buffer->seekable)) ) {
+		start = buffer->offset - buffer->len;
+		pos = offset;
+		if ( whence == RW_SEEK_CUR ) {
+			pos += start + buffer->pos;
+		}
+		if ( pos >= start && pos <= buffer->offset ) {
+			buffer->pos = (int)(pos - start);
+			return(pos);
+		}
+	}
+	if ( buffered_sync(buffer) < 0 ) {
+		return(-1);
+	}
+	pos = SDL_RWseek64(buffer->src, offset, whence);
+	if ( pos >= 0 ) {
+		buffer->offset = pos;
+	}
+	return(pos);
+}
+static int SDLCALL buffered_seek(SDL_RWops *context, int offset, int whence)
+{
+	return SDL_RWoffset32(buffered_seek64(context, offset, whence));
+}
+static int SDLCALL buffered_read(SDL_RWops *context, void *ptr, int size, int maxnum)
+{
+	SDL_RWbuffer *buffer = RW_BUFFER(context);
+	Uint8 *dst = (Uint8 *)ptr;
+	int total, left, avail;
+
+	total = (maxnum * size);
+	if ( (maxnum <= 0) || (size <= 0) || ((total / maxnum) != size) ) {
+		return 0;
+	}
+	if ( buffer->mode == RW_BUFFER_WRITING || buffer->dirty > 0 ) {
+		if ( buffered_sync(buffer) < 0 ) {
+			return(-1);
+		}
+	}
+
+	left = total;
+	while ( left > 0 ) {
+		avail = buffer->len - buffer->pos;
+		if ( avail == 0 ) {
+			if ( left >= buffer->size ) {
+				/* Large reads go straight to the destination */
+				avail = SDL_RWread(buffer->src, dst, 1, left);
+				buffer->mode = RW_BUFFER_READING;
+				buffer->pos = 0;
+				buffer->len = 0;
+				if ( avail <= 0 ) {
+					break;
+				}
+				buffer->offset += avail;
+				dst += avail;
+				left -= avail;
+				continue;
+			}
+			avail = SDL_RWread(buffer->src, buffer->data, 1, buffer->size);
+			buffer->mode = RW_BUFFER_READING;
+			if ( avail <= 0 ) {
+				break;
+			}
+			buffer->offset += avail;
+			buffer->pos = 0;
+			buffer->len = avail;
+		}
+		if ( avail > left ) {
+			avail = left;
+		}
+		SDL_memcpy(dst, buffer->data + buffer->pos, avail);
+		buffer->pos += avail;
+		dst += avail;
+		left -= avail;
+	}
+	return((total - left) / size);
+}
+static int SDLCALL buffered_write(SDL_RWops *context, const void *ptr, int size, int num)
+{
+	SDL_RWbuffer *buffer = RW_BUFFER(context);
+	int total, written;
+
+	total = (num * size);
+	if ( (num <= 0) || (size <= 0) || ((total / num) != size) ) {
+		return 0;
+	}
+	if ( buffer->mode == RW_BUFFER_READING ||
+	     buffer->dirty + total > buffer->size ) {
+		if ( buffered_sync(buffer) < 0 ) {
+			return(-1);
+		}
+	}
+	if ( total >= buffer->size ) {
+		/* Large writes go straight to the source */
+		written = SDL_RWwrite(buffer->src, ptr, size, num);
+		buffer->mode = RW_BUFFER_WRITING;
+		if ( written > 0 ) {
+			buffer->offset += (Sint64)written * size;
+		}
+		return(written);
+	}
+	SDL_memcpy(buffer->data + buffer->dirty, ptr, total);
+	buffer->dirty += total;
+	return(num);
+}
+static int SDLCALL buffered_close(SDL_RWops *context)
+{
+	SDL_RWbuffer *buffer;
+	int status = 0;
+
+	if ( context ) {
+		buffer = RW_BUFFER(context);
+		if ( buffer->freesrc ) {
+			if ( buffered_flush(buffer) < 0 ) {
+				status = -1;
+			}
+			if ( SDL_RWclose(buffer->src) < 0 ) {
+				status = -1;
+			}
+		} else {
+			/* Leave the source where the reads and writes ended */
+			if ( buffered_sync(buffer) < 0 ) {
+				status = -1;
+			}
+		}
+		SDL_free(buffer->data);
+		SDL_free(buffer);
+		SDL_FreeRW(context);
+	}
+	return(status);
+}
+
 
 /* Functions to create SDL_RWops structures from various data sources */
 
@@ -513,6 +775,8 @@ SDL_RWops *SDL_RWFromFile(const char *file, const char *mode)
 		fp = fopen(mpath, mode);
 		SDL_free(mpath);
 	}
+#elif defined(HAVE_FOPEN64)
+	fp = fopen64(file, mode);
 #else
 	fp = fopen(file, mode);
 #endif
@@ -580,6 +844,118 @@ SDL_RWops *SDL_RWFromConstMem(const void *mem, int size)
 	return(rwops);
 }
 
+SDL_RWops *SDL_RWFromMappedFile(const char *file)
+{
+#ifdef HAVE_MMAP
+	SDL_RWops *rwops;
+	struct stat st;
+	void *base;
+	int fd;
+
+	if ( !file || !*file ) {
+		SDL_SetError("SDL_RWFromMappedFile(): No file specified");
+		return NULL;
+	}
+	fd = open(file, O_RDONLY);
+	if ( fd < 0 ) {
+		SDL_SetError("Couldn't open %s", file);
+		return NULL;
+	}
+	if ( fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+	     (Uint64)st.st_size != (size_t)st.st_size ) {
+		SDL_SetError("Couldn't map %s", file);
+		close(fd);
+		return NULL;
+	}
+	base = NULL;
+	if ( st.st_size > 0 ) {
+		base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if ( base == MAP_FAILED ) {
+			SDL_SetError("Couldn't map %s", file);
+			close(fd);
+			return NULL;
+		}
+#ifdef MADV_SEQUENTIAL
+		/* Loaders mostly read straight through, so read ahead */
+		madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+	}
+	/* The mapping stays valid after the file is closed */
+	close(fd);
+
+	rwops = SDL_AllocRW();
+	if ( rwops == NULL ) {
+		if ( base ) {
+			munmap(base, (size_t)st.st_size);
+		}
+		return NULL;
+	}
+	rwops->seek = mem_seek;
+	rwops->read = mem_read;
+	rwops->write = mem_writeconst;
+	rwops->close = mapped_close;
+	rwops->hidden.mem.base = (Uint8 *)base;
+	rwops->hidden.mem.here = rwops->hidden.mem.base;
+	rwops->hidden.mem.stop = rwops->hidden.mem.base+(size_t)st.st_size;
+	return(rwops);
+#else
+	SDL_SetError("SDL_RWFromMappedFile(): Not supported on this platform");
+	return NULL;
+#endif /* HAVE_MMAP */
+}
+
+SDL_RWops *SDL_BufferRW(SDL_RWops *src, int size, int freesrc)
+{
+	SDL_RWops *rwops;
+	SDL_RWbuffer *buffer;
+
+	if ( src == NULL ) {
+		return NULL;
+	}
+	if ( size <= 0 ) {
+		size = RW_BUFFER_SIZE;
+	}
+	rwops = NULL;
+	buffer = (SDL_RWbuffer *)SDL_malloc(sizeof(*buffer));
+	if ( buffer != NULL ) {
+		buffer->data = (Uint8 *)SDL_malloc(size);
+		if ( buffer->data != NULL ) {
+			rwops = SDL_AllocRW();
+		}
+	}
+	if ( rwops == NULL ) {
+		if ( buffer != NULL ) {
+			if ( buffer->data != NULL ) {
+				SDL_free(buffer->data);
+			}
+			SDL_free(buffer);
+		}
+		SDL_OutOfMemory();
+		if ( freesrc ) {
+			SDL_RWclose(src);
+		}
+		return NULL;
+	}
+	buffer->src = src;
+	buffer->freesrc = freesrc;
+	buffer->size = size;
+	buffer->pos = 0;
+	buffer->len = 0;
+	buffer->dirty = 0;
+	buffer->mode = 0;
+	buffer->offset = SDL_RWtell64(src);
+	buffer->seekable = (buffer->offset >= 0);
+	if ( !buffer->seekable ) {
+		buffer->offset = 0;
+	}
+	rwops->seek = buffered_seek;
+	rwops->read = buffered_read;
+	rwops->write = buffered_write;
+	rwops->close = buffered_close;
+	rwops->hidden.unknown.data1 = buffer;
+	return(rwops);
+}
+
 SDL_RWops *SDL_AllocRW(void)
 {
 	SDL_RWops *area;
@@ -596,78 +972,167 @@ void SDL_FreeRW(SDL_RWops *area)
 	SDL_free(area);
 }
 
+/* Functions for 64-bit offsets and direct memory access */
+
+Sint64 SDL_RWseek64(SDL_RWops *context, Sint64 offset, int whence)
+{
+	if ( context->seek == mem_seek ) {
+		return mem_seek64(context, offset, whence);
+	}
+	if ( context->seek == buffered_seek ) {
+		return buffered_seek64(context, offset, whence);
+	}
+#if defined(__WIN32__) && !defined(__SYMBIAN32__)
+	if ( context->seek == win32_file_seek ) {
+		return win32_file_seek64(context, offset, whence);
+	}
+#endif
+#ifdef HAVE_STDIO_H
+	if ( context->seek == stdio_seek ) {
+		return stdio_seek64(context, offset, whence);
+	}
+#endif
+	if ( offset != (int)offset ) {
+		SDL_SetError("Offset is out of range for this data source");
+		return(-1);
+	}
+	return(SDL_RWseek(context, (int)offset, whence));
+}
+
+Sint64 SDL_RWsize64(SDL_RWops *context)
+{
+	Sint64 pos, size;
+
+	if ( context->seek == mem_seek ) {
+		return(context->hidden.mem.stop-context->hidden.mem.base);
+	}
+	pos = SDL_RWtell64(context);
+	if ( pos < 0 ) {
+		return(-1);
+	}
+	size = SDL_RWseek64(context, 0, RW_SEEK_END);
+	SDL_RWseek64(context, pos, RW_SEEK_SET);
+	return(size);
+}
+
+const void *SDL_RWborrow(SDL_RWops *context, int size)
+{
+	const Uint8 *data;
+
+	if ( context->seek != mem_seek || size < 0 ||
+	     size > (context->hidden.mem.stop-context->hidden.mem.here) ) {
+		return(NULL);
+	}
+	data = context->hidden.mem.here;
+	context->hidden.mem.here += size;
+	return(data);
+}
+
 /* Functions for dynamically reading and writing endian-specific values */
 
+/* Values already in memory are copied without calling the read function */
+static __inline__ void SDL_RWreadvalue(SDL_RWops *src, void *value, int size)
+{
+	if ( src->read == buffered_read ) {
+		SDL_RWbuffer *buffer = RW_BUFFER(src);
+		if ( (buffer->len - buffer->pos) >= size ) {
+			SDL_memcpy(value, buffer->data + buffer->pos, size);
+			buffer->pos += size;
+			return;
+		}
+	} else if ( src->read == mem_read ) {
+		if ( (src->hidden.mem.stop - src->hidden.mem.here) >= size ) {
+			SDL_memcpy(value, src->hidden.mem.here, size);
+			src->hidden.mem.here += size;
+			return;
+		}
+	}
+	SDL_RWread(src, value, size, 1);
+}
+static __inline__ int SDL_RWwritevalue(SDL_RWops *dst, const void *value, int size)
+{
+	if ( dst->write == buffered_write ) {
+		SDL_RWbuffer *buffer = RW_BUFFER(dst);
+		if ( buffer->mode != RW_BUFFER_READING &&
+		     (buffer->dirty + size) <= buffer->size ) {
+			SDL_memcpy(buffer->data + buffer->dirty, value, size);
+			buffer->dirty += size;
+			return(1);
+		}
+	}
+	return(SDL_RWwrite(dst, value, size, 1));
+}
+
 Uint16 SDL_ReadLE16 (SDL_RWops *src)
 {
 	Uint16 value;
 
-	SDL_RWread(src, &value, (sizeof value), 1);
+	SDL_RWreadvalue(src, &value, (sizeof value));
 	return(SDL_SwapLE16(value));
 }
 Uint16 SDL_ReadBE16 (SDL_RWops *src)
 {
 	Uint16 value;
 
-	SDL_RWread(src, &value, (sizeof value), 1);
+	SDL_RWreadvalue(src, &value, (sizeof value));
 	return(SDL_SwapBE16(value));
 }
 Uint32 SDL_ReadLE32 (SDL_RWops *src)
 {
 	Uint32 value;
 
-	SDL_RWread(src, &value, (sizeof value), 1);
+	SDL_RWreadvalue(src, &value, (sizeof value));
 	return(SDL_SwapLE32(value));
 }
 Uint32 SDL_ReadBE32 (SDL_RWops *src)
 {
 	Uint32 value;
 
-	SDL_RWread(src, &value, (sizeof value), 1);
+	SDL_RWreadvalue(src, &value, (sizeof value));
 	return(SDL_SwapBE32(value));
 }
 Uint64 SDL_ReadLE64 (SDL_RWops *src)
 {
 	Uint64 value;
 
-	SDL_RWread(src, &value, (sizeof value), 1);
+	SDL_RWreadvalue(src, &value, (sizeof value));
 	return(SDL_SwapLE64(value));
 }
 Uint64 SDL_ReadBE64 (SDL_RWops *src)
 {
 	Uint64 value;
 
-	SDL_RWread(src, &value, (sizeof value), 1);
+	SDL_RWreadvalue(src, &value, (sizeof value));
 	return(SDL_SwapBE64(value));
 }
 
 int SDL_WriteLE16 (SDL_RWops *dst, Uint16 value)
 {
 	value = SDL_SwapLE16(value);
-	return(SDL_RWwrite(dst, &value, (sizeof value), 1));
+	return(SDL_RWwritevalue(dst, &value, (sizeof value)));
 }
 int SDL_WriteBE16 (SDL_RWops *dst, Uint16 value)
 {
 	value = SDL_SwapBE16(value);
-	return(SDL_RWwrite(dst, &value, (sizeof value), 1));
+	return(SDL_RWwritevalue(dst, &value, (sizeof value)));
 }
 int SDL_WriteLE32 (SDL_RWops *dst, Uint32 value)
 {
 	value = SDL_SwapLE32(value);
-	return(SDL_RWwrite(dst, &value, (sizeof value), 1));
+	return(SDL_RWwritevalue(dst, &value, (sizeof value)));
 }
 int SDL_WriteBE32 (SDL_RWops *dst, Uint32 value)
 {
 	value = SDL_SwapBE32(value);
-	return(SDL_RWwrite(dst, &value, (sizeof value), 1));
+	return(SDL_RWwritevalue(dst, &value, (sizeof value)));
 }
 int SDL_WriteLE64 (SDL_RWops *dst, Uint64 value)
 {
 	value = SDL_SwapLE64(value);
-	return(SDL_RWwrite(dst, &value, (sizeof value), 1));
+	return(SDL_RWwritevalue(dst, &value, (sizeof value)));
 }
 int SDL_WriteBE64 (SDL_RWops *dst, Uint64 value)
 {
 	value = SDL_SwapBE64(value);
-	return(SDL_RWwrite(dst, &value, (sizeof value), 1));
+	return(SDL_RWwritevalue(dst, &value, (sizeof value)));
 }
@@ -0,0 +1,68 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_atomic_c_h
+#define _SDL_atomic_c_h
+
+/* Minimal atomic operations used internally by SDL for lock-free data.
+
+   SDL_HAVE_ATOMICS is set to 1 when the operations below really are
+   atomic.  Otherwise they are plain memory operations, and the caller
+   is responsible for serializing access with a mutex.
+*/
+
+#if !SDL_THREADS_DISABLED && defined(__GNUC__) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+
+#define SDL_HAVE_ATOMICS	1
+#define SDL_AtomicCAS(ptr, oldval, newval) \
+	__sync_bool_compare_and_swap(ptr, oldval, newval)
+#define SDL_AtomicAdd(ptr, value)	__sync_fetch_and_add(ptr, value)
+#define SDL_MemoryBarrier()		__sync_synchronize()
+
+#elif !SDL_THREADS_DISABLED && defined(_MSC_VER) && (_MSC_VER >= 1400) && \
+      (defined(_M_IX86) || defined(_M_X64))
+
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange, _InterlockedExchangeAdd, _ReadWriteBarrier)
+
+#define SDL_HAVE_ATOMICS	1
+#define SDL_AtomicCAS(ptr, oldval, newval) \
+	(_InterlockedCompareExchange((volatile long *)(ptr), \
+	                             (long)(newval), (long)(oldval)) == (long)(oldval))
+#define SDL_AtomicAdd(ptr, value) \
+	_InterlockedExchangeAdd((volatile long *)(ptr), (long)(value))
+/* x86 doesn't reorder loads with loads or stores with stores */
+#define SDL_MemoryBarrier()		_ReadWriteBarrier()
+
+#else
+
+#define SDL_HAVE_ATOMICS	0
+#define SDL_AtomicCAS(ptr, oldval, newval) \
+	((*(ptr) == (oldval)) ? ((*(ptr) = (newval)), 1) : 0)
+#define SDL_AtomicAdd(ptr, value)	((*(ptr) += (value)) - (value))
+#define SDL_MemoryBarrier()
+
+#endif
+
+#endif /* _SDL_atomic_c_h */
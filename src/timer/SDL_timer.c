@@ -38,17 +38,174 @@ SDL_TimerCallback SDL_alarm_callback;
 /* Data used for a thread-based timer */
 static int SDL_timer_threaded = 0;
 
+/* The timers are kept in a binary min-heap ordered by deadline, so the
+   next timer to fire is always SDL_timers[0], and adding or removing
+   a timer takes O(log n).  Deadlines are in microseconds.
+ */
 struct _SDL_TimerID {
-	Uint32 interval;
+	Uint32 interval;	/* milliseconds, or microseconds if precise */
 	SDL_NewTimerCallback cb;
 	void *param;
-	Uint32 last_alarm;
-	struct _SDL_TimerID *next;
+	int precise;
+	Uint64 deadline;
+	int index;		/* Position in the heap, -1 if not in it */
+	struct _SDL_TimerID *next;	/* Next timer in the free list */
 };
 
-static SDL_TimerID SDL_timers = NULL;
+static SDL_TimerID *SDL_timers = NULL;
+static int SDL_num_timers = 0;
+static int SDL_max_timers = 0;
+
+/* Timer structures are recycled rather than freed, so that removing a
+   timer which has already expired is safe.
+ */
+static SDL_TimerID SDL_free_timers = NULL;
+
+/* The timer whose callback is running, and whether it was removed */
+static SDL_TimerID SDL_current_timer = NULL;
+static SDL_bool SDL_current_removed = SDL_FALSE;
+
 static SDL_mutex *SDL_timer_mutex;
-static volatile SDL_bool list_changed = SDL_FALSE;
+static SDL_cond *SDL_timer_cond;
+static SDL_bool SDL_timer_changed = SDL_FALSE;
+
+/* Get the current time in microseconds */
+static Uint64 SDL_TimerNow(void)
+{
+	return SDL_GetTicksNS() / 1000;
+}
+
+#if !SDL_TIMER_UNIX
+/* Platforms without a better clock extend the millisecond ticks.
+   This needs to be called at least once every 49 days to notice
+   the ticks wrapping.
+ */
+Uint64 SDL_GetTicksNS(void)
+{
+	static Uint32 last_ticks = 0;
+	static Uint32 wraps = 0;
+	Uint32 ticks = SDL_GetTicks();
+
+	if ( ticks < last_ticks ) {
+		++wraps;
+	}
+	last_ticks = ticks;
+	return ((((Uint64)wraps << 32) + ticks) * 1000000);
+}
+
+void SDL_DelayUntilNS(Uint64 deadline)
+{
+	Uint64 now = SDL_GetTicksNS();
+
+	if ( deadline > now ) {
+		SDL_Delay((Uint32)((deadline - now + 999999) / 1000000));
+	}
+}
+#endif /* !SDL_TIMER_UNIX */
+
+void SDL_DelayNS(Uint64 ns)
+{
+	SDL_DelayUntilNS(SDL_GetTicksNS() + ns);
+}
+
+/* Heap maintenance -- called with the timer mutex held */
+static void SDL_TimerHeapSet(int index, SDL_TimerID t)
+{
+	SDL_timers[index] = t;
+	t->index = index;
+}
+
+static void SDL_TimerHeapUp(int index)
+{
+	SDL_TimerID t = SDL_timers[index];
+
+	while ( index > 0 ) {
+		int parent = (index-1)/2;
+		if ( SDL_timers[parent]->deadline <= t->deadline ) {
+			break;
+		}
+		SDL_TimerHeapSet(index, SDL_timers[parent]);
+		index = parent;
+	}
+	SDL_TimerHeapSet(index, t);
+}
+
+static void SDL_TimerHeapDown(int index)
+{
+	SDL_TimerID t = SDL_timers[index];
+
+	for ( ; ; ) {
+		int child = 2*index+1;
+		if ( child >= SDL_num_timers ) {
+			break;
+		}
+		if ( child+1 < SDL_num_timers &&
+		     SDL_timers[child+1]->deadline < SDL_timers[child]->deadline ) {
+			++child;
+		}
+		if ( t->deadline <= SDL_timers[child]->deadline ) {
+			break;
+		}
+		SDL_TimerHeapSet(index, SDL_timers[child]);
+		index = child;
+	}
+	SDL_TimerHeapSet(index, t);
+}
+
+static int SDL_TimerHeapInsert(SDL_TimerID t)
+{
+	if ( SDL_num_timers == SDL_max_timers ) {
+		int size = SDL_max_timers ? SDL_max_timers*2 : 16;
+		SDL_TimerID *timers;
+
+		timers = (SDL_TimerID *)SDL_realloc(SDL_timers, size*sizeof(*timers));
+		if ( timers == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		SDL_timers = timers;
+		SDL_max_timers = size;
+	}
+	SDL_timers[SDL_num_timers] = t;
+	SDL_TimerHeapUp(SDL_num_timers++);
+	return(0);
+}
+
+static void SDL_TimerHeapRemove(SDL_TimerID t)
+{
+	int index = t->index;
+	SDL_TimerID last = SDL_timers[--SDL_num_timers];
+
+	t->index = -1;
+	if ( last != t ) {
+		SDL_TimerHeapSet(index, last);
+		if ( index > 0 &&
+		     SDL_timers[(index-1)/2]->deadline > last->deadline ) {
+			SDL_TimerHeapUp(index);
+		} else {
+			SDL_TimerHeapDown(index);
+		}
+	}
+}
+
+/* Put a timer structure back on the free list -- called with the mutex held */
+static void SDL_FreeTimer(SDL_TimerID t)
+{
+	t->cb = NULL;
+	t->index = -1;
+	t->next = SDL_free_timers;
+	SDL_free_timers = t;
+	--SDL_timer_running;
+}
+
+/* Let the timer thread know it has to recompute its sleep time */
+static void SDL_TimerChanged(void)
+{
+	SDL_timer_changed = SDL_TRUE;
+	if ( SDL_timer_cond ) {
+		SDL_CondSignal(SDL_timer_cond);
+	}
+}
 
 /* Set whether or not the timer should use a thread.
    This should not be called while the timer subsystem is running.
@@ -80,6 +237,7 @@ int SDL_TimerInit(void)
 	}
 	if ( SDL_timer_threaded ) {
 		SDL_timer_mutex = SDL_CreateMutex();
+		SDL_timer_cond = SDL_CreateCond();
 	}
 	if ( retval == 0 ) {
 		SDL_timer_started = 1;
@@ -94,87 +252,143 @@ void SDL_TimerQuit(void)
 		SDL_SYS_TimerQuit();
 	}
 	if ( SDL_timer_threaded ) {
+		SDL_DestroyCond(SDL_timer_cond);
+		SDL_timer_cond = NULL;
 		SDL_DestroyMutex(SDL_timer_mutex);
 		SDL_timer_mutex = NULL;
 	}
+	while ( SDL_free_timers ) {
+		SDL_TimerID freeme = SDL_free_timers;
+		SDL_free_timers = freeme->next;
+		SDL_free(freeme);
+	}
+	if ( SDL_timers ) {
+		SDL_free(SDL_timers);
+		SDL_timers = NULL;
+	}
+	SDL_max_timers = 0;
 	SDL_timer_started = 0;
 	SDL_timer_threaded = 0;
 }
 
 void SDL_ThreadedTimerCheck(void)
 {
-	Uint32 now, ms;
-	SDL_TimerID t, prev, next;
-	SDL_bool removed;
+	Uint64 now;
+	Uint32 ms;
+	SDL_TimerID t;
 
 	SDL_mutexP(SDL_timer_mutex);
-	list_changed = SDL_FALSE;
-	now = SDL_GetTicks();
-	for ( prev = NULL, t = SDL_timers; t; t = next ) {
-		removed = SDL_FALSE;
-		ms = t->interval - SDL_TIMESLICE;
-		next = t->next;
-		if ( (int)(now - t->last_alarm) > (int)ms ) {
-			struct _SDL_TimerID timer;
-
-			if ( (now - t->last_alarm) < t->interval ) {
-				t->last_alarm += t->interval;
-			} else {
-				t->last_alarm = now;
-			}
+	now = SDL_TimerNow();
+	while ( SDL_num_timers > 0 && SDL_timers[0]->deadline <= now ) {
+		t = SDL_timers[0];
+		SDL_TimerHeapRemove(t);
 #ifdef DEBUG_TIMERS
-			printf("Executing timer %p (thread = %d)\n",
-				t, SDL_ThreadID());
+		printf("Executing timer %p (thread = %d)\n",
+			t, SDL_ThreadID());
 #endif
-			timer = *t;
-			SDL_mutexV(SDL_timer_mutex);
-			ms = timer.cb(timer.interval, timer.param);
-			SDL_mutexP(SDL_timer_mutex);
-			if ( list_changed ) {
-				/* Abort, list of timers modified */
-				/* FIXME: what if ms was changed? */
-				break;
-			}
-			if ( ms != t->interval ) {
-				if ( ms ) {
-					t->interval = ROUND_RESOLUTION(ms);
-				} else {
-					/* Remove timer from the list */
+		/* The timer may be removed while the mutex is released */
+		SDL_current_timer = t;
+		SDL_current_removed = SDL_FALSE;
+		SDL_mutexV(SDL_timer_mutex);
+		ms = t->cb(t->interval, t->param);
+		SDL_mutexP(SDL_timer_mutex);
+		SDL_current_timer = NULL;
+
+		if ( SDL_current_removed ) {
+			continue;
+		}
+		if ( ! ms ) {
 #ifdef DEBUG_TIMERS
-					printf("SDL: Removing timer %p\n", t);
+			printf("SDL: Removing timer %p\n", t);
 #endif
-					if ( prev ) {
-						prev->next = next;
-					} else {
-						SDL_timers = next;
-					}
-					SDL_free(t);
-					--SDL_timer_running;
-					removed = SDL_TRUE;
+			SDL_FreeTimer(t);
+			continue;
+		}
+		if ( ms != t->interval ) {
+			t->interval = t->precise ? ms : ROUND_RESOLUTION(ms);
+		}
+		/* Keep the period steady, unless we're more than a period late */
+		t->deadline += t->precise ? t->interval : (Uint64)t->interval*1000;
+		if ( t->deadline <= now ) {
+			t->deadline = now + (t->precise ? t->interval :
+			                     (Uint64)t->interval*1000);
+		}
+		if ( SDL_TimerHeapInsert(t) < 0 ) {
+			SDL_FreeTimer(t);
+		}
+	}
+	SDL_mutexV(SDL_timer_mutex);
+}
+
+void SDL_ThreadedTimerWait(void)
+{
+	if ( ! SDL_timer_mutex || ! SDL_timer_cond ) {
+		/* Not completely initialized yet */
+		SDL_Delay(1);
+		return;
+	}
+
+	SDL_mutexP(SDL_timer_mutex);
+	if ( ! SDL_timer_changed ) {
+		if ( SDL_num_timers == 0 ) {
+			SDL_CondWait(SDL_timer_cond, SDL_timer_mutex);
+		} else {
+			Uint64 now = SDL_TimerNow();
+			Uint64 deadline = SDL_timers[0]->deadline;
+
+			if ( deadline > now + 1000 ) {
+				Uint64 ms = (deadline - now) / 1000;
+				if ( ms > 0x7FFFFFFF ) {
+					ms = 0x7FFFFFFF;
 				}
+				SDL_CondWaitTimeout(SDL_timer_cond,
+				                    SDL_timer_mutex, (Uint32)ms);
+			} else if ( deadline > now ) {
+				/* Less than a millisecond left, just yield */
+				SDL_mutexV(SDL_timer_mutex);
+				SDL_Delay(0);
+				SDL_mutexP(SDL_timer_mutex);
 			}
 		}
-		/* Don't update prev if the timer has disappeared */
-		if ( ! removed ) {
-			prev = t;
-		}
 	}
+	SDL_timer_changed = SDL_FALSE;
 	SDL_mutexV(SDL_timer_mutex);
 }
 
-static SDL_TimerID SDL_AddTimerInternal(Uint32 interval, SDL_NewTimerCallback callback, void *param)
+void SDL_ThreadedTimerWakeup(void)
+{
+	if ( SDL_timer_mutex ) {
+		SDL_mutexP(SDL_timer_mutex);
+		SDL_TimerChanged();
+		SDL_mutexV(SDL_timer_mutex);
+	}
+}
+
+static SDL_TimerID SDL_AddTimerInternal(Uint32 interval, SDL_NewTimerCallback callback, void *param, int precise)
 {
 	SDL_TimerID t;
-	t = (SDL_TimerID) SDL_malloc(sizeof(struct _SDL_TimerID));
+
+	if ( SDL_free_timers ) {
+		t = SDL_free_timers;
+		SDL_free_timers = t->next;
+	} else {
+		t = (SDL_TimerID) SDL_malloc(sizeof(struct _SDL_TimerID));
+	}
 	if ( t ) {
-		t->interval = ROUND_RESOLUTION(interval);
+		t->interval = precise ? interval : ROUND_RESOLUTION(interval);
 		t->cb = callback;
 		t->param = param;
-		t->last_alarm = SDL_GetTicks();
-		t->next = SDL_timers;
-		SDL_timers = t;
+		t->precise = precise;
+		t->deadline = SDL_TimerNow() +
+			(precise ? t->interval : (Uint64)t->interval*1000);
+		t->next = NULL;
 		++SDL_timer_running;
-		list_changed = SDL_TRUE;
+		if ( SDL_TimerHeapInsert(t) < 0 ) {
+			SDL_FreeTimer(t);
+			t = NULL;
+		} else {
+			SDL_TimerChanged();
+		}
 	}
 #ifdef DEBUG_TIMERS
 	printf("SDL_AddTimer(%d) = %08x num_timers = %d\n", interval, (Uint32)t, SDL_timer_running);
@@ -182,7 +396,7 @@ static SDL_TimerID SDL_AddTimerInternal(Uint32 interval, SDL_NewTimerCallback ca
 	return t;
 }
 
-SDL_TimerID SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *param)
+static SDL_TimerID SDL_AddTimerChecked(Uint32 interval, SDL_NewTimerCallback callback, void *param, int precise)
 {
 	SDL_TimerID t;
 	if ( ! SDL_timer_mutex ) {
@@ -198,32 +412,38 @@ SDL_TimerID SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *p
 		return NULL;
 	}
 	SDL_mutexP(SDL_timer_mutex);
-	t = SDL_AddTimerInternal(interval, callback, param);
+	t = SDL_AddTimerInternal(interval, callback, param, precise);
 	SDL_mutexV(SDL_timer_mutex);
 	return t;
 }
 
+SDL_TimerID SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *param)
+{
+	return SDL_AddTimerChecked(interval, callback, param, 0);
+}
+
+SDL_TimerID SDL_AddPreciseTimer(Uint32 interval, SDL_NewTimerCallback callback, void *param)
+{
+	return SDL_AddTimerChecked(interval, callback, param, 1);
+}
+
 SDL_bool SDL_RemoveTimer(SDL_TimerID id)
 {
-	SDL_TimerID t, prev = NULL;
 	SDL_bool removed;
 
 	removed = SDL_FALSE;
 	SDL_mutexP(SDL_timer_mutex);
-	/* Look for id in the linked list of timers */
-	for (t = SDL_timers; t; prev=t, t = t->next ) {
-		if ( t == id ) {
-			if(prev) {
-				prev->next = t->next;
-			} else {
-				SDL_timers = t->next;
-			}
-			SDL_free(t);
-			--SDL_timer_running;
-			removed = SDL_TRUE;
-			list_changed = SDL_TRUE;
-			break;
-		}
+	if ( id && id == SDL_current_timer && !SDL_current_removed ) {
+		/* The callback is running, free it when it returns */
+		SDL_FreeTimer(id);
+		SDL_current_removed = SDL_TRUE;
+		removed = SDL_TRUE;
+	} else if ( id && id->index >= 0 && id->index < SDL_num_timers &&
+	            SDL_timers[id->index] == id ) {
+		SDL_TimerHeapRemove(id);
+		SDL_FreeTimer(id);
+		SDL_TimerChanged();
+		removed = SDL_TRUE;
 	}
 #ifdef DEBUG_TIMERS
 	printf("SDL_RemoveTimer(%08x) = %d num_timers = %d thread = %d\n", (Uint32)id, removed, SDL_timer_running, SDL_ThreadID());
@@ -253,13 +473,17 @@ int SDL_SetTimer(Uint32 ms, SDL_TimerCallback callback)
 	}
 	if ( SDL_timer_running ) {	/* Stop any currently running timer */
 		if ( SDL_timer_threaded ) {
-			while ( SDL_timers ) {
-				SDL_TimerID freeme = SDL_timers;
-				SDL_timers = SDL_timers->next;
-				SDL_free(freeme);
+			while ( SDL_num_timers > 0 ) {
+				SDL_TimerID freeme = SDL_timers[0];
+				SDL_TimerHeapRemove(freeme);
+				SDL_FreeTimer(freeme);
+			}
+			if ( SDL_current_timer && !SDL_current_removed ) {
+				SDL_FreeTimer(SDL_current_timer);
+				SDL_current_removed = SDL_TRUE;
 			}
 			SDL_timer_running = 0;
-			list_changed = SDL_TRUE;
+			SDL_TimerChanged();
 		} else {
 			SDL_SYS_StopTimer();
 			SDL_timer_running = 0;
@@ -267,7 +491,7 @@ int SDL_SetTimer(Uint32 ms, SDL_TimerCallback callback)
 	}
 	if ( ms ) {
 		if ( SDL_timer_threaded ) {
-			if ( SDL_AddTimerInternal(ms, callback_wrapper, (void *)callback) == NULL ) {
+			if ( SDL_AddTimerInternal(ms, callback_wrapper, (void *)callback, 0) == NULL ) {
 				retval = -1;
 			}
 		} else {
@@ -44,3 +44,9 @@ extern void SDL_TimerQuit(void);
 
 /* This function is called from the SDL event thread if it is available */
 extern void SDL_ThreadedTimerCheck(void);
+
+/* Sleep until the next timer is due or the set of timers changes */
+extern void SDL_ThreadedTimerWait(void);
+
+/* Wake up a thread blocked in SDL_ThreadedTimerWait() */
+extern void SDL_ThreadedTimerWakeup(void);
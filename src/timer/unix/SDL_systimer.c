@@ -31,7 +31,10 @@
 #include <errno.h>
 
 #include "SDL_timer.h"
+#include "SDL_cpuinfo.h"
 #include "../SDL_timer_c.h"
+#include "../../cpuinfo/SDL_cpuinfo_c.h"
+#include "../../thread/SDL_atomic_c.h"
 
 /* The clock_gettime provides monotonous time, so we should use it if
    it's available. The clock_gettime function is behind ifdef
@@ -42,6 +45,12 @@
 #include <time.h>
 #endif
 
+/* Read the time stamp counter directly if it runs at a constant rate,
+   it's several times cheaper than clock_gettime() */
+#if HAVE_CLOCK_GETTIME && defined(__GNUC__) && (defined(i386) || defined(__x86_64__))
+#define USE_RDTSC
+#endif
+
 #if SDL_THREAD_PTH
 #include <pth.h>
 #endif
@@ -58,6 +67,178 @@ static struct timeval start;
 #endif /* HAVE_CLOCK_GETTIME */
 
 
+#ifdef USE_RDTSC
+/* The TSC is calibrated against the monotonic clock over this long,
+   and the monotonic clock is used until then.
+ */
+#define TSC_CALIBRATION_NS	500000000
+
+/* After that the TSC is compared with the monotonic clock again this
+   often, and the difference made up over the next period, so the two
+   can't drift apart.
+ */
+#define TSC_RESYNC_NS		1000000000
+
+/* How the TSC is turned into ticks from one point on */
+typedef struct {
+	Uint64 base;		/* TSC value at the base point */
+	Uint64 base_ns;		/* Ticks at the base point */
+	Uint64 scale;		/* 32.32 fixed point ns per tick */
+	Uint64 resync;		/* TSC ticks until the next comparison */
+} TSCParams;
+
+/* Readers use tsc_params[tsc_seq & 1] and check that tsc_seq didn't
+   change while they did.  The single writer fills in the other set
+   before moving tsc_seq on, so readers never wait for it.  tsc_seq is
+   0 until the TSC is calibrated.
+ */
+static TSCParams tsc_params[2];
+static volatile Uint32 tsc_seq = 0;
+
+static int tsc_calibrating = 0;
+static int tsc_resyncing = 0;
+static Uint64 tsc_start;		/* The last comparison with the clock */
+static Uint64 tsc_start_ns;
+static Uint64 tsc_rate;			/* 32.32 ns per tick, measured */
+
+/* x86 doesn't reorder loads with loads, only the compiler might */
+#define TSC_READ_BARRIER()	__asm__ __volatile__ ("" : : : "memory")
+
+static __inline__ Uint64 ReadTSC(void)
+{
+	Uint32 lo, hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((Uint64)hi << 32) | lo;
+}
+
+static __inline__ Uint64 TSCToNS(Uint64 ticks, Uint64 scale)
+{
+	Uint64 th = ticks >> 32, tl = ticks & 0xFFFFFFFF;
+	Uint64 sh = scale >> 32, sl = scale & 0xFFFFFFFF;
+
+	return ((th * sh) << 32) + th * sl + tl * sh + ((tl * sl) >> 32);
+}
+
+static __inline__ Uint64 GetMonotonicNS(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (Uint64)(now.tv_sec-start.tv_sec)*1000000000+now.tv_nsec-start.tv_nsec;
+}
+
+/* Start turning the TSC into ticks from a new base point */
+static void SetTSCParams(Uint64 tsc, Uint64 ns, Uint64 scale)
+{
+	TSCParams *next = &tsc_params[(tsc_seq + 1) & 1];
+
+	next->base = tsc;
+	next->base_ns = ns;
+	next->scale = scale;
+	next->resync = ((Uint64)TSC_RESYNC_NS << 32) / scale;
+	SDL_MemoryBarrier();
+	if ( ++tsc_seq == 0 ) {
+		/* Don't wrap around to uncalibrated */
+		tsc_seq = 2;
+	}
+}
+
+static void CalibrateTSC(Uint64 ns)
+{
+	Uint64 tsc, elapsed;
+
+	/* Only one thread gets to do this */
+	if ( ! SDL_AtomicCAS(&tsc_calibrating, 1, 0) ) {
+		return;
+	}
+	tsc = ReadTSC();
+	elapsed = ns - tsc_start_ns;
+	if ( tsc <= tsc_start || elapsed >= ((Uint64)1 << 32) ) {
+		/* Too long since the last check, start over */
+		tsc_start = tsc;
+		tsc_start_ns = ns;
+		tsc_calibrating = 1;
+		return;
+	}
+	tsc_rate = (elapsed << 32) / (tsc - tsc_start);
+	tsc_start = tsc;
+	tsc_start_ns = ns;
+	SetTSCParams(tsc, ns, tsc_rate);
+}
+
+/* Compare the TSC with the monotonic clock again.  The ticks never go
+   back, so the difference is made up by running a little faster or
+   slower until the next comparison.
+ */
+static void ResyncTSC(const TSCParams *params)
+{
+	Uint64 tsc, ns, ticks, elapsed, scale, adjust;
+	Sint64 error;
+
+	/* Only one thread gets to do this */
+	if ( ! SDL_AtomicCAS(&tsc_resyncing, 0, 1) ) {
+		return;
+	}
+	if ( params != &tsc_params[tsc_seq & 1] ) {
+		/* Another thread just did it */
+		tsc_resyncing = 0;
+		return;
+	}
+	tsc = ReadTSC();
+	ns = GetMonotonicNS();
+	ticks = params->base_ns + TSCToNS(tsc - params->base, params->scale);
+
+	/* The rate is only measured if it fits the fixed point math */
+	elapsed = ns - tsc_start_ns;
+	if ( tsc > tsc_start && elapsed < ((Uint64)1 << 32) ) {
+		tsc_rate = (elapsed << 32) / (tsc - tsc_start);
+	}
+	tsc_start = tsc;
+	tsc_start_ns = ns;
+
+	error = (Sint64)(ticks - ns);
+	if ( error < -(TSC_RESYNC_NS/2) ) {
+		/* Far behind, say after a suspend, so jump ahead */
+		ticks = ns;
+		error = 0;
+	} else if ( error > TSC_RESYNC_NS/2 ) {
+		/* Far ahead, wait at half speed */
+		error = TSC_RESYNC_NS/2;
+	}
+	adjust = (tsc_rate * (Uint64)(error < 0 ? -error : error)) / TSC_RESYNC_NS;
+	scale = (error < 0) ? tsc_rate + adjust : tsc_rate - adjust;
+	SetTSCParams(tsc, ticks, scale);
+
+	SDL_MemoryBarrier();
+	tsc_resyncing = 0;
+}
+
+static Uint64 GetTicksTSC(void)
+{
+	const TSCParams *params;
+	Uint32 seq;
+	Uint64 ticks, ns;
+
+	do {
+		seq = tsc_seq;
+		TSC_READ_BARRIER();
+		params = &tsc_params[seq & 1];
+		ticks = ReadTSC() - params->base;
+		if ( (Sint64)ticks < 0 ) {
+			/* Read on another CPU just before the base point */
+			ticks = 0;
+		}
+		ns = params->base_ns + TSCToNS(ticks, params->scale);
+		TSC_READ_BARRIER();
+	} while ( seq != tsc_seq );
+
+	if ( ticks >= params->resync ) {
+		ResyncTSC(params);
+	}
+	return(ns);
+}
+#endif /* USE_RDTSC */
+
 void SDL_StartTicks(void)
 {
 	/* Set first ticks value */
@@ -66,6 +247,20 @@ void SDL_StartTicks(void)
 #else
 	gettimeofday(&start, NULL);
 #endif
+#ifdef USE_RDTSC
+	tsc_seq = 0;
+	tsc_calibrating = 0;
+	tsc_resyncing = 0;
+	if ( SDL_HasRDTSC() && SDL_HasInvariantTSC() ) {
+		const char *hint = SDL_getenv("SDL_TIMER_RDTSC");
+		if ( !hint || SDL_atoi(hint) ) {
+			/* Checking the CPU may have taken a while */
+			tsc_start = ReadTSC();
+			tsc_start_ns = GetMonotonicNS();
+			tsc_calibrating = 1;
+		}
+	}
+#endif
 }
 
 Uint32 SDL_GetTicks (void)
@@ -85,6 +280,79 @@ Uint32 SDL_GetTicks (void)
 #endif
 }
 
+Uint64 SDL_GetTicksNS (void)
+{
+#if HAVE_CLOCK_GETTIME
+	Uint64 ns;
+	struct timespec now;
+#ifdef USE_RDTSC
+	if ( tsc_seq ) {
+		return GetTicksTSC();
+	}
+#endif
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	ns=(Uint64)(now.tv_sec-start.tv_sec)*1000000000+now.tv_nsec-start.tv_nsec;
+#ifdef USE_RDTSC
+	if ( tsc_calibrating && ns - tsc_start_ns >= TSC_CALIBRATION_NS ) {
+		CalibrateTSC(ns);
+	}
+#endif
+	return(ns);
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return(((Uint64)(now.tv_sec-start.tv_sec)*1000000+now.tv_usec-start.tv_usec)*1000);
+#endif
+}
+
+void SDL_DelayUntilNS (Uint64 deadline)
+{
+	Uint64 now;
+
+	now = SDL_GetTicksNS();
+	if ( now >= deadline ) {
+		return;
+	}
+#if HAVE_CLOCK_NANOSLEEP && !SDL_THREAD_PTH
+	{
+		/* Sleep until an absolute time, so being interrupted or
+		   preempted doesn't add up over a series of delays.  The
+		   ticks may come from the TSC, which only follows the
+		   monotonic clock, so the deadline is moved over to that
+		   clock by how far away it is now.
+		 */
+		struct timespec tv;
+		Uint64 when;
+
+		clock_gettime(CLOCK_MONOTONIC, &tv);
+		now = SDL_GetTicksNS();
+		if ( now >= deadline ) {
+			return;
+		}
+		when = (Uint64)tv.tv_sec*1000000000+tv.tv_nsec+(deadline-now);
+		tv.tv_sec = (time_t)(when / 1000000000);
+		tv.tv_nsec = (long)(when % 1000000000);
+		while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tv, NULL) == EINTR ) {
+			/* Keep sleeping */
+		}
+	}
+#else
+	while ( deadline - now >= 1000000 ) {
+		SDL_Delay((Uint32)((deadline - now) / 1000000));
+		now = SDL_GetTicksNS();
+		if ( now >= deadline ) {
+			return;
+		}
+	}
+#endif
+	/* The monotonic clock was read a little before the ticks, so the
+	   sleep can end a little early; finish on the ticks themselves.
+	 */
+	while ( SDL_GetTicksNS() < deadline ) {
+		/* Spin */
+	}
+}
+
 void SDL_Delay (Uint32 ms)
 {
 #if SDL_THREAD_PTH
@@ -200,7 +468,7 @@ static int RunTimer(void *unused)
 		if ( SDL_timer_running ) {
 			SDL_ThreadedTimerCheck();
 		}
-		SDL_Delay(1);
+		SDL_ThreadedTimerWait();
 	}
 	return(0);
 }
@@ -219,6 +487,7 @@ void SDL_SYS_TimerQuit(void)
 {
 	timer_alive = 0;
 	if ( timer ) {
+		SDL_ThreadedTimerWakeup();
 		SDL_WaitThread(timer, NULL);
 		timer = NULL;
 	}
@@ -22,10 +22,13 @@
 #include "SDL_config.h"
 
 #include "SDL_video.h"
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
 #include "SDL_pixels_c.h"
+#include "SDL_stretch_c.h"
 
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && SDL_ASSEMBLY_ROUTINES
 #define MMX_ASMBLIT
@@ -39,6 +42,254 @@
 #include "mmx.h"
 #endif
 
+/* Work split into horizontal bands can be run in parallel by a pool of
+   worker threads, which is shared by the software blitter and the YUV
+   overlay converters.  This is disabled unless the SDL_BLIT_THREADS or
+   SDL_YUV_THREADS environment variables are set to the number of
+   threads to use (including the calling thread) when the video
+   subsystem is initialized.  The pool is as large as the larger of the
+   two, and each kind of work is split across as many threads as its
+   own variable asks for.  Blits smaller than SDL_BLIT_THREADS_AREA
+   pixels are always run on the calling thread.
+*/
+#define SDL_BLIT_THREADS_AREA	(256*256)
+#define SDL_MIN_BLIT_BAND	8	/* Minimum rows in a band */
+
+#if !SDL_THREADS_DISABLED
+
+typedef struct {
+	SDL_Thread *thread;
+	SDL_sem *start;
+	void *band;
+} SDL_BandWorker;
+
+static struct {
+	int nworkers;
+	int nthreads[SDL_BAND_USERS];
+	int min_area;
+	SDL_BandFunc run;
+	volatile int quit;
+	SDL_mutex *lock;
+	SDL_sem *done;
+	SDL_BandWorker workers[SDL_MAX_BAND_THREADS-1];
+} SDL_BandPool;
+
+static int SDL_BandWorkerThread(void *data)
+{
+	SDL_BandWorker *worker = (SDL_BandWorker *)data;
+
+	for ( ; ; ) {
+		SDL_SemWait(worker->start);
+		if ( SDL_BandPool.quit ) {
+			break;
+		}
+		SDL_BandPool.run(worker->band);
+		SDL_SemPost(SDL_BandPool.done);
+	}
+	return(0);
+}
+
+/* Get the number of threads asked for by an environment variable */
+static int SDL_GetBandThreadsEnv(const char *name)
+{
+	const char *env;
+	int nthreads;
+
+	env = SDL_getenv(name);
+	nthreads = env ? SDL_atoi(env) : 0;
+	if ( nthreads < 1 ) {
+		nthreads = 1;
+	}
+	if ( nthreads > SDL_MAX_BAND_THREADS ) {
+		nthreads = SDL_MAX_BAND_THREADS;
+	}
+	return(nthreads);
+}
+
+void SDL_BandThreadsInit(void)
+{
+	const char *env;
+	int nthreads;
+	int i;
+
+	/* Make sure we start from a clean state */
+	SDL_BandThreadsQuit();
+
+	SDL_BandPool.nthreads[SDL_BAND_BLIT] =
+		SDL_GetBandThreadsEnv("SDL_BLIT_THREADS");
+	SDL_BandPool.nthreads[SDL_BAND_YUV] =
+		SDL_GetBandThreadsEnv("SDL_YUV_THREADS");
+	env = SDL_getenv("SDL_BLIT_THREADS_AREA");
+	SDL_BandPool.min_area = env ? SDL_atoi(env) : SDL_BLIT_THREADS_AREA;
+	nthreads = SDL_max(SDL_BandPool.nthreads[SDL_BAND_BLIT],
+	                   SDL_BandPool.nthreads[SDL_BAND_YUV]);
+	if ( nthreads <= 1 ) {
+		return;
+	}
+
+	SDL_BandPool.quit = 0;
+	SDL_BandPool.lock = SDL_CreateMutex();
+	SDL_BandPool.done = SDL_CreateSemaphore(0);
+	if ( !SDL_BandPool.lock || !SDL_BandPool.done ) {
+		SDL_BandThreadsQuit();
+		return;
+	}
+
+	/* If we can't get all the threads we asked for, use what we have */
+	for ( i = 0; i < nthreads-1; ++i ) {
+		SDL_BandWorker *worker = &SDL_BandPool.workers[i];
+
+		worker->start = SDL_CreateSemaphore(0);
+		if ( worker->start == NULL ) {
+			break;
+		}
+		worker->thread = SDL_CreateThread(SDL_BandWorkerThread, worker);
+		if ( worker->thread == NULL ) {
+			SDL_DestroySemaphore(worker->start);
+			worker->start = NULL;
+			break;
+		}
+		++SDL_BandPool.nworkers;
+	}
+}
+
+void SDL_BandThreadsQuit(void)
+{
+	int i;
+
+	SDL_BandPool.quit = 1;
+	for ( i = 0; i < SDL_BandPool.nworkers; ++i ) {
+		SDL_SemPost(SDL_BandPool.workers[i].start);
+	}
+	for ( i = 0; i < SDL_BandPool.nworkers; ++i ) {
+		SDL_BandWorker *worker = &SDL_BandPool.workers[i];
+
+		SDL_WaitThread(worker->thread, NULL);
+		worker->thread = NULL;
+		SDL_DestroySemaphore(worker->start);
+		worker->start = NULL;
+	}
+	SDL_BandPool.nworkers = 0;
+
+	if ( SDL_BandPool.done ) {
+		SDL_DestroySemaphore(SDL_BandPool.done);
+		SDL_BandPool.done = NULL;
+	}
+	if ( SDL_BandPool.lock ) {
+		SDL_DestroyMutex(SDL_BandPool.lock);
+		SDL_BandPool.lock = NULL;
+	}
+}
+
+int SDL_BandThreads(SDL_BandUser user)
+{
+	int nthreads;
+
+	nthreads = SDL_BandPool.nworkers + 1;
+	if ( nthreads > SDL_BandPool.nthreads[user] ) {
+		nthreads = SDL_BandPool.nthreads[user];
+	}
+	return(nthreads > 1 ? nthreads : 1);
+}
+
+void SDL_RunBands(SDL_BandFunc run, void *bands, int size, int nbands)
+{
+	Uint8 *band = (Uint8 *)bands;
+	int i;
+
+	if ( nbands < 2 ) {
+		if ( nbands == 1 ) {
+			run(band);
+		}
+		return;
+	}
+	SDL_mutexP(SDL_BandPool.lock);
+	SDL_BandPool.run = run;
+	for ( i = 1; i < nbands; ++i ) {
+		SDL_BandPool.workers[i-1].band = band + i*size;
+		SDL_SemPost(SDL_BandPool.workers[i-1].start);
+	}
+	run(band);
+	for ( i = 1; i < nbands; ++i ) {
+		SDL_SemWait(SDL_BandPool.done);
+	}
+	SDL_mutexV(SDL_BandPool.lock);
+}
+
+/* A band of a blit for one thread */
+typedef struct {
+	SDL_loblit blit;
+	SDL_BlitInfo info;
+} SDL_BlitBand;
+
+static void SDL_RunBlitBand(void *data)
+{
+	SDL_BlitBand *band = (SDL_BlitBand *)data;
+
+	band->blit(&band->info);
+}
+
+/* Run a blit split into bands, the calling thread doing the first one */
+static void SDL_ThreadedBlit(SDL_loblit RunBlit, SDL_BlitInfo *info,
+				int srcpitch, int dstpitch)
+{
+	SDL_BlitBand bands[SDL_MAX_BAND_THREADS];
+	int nbands, rows, extra;
+	int i, y, h;
+
+	nbands = SDL_BandThreads(SDL_BAND_BLIT);
+	if ( nbands > info->d_height / SDL_MIN_BLIT_BAND ) {
+		nbands = info->d_height / SDL_MIN_BLIT_BAND;
+	}
+	if ( nbands < 2 ) {
+		RunBlit(info);
+		return;
+	}
+	rows = info->d_height / nbands;
+	extra = info->d_height % nbands;
+
+	y = 0;
+	for ( i = 0; i < nbands; ++i ) {
+		SDL_BlitBand *band = &bands[i];
+
+		h = rows + (i < extra);
+		band->blit = RunBlit;
+		band->info = *info;
+		band->info.s_pixels += y*srcpitch;
+		band->info.d_pixels += y*dstpitch;
+		band->info.s_height = h;
+		band->info.d_height = h;
+		y += h;
+	}
+	SDL_RunBands(SDL_RunBlitBand, bands, sizeof(bands[0]), nbands);
+}
+
+#else
+
+void SDL_BandThreadsInit(void)
+{
+}
+
+void SDL_BandThreadsQuit(void)
+{
+}
+
+int SDL_BandThreads(SDL_BandUser user)
+{
+	return(1);
+}
+
+void SDL_RunBands(SDL_BandFunc run, void *bands, int size, int nbands)
+{
+	int i;
+
+	for ( i = 0; i < nbands; ++i ) {
+		run((Uint8 *)bands + i*size);
+	}
+}
+
+#endif /* !SDL_THREADS_DISABLED */
+
 /* The general purpose software blit routine */
 static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 			SDL_Surface *dst, SDL_Rect *dstrect)
@@ -94,6 +345,13 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		RunBlit = src->map->sw_data->blit;
 
 		/* Run the actual software blit */
+#if !SDL_THREADS_DISABLED
+		/* Blits within one surface may overlap, so keep them serial */
+		if ( SDL_BandPool.nworkers > 0 && src != dst &&
+		     info.d_width*info.d_height >= SDL_BandPool.min_area ) {
+			SDL_ThreadedBlit(RunBlit, &info, src->pitch, dst->pitch);
+		} else
+#endif
 		RunBlit(&info);
 	}
 
@@ -229,6 +487,191 @@ static void SDL_BlitCopyOverlap(SDL_BlitInfo *info)
 	}
 }
 
+/* The scaled software blit: the source is scaled a band of rows at a
+   time into a buffer in the source format, small enough to stay in the
+   cache, and the blitter of the blit map then converts and blends the
+   band onto the destination.  'clip' is the part of 'dstrect' to draw.
+*/
+#define SDL_SCALED_BAND_BYTES	(32*1024)
+
+int SDL_SoftBlitScaled(SDL_Surface *src, SDL_Rect *srcrect,
+                       SDL_Surface *dst, SDL_Rect *dstrect,
+                       SDL_Rect *clip, SDL_ScaleMode mode)
+{
+	SDL_Stretch *stretch;
+	SDL_BlitInfo info;
+	SDL_loblit RunBlit;
+	Uint8 *band, *dstp;
+	int src_locked;
+	int dst_locked;
+	int rowbytes, rows, y, h, i;
+	int retval;
+
+	/* Check to make sure the blit mapping is valid */
+	if ( (src->map->dst != dst) ||
+	     (src->map->dst->format_version != src->map->format_version) ) {
+		if ( SDL_MapSurface(src, dst) < 0 ) {
+			return(-1);
+		}
+	}
+
+	/* Filtering would blend the color key into the pixels around it */
+	if ( src->flags & SDL_SRCCOLORKEY ) {
+		mode = SDL_SCALE_NEAREST;
+	}
+
+	/* Lock the destination if it's in hardware */
+	dst_locked = 0;
+	if ( SDL_MUSTLOCK(dst) ) {
+		if ( SDL_LockSurface(dst) < 0 ) {
+			SDL_SetError("Unable to lock destination surface");
+			return(-1);
+		}
+		dst_locked = 1;
+	}
+	/* Lock the source if it's in hardware, or decode it if it's RLE */
+	src_locked = 0;
+	if ( SDL_MUSTLOCK(src) ) {
+		if ( SDL_LockSurface(src) < 0 ) {
+			if ( dst_locked ) {
+				SDL_UnlockSurface(dst);
+			}
+			SDL_SetError("Unable to lock source surface");
+			return(-1);
+		}
+		src_locked = 1;
+	}
+
+	retval = -1;
+	stretch = SDL_CreateStretch(src, srcrect, dstrect, clip, mode);
+	if ( stretch ) {
+		dstp = (Uint8 *)dst->pixels + clip->y*dst->pitch +
+		       clip->x*dst->format->BytesPerPixel;
+		RunBlit = src->map->sw_data->blit;
+		if ( RunBlit == SDL_BlitCopy ) {
+			/* Same format, no blending, scale straight into it */
+			for ( y = 0; y < clip->h; ++y ) {
+				SDL_StretchNextRow(stretch, dstp);
+				dstp += dst->pitch;
+			}
+			retval = 0;
+		} else {
+			rowbytes = clip->w*src->format->BytesPerPixel;
+			rows = SDL_SCALED_BAND_BYTES / rowbytes;
+			if ( rows < 1 ) {
+				rows = 1;
+			}
+			if ( rows > clip->h ) {
+				rows = clip->h;
+			}
+			band = (Uint8 *)SDL_malloc(rows*rowbytes);
+			if ( band == NULL ) {
+				SDL_OutOfMemory();
+				y = clip->h;
+			} else {
+				retval = 0;
+				y = 0;
+			}
+			for ( ; y < clip->h; y += h ) {
+				h = clip->h - y;
+				if ( h > rows ) {
+					h = rows;
+				}
+				for ( i = 0; i < h; ++i ) {
+					SDL_StretchNextRow(stretch, band+i*rowbytes);
+				}
+
+				info.s_pixels = band;
+				info.s_width = clip->w;
+				info.s_height = h;
+				info.s_skip = 0;
+				info.d_pixels = dstp;
+				info.d_width = clip->w;
+				info.d_height = h;
+				info.d_skip = dst->pitch -
+				      clip->w*dst->format->BytesPerPixel;
+				info.aux_data = src->map->sw_data->aux_data;
+				info.src = src->format;
+				info.table = src->map->table;
+				info.dst = dst->format;
+				RunBlit(&info);
+				dstp += h*dst->pitch;
+			}
+			SDL_free(band);
+		}
+		SDL_FreeStretch(stretch);
+	}
+
+	/* We need to unlock the surfaces if they're locked */
+	if ( dst_locked ) {
+		SDL_UnlockSurface(dst);
+	}
+	if ( src_locked ) {
+		SDL_UnlockSurface(src);
+	}
+	return(retval);
+}
+
+/* Look up the name of a blit routine in one of the blitter tables */
+static const char *SDL_FindBlitName(const SDL_BlitName *names, SDL_loblit blit)
+{
+	for ( ; names->blit; ++names ) {
+		if ( names->blit == blit ) {
+			return(names->name);
+		}
+	}
+	return(NULL);
+}
+
+/* Name the blit routine that would copy src onto dst, for benchmarks */
+const char *SDL_GetBlitName(SDL_Surface *src, SDL_Surface *dst)
+{
+	SDL_loblit blit;
+	const char *name;
+
+	if ( !src || !dst ) {
+		SDL_SetError("SDL_GetBlitName: passed a NULL surface");
+		return(NULL);
+	}
+	if ( (src->map->dst != dst) ||
+	     (src->map->dst->format_version != src->map->format_version) ) {
+		if ( SDL_MapSurface(src, dst) < 0 ) {
+			return(NULL);
+		}
+	}
+
+	if ( (src->flags & SDL_HWACCEL) == SDL_HWACCEL ) {
+		return("hardware");
+	}
+	if ( src->map->sw_blit == SDL_RLEBlit ) {
+		return("SDL_RLEBlit");
+	}
+	if ( src->map->sw_blit == SDL_RLEAlphaBlit ) {
+		return("SDL_RLEAlphaBlit");
+	}
+	blit = src->map->sw_data->blit;
+	if ( blit == SDL_BlitCopy ) {
+		return("SDL_BlitCopy");
+	}
+	if ( blit == SDL_BlitCopyOverlap ) {
+		return("SDL_BlitCopyOverlap");
+	}
+	name = SDL_FindBlitName(SDL_BlitNames0, blit);
+	if ( !name ) {
+		name = SDL_FindBlitName(SDL_BlitNames1, blit);
+	}
+	if ( !name ) {
+		name = SDL_FindBlitName(SDL_BlitNamesN, blit);
+	}
+	if ( !name ) {
+		name = SDL_FindBlitName(SDL_BlitNamesA, blit);
+	}
+	if ( !name ) {
+		name = "unknown";
+	}
+	return(name);
+}
+
 /* Figure out which of many blit routines to set up on a surface */
 int SDL_CalculateBlit(SDL_Surface *surface)
 {
@@ -67,8 +67,43 @@ typedef struct SDL_BlitMap {
 } SDL_BlitMap;
 
 
+/* The names of the blitters, for SDL_GetBlitName() */
+typedef struct {
+	SDL_loblit blit;
+	const char *name;
+} SDL_BlitName;
+#define SDL_BLIT_NAME(blit)	{ blit, #blit }
+
 /* Functions found in SDL_blit.c */
 extern int SDL_CalculateBlit(SDL_Surface *surface);
+extern int SDL_SoftBlitScaled(SDL_Surface *src, SDL_Rect *srcrect,
+                              SDL_Surface *dst, SDL_Rect *dstrect,
+                              SDL_Rect *clip, SDL_ScaleMode mode);
+
+/* Work split into bands of rows, run in parallel by the worker threads
+   shared by the software blitter and the YUV overlay converters.
+ */
+#define SDL_MAX_BAND_THREADS	16
+
+typedef enum {
+	SDL_BAND_BLIT,		/* Software blits, SDL_BLIT_THREADS */
+	SDL_BAND_YUV,		/* Software YUV overlays, SDL_YUV_THREADS */
+	SDL_BAND_USERS
+} SDL_BandUser;
+
+typedef void (*SDL_BandFunc)(void *band);
+
+/* Start and stop the worker threads, as many as the users asked for */
+extern void SDL_BandThreadsInit(void);
+extern void SDL_BandThreadsQuit(void);
+
+/* Returns how many bands a user's work should be split into */
+extern int SDL_BandThreads(SDL_BandUser user);
+
+/* Runs 'nbands' bands 'size' bytes apart, at most SDL_BandThreads() of
+   them, the calling thread doing the first one.
+ */
+extern void SDL_RunBands(SDL_BandFunc run, void *bands, int size, int nbands);
 
 /* Functions found in SDL_blit_{0,1,N,A}.c */
 extern SDL_loblit SDL_CalculateBlit0(SDL_Surface *surface, int complex);
@@ -76,6 +111,12 @@ extern SDL_loblit SDL_CalculateBlit1(SDL_Surface *surface, int complex);
 extern SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int complex);
 extern SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int complex);
 
+/* Blitter names found in SDL_blit_{0,1,N,A}.c, ending with a NULL blit */
+extern const SDL_BlitName SDL_BlitNames0[];
+extern const SDL_BlitName SDL_BlitNames1[];
+extern const SDL_BlitName SDL_BlitNamesN[];
+extern const SDL_BlitName SDL_BlitNamesA[];
+
 /*
  * Useful macros for blitting routines
  */
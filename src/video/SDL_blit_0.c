@@ -469,3 +469,16 @@ SDL_loblit SDL_CalculateBlit0(SDL_Surface *surface, int blit_index)
 	return NULL;
 }
 
+const SDL_BlitName SDL_BlitNames0[] = {
+	SDL_BLIT_NAME(BlitBto1),
+	SDL_BLIT_NAME(BlitBto2),
+	SDL_BLIT_NAME(BlitBto3),
+	SDL_BLIT_NAME(BlitBto4),
+	SDL_BLIT_NAME(BlitBto1Key),
+	SDL_BLIT_NAME(BlitBto2Key),
+	SDL_BLIT_NAME(BlitBto3Key),
+	SDL_BLIT_NAME(BlitBto4Key),
+	SDL_BLIT_NAME(BlitBtoNAlpha),
+	SDL_BLIT_NAME(BlitBtoNAlphaKey),
+	{ NULL, NULL }
+};
@@ -53,6 +53,7 @@
 
 /* Function to check the CPU flags */
 #include "SDL_cpuinfo.h"
+#include "../cpuinfo/SDL_simd.h"
 #if GCC_ASMBLIT
 #include "mmx.h"
 #elif MSVC_ASMBLIT
@@ -1573,6 +1574,168 @@ static void BlitRGBtoRGBPixelAlpha(SDL_BlitInfo *info)
 	}
 }
 
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/* blend a single pixel exactly like BlitRGBtoRGBPixelAlpha, for row tails */
+static __inline__ Uint32 BlendRGBtoRGBPixelAlpha(Uint32 s, Uint32 d)
+{
+	Uint32 dalpha;
+	Uint32 s1;
+	Uint32 d1;
+	Uint32 alpha = s >> 24;
+
+	if(alpha == 0) {
+		return d;
+	}
+	if(alpha == SDL_ALPHA_OPAQUE) {
+		return (s & 0x00ffffff) | (d & 0xff000000);
+	}
+	dalpha = d & 0xff000000;
+	s1 = s & 0xff00ff;
+	d1 = d & 0xff00ff;
+	d1 = (d1 + ((s1 - d1) * alpha >> 8)) & 0xff00ff;
+	s &= 0xff00;
+	d &= 0xff00;
+	d = (d + ((s - d) * alpha >> 8)) & 0xff00;
+	return d1 | d | dalpha;
+}
+#endif /* SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS */
+
+#if SDL_SSE2_INTRINSICS
+/* fast ARGB888->(A)RGB888 blending with pixel alpha, 4 pixels at a time */
+static void SDL_TARGET_SSE2 BlitRGBtoRGBPixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(0xff000000);
+	const __m128i chanmask = _mm_set1_epi32(0x00ffffff);
+	/* keeps the destination alpha out of the blend */
+	const __m128i dmask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+
+	while(height--) {
+		int n = width;
+		while(n >= 4) {
+			__m128i s = _mm_loadu_si128((const __m128i *)srcp);
+			__m128i a = _mm_and_si128(s, amask);
+			/* skip the destination entirely if all 4 are transparent */
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) != 0xffff) {
+				__m128i d = _mm_loadu_si128((const __m128i *)dstp);
+				__m128i opaque = _mm_cmpeq_epi32(a, amask);
+				__m128i slo, shi, dlo, dhi, alo, ahi;
+
+				slo = _mm_unpacklo_epi8(s, zero); /* 0A0R0G0B x 2 */
+				shi = _mm_unpackhi_epi8(s, zero);
+				dlo = _mm_unpacklo_epi8(d, zero);
+				dhi = _mm_unpackhi_epi8(d, zero);
+
+				/* 000A0A0A for each pixel */
+				alo = _mm_shufflelo_epi16(slo, 0xff);
+				alo = _mm_shufflehi_epi16(alo, 0xff);
+				alo = _mm_and_si128(alo, dmask);
+				ahi = _mm_shufflelo_epi16(shi, 0xff);
+				ahi = _mm_shufflehi_epi16(ahi, 0xff);
+				ahi = _mm_and_si128(ahi, dmask);
+
+				/* dst + (((src - dst) * alpha) >> 8) */
+				slo = _mm_mullo_epi16(_mm_sub_epi16(slo, dlo), alo);
+				shi = _mm_mullo_epi16(_mm_sub_epi16(shi, dhi), ahi);
+				dlo = _mm_add_epi8(_mm_srli_epi16(slo, 8), dlo);
+				dhi = _mm_add_epi8(_mm_srli_epi16(shi, 8), dhi);
+				d = _mm_packus_epi16(dlo, dhi);
+
+				/* opaque pixels copy RGB, keep dst alpha */
+				s = _mm_or_si128(_mm_and_si128(s, chanmask),
+				                 _mm_andnot_si128(chanmask, d));
+				d = _mm_or_si128(_mm_and_si128(opaque, s),
+				                 _mm_andnot_si128(opaque, d));
+				_mm_storeu_si128((__m128i *)dstp, d);
+			}
+			srcp += 4;
+			dstp += 4;
+			n -= 4;
+		}
+		while(n--) {
+			*dstp = BlendRGBtoRGBPixelAlpha(*srcp, *dstp);
+			++srcp;
+			++dstp;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+/* fast ARGB888->(A)RGB888 blending with pixel alpha, 8 pixels at a time */
+static void SDL_TARGET_AVX2 BlitRGBtoRGBPixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i amask = _mm256_set1_epi32(0xff000000);
+	const __m256i chanmask = _mm256_set1_epi32(0x00ffffff);
+	/* keeps the destination alpha out of the blend */
+	const __m256i dmask = _mm256_set1_epi64x(0x0000ffffffffffffLL);
+
+	while(height--) {
+		int n = width;
+		while(n >= 8) {
+			__m256i s = _mm256_loadu_si256((const __m256i *)srcp);
+			__m256i a = _mm256_and_si256(s, amask);
+			/* skip the destination entirely if all 8 are transparent */
+			if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, zero)) != -1) {
+				__m256i d = _mm256_loadu_si256((const __m256i *)dstp);
+				__m256i opaque = _mm256_cmpeq_epi32(a, amask);
+				__m256i slo, shi, dlo, dhi, alo, ahi;
+
+				/* unpacking and packing work within 128-bit lanes,
+				   so the pixel order is preserved in the end */
+				slo = _mm256_unpacklo_epi8(s, zero);
+				shi = _mm256_unpackhi_epi8(s, zero);
+				dlo = _mm256_unpacklo_epi8(d, zero);
+				dhi = _mm256_unpackhi_epi8(d, zero);
+
+				alo = _mm256_shufflelo_epi16(slo, 0xff);
+				alo = _mm256_shufflehi_epi16(alo, 0xff);
+				alo = _mm256_and_si256(alo, dmask);
+				ahi = _mm256_shufflelo_epi16(shi, 0xff);
+				ahi = _mm256_shufflehi_epi16(ahi, 0xff);
+				ahi = _mm256_and_si256(ahi, dmask);
+
+				slo = _mm256_mullo_epi16(_mm256_sub_epi16(slo, dlo), alo);
+				shi = _mm256_mullo_epi16(_mm256_sub_epi16(shi, dhi), ahi);
+				dlo = _mm256_add_epi8(_mm256_srli_epi16(slo, 8), dlo);
+				dhi = _mm256_add_epi8(_mm256_srli_epi16(shi, 8), dhi);
+				d = _mm256_packus_epi16(dlo, dhi);
+
+				s = _mm256_or_si256(_mm256_and_si256(s, chanmask),
+				                    _mm256_andnot_si256(chanmask, d));
+				d = _mm256_blendv_epi8(d, s, opaque);
+				_mm256_storeu_si256((__m256i *)dstp, d);
+			}
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		while(n--) {
+			*dstp = BlendRGBtoRGBPixelAlpha(*srcp, *dstp);
+			++srcp;
+			++dstp;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
 #if GCC_ASMBLIT
 /* fast (as in MMX with prefetch) ARGB888->(A)RGB888 blending with pixel alpha */
 static void BlitRGBtoRGBPixelAlphaMMX3DNOW(SDL_BlitInfo *info)
@@ -2833,6 +2996,14 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Bmask == df->Bmask
 	       && sf->BytesPerPixel == 4)
 	    {
+#if SDL_AVX2_INTRINSICS
+		if(sf->Amask == 0xff000000 && SDL_HasAVX2())
+			return BlitRGBtoRGBPixelAlphaAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+		if(sf->Amask == 0xff000000 && SDL_HasSSE2())
+			return BlitRGBtoRGBPixelAlphaSSE2;
+#endif
 #if MMX_ASMBLIT
 		if(sf->Rshift % 8 == 0
 		   && sf->Gshift % 8 == 0
@@ -2871,3 +3042,39 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
     }
 }
 
+const SDL_BlitName SDL_BlitNamesA[] = {
+#if MMX_ASMBLIT
+	SDL_BLIT_NAME(BlitRGBtoRGBSurfaceAlphaMMX),
+	SDL_BLIT_NAME(BlitRGBtoRGBPixelAlphaMMX),
+	SDL_BLIT_NAME(BlitRGBtoRGBPixelAlphaMMX3DNOW),
+	SDL_BLIT_NAME(Blit565to565SurfaceAlphaMMX),
+	SDL_BLIT_NAME(Blit555to555SurfaceAlphaMMX),
+#endif
+#if SDL_ALTIVEC_BLITTERS
+	SDL_BLIT_NAME(Blit32to565PixelAlphaAltivec),
+	SDL_BLIT_NAME(Blit32to32SurfaceAlphaKeyAltivec),
+	SDL_BLIT_NAME(Blit32to32PixelAlphaAltivec),
+	SDL_BLIT_NAME(BlitRGBtoRGBPixelAlphaAltivec),
+	SDL_BLIT_NAME(Blit32to32SurfaceAlphaAltivec),
+	SDL_BLIT_NAME(BlitRGBtoRGBSurfaceAlphaAltivec),
+#endif
+#if SDL_SSE2_INTRINSICS
+	SDL_BLIT_NAME(BlitRGBtoRGBPixelAlphaSSE2),
+#endif
+#if SDL_AVX2_INTRINSICS
+	SDL_BLIT_NAME(BlitRGBtoRGBPixelAlphaAVX2),
+#endif
+	SDL_BLIT_NAME(BlitNto1SurfaceAlpha),
+	SDL_BLIT_NAME(BlitNto1PixelAlpha),
+	SDL_BLIT_NAME(BlitNto1SurfaceAlphaKey),
+	SDL_BLIT_NAME(BlitRGBtoRGBSurfaceAlpha),
+	SDL_BLIT_NAME(BlitRGBtoRGBPixelAlpha),
+	SDL_BLIT_NAME(Blit565to565SurfaceAlpha),
+	SDL_BLIT_NAME(Blit555to555SurfaceAlpha),
+	SDL_BLIT_NAME(BlitARGBto565PixelAlpha),
+	SDL_BLIT_NAME(BlitARGBto555PixelAlpha),
+	SDL_BLIT_NAME(BlitNtoNSurfaceAlpha),
+	SDL_BLIT_NAME(BlitNtoNSurfaceAlphaKey),
+	SDL_BLIT_NAME(BlitNtoNPixelAlpha),
+	{ NULL, NULL }
+};
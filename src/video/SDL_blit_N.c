@@ -2490,3 +2490,36 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 
 	return(blitfun);
 }
+
+const SDL_BlitName SDL_BlitNamesN[] = {
+#if SDL_HERMES_BLITTERS
+	SDL_BLIT_NAME(ConvertMMX),
+	SDL_BLIT_NAME(ConvertX86),
+#else
+	SDL_BLIT_NAME(Blit_RGB888_index8),
+	SDL_BLIT_NAME(Blit_RGB888_RGB555),
+	SDL_BLIT_NAME(Blit_RGB888_RGB565),
+#endif
+#if SDL_ALTIVEC_BLITTERS
+	SDL_BLIT_NAME(Blit_RGB888_RGB565Altivec),
+	SDL_BLIT_NAME(Blit_RGB565_32Altivec),
+	SDL_BLIT_NAME(Blit_RGB555_32Altivec),
+	SDL_BLIT_NAME(Blit32to32KeyAltivec),
+	SDL_BLIT_NAME(ConvertAltivec32to32_noprefetch),
+	SDL_BLIT_NAME(ConvertAltivec32to32_prefetch),
+#endif
+	SDL_BLIT_NAME(Blit_RGB565_ARGB8888),
+	SDL_BLIT_NAME(Blit_RGB565_ABGR8888),
+	SDL_BLIT_NAME(Blit_RGB565_RGBA8888),
+	SDL_BLIT_NAME(Blit_RGB565_BGRA8888),
+	SDL_BLIT_NAME(Blit_RGB888_index8_map),
+	SDL_BLIT_NAME(BlitNto1),
+	SDL_BLIT_NAME(Blit4to4MaskAlpha),
+	SDL_BLIT_NAME(BlitNtoN),
+	SDL_BLIT_NAME(BlitNtoNCopyAlpha),
+	SDL_BLIT_NAME(BlitNto1Key),
+	SDL_BLIT_NAME(Blit2to2Key),
+	SDL_BLIT_NAME(BlitNtoNKey),
+	SDL_BLIT_NAME(BlitNtoNKeyCopyAlpha),
+	{ NULL, NULL }
+};
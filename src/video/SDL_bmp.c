@@ -49,7 +49,7 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 {
 	SDL_bool was_error;
 	long fp_offset = 0;
-	int bmpPitch;
+	int bmpPitch = 0;
 	int i, pad;
 	SDL_Surface *surface;
 	Uint32 Rmask;
@@ -89,6 +89,15 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 		goto done;
 	}
 
+	/* Read sources we own through a buffer, unless they're in memory */
+	if ( freesrc && !SDL_RWborrow(src, 0) ) {
+		src = SDL_BufferRW(src, 0, 1);
+		if ( src == NULL ) {
+			was_error = SDL_TRUE;
+			goto done;
+		}
+	}
+
 	/* Read in the BMP file header */
 	fp_offset = SDL_RWtell(src);
 	SDL_ClearError();
@@ -231,23 +240,28 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 	/* Load the palette, if any */
 	palette = (surface->format)->palette;
 	if ( palette ) {
+		int entry = (biSize == 12) ? 3 : 4;
+		const Uint8 *colors;
+		const Uint8 *color;
+		Uint8 buffer[4];
+
 		if ( biClrUsed == 0 ) {
 			biClrUsed = 1 << biBitCount;
 		}
-		if ( biSize == 12 ) {
-			for ( i = 0; i < (int)biClrUsed; ++i ) {
-				SDL_RWread(src, &palette->colors[i].b, 1, 1);
-				SDL_RWread(src, &palette->colors[i].g, 1, 1);
-				SDL_RWread(src, &palette->colors[i].r, 1, 1);
-				palette->colors[i].unused = 0;
-			}	
-		} else {
-			for ( i = 0; i < (int)biClrUsed; ++i ) {
-				SDL_RWread(src, &palette->colors[i].b, 1, 1);
-				SDL_RWread(src, &palette->colors[i].g, 1, 1);
-				SDL_RWread(src, &palette->colors[i].r, 1, 1);
-				SDL_RWread(src, &palette->colors[i].unused, 1, 1);
-			}	
+
+		/* Memory sources can be read in place */
+		colors = (const Uint8 *)SDL_RWborrow(src, biClrUsed*entry);
+		for ( i = 0; i < (int)biClrUsed; ++i ) {
+			if ( colors ) {
+				color = colors + i*entry;
+			} else {
+				SDL_RWread(src, buffer, 1, entry);
+				color = buffer;
+			}
+			palette->colors[i].b = color[0];
+			palette->colors[i].g = color[1];
+			palette->colors[i].r = color[2];
+			palette->colors[i].unused = (entry == 4) ? color[3] : 0;
 		}
 		palette->ncolors = biClrUsed;
 	}
@@ -285,9 +299,12 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 			case 4: {
 			Uint8 pixel = 0;
 			int   shift = (8-ExpandBMP);
+			const Uint8 *row = (const Uint8 *)SDL_RWborrow(src, bmpPitch);
 			for ( i=0; i<surface->w; ++i ) {
 				if ( i%(8/ExpandBMP) == 0 ) {
-					if ( !SDL_RWread(src, &pixel, 1, 1) ) {
+					if ( row ) {
+						pixel = *row++;
+					} else if ( !SDL_RWread(src, &pixel, 1, 1) ) {
 						SDL_SetError(
 					"Error reading from BMP");
 						was_error = SDL_TRUE;
@@ -329,7 +346,7 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 			break;
 		}
 		/* Skip padding bytes, ugh */
-		if ( pad ) {
+		if ( pad && !SDL_RWborrow(src, pad) ) {
 			Uint8 padbyte;
 			for ( i=0; i<pad; ++i ) {
 				SDL_RWread(src, &padbyte, 1, 1);
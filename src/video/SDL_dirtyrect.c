@@ -0,0 +1,285 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Collecting the parts of the screen that need updating in a frame */
+
+#include "SDL_video.h"
+#include "SDL_sysvideo.h"
+
+/* Each rectangle passed to the video driver costs about as much as
+   this many pixels, so two rectangles are merged when their bounding
+   box adds less than this to the area they cover.
+*/
+#define DIRTY_RECT_COST		1024
+
+/* The whole screen is updated when the dirty area, counting the cost
+   of each rectangle, is more than this many 256ths of the screen.
+*/
+#define DIRTY_FULL_SCREEN	192
+
+/* Make room for another dirty rectangle, returns 0 if out of memory */
+static int SDL_GrowDirtyRects(SDL_VideoDevice *video)
+{
+	SDL_Rect *rects;
+	int max;
+
+	if ( video->num_dirty_rects < video->max_dirty_rects ) {
+		return(1);
+	}
+	max = video->max_dirty_rects ? video->max_dirty_rects*2 : 32;
+	rects = (SDL_Rect *)SDL_realloc(video->dirty_rects, max*sizeof(*rects));
+	if ( rects == NULL ) {
+		return(0);
+	}
+	video->dirty_rects = rects;
+	video->max_dirty_rects = max;
+	return(1);
+}
+
+/* Replace 'a' with the bounding box of 'a' and 'b' if that adds little
+   to the area they cover, returns 1 if they were merged.
+ */
+static int SDL_MergeDirtyRect(SDL_Rect *a, const SDL_Rect *b)
+{
+	int x1, y1, x2, y2;
+	Uint32 area, overlap;
+
+	x1 = SDL_max(a->x, b->x);
+	y1 = SDL_max(a->y, b->y);
+	x2 = SDL_min(a->x+a->w, b->x+b->w);
+	y2 = SDL_min(a->y+a->h, b->y+b->h);
+	if ( x1 < x2 && y1 < y2 ) {
+		overlap = (Uint32)(x2-x1)*(y2-y1);
+	} else {
+		overlap = 0;
+	}
+	area = (Uint32)a->w*a->h + (Uint32)b->w*b->h - overlap;
+
+	x1 = SDL_min(a->x, b->x);
+	y1 = SDL_min(a->y, b->y);
+	x2 = SDL_max(a->x+a->w, b->x+b->w);
+	y2 = SDL_max(a->y+a->h, b->y+b->h);
+	if ( (Uint32)(x2-x1)*(y2-y1) - area > DIRTY_RECT_COST ) {
+		return(0);
+	}
+	a->x = (Sint16)x1;
+	a->y = (Sint16)y1;
+	a->w = (Uint16)(x2-x1);
+	a->h = (Uint16)(y2-y1);
+	return(1);
+}
+
+/* Merge the dirty rectangles until no two of them are worth merging */
+static void SDL_MergeDirtyRects(SDL_VideoDevice *video)
+{
+	SDL_Rect *rects = video->dirty_rects;
+	int i, j, n;
+
+	/* Merged rectangles are marked with a width of 0 */
+	for ( i=0; i<video->num_dirty_rects; ++i ) {
+		if ( rects[i].w == 0 ) {
+			continue;
+		}
+		/* Check everything again each time this one grows */
+		for ( j=0; j<video->num_dirty_rects; ++j ) {
+			if ( j != i && rects[j].w != 0 &&
+			     SDL_MergeDirtyRect(&rects[i], &rects[j]) ) {
+				rects[j].w = 0;
+				j = -1;
+			}
+		}
+	}
+	n = 0;
+	for ( i=0; i<video->num_dirty_rects; ++i ) {
+		if ( rects[i].w != 0 ) {
+			rects[n++] = rects[i];
+		}
+	}
+	video->num_dirty_rects = n;
+}
+
+/* Add the parts of a rectangle from (x1,y1) to (x2,y2) that aren't in
+   dirty rectangles 'first' onward, returns 0 if out of memory.
+ */
+static int SDL_SplitDirtyRect(SDL_VideoDevice *video, int first,
+				int x1, int y1, int x2, int y2)
+{
+	SDL_Rect *dirty;
+	int dx1, dy1, dx2, dy2;
+	int i;
+
+	for ( i=first; i<video->num_dirty_rects; ++i ) {
+		dirty = &video->dirty_rects[i];
+		dx1 = dirty->x;
+		dy1 = dirty->y;
+		dx2 = dx1 + dirty->w;
+		dy2 = dy1 + dirty->h;
+		if ( x1 >= dx2 || x2 <= dx1 || y1 >= dy2 || y2 <= dy1 ) {
+			continue;
+		}
+
+		/* The pieces above, below, left and right of this one */
+		if ( y1 < dy1 ) {
+			if ( !SDL_SplitDirtyRect(video, i+1, x1, y1, x2, dy1) ) {
+				return(0);
+			}
+			y1 = dy1;
+		}
+		if ( y2 > dy2 ) {
+			if ( !SDL_SplitDirtyRect(video, i+1, x1, dy2, x2, y2) ) {
+				return(0);
+			}
+			y2 = dy2;
+		}
+		if ( x1 < dx1 ) {
+			if ( !SDL_SplitDirtyRect(video, i+1, x1, y1, dx1, y2) ) {
+				return(0);
+			}
+		}
+		if ( x2 > dx2 ) {
+			if ( !SDL_SplitDirtyRect(video, i+1, dx2, y1, x2, y2) ) {
+				return(0);
+			}
+		}
+		return(1);
+	}
+
+	if ( !SDL_GrowDirtyRects(video) ) {
+		return(0);
+	}
+	dirty = &video->dirty_rects[video->num_dirty_rects++];
+	dirty->x = (Sint16)x1;
+	dirty->y = (Sint16)y1;
+	dirty->w = (Uint16)(x2-x1);
+	dirty->h = (Uint16)(y2-y1);
+	return(1);
+}
+
+/* Trim the dirty rectangles so they don't overlap, returns 0 if out of
+   memory.  The pieces are added after the original rectangles and then
+   moved down over them.
+ */
+static int SDL_SplitDirtyRects(SDL_VideoDevice *video)
+{
+	SDL_Rect rect;
+	int i, n;
+
+	n = video->num_dirty_rects;
+	for ( i=0; i<n; ++i ) {
+		rect = video->dirty_rects[i];
+		if ( !SDL_SplitDirtyRect(video, n, rect.x, rect.y,
+		                         rect.x+rect.w, rect.y+rect.h) ) {
+			return(0);
+		}
+	}
+	video->num_dirty_rects -= n;
+	SDL_memmove(video->dirty_rects, video->dirty_rects+n,
+	            video->num_dirty_rects*sizeof(SDL_Rect));
+	return(1);
+}
+
+void SDL_AddDirtyRects(SDL_Surface *screen, int numrects, const SDL_Rect *rects)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_Rect *dirty;
+	int x1, y1, x2, y2;
+	int i;
+
+	if ( !video || !screen ) {
+		return;
+	}
+	for ( i=0; i<numrects; ++i ) {
+		/* Clip the rectangle to the screen */
+		x1 = SDL_max(rects[i].x, 0);
+		y1 = SDL_max(rects[i].y, 0);
+		x2 = SDL_min(rects[i].x+rects[i].w, screen->w);
+		y2 = SDL_min(rects[i].y+rects[i].h, screen->h);
+		if ( x1 >= x2 || y1 >= y2 ) {
+			continue;
+		}
+		if ( SDL_GrowDirtyRects(video) ) {
+			dirty = &video->dirty_rects[video->num_dirty_rects++];
+			dirty->x = (Sint16)x1;
+			dirty->y = (Sint16)y1;
+			dirty->w = (Uint16)(x2-x1);
+			dirty->h = (Uint16)(y2-y1);
+		} else if ( video->num_dirty_rects > 0 ) {
+			/* Out of memory, grow the last one to include it */
+			dirty = &video->dirty_rects[video->num_dirty_rects-1];
+			x1 = SDL_min(x1, dirty->x);
+			y1 = SDL_min(y1, dirty->y);
+			x2 = SDL_max(x2, dirty->x+dirty->w);
+			y2 = SDL_max(y2, dirty->y+dirty->h);
+			dirty->x = (Sint16)x1;
+			dirty->y = (Sint16)y1;
+			dirty->w = (Uint16)(x2-x1);
+			dirty->h = (Uint16)(y2-y1);
+		} else {
+			SDL_OutOfMemory();
+		}
+	}
+}
+
+void SDL_AddDirtyRect(SDL_Surface *screen, const SDL_Rect *rect)
+{
+	SDL_Rect full;
+
+	if ( rect == NULL && screen ) {
+		full.x = 0;
+		full.y = 0;
+		full.w = screen->w;
+		full.h = screen->h;
+		rect = &full;
+	}
+	SDL_AddDirtyRects(screen, 1, rect);
+}
+
+void SDL_UpdateDirtyRects(SDL_Surface *screen)
+{
+	SDL_VideoDevice *video = current_video;
+	Uint32 area;
+	int i;
+
+	if ( !video || !screen || video->num_dirty_rects == 0 ) {
+		return;
+	}
+
+	/* Update the whole screen if most of it is dirty */
+	SDL_MergeDirtyRects(video);
+	area = 0;
+	if ( SDL_SplitDirtyRects(video) ) {
+		area = video->num_dirty_rects * DIRTY_RECT_COST;
+		for ( i=0; i<video->num_dirty_rects; ++i ) {
+			area += (Uint32)video->dirty_rects[i].w *
+			                video->dirty_rects[i].h;
+		}
+	}
+	if ( area == 0 ||
+	     area > (Uint32)screen->w*screen->h/256*DIRTY_FULL_SCREEN ) {
+		SDL_UpdateRect(screen, 0, 0, 0, 0);
+	} else {
+		SDL_UpdateRects(screen,
+		                video->num_dirty_rects, video->dirty_rects);
+	}
+	video->num_dirty_rects = 0;
+}
@@ -29,231 +29,897 @@
 
 #include "SDL_video.h"
 #include "SDL_blit.h"
+#include "SDL_stretch_c.h"
+#include "../cpuinfo/SDL_simd.h"
 
-/* This isn't ready for general consumption yet - it should be folded
-   into the general blitting mechanism.
+/* The target is produced one row at a time.  Bilinear and box filtering
+   are done in two steps: each source row is first scaled horizontally
+   into a row of 8-bit channels, and each target row is then a weighted
+   sum of those rows.  24 and 32 bpp pixels are filtered byte by byte as
+   they are, whatever order their channels are in, while 16 bpp pixels
+   are unpacked to 4 bytes and packed again once filtered.  8 bpp pixels
+   are palette indices, so they are always scaled with nearest sampling.
 */
 
-#if ((defined(_MFC_VER) && defined(_M_IX86)/* && !defined(_WIN32_WCE) still needed? */) || \
-     defined(__WATCOMC__) || \
-     (defined(__GNUC__) && defined(__i386__))) && SDL_ASSEMBLY_ROUTINES
-/* There's a bug with gcc 4.4.1 and -O2 where srcp doesn't get the correct
- * value after the first scanline.  FIXME? */
-/*#define USE_ASM_STRETCH*/
-#endif
+/* Box filter weights of the source pixels of a target column add up to
+   this, and those of the source rows of a target row add up to 256 */
+#define BOX_COL_TOTAL	16384
+#define BOX_ROW_TOTAL	256
 
-#ifdef USE_ASM_STRETCH
+struct SDL_Stretch {
+	SDL_ScaleMode mode;
+	SDL_PixelFormat *format;
+	Uint8 *pixels;		/* first source column used, on the first row */
+	int pitch;
+	int bpp;		/* bytes per source pixel */
+	int nchan;		/* bytes per pixel while filtering */
+	int next;		/* bytes to the second pixel of a bilinear pair */
+	int span;		/* source columns used */
+	int width;		/* target columns produced */
+	int height;		/* target rows produced */
+	int row;		/* next target row */
 
-#ifdef HAVE_MPROTECT
-#include <sys/types.h>
-#include <sys/mman.h>
-#endif
-#ifdef __GNUC__
-#define PAGE_ALIGNED __attribute__((__aligned__(4096)))
-#else
-#define PAGE_ALIGNED
-#endif
+	/* Byte offset of the first source pixel of each target column, and
+	   when filtering, how many pixels are used and with which weights.
+	   Bilinear weights are stored 8 per column, 4 for each pixel. */
+	int *cols;
+	int *colcount;
+	Uint16 *colweights;
 
-#if defined(_M_IX86) || defined(i386)
-#define PREFIX16	0x66
-#define STORE_BYTE	0xAA
-#define STORE_WORD	0xAB
-#define LOAD_BYTE	0xAC
-#define LOAD_WORD	0xAD
-#define RETURN		0xC3
-#else
-#error Need assembly opcodes for this architecture
-#endif
+	/* The first source row of each target row, and when filtering, how
+	   many rows are used and with which weights */
+	int *rows;
+	int *rowcount;
+	Uint16 *rowweights;
+	Uint16 *rowweight;	/* weights of the next target row */
 
-static unsigned char copy_row[4096] PAGE_ALIGNED;
+	Uint8 *unpacked;	/* a 16 bpp source row unpacked to 4 bytes */
+	Uint8 *cache[2];	/* source rows scaled horizontally */
+	int cached[2];
+	Uint8 *filtered;	/* a 16 bpp target row before packing */
+	Uint16 *sum;		/* box filter sums of a target row */
 
-static int generate_rowbytes(int src_w, int dst_w, int bpp)
-{
-	static struct {
-		int bpp;
-		int src_w;
-		int dst_w;
-		int status;
-	} last;
+	void (*Scale)(const SDL_Stretch *stretch, const Uint8 *in, Uint8 *out);
+	void (*Blend)(Uint8 *out, const Uint8 *row0, const Uint8 *row1,
+	              int n, int weight);
+	void (*Sum)(Uint16 *sum, const Uint8 *row, int n, int weight, int first);
+	void (*Finish)(Uint8 *out, const Uint16 *sum, int n);
+	void (*Unpack)(const SDL_PixelFormat *format, const Uint16 *in,
+	               Uint8 *out, int n);
+	void (*Pack)(const SDL_PixelFormat *format, const Uint8 *in,
+	             Uint16 *out, int n);
+};
 
+/*
+ * Working out which source pixels make up each target pixel.  'dstlen'
+ * target pixels cover 'srclen' source pixels, and only target pixels
+ * 'first' to 'first+n-1' are needed.  Source positions are relative to
+ * the start of the source rectangle.
+ */
+
+/* The source pixel under the centre of each target pixel */
+static void SDL_NearestAxis(int srclen, int dstlen, int first, int n,
+                            int *pos)
+{
 	int i;
-	int pos, inc;
-	unsigned char *eip, *fence;
-	unsigned char load, store;
 
-	/* See if we need to regenerate the copy buffer */
-	if ( (src_w == last.src_w) &&
-	     (dst_w == last.dst_w) && (bpp == last.bpp) ) {
-		return(last.status);
+	for ( i = 0; i < n; ++i ) {
+		pos[i] = (int)(((Sint64)(2*(first+i)+1)*srclen) / (2*dstlen));
+	}
+}
+
+/* The source pixel before the centre of each target pixel, and the
+   weight of the one after it, out of 256.  If 'pairs' is set, the last
+   source pixel is used as the second of a pair with full weight, so
+   that both pixels of a pair are always inside the source.
+*/
+static void SDL_BilinearAxis(int srclen, int dstlen, int first, int n,
+                             int *pos, Uint16 *weight, int pairs)
+{
+	Sint64 p;
+	int i, x, w;
+
+	for ( i = 0; i < n; ++i ) {
+		p = (((Sint64)(2*(first+i)+1)*srclen*256) / (2*dstlen)) - 128;
+		if ( p < 0 ) {
+			p = 0;
+		}
+		x = (int)(p >> 8);
+		w = (int)(p & 0xFF);
+		if ( x >= srclen-1 ) {
+			x = srclen-1;
+			w = 0;
+			if ( pairs && (srclen > 1) ) {
+				x = srclen-2;
+				w = 256;
+			}
+		}
+		pos[i] = x;
+		weight[i] = (Uint16)w;
 	}
-	last.bpp = bpp;
-	last.src_w = src_w;
-	last.dst_w = dst_w;
-	last.status = -1;
+}
 
-	switch (bpp) {
+/* The source pixels covered by each target pixel, with weights in
+   proportion to how much of them is covered, adding up to 'total'.
+   Returns the weights, or NULL if out of memory.
+*/
+static Uint16 *SDL_BoxAxis(int srclen, int dstlen, int first, int n,
+                           int total, int *pos, int *count)
+{
+	Sint64 s0, s1, lo, hi;
+	Uint16 *weights;
+	int i, j, k, w, left, size;
+
+	size = 0;
+	for ( i = 0; i < n; ++i ) {
+		s0 = (((Sint64)(first+i)*srclen) << 16) / dstlen;
+		s1 = (((Sint64)(first+i+1)*srclen) << 16) / dstlen;
+		pos[i] = (int)(s0 >> 16);
+		count[i] = (int)((s1 + 0xFFFF) >> 16) - pos[i];
+		size += count[i];
+	}
+	weights = (Uint16 *)SDL_malloc(size*sizeof(*weights));
+	if ( weights == NULL ) {
+		return(NULL);
+	}
+
+	size = 0;
+	for ( i = 0; i < n; ++i ) {
+		s0 = (((Sint64)(first+i)*srclen) << 16) / dstlen;
+		s1 = (((Sint64)(first+i+1)*srclen) << 16) / dstlen;
+		left = total;
+		for ( k = 0; k < count[i]; ++k ) {
+			j = pos[i]+k;
+			if ( k == count[i]-1 ) {
+				w = left;
+			} else {
+				lo = ((Sint64)j << 16);
+				hi = ((Sint64)(j+1) << 16);
+				if ( lo < s0 ) {
+					lo = s0;
+				}
+				if ( hi > s1 ) {
+					hi = s1;
+				}
+				w = (int)(((hi-lo)*total + (s1-s0)/2) / (s1-s0));
+				if ( w > left ) {
+					w = left;
+				}
+			}
+			weights[size++] = (Uint16)w;
+			left -= w;
+		}
+	}
+	return(weights);
+}
+
+/*
+ * Row functions
+ */
+
+static void SDL_NearestRow(const SDL_Stretch *stretch,
+                           const Uint8 *in, Uint8 *out)
+{
+	const int *cols = stretch->cols;
+	int i;
+
+	switch (stretch->bpp) {
 	    case 1:
-		load = LOAD_BYTE;
-		store = STORE_BYTE;
+		for ( i = 0; i < stretch->width; ++i ) {
+			out[i] = in[cols[i]];
+		}
 		break;
 	    case 2:
+		for ( i = 0; i < stretch->width; ++i ) {
+			((Uint16 *)out)[i] = *(const Uint16 *)(in+cols[i]);
+		}
+		break;
+	    case 3:
+		for ( i = 0; i < stretch->width; ++i ) {
+			out[0] = in[cols[i]];
+			out[1] = in[cols[i]+1];
+			out[2] = in[cols[i]+2];
+			out += 3;
+		}
+		break;
 	    case 4:
-		load = LOAD_WORD;
-		store = STORE_WORD;
+		for ( i = 0; i < stretch->width; ++i ) {
+			((Uint32 *)out)[i] = *(const Uint32 *)(in+cols[i]);
+		}
 		break;
-	    default:
-		SDL_SetError("ASM stretch of %d bytes isn't supported\n", bpp);
-		return(-1);
 	}
-#ifdef HAVE_MPROTECT
-	/* Make the code writeable */
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_WRITE) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer writeable");
-		return(-1);
+}
+
+static void SDL_BilinearRow(const SDL_Stretch *stretch,
+                            const Uint8 *in, Uint8 *out)
+{
+	const int nchan = stretch->nchan;
+	const int next = stretch->next;
+	const Uint8 *p;
+	int i, c, w;
+
+	for ( i = 0; i < stretch->width; ++i ) {
+		p = in + stretch->cols[i];
+		w = stretch->colweights[i*8+4];
+		for ( c = 0; c < nchan; ++c ) {
+			*out++ = (Uint8)((p[c]*(256-w) + p[c+next]*w + 128) >> 8);
+		}
 	}
-#endif
-	pos = 0x10000;
-	inc = (src_w << 16) / dst_w;
-	eip = copy_row;
-	fence = copy_row+sizeof(copy_row)-2;
-	for ( i=0; i<dst_w && eip < end; ++i ) {
-		while ( pos >= 0x10000L ) {
-			if ( eip == fence ) {
-				return -1;
-			}
-			if ( bpp == 2 ) {
-				*eip++ = PREFIX16;
+}
+
+static void SDL_BoxRow(const SDL_Stretch *stretch,
+                       const Uint8 *in, Uint8 *out)
+{
+	const int nchan = stretch->nchan;
+	const Uint16 *weights = stretch->colweights;
+	const Uint8 *p;
+	Uint32 sum[4];
+	int i, k, c;
+
+	for ( i = 0; i < stretch->width; ++i ) {
+		p = in + stretch->cols[i];
+		for ( c = 0; c < nchan; ++c ) {
+			sum[c] = BOX_COL_TOTAL/2;
+		}
+		for ( k = stretch->colcount[i]; k; --k ) {
+			for ( c = 0; c < nchan; ++c ) {
+				sum[c] += p[c] * *weights;
 			}
-			*eip++ = load;
-			pos -= 0x10000L;
+			p += nchan;
+			++weights;
 		}
-		if ( eip == fence ) {
-			return -1;
+		for ( c = 0; c < nchan; ++c ) {
+			*out++ = (Uint8)(sum[c] / BOX_COL_TOTAL);
 		}
-		if ( bpp == 2 ) {
-			*eip++ = PREFIX16;
+	}
+}
+
+static void SDL_BlendRows(Uint8 *out, const Uint8 *row0, const Uint8 *row1,
+                          int n, int weight)
+{
+	int i;
+
+	for ( i = 0; i < n; ++i ) {
+		out[i] = (Uint8)((row0[i]*(256-weight) + row1[i]*weight + 128) >> 8);
+	}
+}
+
+static void SDL_SumRow(Uint16 *sum, const Uint8 *row, int n, int weight,
+                       int first)
+{
+	int i;
+
+	if ( first ) {
+		for ( i = 0; i < n; ++i ) {
+			sum[i] = (Uint16)(row[i]*weight);
+		}
+	} else {
+		for ( i = 0; i < n; ++i ) {
+			sum[i] += (Uint16)(row[i]*weight);
 		}
-		*eip++ = store;
-		pos += inc;
 	}
-	*eip++ = RETURN;
+}
 
-#ifdef HAVE_MPROTECT
-	/* Make the code executable but not writeable */
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_EXEC) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer executable");
-		return(-1);
+static void SDL_FinishSum(Uint8 *out, const Uint16 *sum, int n)
+{
+	int i;
+
+	for ( i = 0; i < n; ++i ) {
+		out[i] = (Uint8)((sum[i] + BOX_ROW_TOTAL/2) / BOX_ROW_TOTAL);
 	}
-#endif
-	last.status = 0;
-	return(0);
 }
 
-#endif /* USE_ASM_STRETCH */
-
-#define DEFINE_COPY_ROW(name, type)			\
-void name(type *src, int src_w, type *dst, int dst_w)	\
-{							\
-	int i;						\
-	int pos, inc;					\
-	type pixel = 0;					\
-							\
-	pos = 0x10000;					\
-	inc = (src_w << 16) / dst_w;			\
-	for ( i=dst_w; i>0; --i ) {			\
-		while ( pos >= 0x10000L ) {		\
-			pixel = *src++;			\
-			pos -= 0x10000L;		\
-		}					\
-		*dst++ = pixel;				\
-		pos += inc;				\
-	}						\
+/* 16 bpp pixels are unpacked to one byte per channel, in RGBA order.
+   Missing bits are left zero, so packing them again is lossless. */
+static void SDL_UnpackRow16(const SDL_PixelFormat *format, const Uint16 *in,
+                            Uint8 *out, int n)
+{
+	Uint32 p;
+	int i;
+
+	for ( i = 0; i < n; ++i ) {
+		p = in[i];
+		out[0] = (Uint8)(((p & format->Rmask) >> format->Rshift) << format->Rloss);
+		out[1] = (Uint8)(((p & format->Gmask) >> format->Gshift) << format->Gloss);
+		out[2] = (Uint8)(((p & format->Bmask) >> format->Bshift) << format->Bloss);
+		out[3] = (Uint8)(((p & format->Amask) >> format->Ashift) << format->Aloss);
+		out += 4;
+	}
 }
-DEFINE_COPY_ROW(copy_row1, Uint8)
-DEFINE_COPY_ROW(copy_row2, Uint16)
-DEFINE_COPY_ROW(copy_row4, Uint32)
 
-/* The ASM code doesn't handle 24-bpp stretch blits */
-void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
+static void SDL_PackRow16(const SDL_PixelFormat *format, const Uint8 *in,
+                          Uint16 *out, int n)
 {
 	int i;
-	int pos, inc;
-	Uint8 pixel[3] = { 0, 0, 0 };
-
-	pos = 0x10000;
-	inc = (src_w << 16) / dst_w;
-	for ( i=dst_w; i>0; --i ) {
-		while ( pos >= 0x10000L ) {
-			pixel[0] = *src++;
-			pixel[1] = *src++;
-			pixel[2] = *src++;
-			pos -= 0x10000L;
-		}
-		*dst++ = pixel[0];
-		*dst++ = pixel[1];
-		*dst++ = pixel[2];
-		pos += inc;
+
+	for ( i = 0; i < n; ++i ) {
+		out[i] = (Uint16)(((in[0] >> format->Rloss) << format->Rshift) |
+		                  ((in[1] >> format->Gloss) << format->Gshift) |
+		                  ((in[2] >> format->Bloss) << format->Bshift) |
+		                  ((in[3] >> format->Aloss) << format->Ashift));
+		in += 4;
 	}
 }
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
-*/
-int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
-                    SDL_Surface *dst, SDL_Rect *dstrect)
+#if SDL_SSE2_INTRINSICS
+/* Scale 4 byte pixels, 4 target pixels at a time */
+SDL_TARGET_SSE2
+static void SDL_BilinearRowSSE2(const SDL_Stretch *stretch,
+                                const Uint8 *in, Uint8 *out)
 {
-	int src_locked;
-	int dst_locked;
-	int pos, inc;
-	int dst_maxrow;
-	int src_row, dst_row;
-	Uint8 *srcp = NULL;
-	Uint8 *dstp;
-	SDL_Rect full_src;
-	SDL_Rect full_dst;
-#ifdef USE_ASM_STRETCH
-	SDL_bool use_asm = SDL_TRUE;
-#ifdef __GNUC__
-	int u1, u2;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+	const int *cols = stretch->cols;
+	const Uint16 *weights = stretch->colweights;
+	const int n = stretch->width & ~3;
+	__m128i p0, p1, p2, p3;
+	int i;
+
+	for ( i = 0; i < n; i += 4 ) {
+		/* Each load is a pair of source pixels, weighted as a pair */
+		p0 = _mm_loadl_epi64((const __m128i *)(in+cols[i]));
+		p1 = _mm_loadl_epi64((const __m128i *)(in+cols[i+1]));
+		p2 = _mm_loadl_epi64((const __m128i *)(in+cols[i+2]));
+		p3 = _mm_loadl_epi64((const __m128i *)(in+cols[i+3]));
+		p0 = _mm_mullo_epi16(_mm_unpacklo_epi8(p0, zero),
+		        _mm_loadu_si128((const __m128i *)(weights+i*8)));
+		p1 = _mm_mullo_epi16(_mm_unpacklo_epi8(p1, zero),
+		        _mm_loadu_si128((const __m128i *)(weights+i*8+8)));
+		p2 = _mm_mullo_epi16(_mm_unpacklo_epi8(p2, zero),
+		        _mm_loadu_si128((const __m128i *)(weights+i*8+16)));
+		p3 = _mm_mullo_epi16(_mm_unpacklo_epi8(p3, zero),
+		        _mm_loadu_si128((const __m128i *)(weights+i*8+24)));
+		p0 = _mm_add_epi16(_mm_unpacklo_epi64(p0, p1),
+		                   _mm_unpackhi_epi64(p0, p1));
+		p2 = _mm_add_epi16(_mm_unpacklo_epi64(p2, p3),
+		                   _mm_unpackhi_epi64(p2, p3));
+		p0 = _mm_srli_epi16(_mm_add_epi16(p0, round), 8);
+		p2 = _mm_srli_epi16(_mm_add_epi16(p2, round), 8);
+		_mm_storeu_si128((__m128i *)(out+i*4), _mm_packus_epi16(p0, p2));
+	}
+	for ( ; i < stretch->width; ++i ) {
+		const Uint8 *p = in + cols[i];
+		int w = weights[i*8+4];
+		out[i*4+0] = (Uint8)((p[0]*(256-w) + p[4]*w + 128) >> 8);
+		out[i*4+1] = (Uint8)((p[1]*(256-w) + p[5]*w + 128) >> 8);
+		out[i*4+2] = (Uint8)((p[2]*(256-w) + p[6]*w + 128) >> 8);
+		out[i*4+3] = (Uint8)((p[3]*(256-w) + p[7]*w + 128) >> 8);
+	}
+}
+
+/* Box filter 4 byte pixels, multiplying and adding pairs of pixels */
+SDL_TARGET_SSE2
+static void SDL_BoxRowSSE2(const SDL_Stretch *stretch,
+                           const Uint8 *in, Uint8 *out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(BOX_COL_TOTAL/2);
+	const Uint16 *weights = stretch->colweights;
+	const Uint8 *p;
+	__m128i sum, pair, w;
+	int i, k;
+
+	for ( i = 0; i < stretch->width; ++i ) {
+		p = in + stretch->cols[i];
+		sum = round;
+		for ( k = stretch->colcount[i]; k >= 2; k -= 2 ) {
+			/* Interleave the channels of the two pixels */
+			pair = _mm_unpacklo_epi8(
+			         _mm_loadl_epi64((const __m128i *)p), zero);
+			pair = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8));
+			w = _mm_set1_epi32(weights[0] | (weights[1] << 16));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, w));
+			p += 8;
+			weights += 2;
+		}
+		if ( k ) {
+			pair = _mm_unpacklo_epi8(
+			         _mm_cvtsi32_si128(*(const int *)p), zero);
+			pair = _mm_unpacklo_epi16(pair, zero);
+			w = _mm_set1_epi32(weights[0]);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, w));
+			++weights;
+		}
+		sum = _mm_srli_epi32(sum, 14);
+		sum = _mm_packs_epi32(sum, sum);
+		*(int *)(out+i*4) = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+	}
+}
+
+SDL_TARGET_SSE2
+static void SDL_BlendRowsSSE2(Uint8 *out, const Uint8 *row0,
+                              const Uint8 *row1, int n, int weight)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i w0 = _mm_set1_epi16((short)(256-weight));
+	const __m128i w1 = _mm_set1_epi16((short)weight);
+	__m128i a, b, lo, hi;
+	int i;
+
+	for ( i = 0; i+16 <= n; i += 16 ) {
+		a = _mm_loadu_si128((const __m128i *)(row0+i));
+		b = _mm_loadu_si128((const __m128i *)(row1+i));
+		lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+		                   _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+		hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+		                   _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i *)(out+i), _mm_packus_epi16(lo, hi));
+	}
+	SDL_BlendRows(out+i, row0+i, row1+i, n-i, weight);
+}
+
+SDL_TARGET_SSE2
+static void SDL_SumRowSSE2(Uint16 *sum, const Uint8 *row, int n, int weight,
+                           int first)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w = _mm_set1_epi16((short)weight);
+	__m128i p, lo, hi;
+	int i;
+
+	for ( i = 0; i+16 <= n; i += 16 ) {
+		p = _mm_loadu_si128((const __m128i *)(row+i));
+		lo = _mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), w);
+		hi = _mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), w);
+		if ( !first ) {
+			lo = _mm_add_epi16(lo, _mm_loadu_si128((const __m128i *)(sum+i)));
+			hi = _mm_add_epi16(hi, _mm_loadu_si128((const __m128i *)(sum+i+8)));
+		}
+		_mm_storeu_si128((__m128i *)(sum+i), lo);
+		_mm_storeu_si128((__m128i *)(sum+i+8), hi);
+	}
+	SDL_SumRow(sum+i, row+i, n-i, weight, first);
+}
+
+SDL_TARGET_SSE2
+static void SDL_FinishSumSSE2(Uint8 *out, const Uint16 *sum, int n)
+{
+	const __m128i round = _mm_set1_epi16(BOX_ROW_TOTAL/2);
+	__m128i lo, hi;
+	int i;
+
+	for ( i = 0; i+16 <= n; i += 16 ) {
+		lo = _mm_loadu_si128((const __m128i *)(sum+i));
+		hi = _mm_loadu_si128((const __m128i *)(sum+i+8));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i *)(out+i), _mm_packus_epi16(lo, hi));
+	}
+	SDL_FinishSum(out+i, sum+i, n-i);
+}
+
+SDL_TARGET_SSE2
+static void SDL_UnpackRow16SSE2(const SDL_PixelFormat *format,
+                                const Uint16 *in, Uint8 *out, int n)
+{
+	const __m128i rmask = _mm_set1_epi16((short)format->Rmask);
+	const __m128i gmask = _mm_set1_epi16((short)format->Gmask);
+	const __m128i bmask = _mm_set1_epi16((short)format->Bmask);
+	const __m128i amask = _mm_set1_epi16((short)format->Amask);
+	const __m128i rshift = _mm_cvtsi32_si128(format->Rshift);
+	const __m128i gshift = _mm_cvtsi32_si128(format->Gshift);
+	const __m128i bshift = _mm_cvtsi32_si128(format->Bshift);
+	const __m128i ashift = _mm_cvtsi32_si128(format->Ashift);
+	const __m128i rloss = _mm_cvtsi32_si128(format->Rloss);
+	const __m128i gloss = _mm_cvtsi32_si128(format->Gloss);
+	const __m128i bloss = _mm_cvtsi32_si128(format->Bloss);
+	const __m128i aloss = _mm_cvtsi32_si128(format->Aloss);
+	__m128i p, r, g, b, a;
+	int i;
+
+	for ( i = 0; i+8 <= n; i += 8 ) {
+		p = _mm_loadu_si128((const __m128i *)(in+i));
+		r = _mm_sll_epi16(_mm_srl_epi16(_mm_and_si128(p, rmask), rshift), rloss);
+		g = _mm_sll_epi16(_mm_srl_epi16(_mm_and_si128(p, gmask), gshift), gloss);
+		b = _mm_sll_epi16(_mm_srl_epi16(_mm_and_si128(p, bmask), bshift), bloss);
+		a = _mm_sll_epi16(_mm_srl_epi16(_mm_and_si128(p, amask), ashift), aloss);
+		r = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+		b = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+		_mm_storeu_si128((__m128i *)(out+i*4), _mm_unpacklo_epi16(r, b));
+		_mm_storeu_si128((__m128i *)(out+i*4+16), _mm_unpackhi_epi16(r, b));
+	}
+	SDL_UnpackRow16(format, in+i, out+i*4, n-i);
+}
+
+SDL_TARGET_SSE2
+static void SDL_PackRow16SSE2(const SDL_PixelFormat *format, const Uint8 *in,
+                              Uint16 *out, int n)
+{
+	const __m128i low = _mm_set1_epi16(0xFF);
+	const __m128i rshift = _mm_cvtsi32_si128(format->Rshift);
+	const __m128i gshift = _mm_cvtsi32_si128(format->Gshift);
+	const __m128i bshift = _mm_cvtsi32_si128(format->Bshift);
+	const __m128i ashift = _mm_cvtsi32_si128(format->Ashift);
+	const __m128i rloss = _mm_cvtsi32_si128(format->Rloss);
+	const __m128i gloss = _mm_cvtsi32_si128(format->Gloss);
+	const __m128i bloss = _mm_cvtsi32_si128(format->Bloss);
+	const __m128i aloss = _mm_cvtsi32_si128(format->Aloss);
+	__m128i p0, p1, rg, ba, p;
+	int i;
+
+	for ( i = 0; i+8 <= n; i += 8 ) {
+		p0 = _mm_loadu_si128((const __m128i *)(in+i*4));
+		p1 = _mm_loadu_si128((const __m128i *)(in+i*4+16));
+		/* Split the pixels into RG and BA halves, sign extended so
+		   that the saturating pack leaves them alone */
+		rg = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(p0, 16), 16),
+		                     _mm_srai_epi32(_mm_slli_epi32(p1, 16), 16));
+		ba = _mm_packs_epi32(_mm_srai_epi32(p0, 16),
+		                     _mm_srai_epi32(p1, 16));
+		p = _mm_sll_epi16(_mm_srl_epi16(_mm_and_si128(rg, low), rloss), rshift);
+		p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(_mm_srli_epi16(rg, 8), gloss), gshift));
+		p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(_mm_and_si128(ba, low), bloss), bshift));
+		p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(_mm_srli_epi16(ba, 8), aloss), ashift));
+		_mm_storeu_si128((__m128i *)(out+i), p);
+	}
+	SDL_PackRow16(format, in+i*4, out+i, n-i);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+SDL_Stretch *SDL_CreateStretch(SDL_Surface *src, const SDL_Rect *srcrect,
+                               const SDL_Rect *dstrect, const SDL_Rect *clip,
+                               SDL_ScaleMode mode)
+{
+	SDL_Stretch *stretch;
+	Uint16 *weights;
+	int first, last, i, n;
+
+	stretch = (SDL_Stretch *)SDL_malloc(sizeof(*stretch));
+	if ( stretch == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(stretch, 0, sizeof(*stretch));
+
+	stretch->format = src->format;
+	stretch->bpp = src->format->BytesPerPixel;
+	if ( stretch->bpp == 1 ) {
+		mode = SDL_SCALE_NEAREST;
+	}
+	stretch->mode = mode;
+	stretch->nchan = (stretch->bpp == 2) ? 4 : stretch->bpp;
+	stretch->width = clip->w;
+	stretch->height = clip->h;
+	stretch->cached[0] = -1;
+	stretch->cached[1] = -1;
+
+	stretch->Scale = (mode == SDL_SCALE_BOX) ? SDL_BoxRow : SDL_BilinearRow;
+	stretch->Blend = SDL_BlendRows;
+	stretch->Sum = SDL_SumRow;
+	stretch->Finish = SDL_FinishSum;
+	stretch->Unpack = SDL_UnpackRow16;
+	stretch->Pack = SDL_PackRow16;
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		if ( (mode == SDL_SCALE_BILINEAR) &&
+		     (stretch->nchan == 4) && (srcrect->w > 1) ) {
+			stretch->Scale = SDL_BilinearRowSSE2;
+		}
+		if ( (mode == SDL_SCALE_BOX) && (stretch->nchan == 4) ) {
+			stretch->Scale = SDL_BoxRowSSE2;
+		}
+		stretch->Blend = SDL_BlendRowsSSE2;
+		stretch->Sum = SDL_SumRowSSE2;
+		stretch->Finish = SDL_FinishSumSSE2;
+		stretch->Unpack = SDL_UnpackRow16SSE2;
+		stretch->Pack = SDL_PackRow16SSE2;
+	}
 #endif
-#endif /* USE_ASM_STRETCH */
-	const int bpp = dst->format->BytesPerPixel;
 
-	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
-		SDL_SetError("Only works with same format surfaces");
-		return(-1);
+	/* Work out the columns and rows */
+	first = clip->x - dstrect->x;
+	n = clip->w;
+	stretch->cols = (int *)SDL_malloc(n*sizeof(int));
+	stretch->colcount = (int *)SDL_malloc(n*sizeof(int));
+	stretch->rows = (int *)SDL_malloc(clip->h*sizeof(int));
+	stretch->rowcount = (int *)SDL_malloc(clip->h*sizeof(int));
+	if ( !stretch->cols || !stretch->colcount ||
+	     !stretch->rows || !stretch->rowcount ) {
+		goto outofmemory;
 	}
+	switch (mode) {
+	    case SDL_SCALE_NEAREST:
+		SDL_NearestAxis(srcrect->w, dstrect->w, first, n,
+		                stretch->cols);
+		SDL_NearestAxis(srcrect->h, dstrect->h, clip->y - dstrect->y,
+		                clip->h, stretch->rows);
+		last = stretch->cols[n-1];
+		break;
+	    case SDL_SCALE_BILINEAR:
+		weights = (Uint16 *)SDL_malloc(n*8*sizeof(Uint16));
+		stretch->colweights = weights;
+		stretch->rowweights = (Uint16 *)
+				SDL_malloc(clip->h*sizeof(Uint16));
+		if ( !weights || !stretch->rowweights ) {
+			goto outofmemory;
+		}
+		SDL_BilinearAxis(srcrect->w, dstrect->w, first, n,
+		                 stretch->cols, weights, 1);
+		/* Spread the weights out for each channel of a pair */
+		for ( i = n-1; i >= 0; --i ) {
+			Uint16 w = weights[i];
+			weights[i*8+0] = weights[i*8+1] = (Uint16)(256-w);
+			weights[i*8+2] = weights[i*8+3] = (Uint16)(256-w);
+			weights[i*8+4] = weights[i*8+5] = w;
+			weights[i*8+6] = weights[i*8+7] = w;
+		}
+		SDL_BilinearAxis(srcrect->h, dstrect->h, clip->y - dstrect->y,
+		                 clip->h, stretch->rows, stretch->rowweights, 0);
+		if ( srcrect->w > 1 ) {
+			stretch->next = stretch->nchan;
+			last = stretch->cols[n-1]+1;
+		} else {
+			last = stretch->cols[n-1];
+		}
+		break;
+	    default:
+		stretch->colweights = SDL_BoxAxis(srcrect->w, dstrect->w,
+		                                  first, n, BOX_COL_TOTAL,
+		                                  stretch->cols,
+		                                  stretch->colcount);
+		stretch->rowweights = SDL_BoxAxis(srcrect->h, dstrect->h,
+		                                  clip->y - dstrect->y, clip->h,
+		                                  BOX_ROW_TOTAL, stretch->rows,
+		                                  stretch->rowcount);
+		if ( !stretch->colweights || !stretch->rowweights ) {
+			goto outofmemory;
+		}
+		last = stretch->cols[n-1]+stretch->colcount[n-1]-1;
+		break;
+	}
+	stretch->rowweight = stretch->rowweights;
 
-	/* Verify the blit rectangles */
-	if ( srcrect ) {
-		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
-		     ((srcrect->x+srcrect->w) > src->w) ||
-		     ((srcrect->y+srcrect->h) > src->h) ) {
-			SDL_SetError("Invalid source blit rectangle");
-			return(-1);
+	/* Only the source columns used are read, the offsets start there */
+	stretch->span = last - stretch->cols[0] + 1;
+	stretch->pixels = (Uint8 *)src->pixels + srcrect->y*src->pitch +
+	                  (srcrect->x + stretch->cols[0])*stretch->bpp;
+	stretch->pitch = src->pitch;
+	for ( i = n-1; i >= 0; --i ) {
+		stretch->cols[i] -= stretch->cols[0];
+		stretch->cols[i] *= (mode == SDL_SCALE_NEAREST) ?
+		                    stretch->bpp : stretch->nchan;
+	}
+
+	if ( mode != SDL_SCALE_NEAREST ) {
+		n = stretch->width*stretch->nchan;
+		stretch->cache[0] = (Uint8 *)SDL_malloc(n);
+		stretch->cache[1] = (Uint8 *)SDL_malloc(n);
+		if ( !stretch->cache[0] || !stretch->cache[1] ) {
+			goto outofmemory;
+		}
+		if ( stretch->bpp == 2 ) {
+			stretch->unpacked = (Uint8 *)SDL_malloc(stretch->span*4);
+			stretch->filtered = (Uint8 *)SDL_malloc(n);
+			if ( !stretch->unpacked || !stretch->filtered ) {
+				goto outofmemory;
+			}
+		}
+		if ( mode == SDL_SCALE_BOX ) {
+			stretch->sum = (Uint16 *)SDL_malloc(n*sizeof(Uint16));
+			if ( !stretch->sum ) {
+				goto outofmemory;
+			}
+		}
+	}
+	return(stretch);
+
+outofmemory:
+	SDL_FreeStretch(stretch);
+	SDL_OutOfMemory();
+	return(NULL);
+}
+
+/* Return source row 'y' scaled horizontally, keeping the last two */
+static const Uint8 *SDL_StretchSourceRow(SDL_Stretch *stretch, int y)
+{
+	const Uint8 *in;
+	int slot;
+
+	if ( stretch->cached[0] == y ) {
+		return(stretch->cache[0]);
+	}
+	if ( stretch->cached[1] == y ) {
+		return(stretch->cache[1]);
+	}
+
+	/* Rows are used going down, so the older one can go */
+	slot = (stretch->cached[0] < stretch->cached[1]) ? 0 : 1;
+	in = stretch->pixels + y*stretch->pitch;
+	if ( stretch->unpacked ) {
+		stretch->Unpack(stretch->format, (const Uint16 *)in,
+		                stretch->unpacked, stretch->span);
+		in = stretch->unpacked;
+	}
+	stretch->Scale(stretch, in, stretch->cache[slot]);
+	stretch->cached[slot] = y;
+	return(stretch->cache[slot]);
+}
+
+void SDL_StretchNextRow(SDL_Stretch *stretch, Uint8 *out)
+{
+	const int n = stretch->width*stretch->nchan;
+	const int row = stretch->row++;
+	const int y = stretch->rows[row];
+	const Uint16 *weight;
+	Uint8 *filtered;
+	int k;
+
+	if ( stretch->mode == SDL_SCALE_NEAREST ) {
+		SDL_NearestRow(stretch, stretch->pixels + y*stretch->pitch, out);
+		return;
+	}
+
+	filtered = stretch->filtered ? stretch->filtered : out;
+	if ( stretch->mode == SDL_SCALE_BILINEAR ) {
+		weight = stretch->rowweight++;
+		if ( *weight == 0 ) {
+			/* The centre of the row is on a source row */
+			if ( stretch->filtered ) {
+				filtered = (Uint8 *)SDL_StretchSourceRow(stretch, y);
+			} else {
+				SDL_memcpy(out, SDL_StretchSourceRow(stretch, y), n);
+			}
+		} else {
+			stretch->Blend(filtered,
+			               SDL_StretchSourceRow(stretch, y),
+			               SDL_StretchSourceRow(stretch, y+1),
+			               n, *weight);
 		}
 	} else {
-		full_src.x = 0;
-		full_src.y = 0;
-		full_src.w = src->w;
-		full_src.h = src->h;
-		srcrect = &full_src;
+		weight = stretch->rowweight;
+		for ( k = 0; k < stretch->rowcount[row]; ++k ) {
+			stretch->Sum(stretch->sum,
+			             SDL_StretchSourceRow(stretch, y+k),
+			             n, weight[k], (k == 0));
+		}
+		stretch->rowweight += stretch->rowcount[row];
+		stretch->Finish(filtered, stretch->sum, n);
+	}
+	if ( stretch->filtered ) {
+		stretch->Pack(stretch->format, filtered, (Uint16 *)out,
+		              stretch->width);
+	}
+}
+
+void SDL_FreeStretch(SDL_Stretch *stretch)
+{
+	if ( stretch ) {
+		SDL_free(stretch->cols);
+		SDL_free(stretch->colcount);
+		SDL_free(stretch->colweights);
+		SDL_free(stretch->rows);
+		SDL_free(stretch->rowcount);
+		SDL_free(stretch->rowweights);
+		SDL_free(stretch->unpacked);
+		SDL_free(stretch->cache[0]);
+		SDL_free(stretch->cache[1]);
+		SDL_free(stretch->filtered);
+		SDL_free(stretch->sum);
+		SDL_free(stretch);
+	}
+}
+
+int SDL_ClipStretch(SDL_Surface *src, const SDL_Rect *srcrect,
+                    SDL_Surface *dst, const SDL_Rect *dstrect,
+                    SDL_Rect *sr, SDL_Rect *dr, SDL_Rect *clip)
+{
+	int sx, sy, sw, sh;
+	int dx, dy, dw, dh;
+	int x0, y0, x1, y1, cut;
+
+	if ( srcrect ) {
+		sx = srcrect->x;
+		sy = srcrect->y;
+		sw = srcrect->w;
+		sh = srcrect->h;
+	} else {
+		sx = 0;
+		sy = 0;
+		sw = src->w;
+		sh = src->h;
 	}
 	if ( dstrect ) {
-		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
-		     ((dstrect->x+dstrect->w) > dst->w) ||
-		     ((dstrect->y+dstrect->h) > dst->h) ) {
-			SDL_SetError("Invalid destination blit rectangle");
-			return(-1);
-		}
+		dx = dstrect->x;
+		dy = dstrect->y;
+		dw = dstrect->w;
+		dh = dstrect->h;
 	} else {
-		full_dst.x = 0;
-		full_dst.y = 0;
-		full_dst.w = dst->w;
-		full_dst.h = dst->h;
-		dstrect = &full_dst;
+		dx = 0;
+		dy = 0;
+		dw = dst->w;
+		dh = dst->h;
+	}
+	if ( (sw <= 0) || (sh <= 0) || (dw <= 0) || (dh <= 0) ) {
+		return(0);
+	}
+
+	/* Clip the source rectangle, moving the target edges with it */
+	if ( sx < 0 ) {
+		cut = (int)(((Sint64)-sx*dw) / sw);
+		dx += cut;
+		dw -= cut;
+		sw += sx;
+		sx = 0;
+	}
+	if ( sx+sw > src->w ) {
+		cut = sx+sw - src->w;
+		if ( cut >= sw ) {
+			return(0);
+		}
+		dw -= (int)(((Sint64)cut*dw) / sw);
+		sw -= cut;
+	}
+	if ( sy < 0 ) {
+		cut = (int)(((Sint64)-sy*dh) / sh);
+		dy += cut;
+		dh -= cut;
+		sh += sy;
+		sy = 0;
+	}
+	if ( sy+sh > src->h ) {
+		cut = sy+sh - src->h;
+		if ( cut >= sh ) {
+			return(0);
+		}
+		dh -= (int)(((Sint64)cut*dh) / sh);
+		sh -= cut;
+	}
+	if ( (sw <= 0) || (sh <= 0) || (dw <= 0) || (dh <= 0) ) {
+		return(0);
 	}
 
+	/* Then clip the target to the clip rectangle */
+	x0 = dx;
+	if ( x0 < dst->clip_rect.x ) {
+		x0 = dst->clip_rect.x;
+	}
+	x1 = dx + dw;
+	if ( x1 > dst->clip_rect.x + dst->clip_rect.w ) {
+		x1 = dst->clip_rect.x + dst->clip_rect.w;
+	}
+	y0 = dy;
+	if ( y0 < dst->clip_rect.y ) {
+		y0 = dst->clip_rect.y;
+	}
+	y1 = dy + dh;
+	if ( y1 > dst->clip_rect.y + dst->clip_rect.h ) {
+		y1 = dst->clip_rect.y + dst->clip_rect.h;
+	}
+	if ( (x1 <= x0) || (y1 <= y0) ) {
+		return(0);
+	}
+
+	sr->x = sx;
+	sr->y = sy;
+	sr->w = sw;
+	sr->h = sh;
+	dr->x = dx;
+	dr->y = dy;
+	dr->w = dw;
+	dr->h = dh;
+	clip->x = x0;
+	clip->y = y0;
+	clip->w = x1 - x0;
+	clip->h = y1 - y0;
+	return(1);
+}
+
+/* Stretch 'srcrect' onto 'dstrect', drawing only the 'clip' part of it.
+   The rectangles have already been checked.
+*/
+static int SDL_StretchRect(SDL_Surface *src, const SDL_Rect *srcrect,
+                           SDL_Surface *dst, const SDL_Rect *dstrect,
+                           const SDL_Rect *clip, SDL_ScaleMode mode)
+{
+	SDL_Stretch *stretch;
+	Uint8 *dstp;
+	int src_locked;
+	int dst_locked;
+	int row;
+
 	/* Lock the destination if it's in hardware */
 	dst_locked = 0;
 	if ( SDL_MUSTLOCK(dst) ) {
@@ -276,74 +942,16 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 		src_locked = 1;
 	}
 
-	/* Set up the data... */
-	pos = 0x10000;
-	inc = (srcrect->h << 16) / dstrect->h;
-	src_row = srcrect->y;
-	dst_row = dstrect->y;
-
-#ifdef USE_ASM_STRETCH
-	/* Write the opcodes for this stretch */
-	if ( (bpp == 3) ||
-	     (generate_rowbytes(srcrect->w, dstrect->w, bpp) < 0) ) {
-		use_asm = SDL_FALSE;
-	}
-#endif
-
 	/* Perform the stretch blit */
-	for ( dst_maxrow = dst_row+dstrect->h; dst_row<dst_maxrow; ++dst_row ) {
-		dstp = (Uint8 *)dst->pixels + (dst_row*dst->pitch)
-		                            + (dstrect->x*bpp);
-		while ( pos >= 0x10000L ) {
-			srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
-			                            + (srcrect->x*bpp);
-			++src_row;
-			pos -= 0x10000L;
-		}
-#ifdef USE_ASM_STRETCH
-		if (use_asm) {
-#ifdef __GNUC__
-			__asm__ __volatile__ (
-			"call *%4"
-			: "=&D" (u1), "=&S" (u2)
-			: "0" (dstp), "1" (srcp), "r" (copy_row)
-			: "memory" );
-#elif defined(_MSC_VER) || defined(__WATCOMC__)
-		{ void *code = copy_row;
-			__asm {
-				push edi
-				push esi
-	
-				mov edi, dstp
-				mov esi, srcp
-				call dword ptr code
-
-				pop esi
-				pop edi
-			}
+	stretch = SDL_CreateStretch(src, srcrect, dstrect, clip, mode);
+	if ( stretch ) {
+		dstp = (Uint8 *)dst->pixels + clip->y*dst->pitch +
+		       clip->x*dst->format->BytesPerPixel;
+		for ( row = 0; row < clip->h; ++row ) {
+			SDL_StretchNextRow(stretch, dstp);
+			dstp += dst->pitch;
 		}
-#else
-#error Need inline assembly for this compiler
-#endif
-		} else
-#endif
-		switch (bpp) {
-		    case 1:
-			copy_row1(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 2:
-			copy_row2((Uint16 *)srcp, srcrect->w,
-			          (Uint16 *)dstp, dstrect->w);
-			break;
-		    case 3:
-			copy_row3(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 4:
-			copy_row4((Uint32 *)srcp, srcrect->w,
-			          (Uint32 *)dstp, dstrect->w);
-			break;
-		}
-		pos += inc;
+		SDL_FreeStretch(stretch);
 	}
 
 	/* We need to unlock the surfaces if they're locked */
@@ -353,6 +961,103 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	if ( src_locked ) {
 		SDL_UnlockSurface(src);
 	}
-	return(0);
+	return(stretch ? 0 : -1);
 }
 
+int SDL_StretchSurface(SDL_Surface *src, SDL_Rect *srcrect,
+                       SDL_Surface *dst, SDL_Rect *dstrect,
+                       SDL_ScaleMode mode)
+{
+	SDL_Rect sr, dr, clip;
+	int retval;
+
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_StretchSurface: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+	if ( (src->format->BitsPerPixel != dst->format->BitsPerPixel) ||
+	     (src->format->Rmask != dst->format->Rmask) ||
+	     (src->format->Gmask != dst->format->Gmask) ||
+	     (src->format->Bmask != dst->format->Bmask) ||
+	     (src->format->Amask != dst->format->Amask) ) {
+		SDL_SetError("Only works with same format surfaces");
+		return(-1);
+	}
+	if ( src->format->BitsPerPixel < 8 ) {
+		SDL_SetError("Stretching needs at least 8 bits per pixel");
+		return(-1);
+	}
+	if ( (mode != SDL_SCALE_NEAREST) && (mode != SDL_SCALE_BILINEAR) &&
+	     (mode != SDL_SCALE_BOX) ) {
+		SDL_SetError("Unknown scale mode");
+		return(-1);
+	}
+
+	if ( ! SDL_ClipStretch(src, srcrect, dst, dstrect, &sr, &dr, &clip) ) {
+		if ( dstrect ) {
+			dstrect->w = dstrect->h = 0;
+		}
+		return(0);
+	}
+	retval = SDL_StretchRect(src, &sr, dst, &dr, &clip, mode);
+	if ( dstrect ) {
+		*dstrect = clip;
+	}
+	return(retval);
+}
+
+/* Perform a stretch blit between two surfaces of the same format.
+   The rectangles must be inside the surfaces, there is no clipping.
+*/
+int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
+                    SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	SDL_Rect full_src;
+	SDL_Rect full_dst;
+
+	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
+		SDL_SetError("Only works with same format surfaces");
+		return(-1);
+	}
+
+	/* Verify the blit rectangles */
+	if ( srcrect ) {
+		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
+		     ((srcrect->x+srcrect->w) > src->w) ||
+		     ((srcrect->y+srcrect->h) > src->h) ) {
+			SDL_SetError("Invalid source blit rectangle");
+			return(-1);
+		}
+	} else {
+		full_src.x = 0;
+		full_src.y = 0;
+		full_src.w = src->w;
+		full_src.h = src->h;
+		srcrect = &full_src;
+	}
+	if ( dstrect ) {
+		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
+		     ((dstrect->x+dstrect->w) > dst->w) ||
+		     ((dstrect->y+dstrect->h) > dst->h) ) {
+			SDL_SetError("Invalid destination blit rectangle");
+			return(-1);
+		}
+	} else {
+		full_dst.x = 0;
+		full_dst.y = 0;
+		full_dst.w = dst->w;
+		full_dst.h = dst->h;
+		dstrect = &full_dst;
+	}
+	if ( !srcrect->w || !srcrect->h || !dstrect->w || !dstrect->h ) {
+		return(0);
+	}
+
+	return(SDL_StretchRect(src, srcrect, dst, dstrect, dstrect,
+	                       SDL_SCALE_NEAREST));
+}
@@ -22,8 +22,36 @@
 #include "SDL_config.h"
 
 /* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
+   The rectangles must be inside the surfaces, there is no clipping.
 */
 extern int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                            SDL_Surface *dst, SDL_Rect *dstrect);
 
+/* Clip a stretch of 'srcrect' of 'src' onto 'dstrect' of 'dst', either of
+   which may be NULL for the whole surface.  The source rectangle clipped
+   to the source surface is returned in 'sr', the target rectangle it
+   scales to in 'dr', and the part of that inside the clip rectangle of
+   'dst' in 'clip'.  Returns 0 if there is nothing to draw.
+*/
+extern int SDL_ClipStretch(SDL_Surface *src, const SDL_Rect *srcrect,
+                           SDL_Surface *dst, const SDL_Rect *dstrect,
+                           SDL_Rect *sr, SDL_Rect *dr, SDL_Rect *clip);
+
+/* A stretch in progress, producing the target rows one at a time */
+typedef struct SDL_Stretch SDL_Stretch;
+
+/* Set up a stretch of 'srcrect' of 'src' onto 'dstrect', producing the
+   'clip' part of it, which must be inside 'dstrect'.  The source surface
+   must stay locked while the stretch is used.  Returns NULL if out of
+   memory.
+*/
+extern SDL_Stretch *SDL_CreateStretch(SDL_Surface *src,
+                                      const SDL_Rect *srcrect,
+                                      const SDL_Rect *dstrect,
+                                      const SDL_Rect *clip,
+                                      SDL_ScaleMode mode);
+
+/* Write the next target row, in the source pixel format, to 'out' */
+extern void SDL_StretchNextRow(SDL_Stretch *stretch, Uint8 *out);
+
+extern void SDL_FreeStretch(SDL_Stretch *stretch);
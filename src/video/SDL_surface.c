@@ -27,7 +27,9 @@
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
 #include "SDL_pixels_c.h"
+#include "SDL_stretch_c.h"
 #include "SDL_leaks.h"
+#include "../cpuinfo/SDL_simd.h"
 
 
 /* Public routines */
@@ -533,73 +535,263 @@ int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
 	return 0;
 }
 
-static int SDL_FillRect1(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+int SDL_UpperBlitScaled (SDL_Surface *src, SDL_Rect *srcrect,
+			 SDL_Surface *dst, SDL_Rect *dstrect,
+			 SDL_ScaleMode mode)
 {
-	/* FIXME: We have to worry about packing order.. *sigh* */
-	SDL_SetError("1-bpp rect fill not yet implemented");
-	return -1;
-}
+	SDL_Rect sr, dr, clip;
+	int retval;
 
-static int SDL_FillRect4(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
-{
-	/* FIXME: We have to worry about packing order.. *sigh* */
-	SDL_SetError("4-bpp rect fill not yet implemented");
-	return -1;
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_UpperBlitScaled: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+	if ( src->format->BitsPerPixel < 8 ) {
+		SDL_SetError("Stretching needs at least 8 bits per pixel");
+		return(-1);
+	}
+	if ( (mode != SDL_SCALE_NEAREST) && (mode != SDL_SCALE_BILINEAR) &&
+	     (mode != SDL_SCALE_BOX) ) {
+		SDL_SetError("Unknown scale mode");
+		return(-1);
+	}
+
+	/* Clip both rectangles, keeping the scale of the whole blit */
+	if ( ! SDL_ClipStretch(src, srcrect, dst, dstrect, &sr, &dr, &clip) ) {
+		if ( dstrect ) {
+			dstrect->w = dstrect->h = 0;
+		}
+		return(0);
+	}
+	retval = SDL_SoftBlitScaled(src, &sr, dst, &dr, &clip, mode);
+	if ( dstrect ) {
+		*dstrect = clip;
+	}
+	return(retval);
 }
 
-/* 
- * This function performs a fast fill of the given rectangle with 'color'
+/*
+ * Fill a rectangle on a 1 or 4 bpp surface, where the leftmost pixel is
+ * in the most significant bits of each byte.
  */
-int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+static void SDL_FillRectPacked(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 {
-	SDL_VideoDevice *video = current_video;
-	SDL_VideoDevice *this  = current_video;
-	int x, y;
-	Uint8 *row;
+	int bpp = dst->format->BitsPerPixel;
+	Uint8 *row, *byte;
+	Uint8 fill, lmask, rmask;
+	int x1, x2, n, i, y;
+
+	/* Repeat the pixel over a whole byte */
+	color &= (1 << bpp) - 1;
+	fill = 0;
+	for ( i = 0; i < 8; i += bpp ) {
+		fill |= (Uint8)(color << i);
+	}
 
-	/* This function doesn't work on surfaces < 8 bpp */
-	if ( dst->format->BitsPerPixel < 8 ) {
-		switch(dst->format->BitsPerPixel) {
-		    case 1:
-			return SDL_FillRect1(dst, dstrect, color);
-			break;
-		    case 4:
-			return SDL_FillRect4(dst, dstrect, color);
-			break;
-		    default:
-			SDL_SetError("Fill rect on unsupported surface format");
-			return(-1);
-			break;
+	/* Bit offsets of the first and past the last pixel in the row */
+	x1 = dstrect->x * bpp;
+	x2 = (dstrect->x + dstrect->w) * bpp;
+	lmask = (Uint8)(0xFF >> (x1 & 7));
+	rmask = (Uint8)(0xFF << (8 - (x2 & 7)));
+	if ( (x1 >> 3) == (x2 >> 3) ) {
+		/* All the pixels are in a single byte */
+		lmask &= rmask;
+		rmask = 0;
+		n = 0;
+	} else {
+		if ( !(x1 & 7) ) {
+			lmask = 0;
 		}
+		n = (x2 >> 3) - ((x1 + 7) >> 3);
 	}
 
-	/* If 'dstrect' == NULL, then fill the whole surface */
-	if ( dstrect ) {
-		/* Perform clipping */
-		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
-			return(0);
+	row = (Uint8 *)dst->pixels + dstrect->y*dst->pitch + (x1 >> 3);
+	for ( y = dstrect->h; y; --y ) {
+		byte = row;
+		if ( lmask ) {
+			*byte = (*byte & ~lmask) | (fill & lmask);
+			++byte;
 		}
-	} else {
-		dstrect = &dst->clip_rect;
+		if ( n > 0 ) {
+			SDL_memset(byte, fill, n);
+			byte += n;
+		}
+		if ( rmask ) {
+			*byte = (*byte & ~rmask) | (fill & rmask);
+		}
+		row += dst->pitch;
 	}
+}
 
-	/* Check for hardware acceleration */
-	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
-					video->info.blit_fill ) {
-		SDL_Rect hw_rect;
-		if ( dst == SDL_VideoSurface ) {
-			hw_rect = *dstrect;
-			hw_rect.x += current_video->offset_x;
-			hw_rect.y += current_video->offset_y;
-			dstrect = &hw_rect;
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/* The vector fills repeat the pixel over this many bytes, a multiple of
+   the vector size and of every pixel size, so a row can start anywhere
+   within the pattern.
+ */
+#define FILL_PATTERN		96
+
+/* Fills larger than this bypass the cache with non-temporal stores */
+#define FILL_STREAM_BYTES	(1024*1024)
+#endif /* SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS */
+
+#if SDL_SSE2_INTRINSICS
+static void SDL_TARGET_SSE2 SDL_FillRowsSSE2(Uint8 *row, int pitch, int len,
+				int h, const Uint8 *pattern, int stream)
+{
+	__m128i v0, v1, v2;
+	int head, pos;
+
+	for ( ; h; --h, row += pitch ) {
+		/* Write up to the first aligned vector, then 48 bytes at once */
+		head = (int)(-(uintptr_t)row & 15);
+		if ( len < head + 48 ) {
+			SDL_memcpy(row, pattern, len);
+			continue;
 		}
-		return(video->FillHWRect(this, dst, dstrect, color));
+		SDL_memcpy(row, pattern, head);
+		v0 = _mm_loadu_si128((const __m128i *)(pattern + head));
+		v1 = _mm_loadu_si128((const __m128i *)(pattern + head + 16));
+		v2 = _mm_loadu_si128((const __m128i *)(pattern + head + 32));
+		pos = head;
+		if ( stream ) {
+			for ( ; pos + 48 <= len; pos += 48 ) {
+				_mm_stream_si128((__m128i *)(row + pos), v0);
+				_mm_stream_si128((__m128i *)(row + pos + 16), v1);
+				_mm_stream_si128((__m128i *)(row + pos + 32), v2);
+			}
+		} else {
+			for ( ; pos + 48 <= len; pos += 48 ) {
+				_mm_store_si128((__m128i *)(row + pos), v0);
+				_mm_store_si128((__m128i *)(row + pos + 16), v1);
+				_mm_store_si128((__m128i *)(row + pos + 32), v2);
+			}
+		}
+		SDL_memcpy(row + pos, pattern + (pos % FILL_PATTERN), len - pos);
+	}
+	if ( stream ) {
+		_mm_sfence();
 	}
+}
+#endif /* SDL_SSE2_INTRINSICS */
 
-	/* Perform software fill */
-	if ( SDL_LockSurface(dst) != 0 ) {
-		return(-1);
+#if SDL_AVX2_INTRINSICS
+static void SDL_TARGET_AVX2 SDL_FillRowsAVX2(Uint8 *row, int pitch, int len,
+				int h, const Uint8 *pattern, int stream)
+{
+	__m256i v0, v1, v2;
+	int head, pos;
+
+	for ( ; h; --h, row += pitch ) {
+		/* Write up to the first aligned vector, then 96 bytes at once */
+		head = (int)(-(uintptr_t)row & 31);
+		if ( len < head + 96 ) {
+			SDL_memcpy(row, pattern, len);
+			continue;
+		}
+		SDL_memcpy(row, pattern, head);
+		v0 = _mm256_loadu_si256((const __m256i *)(pattern + head));
+		v1 = _mm256_loadu_si256((const __m256i *)(pattern + head + 32));
+		v2 = _mm256_loadu_si256((const __m256i *)(pattern + head + 64));
+		pos = head;
+		if ( stream ) {
+			for ( ; pos + 96 <= len; pos += 96 ) {
+				_mm256_stream_si256((__m256i *)(row + pos), v0);
+				_mm256_stream_si256((__m256i *)(row + pos + 32), v1);
+				_mm256_stream_si256((__m256i *)(row + pos + 64), v2);
+			}
+		} else {
+			for ( ; pos + 96 <= len; pos += 96 ) {
+				_mm256_store_si256((__m256i *)(row + pos), v0);
+				_mm256_store_si256((__m256i *)(row + pos + 32), v1);
+				_mm256_store_si256((__m256i *)(row + pos + 64), v2);
+			}
+		}
+		SDL_memcpy(row + pos, pattern + (pos % FILL_PATTERN), len - pos);
+	}
+	if ( stream ) {
+		_mm_sfence();
+	}
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/* Fill a clipped rectangle with vector stores, returns 0 if the CPU
+   doesn't support them.
+ */
+static int SDL_FillRectSIMD(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	Uint8 pattern[FILL_PATTERN*2];
+	Uint8 pixel[4];
+	Uint16 color16;
+	Uint8 *row;
+	int bpp, len, i, stream;
+
+	/* The pixel as it is laid out in memory */
+	bpp = dst->format->BytesPerPixel;
+	switch (bpp) {
+	    case 1:
+		pixel[0] = (Uint8)color;
+		break;
+	    case 2:
+		color16 = (Uint16)color;
+		SDL_memcpy(pixel, &color16, 2);
+		break;
+	    case 3:
+		#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			color <<= 8;
+		#endif
+		SDL_memcpy(pixel, &color, 3);
+		break;
+	    default:
+		SDL_memcpy(pixel, &color, 4);
+		break;
+	}
+	for ( i = 0; i < (int)sizeof(pattern); ++i ) {
+		pattern[i] = pixel[i % bpp];
+	}
+
+	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+dstrect->x*bpp;
+	len = dstrect->w*bpp;
+	stream = (len*dstrect->h >= FILL_STREAM_BYTES);
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		SDL_FillRowsAVX2(row, dst->pitch, len, dstrect->h, pattern, stream);
+		return(1);
+	}
+#endif
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		SDL_FillRowsSSE2(row, dst->pitch, len, dstrect->h, pattern, stream);
+		return(1);
+	}
+#endif
+	return(0);
+}
+#endif /* SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS */
+
+/*
+ * Fill a clipped rectangle on a locked software surface
+ */
+static void SDL_FillRectSW(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	int x, y;
+	Uint8 *row;
+
+	if ( dst->format->BitsPerPixel < 8 ) {
+		SDL_FillRectPacked(dst, dstrect, color);
+		return;
+	}
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+	if ( SDL_FillRectSIMD(dst, dstrect, color) ) {
+		return;
 	}
+#endif
+
 	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+
 			dstrect->x*dst->format->BytesPerPixel;
 	if ( dst->format->palette || (color == 0) ) {
@@ -724,12 +916,123 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 			break;
 		}
 	}
+}
+
+/* Returns 0 if the surface can't be filled */
+static int SDL_CanFillRect(SDL_Surface *dst)
+{
+	switch (dst->format->BitsPerPixel) {
+	    case 1:
+	    case 4:
+		return(1);
+	    default:
+		if ( dst->format->BitsPerPixel < 8 ) {
+			SDL_SetError("Fill rect on unsupported surface format");
+			return(0);
+		}
+		return(1);
+	}
+}
+
+/* 
+ * This function performs a fast fill of the given rectangle with 'color'
+ */
+int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+
+	if ( !SDL_CanFillRect(dst) ) {
+		return(-1);
+	}
+
+	/* If 'dstrect' == NULL, then fill the whole surface */
+	if ( dstrect ) {
+		/* Perform clipping */
+		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
+			return(0);
+		}
+	} else {
+		dstrect = &dst->clip_rect;
+	}
+
+	/* Check for hardware acceleration */
+	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
+					video->info.blit_fill ) {
+		SDL_Rect hw_rect;
+		if ( dst == SDL_VideoSurface ) {
+			hw_rect = *dstrect;
+			hw_rect.x += current_video->offset_x;
+			hw_rect.y += current_video->offset_y;
+			dstrect = &hw_rect;
+		}
+		return(video->FillHWRect(this, dst, dstrect, color));
+	}
+
+	/* Perform software fill */
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	SDL_FillRectSW(dst, dstrect, color);
 	SDL_UnlockSurface(dst);
 
 	/* We're done! */
 	return(0);
 }
 
+/*
+ * This function fills a list of rectangles, locking the surface once
+ */
+int SDL_FillRects(SDL_Surface *dst, const SDL_Rect *rects, int numrects,
+							Uint32 color)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+	SDL_Rect rect;
+	int i, retval;
+
+	if ( !SDL_CanFillRect(dst) ) {
+		return(-1);
+	}
+	if ( numrects > 0 && !rects ) {
+		SDL_SetError("SDL_FillRects: passed a NULL rectangle list");
+		return(-1);
+	}
+
+	/* Check for hardware acceleration */
+	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
+					video->info.blit_fill ) {
+		retval = 0;
+		for ( i = 0; i < numrects; ++i ) {
+			rect = rects[i];
+			if ( !SDL_IntersectRect(&rect, &dst->clip_rect, &rect) ) {
+				continue;
+			}
+			if ( dst == SDL_VideoSurface ) {
+				rect.x += current_video->offset_x;
+				rect.y += current_video->offset_y;
+			}
+			if ( video->FillHWRect(this, dst, &rect, color) < 0 ) {
+				retval = -1;
+			}
+		}
+		return(retval);
+	}
+
+	/* Perform software fill */
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	for ( i = 0; i < numrects; ++i ) {
+		rect = rects[i];
+		if ( SDL_IntersectRect(&rect, &dst->clip_rect, &rect) ) {
+			SDL_FillRectSW(dst, &rect, color);
+		}
+	}
+	SDL_UnlockSurface(dst);
+	return(0);
+}
+
 /*
  * Lock a surface to directly access the pixels
  */
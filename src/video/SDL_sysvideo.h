@@ -271,6 +271,11 @@ struct SDL_VideoDevice {
 	int offset_y;
 	SDL_GrabMode input_grab;
 
+	/* Dirty rectangles waiting for SDL_UpdateDirtyRects() */
+	SDL_Rect *dirty_rects;
+	int num_dirty_rects;
+	int max_dirty_rects;
+
 	/* Driver information flags */
 	int handles_any_size;	/* Driver handles any size video mode */
 
@@ -28,6 +28,8 @@
 #include "SDL_blit.h"
 #include "SDL_pixels_c.h"
 #include "SDL_cursor_c.h"
+#include "SDL_yuvfuncs.h"
+#include "SDL_yuv_sw_c.h"
 #include "../events/SDL_sysevents.h"
 #include "../events/SDL_events_c.h"
 
@@ -219,6 +221,9 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 	video->wm_icon  = NULL;
 	video->offset_x = 0;
 	video->offset_y = 0;
+	video->dirty_rects = NULL;
+	video->num_dirty_rects = 0;
+	video->max_dirty_rects = 0;
 	SDL_memset(&video->info, 0, (sizeof video->info));
 	
 	video->displayformatalphapixel = NULL;
@@ -283,6 +288,9 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 	}
 	SDL_CursorInit(flags & SDL_INIT_EVENTTHREAD);
 
+	/* Start the software blit and YUV worker threads, if requested */
+	SDL_BandThreadsInit();
+
 	/* We're ready to go! */
 	return(0);
 }
@@ -660,6 +668,7 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 	if ( SDL_PublicSurface != NULL ) {
 		SDL_PublicSurface = NULL;
 	}
+	video->num_dirty_rects = 0;
 	if ( SDL_ShadowSurface != NULL ) {
 		SDL_Surface *ready_to_go;
 		ready_to_go = SDL_ShadowSurface;
@@ -1360,6 +1369,7 @@ void SDL_VideoQuit (void)
 			SDL_PublicSurface = NULL;
 		}
 		SDL_CursorQuit();
+		SDL_BandThreadsQuit();
 
 		/* Just in case... */
 		SDL_WM_GrabInputOff();
@@ -1400,6 +1410,10 @@ void SDL_VideoQuit (void)
 			SDL_free(video->wm_icon);
 			video->wm_icon = NULL;
 		}
+		if ( video->dirty_rects != NULL ) {
+			SDL_free(video->dirty_rects);
+			video->dirty_rects = NULL;
+		}
 
 		/* Finish cleaning up video subsystem */
 		video->free(this);
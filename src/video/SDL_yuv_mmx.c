@@ -80,16 +80,17 @@ static mmx_t MMX_grn565   = { .uw = {0x07e0, 0x07e0, 0x07e0, 0x07e0} };
 void ColorRGBDitherYV12MMX1X( int *colortab, Uint32 *rgb_2_pix,
                               unsigned char *lum, unsigned char *cr,
                               unsigned char *cb, unsigned char *out,
-                              int rows, int cols, int mod )
+                              int rows, int cols, int pitch )
 {
 	Uint32 *row1;
 	Uint32 *row2;
+	int mod;
 
 	unsigned char* y = lum +cols*rows;    // Pointer to the end
 	int x = 0;
 	row1 = (Uint32 *)out;                 // 32 bit target
-	row2 = (Uint32 *)out+cols+mod;        // start of second row
-	mod = (mod+cols+mod)*4;               // increment for row1 in byte
+	row2 = (Uint32 *)(out+pitch);         // start of second row
+	mod = 2*pitch - cols*4;               // increment for row1 in byte
 
 	__asm__ __volatile__ (
 		// tap dance to workaround the inability to use %%ebx at will...
@@ -241,16 +242,17 @@ void ColorRGBDitherYV12MMX1X( int *colortab, Uint32 *rgb_2_pix,
 void Color565DitherYV12MMX1X( int *colortab, Uint32 *rgb_2_pix,
                              unsigned char *lum, unsigned char *cr,
                              unsigned char *cb, unsigned char *out,
-                             int rows, int cols, int mod )
+                             int rows, int cols, int pitch )
 {
 	Uint16 *row1;
 	Uint16 *row2;
+	int mod;
 
 	unsigned char* y = lum +cols*rows;    /* Pointer to the end */
 	int x = 0;
 	row1 = (Uint16 *)out;                 /* 16 bit target */
-	row2 = (Uint16 *)out+cols+mod;        /* start of second row  */
-	mod = (mod+cols+mod)*2;               /* increment for row1 in byte */
+	row2 = (Uint16 *)(out+pitch);         /* start of second row  */
+	mod = 2*pitch - cols*2;               /* increment for row1 in byte */
 
 	__asm__ __volatile__(
 		// tap dance to workaround the inability to use %%ebx at will...
@@ -0,0 +1,807 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* SSE2 and AVX2 versions of the software YUV overlay converters.
+
+   The chroma offsets for each sample are computed in single precision,
+   which truncates to the same values as the tables the C converters
+   use, then added to the luma, clamped and packed into pixels in vector
+   registers, so the results match the C code exactly.
+*/
+
+#include "SDL_video.h"
+#include "../cpuinfo/SDL_simd.h"
+#include "SDL_yuvfuncs.h"
+#include "SDL_yuv_sw_c.h"
+
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+
+/* The rows are converted in chunks of this many pixels, with the chroma
+   offsets for a chunk kept on the stack.
+ */
+#define YUV_CHUNK	256
+
+/* How a row is read and written */
+typedef struct {
+	Uint32 *rgb_2_pix;
+	int *colortab;
+	int planar;		/* luma in its own plane, or interleaved */
+	int yshift;		/* interleaved luma in the low or high byte */
+	int crshift, cbshift;	/* interleaved chroma byte positions */
+	int bpp;		/* bytes per output pixel */
+	int scale;		/* 1 or 2 output pixels per input pixel */
+	int rloss, gloss, bloss;
+	int rshift, gshift, bshift;
+} YUVRowInfo;
+
+/* Compute the R, G and B chroma offsets for 'n' chroma samples */
+typedef void (*YUVChromaFunc)(const YUVRowInfo *info, const Uint8 *cr,
+			const Uint8 *cb, Sint16 *offsets, int n);
+
+/* Convert 'n' pixels, writing a second row at 2X */
+typedef void (*YUVRowFunc)(const YUVRowInfo *info, const Uint8 *lum,
+			const Sint16 *offsets, Uint8 *out, Uint8 *out2, int n);
+
+typedef struct {
+	YUVChromaFunc chroma;
+	YUVRowFunc row;
+} YUVFuncs;
+
+/* Write a pixel once, or twice across on two rows at 2X */
+static __inline__ void PutPixel(const YUVRowInfo *info, Uint8 *out,
+				Uint8 *out2, int i, Uint32 value)
+{
+	Uint8 *dst;
+	int j;
+
+	i *= info->scale;
+	for ( j = 0; j < info->scale; ++j, ++i ) {
+		switch (info->bpp) {
+		    case 2:
+			((Uint16 *)out)[i] = (Uint16)value;
+			if ( out2 ) {
+				((Uint16 *)out2)[i] = (Uint16)value;
+			}
+			break;
+		    case 3:
+			/* Same byte order as the C converters */
+			dst = out + i*3;
+			dst[0] = (value      ) & 0xFF;
+			dst[1] = (value >>  8) & 0xFF;
+			dst[2] = (value >> 16) & 0xFF;
+			if ( out2 ) {
+				dst = out2 + i*3;
+				dst[0] = (value      ) & 0xFF;
+				dst[1] = (value >>  8) & 0xFF;
+				dst[2] = (value >> 16) & 0xFF;
+			}
+			break;
+		    default:
+			((Uint32 *)out)[i] = value;
+			if ( out2 ) {
+				((Uint32 *)out2)[i] = value;
+			}
+			break;
+		}
+	}
+}
+
+/* Compute the chroma offsets the vector loop left over */
+static void ConvertChromaTail(const YUVRowInfo *info, const Uint8 *cr,
+				const Uint8 *cb, Sint16 *offsets, int i, int n)
+{
+	int *colortab = info->colortab;
+	int Cr, Cb;
+
+	for ( ; i < n; ++i ) {
+		if ( info->planar ) {
+			Cr = cr[i];
+			Cb = cb[i];
+		} else {
+			Cr = cr[i*4 + info->crshift/8];
+			Cb = cb[i*4 + info->cbshift/8];
+		}
+		offsets[i] = colortab[Cr + 0*256];
+		offsets[YUV_CHUNK/2 + i] = colortab[Cr + 1*256] +
+		                           colortab[Cb + 2*256];
+		offsets[YUV_CHUNK + i] = colortab[Cb + 3*256];
+	}
+}
+
+/* Convert the pixels the vector loop left over, using the tables */
+static void ConvertRowTail(const YUVRowInfo *info, const Uint8 *lum,
+				const Sint16 *offsets, Uint8 *out, Uint8 *out2,
+				int i, int n)
+{
+	Uint32 *rgb_2_pix = info->rgb_2_pix;
+	int L, c;
+
+	for ( ; i < n; ++i ) {
+		if ( info->planar ) {
+			L = lum[i];
+		} else {
+			L = lum[i*2 + (info->yshift ? 1 : 0)];
+		}
+		c = i / 2;
+		PutPixel(info, out, out2, i,
+			rgb_2_pix[0*768+256 + L + offsets[c]] |
+			rgb_2_pix[1*768+256 + L + offsets[YUV_CHUNK/2 + c]] |
+			rgb_2_pix[2*768+256 + L + offsets[YUV_CHUNK + c]]);
+	}
+}
+
+#if SDL_SSE2_INTRINSICS
+/* Multiply chroma values less 128 by a factor, truncating toward zero */
+static __inline__ __m128i SDL_TARGET_SSE2 ScaleChromaSSE2(__m128i c, float f)
+{
+	c = _mm_sub_epi32(c, _mm_set1_epi32(128));
+	return _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(c), _mm_set1_ps(f)));
+}
+
+/* Compute the chroma offsets 8 samples at a time */
+static void SDL_TARGET_SSE2 ConvertChromaSSE2(const YUVRowInfo *info,
+				const Uint8 *cr, const Uint8 *cb,
+				Sint16 *offsets, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lowbyte = _mm_set1_epi32(0xFF);
+	const __m128i crshift = _mm_cvtsi32_si128(info->crshift);
+	const __m128i cbshift = _mm_cvtsi32_si128(info->cbshift);
+	__m128i cr_lo, cr_hi, cb_lo, cb_hi, lo, hi;
+	int i;
+
+	for ( i = 0; i + 8 <= n; i += 8 ) {
+		if ( info->planar ) {
+			lo = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cr + i)), zero);
+			cr_lo = _mm_unpacklo_epi16(lo, zero);
+			cr_hi = _mm_unpackhi_epi16(lo, zero);
+			lo = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cb + i)), zero);
+			cb_lo = _mm_unpacklo_epi16(lo, zero);
+			cb_hi = _mm_unpackhi_epi16(lo, zero);
+		} else {
+			/* Both pointers are at the start of the macropixels */
+			lo = _mm_loadu_si128((const __m128i *)(cr + i*4));
+			hi = _mm_loadu_si128((const __m128i *)(cr + i*4 + 16));
+			cr_lo = _mm_and_si128(_mm_srl_epi32(lo, crshift), lowbyte);
+			cr_hi = _mm_and_si128(_mm_srl_epi32(hi, crshift), lowbyte);
+			cb_lo = _mm_and_si128(_mm_srl_epi32(lo, cbshift), lowbyte);
+			cb_hi = _mm_and_si128(_mm_srl_epi32(hi, cbshift), lowbyte);
+		}
+		_mm_storeu_si128((__m128i *)(offsets + i), _mm_packs_epi32(
+			ScaleChromaSSE2(cr_lo, (float)SDL_YUV_CR_R),
+			ScaleChromaSSE2(cr_hi, (float)SDL_YUV_CR_R)));
+		_mm_storeu_si128((__m128i *)(offsets + YUV_CHUNK/2 + i), _mm_packs_epi32(
+			_mm_add_epi32(ScaleChromaSSE2(cr_lo, (float)SDL_YUV_CR_G),
+			              ScaleChromaSSE2(cb_lo, (float)SDL_YUV_CB_G)),
+			_mm_add_epi32(ScaleChromaSSE2(cr_hi, (float)SDL_YUV_CR_G),
+			              ScaleChromaSSE2(cb_hi, (float)SDL_YUV_CB_G))));
+		_mm_storeu_si128((__m128i *)(offsets + YUV_CHUNK + i), _mm_packs_epi32(
+			ScaleChromaSSE2(cb_lo, (float)SDL_YUV_CB_B),
+			ScaleChromaSSE2(cb_hi, (float)SDL_YUV_CB_B)));
+	}
+	ConvertChromaTail(info, cr, cb, offsets, i, n);
+}
+
+/* Write 4 pixels as 24-bit, in the byte order of the C converters since
+   x86 is little endian.  The second store writes 2 bytes past the end,
+   so there must be more pixels after these.
+ */
+static __inline__ void SDL_TARGET_SSE2 Store24SSE2(Uint8 *dst, __m128i v)
+{
+	const __m128i lo = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+	const __m128i hi = _mm_set_epi32(0x0000FFFF, 0xFF000000, 0x0000FFFF, 0xFF000000);
+
+	v = _mm_or_si128(_mm_and_si128(v, lo),
+	                 _mm_and_si128(_mm_srli_epi64(v, 8), hi));
+	_mm_storel_epi64((__m128i *)dst, v);
+	_mm_storel_epi64((__m128i *)(dst + 6), _mm_unpackhi_epi64(v, v));
+}
+
+/* Convert a row 8 pixels at a time */
+static void SDL_TARGET_SSE2 ConvertRowSSE2(const YUVRowInfo *info,
+				const Uint8 *lum, const Sint16 *offsets,
+				Uint8 *out, Uint8 *out2, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i max = _mm_set1_epi16(255);
+	const __m128i lowbytes = _mm_set1_epi16(0x00FF);
+	const __m128i rloss = _mm_cvtsi32_si128(info->rloss);
+	const __m128i gloss = _mm_cvtsi32_si128(info->gloss);
+	const __m128i bloss = _mm_cvtsi32_si128(info->bloss);
+	const __m128i rshift = _mm_cvtsi32_si128(info->rshift);
+	const __m128i gshift = _mm_cvtsi32_si128(info->gshift);
+	const __m128i bshift = _mm_cvtsi32_si128(info->bshift);
+	__m128i y, c, r, g, b, lo, hi;
+	Uint8 *dst;
+	int i, j, last;
+
+	/* The 24-bit stores need a pixel after them */
+	last = (info->bpp == 3) ? n - 1 : n;
+	for ( i = 0; i + 8 <= last; i += 8 ) {
+		if ( info->planar ) {
+			y = _mm_loadl_epi64((const __m128i *)(lum + i));
+			y = _mm_unpacklo_epi8(y, zero);
+		} else {
+			y = _mm_loadu_si128((const __m128i *)(lum + i*2));
+			if ( info->yshift ) {
+				y = _mm_srli_epi16(y, 8);
+			} else {
+				y = _mm_and_si128(y, lowbytes);
+			}
+		}
+
+		/* Each chroma offset covers two pixels */
+		c = _mm_loadl_epi64((const __m128i *)(offsets + i/2));
+		r = _mm_add_epi16(y, _mm_unpacklo_epi16(c, c));
+		c = _mm_loadl_epi64((const __m128i *)(offsets + YUV_CHUNK/2 + i/2));
+		g = _mm_add_epi16(y, _mm_unpacklo_epi16(c, c));
+		c = _mm_loadl_epi64((const __m128i *)(offsets + YUV_CHUNK + i/2));
+		b = _mm_add_epi16(y, _mm_unpacklo_epi16(c, c));
+		r = _mm_min_epi16(_mm_max_epi16(r, zero), max);
+		g = _mm_min_epi16(_mm_max_epi16(g, zero), max);
+		b = _mm_min_epi16(_mm_max_epi16(b, zero), max);
+
+		if ( info->bpp == 2 ) {
+			lo = _mm_or_si128(
+				_mm_or_si128(
+				  _mm_sll_epi16(_mm_srl_epi16(r, rloss), rshift),
+				  _mm_sll_epi16(_mm_srl_epi16(g, gloss), gshift)),
+				_mm_sll_epi16(_mm_srl_epi16(b, bloss), bshift));
+			if ( info->scale == 1 ) {
+				_mm_storeu_si128((__m128i *)(out + i*2), lo);
+			} else {
+				hi = _mm_unpackhi_epi16(lo, lo);
+				lo = _mm_unpacklo_epi16(lo, lo);
+				dst = out + i*4;
+				_mm_storeu_si128((__m128i *)dst, lo);
+				_mm_storeu_si128((__m128i *)(dst + 16), hi);
+				dst = out2 + i*4;
+				_mm_storeu_si128((__m128i *)dst, lo);
+				_mm_storeu_si128((__m128i *)(dst + 16), hi);
+			}
+			continue;
+		}
+
+		lo = _mm_or_si128(
+			_mm_or_si128(
+			  _mm_sll_epi32(_mm_srl_epi32(_mm_unpacklo_epi16(r, zero), rloss), rshift),
+			  _mm_sll_epi32(_mm_srl_epi32(_mm_unpacklo_epi16(g, zero), gloss), gshift)),
+			_mm_sll_epi32(_mm_srl_epi32(_mm_unpacklo_epi16(b, zero), bloss), bshift));
+		hi = _mm_or_si128(
+			_mm_or_si128(
+			  _mm_sll_epi32(_mm_srl_epi32(_mm_unpackhi_epi16(r, zero), rloss), rshift),
+			  _mm_sll_epi32(_mm_srl_epi32(_mm_unpackhi_epi16(g, zero), gloss), gshift)),
+			_mm_sll_epi32(_mm_srl_epi32(_mm_unpackhi_epi16(b, zero), bloss), bshift));
+		if ( info->bpp == 3 ) {
+			if ( info->scale == 1 ) {
+				dst = out + i*3;
+				Store24SSE2(dst, lo);
+				Store24SSE2(dst + 12, hi);
+			} else {
+				for ( j = 0; j < 2; ++j ) {
+					dst = j ? out2 + i*6 : out + i*6;
+					Store24SSE2(dst, _mm_unpacklo_epi32(lo, lo));
+					Store24SSE2(dst + 12, _mm_unpackhi_epi32(lo, lo));
+					Store24SSE2(dst + 24, _mm_unpacklo_epi32(hi, hi));
+					Store24SSE2(dst + 36, _mm_unpackhi_epi32(hi, hi));
+				}
+			}
+		} else if ( info->scale == 1 ) {
+			dst = out + i*4;
+			_mm_storeu_si128((__m128i *)dst, lo);
+			_mm_storeu_si128((__m128i *)(dst + 16), hi);
+		} else {
+			for ( j = 0; j < 2; ++j ) {
+				dst = j ? out2 + i*8 : out + i*8;
+				_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi32(lo, lo));
+				_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi32(lo, lo));
+				_mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi32(hi, hi));
+				_mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi32(hi, hi));
+			}
+		}
+	}
+	ConvertRowTail(info, lum, offsets, out, out2, i, n);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+/* Multiply chroma values less 128 by a factor, truncating toward zero */
+static __inline__ __m256i SDL_TARGET_AVX2 ScaleChromaAVX2(__m256i c, float f)
+{
+	c = _mm256_sub_epi32(c, _mm256_set1_epi32(128));
+	return _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(c),
+	                                         _mm256_set1_ps(f)));
+}
+
+/* Pack two vectors of doublewords into words, keeping them in order */
+static __inline__ __m256i SDL_TARGET_AVX2 PackChromaAVX2(__m256i lo, __m256i hi)
+{
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+}
+
+/* Compute the chroma offsets 16 samples at a time */
+static void SDL_TARGET_AVX2 ConvertChromaAVX2(const YUVRowInfo *info,
+				const Uint8 *cr, const Uint8 *cb,
+				Sint16 *offsets, int n)
+{
+	const __m256i lowbyte = _mm256_set1_epi32(0xFF);
+	const __m128i crshift = _mm_cvtsi32_si128(info->crshift);
+	const __m128i cbshift = _mm_cvtsi32_si128(info->cbshift);
+	__m256i cr_lo, cr_hi, cb_lo, cb_hi, lo, hi;
+	int i;
+
+	for ( i = 0; i + 16 <= n; i += 16 ) {
+		if ( info->planar ) {
+			cr_lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(cr + i)));
+			cr_hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(cr + i + 8)));
+			cb_lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(cb + i)));
+			cb_hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(cb + i + 8)));
+		} else {
+			/* Both pointers are at the start of the macropixels */
+			lo = _mm256_loadu_si256((const __m256i *)(cr + i*4));
+			hi = _mm256_loadu_si256((const __m256i *)(cr + i*4 + 32));
+			cr_lo = _mm256_and_si256(_mm256_srl_epi32(lo, crshift), lowbyte);
+			cr_hi = _mm256_and_si256(_mm256_srl_epi32(hi, crshift), lowbyte);
+			cb_lo = _mm256_and_si256(_mm256_srl_epi32(lo, cbshift), lowbyte);
+			cb_hi = _mm256_and_si256(_mm256_srl_epi32(hi, cbshift), lowbyte);
+		}
+		_mm256_storeu_si256((__m256i *)(offsets + i), PackChromaAVX2(
+			ScaleChromaAVX2(cr_lo, (float)SDL_YUV_CR_R),
+			ScaleChromaAVX2(cr_hi, (float)SDL_YUV_CR_R)));
+		_mm256_storeu_si256((__m256i *)(offsets + YUV_CHUNK/2 + i), PackChromaAVX2(
+			_mm256_add_epi32(ScaleChromaAVX2(cr_lo, (float)SDL_YUV_CR_G),
+			                 ScaleChromaAVX2(cb_lo, (float)SDL_YUV_CB_G)),
+			_mm256_add_epi32(ScaleChromaAVX2(cr_hi, (float)SDL_YUV_CR_G),
+			                 ScaleChromaAVX2(cb_hi, (float)SDL_YUV_CB_G))));
+		_mm256_storeu_si256((__m256i *)(offsets + YUV_CHUNK + i), PackChromaAVX2(
+			ScaleChromaAVX2(cb_lo, (float)SDL_YUV_CB_B),
+			ScaleChromaAVX2(cb_hi, (float)SDL_YUV_CB_B)));
+	}
+	ConvertChromaTail(info, cr, cb, offsets, i, n);
+}
+
+/* Write 8 pixels as 24-bit, with 2 bytes past the end like Store24SSE2() */
+static __inline__ void SDL_TARGET_AVX2 Store24AVX2(Uint8 *dst, __m256i v)
+{
+	const __m256i lo = _mm256_set1_epi64x(0x0000000000FFFFFFLL);
+	const __m256i hi = _mm256_set1_epi64x(0x0000FFFFFF000000LL);
+	__m128i half;
+
+	v = _mm256_or_si256(_mm256_and_si256(v, lo),
+	                    _mm256_and_si256(_mm256_srli_epi64(v, 8), hi));
+	half = _mm256_castsi256_si128(v);
+	_mm_storel_epi64((__m128i *)dst, half);
+	_mm_storel_epi64((__m128i *)(dst + 6), _mm_unpackhi_epi64(half, half));
+	half = _mm256_extracti128_si256(v, 1);
+	_mm_storel_epi64((__m128i *)(dst + 12), half);
+	_mm_storel_epi64((__m128i *)(dst + 18), _mm_unpackhi_epi64(half, half));
+}
+
+/* Convert a row 16 pixels at a time */
+static void SDL_TARGET_AVX2 ConvertRowAVX2(const YUVRowInfo *info,
+				const Uint8 *lum, const Sint16 *offsets,
+				Uint8 *out, Uint8 *out2, int n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi16(255);
+	const __m256i lowbytes = _mm256_set1_epi16(0x00FF);
+	const __m256i lowwords = _mm256_set1_epi32(0x0000FFFF);
+	const __m256i dup_lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+	const __m256i dup_hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+	const __m128i rloss = _mm_cvtsi32_si128(info->rloss);
+	const __m128i gloss = _mm_cvtsi32_si128(info->gloss);
+	const __m128i bloss = _mm_cvtsi32_si128(info->bloss);
+	const __m128i rshift = _mm_cvtsi32_si128(info->rshift);
+	const __m128i gshift = _mm_cvtsi32_si128(info->gshift);
+	const __m128i bshift = _mm_cvtsi32_si128(info->bshift);
+	__m256i y, c, r, g, b, lo, hi;
+	Uint8 *dst;
+	int i, j, last;
+
+	/* The 24-bit stores need a pixel after them */
+	last = (info->bpp == 3) ? n - 1 : n;
+	for ( i = 0; i + 16 <= last; i += 16 ) {
+		if ( info->planar ) {
+			y = _mm256_cvtepu8_epi16(
+				_mm_loadu_si128((const __m128i *)(lum + i)));
+		} else {
+			y = _mm256_loadu_si256((const __m256i *)(lum + i*2));
+			if ( info->yshift ) {
+				y = _mm256_srli_epi16(y, 8);
+			} else {
+				y = _mm256_and_si256(y, lowbytes);
+			}
+		}
+
+		/* Each chroma offset covers two pixels, widening a word
+		   to a doubleword and copying it into the top half puts
+		   the offsets in pixel order.
+		 */
+		c = _mm256_cvtepi16_epi32(
+			_mm_loadu_si128((const __m128i *)(offsets + i/2)));
+		c = _mm256_or_si256(_mm256_and_si256(c, lowwords),
+		                    _mm256_slli_epi32(c, 16));
+		r = _mm256_add_epi16(y, c);
+		c = _mm256_cvtepi16_epi32(
+			_mm_loadu_si128((const __m128i *)(offsets + YUV_CHUNK/2 + i/2)));
+		c = _mm256_or_si256(_mm256_and_si256(c, lowwords),
+		                    _mm256_slli_epi32(c, 16));
+		g = _mm256_add_epi16(y, c);
+		c = _mm256_cvtepi16_epi32(
+			_mm_loadu_si128((const __m128i *)(offsets + YUV_CHUNK + i/2)));
+		c = _mm256_or_si256(_mm256_and_si256(c, lowwords),
+		                    _mm256_slli_epi32(c, 16));
+		b = _mm256_add_epi16(y, c);
+		r = _mm256_min_epi16(_mm256_max_epi16(r, zero), max);
+		g = _mm256_min_epi16(_mm256_max_epi16(g, zero), max);
+		b = _mm256_min_epi16(_mm256_max_epi16(b, zero), max);
+
+		if ( info->bpp == 2 ) {
+			lo = _mm256_or_si256(
+				_mm256_or_si256(
+				  _mm256_sll_epi16(_mm256_srl_epi16(r, rloss), rshift),
+				  _mm256_sll_epi16(_mm256_srl_epi16(g, gloss), gshift)),
+				_mm256_sll_epi16(_mm256_srl_epi16(b, bloss), bshift));
+			if ( info->scale == 1 ) {
+				_mm256_storeu_si256((__m256i *)(out + i*2), lo);
+			} else {
+				hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(lo, 1));
+				lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(lo));
+				hi = _mm256_or_si256(hi, _mm256_slli_epi32(hi, 16));
+				lo = _mm256_or_si256(lo, _mm256_slli_epi32(lo, 16));
+				dst = out + i*4;
+				_mm256_storeu_si256((__m256i *)dst, lo);
+				_mm256_storeu_si256((__m256i *)(dst + 32), hi);
+				dst = out2 + i*4;
+				_mm256_storeu_si256((__m256i *)dst, lo);
+				_mm256_storeu_si256((__m256i *)(dst + 32), hi);
+			}
+			continue;
+		}
+
+		lo = _mm256_or_si256(
+			_mm256_or_si256(
+			  _mm256_sll_epi32(_mm256_srl_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(r)), rloss), rshift),
+			  _mm256_sll_epi32(_mm256_srl_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(g)), gloss), gshift)),
+			_mm256_sll_epi32(_mm256_srl_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(b)), bloss), bshift));
+		hi = _mm256_or_si256(
+			_mm256_or_si256(
+			  _mm256_sll_epi32(_mm256_srl_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(r, 1)), rloss), rshift),
+			  _mm256_sll_epi32(_mm256_srl_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(g, 1)), gloss), gshift)),
+			_mm256_sll_epi32(_mm256_srl_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(b, 1)), bloss), bshift));
+		if ( info->bpp == 3 ) {
+			if ( info->scale == 1 ) {
+				dst = out + i*3;
+				Store24AVX2(dst, lo);
+				Store24AVX2(dst + 24, hi);
+			} else {
+				for ( j = 0; j < 2; ++j ) {
+					dst = j ? out2 + i*6 : out + i*6;
+					Store24AVX2(dst, _mm256_permutevar8x32_epi32(lo, dup_lo));
+					Store24AVX2(dst + 24, _mm256_permutevar8x32_epi32(lo, dup_hi));
+					Store24AVX2(dst + 48, _mm256_permutevar8x32_epi32(hi, dup_lo));
+					Store24AVX2(dst + 72, _mm256_permutevar8x32_epi32(hi, dup_hi));
+				}
+			}
+		} else if ( info->scale == 1 ) {
+			dst = out + i*4;
+			_mm256_storeu_si256((__m256i *)dst, lo);
+			_mm256_storeu_si256((__m256i *)(dst + 32), hi);
+		} else {
+			for ( j = 0; j < 2; ++j ) {
+				dst = j ? out2 + i*8 : out + i*8;
+				_mm256_storeu_si256((__m256i *)dst, _mm256_permutevar8x32_epi32(lo, dup_lo));
+				_mm256_storeu_si256((__m256i *)(dst + 32), _mm256_permutevar8x32_epi32(lo, dup_hi));
+				_mm256_storeu_si256((__m256i *)(dst + 64), _mm256_permutevar8x32_epi32(hi, dup_lo));
+				_mm256_storeu_si256((__m256i *)(dst + 96), _mm256_permutevar8x32_epi32(hi, dup_hi));
+			}
+		}
+	}
+	ConvertRowTail(info, lum, offsets, out, out2, i, n);
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+/* Find the shift that puts the top bits of an 8-bit channel in a mask,
+   returns 0 if the channel is wider than 8 bits.
+ */
+static int GetChannelShift(Uint32 mask, int *loss, int *shift)
+{
+	int bits;
+
+	*shift = 0;
+	if ( mask ) {
+		while ( !(mask & 1) ) {
+			mask >>= 1;
+			++*shift;
+		}
+	}
+	for ( bits = 0; mask; mask >>= 1 ) {
+		bits += (mask & 1);
+	}
+	*loss = 8 - bits;
+	return(bits <= 8);
+}
+
+/* Convert a whole frame, with the same layout as the C converters */
+static void ConvertYUV(const YUVFuncs *funcs, int *colortab, Uint32 *rgb_2_pix,
+                       unsigned char *lum, unsigned char *cr,
+                       unsigned char *cb, unsigned char *out,
+                       int rows, int cols, int pitch,
+                       int planar, int bpp, int scale)
+{
+	Sint16 offsets[3*YUV_CHUNK/2];
+	YUVRowInfo info;
+	Uint32 mask;
+	int lumpitch, chromapitch, chromastep;
+	int x, y, n;
+	Uint8 *dst, *dst2;
+
+	/* The tables hold each channel shifted into place, at full value
+	   at the top of the 0-255 range.
+	 */
+	mask = (bpp == 2) ? 0xFFFF : 0xFFFFFFFF;
+	GetChannelShift(rgb_2_pix[0*768+511] & mask, &info.rloss, &info.rshift);
+	GetChannelShift(rgb_2_pix[1*768+511] & mask, &info.gloss, &info.gshift);
+	GetChannelShift(rgb_2_pix[2*768+511] & mask, &info.bloss, &info.bshift);
+	info.rgb_2_pix = rgb_2_pix;
+	info.colortab = colortab;
+	info.planar = planar;
+	info.bpp = bpp;
+	info.scale = scale;
+
+	if ( planar ) {
+		info.yshift = 0;
+		info.crshift = 0;
+		info.cbshift = 0;
+		lumpitch = cols;
+		chromapitch = cols / 2;
+		chromastep = 1;
+	} else {
+		/* Point everything at the start of the macropixels, luma
+		   is in the even bytes except for UYVY.
+		 */
+		info.yshift = (lum > cr || lum > cb);
+		if ( info.yshift ) {
+			--lum;
+		}
+		info.crshift = (int)(cr - lum) * 8;
+		info.cbshift = (int)(cb - lum) * 8;
+		cr = cb = lum;
+		lumpitch = cols * 2;
+		chromapitch = cols * 2;
+		chromastep = 4;
+	}
+	/* Like the C converters, a trailing odd column or row is skipped */
+	cols &= ~1;
+	if ( planar ) {
+		rows &= ~1;
+	}
+	for ( y = 0; y < rows; y += (planar ? 2 : 1) ) {
+		for ( x = 0; x < cols; x += YUV_CHUNK ) {
+			n = SDL_min(YUV_CHUNK, cols - x);
+			funcs->chroma(&info, cr + (x/2)*chromastep,
+			              cb + (x/2)*chromastep, offsets, n/2);
+			dst = out + x*scale*bpp;
+			dst2 = (scale == 2) ? dst + pitch : NULL;
+			funcs->row(&info, lum + x*(planar ? 1 : 2),
+			           offsets, dst, dst2, n);
+			if ( planar ) {
+				/* The chroma is shared with the next row */
+				dst += scale*pitch;
+				dst2 = (scale == 2) ? dst + pitch : NULL;
+				funcs->row(&info, lum + lumpitch + x,
+				           offsets, dst, dst2, n);
+			}
+		}
+		if ( planar ) {
+			lum += 2*lumpitch;
+			out += 2*scale*pitch;
+		} else {
+			lum += lumpitch;
+			out += scale*pitch;
+		}
+		cr += chromapitch;
+		cb += chromapitch;
+	}
+}
+
+/* The converters for each row function, layout, pixel size and scale */
+#define YUV_CONVERTER(name, funcs, planar, bpp, scale) \
+static void name(int *colortab, Uint32 *rgb_2_pix, \
+                 unsigned char *lum, unsigned char *cr, \
+                 unsigned char *cb, unsigned char *out, \
+                 int rows, int cols, int pitch) \
+{ \
+	ConvertYUV(&funcs, colortab, rgb_2_pix, lum, cr, cb, out, \
+	           rows, cols, pitch, planar, bpp, scale); \
+}
+
+#if SDL_SSE2_INTRINSICS
+static const YUVFuncs sse2_funcs = { ConvertChromaSSE2, ConvertRowSSE2 };
+
+YUV_CONVERTER(Color16DitherYUY2SSE2_1X, sse2_funcs, 0, 2, 1)
+YUV_CONVERTER(Color24DitherYUY2SSE2_1X, sse2_funcs, 0, 3, 1)
+YUV_CONVERTER(Color32DitherYUY2SSE2_1X, sse2_funcs, 0, 4, 1)
+YUV_CONVERTER(Color16DitherYUY2SSE2_2X, sse2_funcs, 0, 2, 2)
+YUV_CONVERTER(Color24DitherYUY2SSE2_2X, sse2_funcs, 0, 3, 2)
+YUV_CONVERTER(Color32DitherYUY2SSE2_2X, sse2_funcs, 0, 4, 2)
+YUV_CONVERTER(Color16DitherYV12SSE2_1X, sse2_funcs, 1, 2, 1)
+YUV_CONVERTER(Color24DitherYV12SSE2_1X, sse2_funcs, 1, 3, 1)
+YUV_CONVERTER(Color32DitherYV12SSE2_1X, sse2_funcs, 1, 4, 1)
+YUV_CONVERTER(Color16DitherYV12SSE2_2X, sse2_funcs, 1, 2, 2)
+YUV_CONVERTER(Color24DitherYV12SSE2_2X, sse2_funcs, 1, 3, 2)
+YUV_CONVERTER(Color32DitherYV12SSE2_2X, sse2_funcs, 1, 4, 2)
+
+static const SDL_YUVDisplayFunc sse2_converters[2][3][2] = {
+	{
+		{ Color16DitherYUY2SSE2_1X, Color16DitherYUY2SSE2_2X },
+		{ Color24DitherYUY2SSE2_1X, Color24DitherYUY2SSE2_2X },
+		{ Color32DitherYUY2SSE2_1X, Color32DitherYUY2SSE2_2X }
+	}, {
+		{ Color16DitherYV12SSE2_1X, Color16DitherYV12SSE2_2X },
+		{ Color24DitherYV12SSE2_1X, Color24DitherYV12SSE2_2X },
+		{ Color32DitherYV12SSE2_1X, Color32DitherYV12SSE2_2X }
+	}
+};
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+static const YUVFuncs avx2_funcs = { ConvertChromaAVX2, ConvertRowAVX2 };
+
+YUV_CONVERTER(Color16DitherYUY2AVX2_1X, avx2_funcs, 0, 2, 1)
+YUV_CONVERTER(Color24DitherYUY2AVX2_1X, avx2_funcs, 0, 3, 1)
+YUV_CONVERTER(Color32DitherYUY2AVX2_1X, avx2_funcs, 0, 4, 1)
+YUV_CONVERTER(Color16DitherYUY2AVX2_2X, avx2_funcs, 0, 2, 2)
+YUV_CONVERTER(Color24DitherYUY2AVX2_2X, avx2_funcs, 0, 3, 2)
+YUV_CONVERTER(Color32DitherYUY2AVX2_2X, avx2_funcs, 0, 4, 2)
+YUV_CONVERTER(Color16DitherYV12AVX2_1X, avx2_funcs, 1, 2, 1)
+YUV_CONVERTER(Color24DitherYV12AVX2_1X, avx2_funcs, 1, 3, 1)
+YUV_CONVERTER(Color32DitherYV12AVX2_1X, avx2_funcs, 1, 4, 1)
+YUV_CONVERTER(Color16DitherYV12AVX2_2X, avx2_funcs, 1, 2, 2)
+YUV_CONVERTER(Color24DitherYV12AVX2_2X, avx2_funcs, 1, 3, 2)
+YUV_CONVERTER(Color32DitherYV12AVX2_2X, avx2_funcs, 1, 4, 2)
+
+static const SDL_YUVDisplayFunc avx2_converters[2][3][2] = {
+	{
+		{ Color16DitherYUY2AVX2_1X, Color16DitherYUY2AVX2_2X },
+		{ Color24DitherYUY2AVX2_1X, Color24DitherYUY2AVX2_2X },
+		{ Color32DitherYUY2AVX2_1X, Color32DitherYUY2AVX2_2X }
+	}, {
+		{ Color16DitherYV12AVX2_1X, Color16DitherYV12AVX2_2X },
+		{ Color24DitherYV12AVX2_1X, Color24DitherYV12AVX2_2X },
+		{ Color32DitherYV12AVX2_1X, Color32DitherYV12AVX2_2X }
+	}
+};
+#endif /* SDL_AVX2_INTRINSICS */
+
+/* Blending rows for the bilinear scaler */
+
+static void BlendRowsTail(Uint8 *out, const Uint8 *row0, const Uint8 *row1,
+                          int i, int n, int weight)
+{
+	for ( ; i < n; ++i ) {
+		out[i] = (Uint8)((row0[i] * (256-weight) +
+		                  row1[i] * weight + 128) >> 8);
+	}
+}
+
+#if SDL_SSE2_INTRINSICS
+static void SDL_TARGET_SSE2 BlendRowsSSE2(Uint8 *out, const Uint8 *row0,
+                                          const Uint8 *row1, int n, int weight)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w0 = _mm_set1_epi16((short)(256 - weight));
+	const __m128i w1 = _mm_set1_epi16((short)weight);
+	const __m128i round = _mm_set1_epi16(128);
+	__m128i a, b, lo, hi;
+	int i;
+
+	/* The sums fit in 16 bits unsigned */
+	for ( i = 0; i + 16 <= n; i += 16 ) {
+		a = _mm_loadu_si128((const __m128i *)(row0 + i));
+		b = _mm_loadu_si128((const __m128i *)(row1 + i));
+		lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+		                   _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+		hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+		                   _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+	}
+	BlendRowsTail(out, row0, row1, i, n, weight);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+static void SDL_TARGET_AVX2 BlendRowsAVX2(Uint8 *out, const Uint8 *row0,
+                                          const Uint8 *row1, int n, int weight)
+{
+	const __m256i w0 = _mm256_set1_epi16((short)(256 - weight));
+	const __m256i w1 = _mm256_set1_epi16((short)weight);
+	const __m256i round = _mm256_set1_epi16(128);
+	__m256i lo, hi;
+	int i;
+
+	for ( i = 0; i + 32 <= n; i += 32 ) {
+		lo = _mm256_add_epi16(
+			_mm256_mullo_epi16(_mm256_cvtepu8_epi16(
+				_mm_loadu_si128((const __m128i *)(row0 + i))), w0),
+			_mm256_mullo_epi16(_mm256_cvtepu8_epi16(
+				_mm_loadu_si128((const __m128i *)(row1 + i))), w1));
+		hi = _mm256_add_epi16(
+			_mm256_mullo_epi16(_mm256_cvtepu8_epi16(
+				_mm_loadu_si128((const __m128i *)(row0 + i + 16))), w0),
+			_mm256_mullo_epi16(_mm256_cvtepu8_epi16(
+				_mm_loadu_si128((const __m128i *)(row1 + i + 16))), w1));
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+		_mm256_storeu_si256((__m256i *)(out + i), _mm256_permute4x64_epi64(
+			_mm256_packus_epi16(lo, hi), 0xD8));
+	}
+	BlendRowsTail(out, row0, row1, i, n, weight);
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+SDL_YUVBlendFunc SDL_GetYUVBlendSIMD(void)
+{
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		return(BlendRowsAVX2);
+	}
+#endif
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		return(BlendRowsSSE2);
+	}
+#endif
+	return(NULL);
+}
+
+SDL_YUVDisplayFunc SDL_GetYUVDisplaySIMD(int planar, SDL_PixelFormat *format,
+                                         int scale_2x)
+{
+	int loss, shift;
+	int bpp = format->BytesPerPixel;
+
+	if ( bpp < 2 || bpp > 4 ||
+	     !GetChannelShift(format->Rmask, &loss, &shift) ||
+	     !GetChannelShift(format->Gmask, &loss, &shift) ||
+	     !GetChannelShift(format->Bmask, &loss, &shift) ) {
+		return(NULL);
+	}
+	planar = planar ? 1 : 0;
+	scale_2x = scale_2x ? 1 : 0;
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		return(avx2_converters[planar][bpp-2][scale_2x]);
+	}
+#endif
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		return(sse2_converters[planar][bpp-2][scale_2x]);
+	}
+#endif
+	return(NULL);
+}
+
+#endif /* SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS */
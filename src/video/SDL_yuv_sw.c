@@ -85,9 +85,10 @@
 
 #include "SDL_video.h"
 #include "SDL_cpuinfo.h"
-#include "SDL_stretch_c.h"
+#include "SDL_timer.h"
 #include "SDL_yuvfuncs.h"
 #include "SDL_yuv_sw_c.h"
+#include "SDL_blit.h"
 
 /* The functions used to manipulate software video overlays */
 static struct private_yuvhwfuncs sw_yuvfuncs = {
@@ -97,21 +98,42 @@ static struct private_yuvhwfuncs sw_yuvfuncs = {
 	SDL_FreeYUV_SW
 };
 
+#define SDL_YUV_BAND_ROWS	16	/* Rows in a macroblock */
+
+/* The rows kept by one thread while scaling a band of the target */
+typedef struct {
+	Uint8 *rows[3][2];
+	int rownum[3][2];
+	Uint8 *lum, *cr, *cb;
+	Uint8 *out;
+} SDL_YUVScaleBand;
+
+/* The tables and buffers for scaling between two rectangles */
+typedef struct {
+	SDL_Rect src;
+	SDL_Rect dst;
+	int width;
+	int lumfirst, lumlast;
+	int chromafirst, chromalast;
+	int *cols[3];
+	int ncols[3];
+	int next[3];
+	SDL_YUVBlendFunc blend;
+	int nbands;
+	SDL_YUVScaleBand bands[SDL_MAX_BAND_THREADS];
+	void *mem;
+} SDL_YUVScale;
+
 /* RGB conversion lookup tables */
 struct private_yuvhwdata {
-	SDL_Surface *stretch;
 	SDL_Surface *display;
 	Uint8 *pixels;
 	int *colortab;
 	Uint32 *rgb_2_pix;
-	void (*Display1X)(int *colortab, Uint32 *rgb_2_pix,
-                          unsigned char *lum, unsigned char *cr,
-                          unsigned char *cb, unsigned char *out,
-                          int rows, int cols, int mod );
-	void (*Display2X)(int *colortab, Uint32 *rgb_2_pix,
-	                  unsigned char *lum, unsigned char *cr,
-                          unsigned char *cb, unsigned char *out,
-                          int rows, int cols, int mod );
+	SDL_YUVDisplayFunc Display1X;
+	SDL_YUVDisplayFunc Display2X;
+	SDL_YUVDisplayFunc DisplayScaled;
+	SDL_YUVScale scale;
 
 	/* These are just so we don't have to allocate them separately */
 	Uint16 pitches[3];
@@ -125,17 +147,17 @@ struct private_yuvhwdata {
 extern void Color565DitherYV12MMX1X( int *colortab, Uint32 *rgb_2_pix,
                                      unsigned char *lum, unsigned char *cr,
                                      unsigned char *cb, unsigned char *out,
-                                     int rows, int cols, int mod );
+                                     int rows, int cols, int pitch );
 extern void ColorRGBDitherYV12MMX1X( int *colortab, Uint32 *rgb_2_pix,
                                      unsigned char *lum, unsigned char *cr,
                                      unsigned char *cb, unsigned char *out,
-                                     int rows, int cols, int mod );
+                                     int rows, int cols, int pitch );
 #endif 
 
 static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned short* row1;
     unsigned short* row2;
@@ -145,12 +167,14 @@ static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    const int next_row = pitch / 2;
+    int mod;
 
     row1 = (unsigned short*) out;
-    row2 = row1 + cols + mod;
+    row2 = row1 + next_row;
     lum2 = lum + cols;
 
-    mod += cols + mod;
+    mod = 2*next_row - cols;
 
     y = rows / 2;
     while( y-- )
@@ -205,7 +229,7 @@ static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int value;
     unsigned char* row1;
@@ -217,12 +241,13 @@ static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
     int cb_b;
     int cols_2 = cols / 2;
 
+    int mod;
+
     row1 = out;
-    row2 = row1 + cols*3 + mod*3;
+    row2 = row1 + pitch;
     lum2 = lum + cols;
 
-    mod += cols + mod;
-    mod *= 3;
+    mod = 2*pitch - cols*3;
 
     y = rows / 2;
     while( y-- )
@@ -289,7 +314,7 @@ static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int* row1;
     unsigned int* row2;
@@ -299,12 +324,14 @@ static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    const int next_row = pitch / 4;
+    int mod;
 
     row1 = (unsigned int*) out;
-    row2 = row1 + cols + mod;
+    row2 = row1 + next_row;
     lum2 = lum + cols;
 
-    mod += cols + mod;
+    mod = 2*next_row - cols;
 
     y = rows / 2;
     while( y-- )
@@ -364,10 +391,10 @@ static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int* row1 = (unsigned int*) out;
-    const int next_row = cols+(mod/2);
+    const int next_row = pitch / 4;
     unsigned int* row2 = row1 + 2*next_row;
     unsigned char* lum2;
     int x, y;
@@ -375,10 +402,11 @@ static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    int mod;
 
     lum2 = lum + cols;
 
-    mod = (next_row * 3) + (mod/2);
+    mod = 4*next_row - cols;
 
     y = rows / 2;
     while( y-- )
@@ -437,11 +465,11 @@ static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
 static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int value;
     unsigned char* row1 = out;
-    const int next_row = (cols*2 + mod) * 3;
+    const int next_row = pitch;
     unsigned char* row2 = row1 + 2*next_row;
     unsigned char* lum2;
     int x, y;
@@ -449,10 +477,11 @@ static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    int mod;
 
     lum2 = lum + cols;
 
-    mod = next_row*3 + mod*3;
+    mod = 4*next_row - cols*2*3;
 
     y = rows / 2;
     while( y-- )
@@ -535,10 +564,10 @@ static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
 static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int* row1 = (unsigned int*) out;
-    const int next_row = cols*2+mod;
+    const int next_row = pitch / 4;
     unsigned int* row2 = row1 + 2*next_row;
     unsigned char* lum2;
     int x, y;
@@ -546,10 +575,11 @@ static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    int mod;
 
     lum2 = lum + cols;
 
-    mod = (next_row * 3) + mod;
+    mod = 4*next_row - cols*2;
 
     y = rows / 2;
     while( y-- )
@@ -612,7 +642,7 @@ static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
 static void Color16DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned short* row;
     int x, y;
@@ -620,6 +650,7 @@ static void Color16DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    const int mod = pitch/2 - cols;
 
     row = (unsigned short*) out;
 
@@ -656,7 +687,7 @@ static void Color16DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color24DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int value;
     unsigned char* row;
@@ -665,9 +696,9 @@ static void Color24DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    const int mod = pitch - cols*3;
 
     row = (unsigned char*) out;
-    mod *= 3;
     y = rows;
     while( y-- )
     {
@@ -706,7 +737,7 @@ static void Color24DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color32DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int* row;
     int x, y;
@@ -714,6 +745,7 @@ static void Color32DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+    const int mod = pitch/4 - cols;
 
     row = (unsigned int*) out;
     y = rows;
@@ -754,10 +786,10 @@ static void Color32DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int* row = (unsigned int*) out;
-    const int next_row = cols+(mod/2);
+    const int next_row = pitch / 4;
     int x, y;
     int cr_r;
     int crb_g;
@@ -791,18 +823,18 @@ static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row++;
 
         }
-        row += next_row;
+        row += 2*next_row - cols;
     }
 }
 
 static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int value;
     unsigned char* row = out;
-    const int next_row = (cols*2 + mod) * 3;
+    const int next_row = pitch;
     int x, y;
     int cr_r;
     int crb_g;
@@ -847,23 +879,22 @@ static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row += 2*3;
 
         }
-        row += next_row;
+        row += 2*next_row - cols*2*3;
     }
 }
 
 static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int pitch )
 {
     unsigned int* row = (unsigned int*) out;
-    const int next_row = cols*2+mod;
+    const int next_row = pitch / 4;
     int x, y;
     int cr_r;
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
-    mod+=mod;
     y = rows;
     while( y-- )
     {
@@ -895,7 +926,7 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
 
         }
 
-        row += next_row;
+        row += 2*next_row - cols*2;
     }
 }
 
@@ -923,6 +954,360 @@ static int free_bits_at_bottom( Uint32 a )
 }
 
 
+/* Scaling to any size with bilinear filtering
+
+   Each pair of target rows is scaled from the overlay into planar rows
+   at the target width, which are then converted straight to the
+   display.  Source rows are scaled across once and kept while they're
+   needed, then blended down.  Positions are 16.16 fixed point at the
+   pixel centers, and the chroma is sampled once for each 2x2 block of
+   target pixels.
+ */
+
+/* Fill a table of the source samples for 'n' target columns, starting
+   at 16.16 position 'pos' and moving 'inc' each column.  Each column
+   has the byte offset of the sample before it from sample 'first', and
+   the weight of the sample after it, 'step' bytes on.  The last column
+   uses the one before it at full weight so nothing past it is read.
+ */
+static void SDL_YUVScaleCols(int *cols, int n, int pos, int inc,
+                             int first, int last, int step)
+{
+	int i, x, weight;
+
+	for ( i=0; i<n; ++i, pos += inc ) {
+		if ( pos <= (first << 16) ) {
+			x = first;
+			weight = 0;
+		} else if ( pos >= (last << 16) ) {
+			x = last;
+			weight = 0;
+		} else {
+			x = (pos >> 16);
+			weight = (pos >> 8) & 0xFF;
+		}
+		if ( x == last && x > first ) {
+			x = last - 1;
+			weight = 256;
+		}
+		cols[2*i] = (x - first) * step;
+		cols[2*i+1] = weight;
+	}
+}
+
+/* Find the source row before a 16.16 position and the weight of the
+   row after it, between rows 'first' and 'last'.
+ */
+static int SDL_YUVScaleRowPos(int pos, int first, int last, int *weight)
+{
+	if ( pos <= (first << 16) ) {
+		*weight = 0;
+		return(first);
+	}
+	if ( pos >= (last << 16) ) {
+		*weight = 0;
+		return(last);
+	}
+	*weight = (pos >> 8) & 0xFF;
+	return(pos >> 16);
+}
+
+/* Scale a source row to the columns in a table, with the samples
+   'next' bytes apart.
+ */
+static void SDL_YUVScaleRow(Uint8 *out, const Uint8 *in,
+                            const int *cols, int n, int next)
+{
+	const Uint8 *p;
+	int i, weight;
+
+	for ( i=0; i<n; ++i ) {
+		p = in + cols[2*i];
+		weight = cols[2*i+1];
+		out[i] = (Uint8)((p[0] * (256-weight) +
+		                  p[next] * weight + 128) >> 8);
+	}
+}
+
+/* Blend two scaled rows using 'weight' 256ths of the second one */
+static void SDL_YUVBlendRows(Uint8 *out, const Uint8 *row0, const Uint8 *row1,
+                             int n, int weight)
+{
+	int i;
+
+	for ( i=0; i<n; ++i ) {
+		out[i] = (Uint8)((row0[i] * (256-weight) +
+		                  row1[i] * weight + 128) >> 8);
+	}
+}
+
+/* Return source row 'row' of a plane scaled across, scaling it unless
+   it's still kept from the last rows, without replacing row 'keep'.
+ */
+static Uint8 *SDL_YUVScaledRow(SDL_YUVScale *scale, SDL_YUVScaleBand *band,
+                               int plane, int row, int keep,
+                               const Uint8 *pixels, int pitch)
+{
+	int slot;
+
+	for ( slot=0; slot<2; ++slot ) {
+		if ( band->rownum[plane][slot] == row ) {
+			return(band->rows[plane][slot]);
+		}
+	}
+	slot = (band->rownum[plane][0] == keep);
+	SDL_YUVScaleRow(band->rows[plane][slot], pixels + row*pitch,
+	                scale->cols[plane], scale->ncols[plane],
+	                scale->next[plane]);
+	band->rownum[plane][slot] = row;
+	return(band->rows[plane][slot]);
+}
+
+/* Make target row 'out' of a plane from the source rows at 'pos' */
+static void SDL_YUVScalePlaneRow(SDL_YUVScale *scale, SDL_YUVScaleBand *band,
+                                 int plane, Uint8 *out,
+                                 int pos, int first, int last,
+                                 const Uint8 *pixels, int pitch)
+{
+	Uint8 *row0, *row1;
+	int row, weight;
+
+	row = SDL_YUVScaleRowPos(pos, first, last, &weight);
+	row0 = SDL_YUVScaledRow(scale, band, plane, row, -1, pixels, pitch);
+	if ( weight == 0 ) {
+		SDL_memcpy(out, row0, scale->ncols[plane]);
+		return;
+	}
+	row1 = SDL_YUVScaledRow(scale, band, plane, row+1, row, pixels, pitch);
+	scale->blend(out, row0, row1, scale->ncols[plane], weight);
+}
+
+/* Set up the column tables, and the row buffers for 'nbands' threads,
+   for scaling between two rectangles, returns -1 if out of memory.
+ */
+static int SDL_SetupYUVScale(struct private_yuvhwdata *swdata,
+                             SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst,
+                             int nbands)
+{
+	SDL_YUVScale *scale = &swdata->scale;
+	SDL_YUVScaleBand *band;
+	int width, bpp, lumstep, chromastep;
+	int i, plane, slot, inc;
+	Uint8 *mem;
+
+	if ( scale->mem && scale->nbands == nbands &&
+	     scale->src.x == src->x && scale->src.y == src->y &&
+	     scale->src.w == src->w && scale->src.h == src->h &&
+	     scale->dst.w == dst->w && scale->dst.h == dst->h ) {
+		return(0);
+	}
+	if ( scale->mem ) {
+		SDL_free(scale->mem);
+		scale->mem = NULL;
+	}
+
+	/* The converters work on pairs of pixels */
+	width = (dst->w + 1) & ~1;
+	bpp = swdata->display->format->BytesPerPixel;
+	mem = (Uint8 *)SDL_malloc(3*width * sizeof(int) +
+	                          nbands * (7*width + 2*width*bpp));
+	if ( mem == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	scale->mem = mem;
+	scale->width = width;
+	scale->cols[0] = (int *)mem;
+	scale->cols[1] = scale->cols[0] + 2*width;
+	scale->cols[2] = scale->cols[1];
+	mem += 3*width * sizeof(int);
+	scale->nbands = nbands;
+	for ( i=0; i<nbands; ++i ) {
+		band = &scale->bands[i];
+		for ( plane=0; plane<3; ++plane ) {
+			for ( slot=0; slot<2; ++slot ) {
+				band->rows[plane][slot] = mem;
+				mem += (plane == 0) ? width : width/2;
+			}
+		}
+		band->lum = mem;
+		mem += 2*width;
+		band->cr = mem;
+		mem += width/2;
+		band->cb = mem;
+		mem += width/2;
+		band->out = mem;
+		mem += 2*width*bpp;
+	}
+
+	/* The chroma covers pairs of columns, and rows for planar data */
+	scale->lumfirst = src->x;
+	scale->lumlast = src->x + src->w - 1;
+	scale->chromafirst = src->x / 2;
+	scale->chromalast = SDL_min(scale->lumlast / 2, overlay->w / 2 - 1);
+	scale->chromalast = SDL_max(scale->chromalast, scale->chromafirst);
+	if ( overlay->planes == 3 ) {
+		lumstep = 1;
+		chromastep = 1;
+	} else {
+		lumstep = 2;
+		chromastep = 4;
+	}
+	scale->ncols[0] = width;
+	scale->ncols[1] = scale->ncols[2] = width/2;
+	if ( scale->lumlast == scale->lumfirst ) {
+		lumstep = 0;
+	}
+	if ( scale->chromalast == scale->chromafirst ) {
+		chromastep = 0;
+	}
+	scale->next[0] = lumstep;
+	scale->next[1] = scale->next[2] = chromastep;
+	inc = (src->w << 16) / dst->w;
+	SDL_YUVScaleCols(scale->cols[0], width,
+	                 (src->x << 16) + inc/2 - 0x8000, inc,
+	                 scale->lumfirst, scale->lumlast, lumstep);
+	SDL_YUVScaleCols(scale->cols[1], width/2,
+	                 ((src->x << 16) + inc) / 2 - 0x8000, inc,
+	                 scale->chromafirst, scale->chromalast, chromastep);
+	scale->src = *src;
+	scale->dst = *dst;
+	return(0);
+}
+
+/* Scale and convert 'rows' target rows from row 'first', which is even,
+   to 'dstp' using the buffers of one band.
+ */
+static void SDL_DisplayYUVScaled(struct private_yuvhwdata *swdata,
+                                 SDL_Overlay *overlay,
+                                 Uint8 *lum, Uint8 *Cr, Uint8 *Cb, Uint8 *dstp,
+                                 int first, int rows, SDL_YUVScaleBand *band)
+{
+	SDL_YUVScale *scale = &swdata->scale;
+	SDL_Rect *src = &scale->src;
+	SDL_Rect *dst = &scale->dst;
+	int lumpitch, lumtop, lumbottom;
+	int chromapitch, chromatop, chromabottom, vsub;
+	int width, bpp, pitch;
+	int y, i, n, inc, pos, direct;
+	Uint8 *out;
+
+	if ( overlay->planes == 3 ) {
+		lum += scale->lumfirst;
+		Cr += scale->chromafirst;
+		Cb += scale->chromafirst;
+		lumpitch = overlay->pitches[0];
+		chromapitch = overlay->pitches[1];
+		vsub = 2;
+	} else {
+		lum += scale->lumfirst * 2;
+		Cr += scale->chromafirst * 4;
+		Cb += scale->chromafirst * 4;
+		lumpitch = overlay->pitches[0];
+		chromapitch = overlay->pitches[0];
+		vsub = 1;
+	}
+	lumtop = src->y;
+	lumbottom = src->y + src->h - 1;
+	chromatop = src->y / vsub;
+	chromabottom = SDL_min(lumbottom / vsub, overlay->h / vsub - 1);
+	chromabottom = SDL_max(chromabottom, chromatop);
+	width = scale->width;
+	bpp = swdata->display->format->BytesPerPixel;
+	pitch = swdata->display->pitch;
+
+	/* The overlay has new data, so nothing scaled before is kept */
+	for ( i=0; i<3; ++i ) {
+		band->rownum[i][0] = -1;
+		band->rownum[i][1] = -1;
+	}
+
+	inc = (src->h << 16) / dst->h;
+	for ( y=first; y<first+rows; y+=2 ) {
+		/* Two rows of luma, repeating the last one if needed */
+		for ( i=0; i<2; ++i ) {
+			pos = (src->y << 16) + SDL_min(y+i, dst->h-1)*inc +
+			      inc/2 - 0x8000;
+			SDL_YUVScalePlaneRow(scale, band, 0, band->lum + i*width,
+			                     pos, lumtop, lumbottom,
+			                     lum, lumpitch);
+		}
+
+		/* One row of chroma between them */
+		pos = ((src->y << 16) + (y+1)*inc) / vsub - 0x8000;
+		SDL_YUVScalePlaneRow(scale, band, 1, band->cr,
+		                     pos, chromatop, chromabottom,
+		                     Cr, chromapitch);
+		SDL_YUVScalePlaneRow(scale, band, 2, band->cb,
+		                     pos, chromatop, chromabottom,
+		                     Cb, chromapitch);
+
+		/* Convert straight to the display unless the rows don't
+		   fit there exactly, then go through a small buffer.
+		 */
+		n = SDL_min(2, first + rows - y);
+		direct = (n == 2 && width == dst->w);
+		out = direct ? dstp : band->out;
+		swdata->DisplayScaled(swdata->colortab, swdata->rgb_2_pix,
+		                      band->lum, band->cr, band->cb, out,
+		                      2, width, direct ? pitch : width*bpp);
+		if ( ! direct ) {
+			for ( i=0; i<n; ++i ) {
+				SDL_memcpy(dstp + i*pitch,
+				           band->out + i*width*bpp, dst->w*bpp);
+			}
+		}
+		dstp += 2*pitch;
+	}
+}
+
+/* Converting with several threads
+
+   A frame is split into bands of whole macroblock rows, one for each
+   thread, which are run by the worker threads shared with the blitter.
+   This is disabled unless the SDL_YUV_THREADS environment variable is
+   set to the number of threads to use (including the calling thread)
+   when the video subsystem is initialized.
+ */
+
+/* A band of rows for one thread to convert */
+typedef struct {
+	struct private_yuvhwdata *swdata;
+	SDL_Overlay *overlay;
+	SDL_YUVDisplayFunc Display;	/* NULL to scale */
+	Uint8 *lum, *cr, *cb;
+	Uint8 *out;
+	int rows, cols;
+	int pitch;			/* The display pitch in bytes */
+	int first;			/* The first target row when scaling */
+	SDL_YUVScaleBand *scaleband;
+} SDL_YUVBand;
+
+static void SDL_ConvertYUVBand(void *data)
+{
+	SDL_YUVBand *band = (SDL_YUVBand *)data;
+	struct private_yuvhwdata *swdata = band->swdata;
+
+	if ( band->Display ) {
+		band->Display(swdata->colortab, swdata->rgb_2_pix,
+		              band->lum, band->cr, band->cb, band->out,
+		              band->rows, band->cols, band->pitch);
+	} else {
+		SDL_DisplayYUVScaled(swdata, band->overlay,
+		                     band->lum, band->cr, band->cb, band->out,
+		                     band->first, band->rows, band->scaleband);
+	}
+}
+
+static SDL_YUVConvertHook SDL_YUVHook = NULL;
+static void *SDL_YUVHookData = NULL;
+
+void SDL_SetYUVConvertHook(SDL_YUVConvertHook hook, void *userdata)
+{
+	SDL_YUVHook = hook;
+	SDL_YUVHookData = userdata;
+}
+
 SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_Surface *display)
 {
 	SDL_Overlay *overlay;
@@ -983,8 +1368,9 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		SDL_FreeYUVOverlay(overlay);
 		return(NULL);
 	}
-	swdata->stretch = NULL;
 	swdata->display = display;
+	SDL_memset(&swdata->scale, 0, sizeof(swdata->scale));
+	swdata->scale.blend = SDL_YUVBlendRows;
 	swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
 	swdata->colortab = (int *)SDL_malloc(4*256*sizeof(int));
 	Cr_r_tab = &swdata->colortab[0*256];
@@ -1007,10 +1393,10 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		   would be done here.  See the Berkeley mpeg_play sources.
 		*/
 		CB = CR = (i-128);
-		Cr_r_tab[i] = (int) ( (0.419/0.299) * CR);
-		Cr_g_tab[i] = (int) (-(0.299/0.419) * CR);
-		Cb_g_tab[i] = (int) (-(0.114/0.331) * CB); 
-		Cb_b_tab[i] = (int) ( (0.587/0.331) * CB);
+		Cr_r_tab[i] = (int) (SDL_YUV_CR_R * CR);
+		Cr_g_tab[i] = (int) (SDL_YUV_CR_G * CR);
+		Cb_g_tab[i] = (int) (SDL_YUV_CB_G * CB);
+		Cb_b_tab[i] = (int) (SDL_YUV_CB_B * CB);
 	}
 
 	/* 
@@ -1122,6 +1508,44 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		break;
 	}
 
+	/* Scaled rows are always converted as planar data */
+	switch (display->format->BytesPerPixel) {
+	    case 2:
+		swdata->DisplayScaled = Color16DitherYV12Mod1X;
+		break;
+	    case 3:
+		swdata->DisplayScaled = Color24DitherYV12Mod1X;
+		break;
+	    default:
+		swdata->DisplayScaled = Color32DitherYV12Mod1X;
+		break;
+	}
+
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+	/* Use the vector converters if the CPU supports them */
+	{
+		int planar = (format == SDL_YV12_OVERLAY ||
+		              format == SDL_IYUV_OVERLAY);
+		SDL_YUVDisplayFunc convert;
+
+		convert = SDL_GetYUVDisplaySIMD(planar, display->format, 0);
+		if ( convert ) {
+			swdata->Display1X = convert;
+		}
+		convert = SDL_GetYUVDisplaySIMD(planar, display->format, 1);
+		if ( convert ) {
+			swdata->Display2X = convert;
+		}
+		convert = SDL_GetYUVDisplaySIMD(1, display->format, 0);
+		if ( convert ) {
+			swdata->DisplayScaled = convert;
+		}
+		if ( SDL_GetYUVBlendSIMD() ) {
+			swdata->scale.blend = SDL_GetYUVBlendSIMD();
+		}
+	}
+#endif
+
 	/* Find the pitch and offset values for the overlay */
 	overlay->pitches = swdata->pitches;
 	overlay->pixels = swdata->planes;
@@ -1167,48 +1591,41 @@ void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay)
 int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 {
 	struct private_yuvhwdata *swdata;
-	int stretch;
+	int scale;
 	int scale_2x;
 	SDL_Surface *display;
 	Uint8 *lum, *Cr, *Cb;
 	Uint8 *dstp;
-	int mod;
+	SDL_YUVBand bands[SDL_MAX_BAND_THREADS];
+	SDL_YUVBand *band;
+	int nthreads, nbands, blocks;
+	int i, first, rows, total, chroma;
+	Uint64 start = 0;
 
 	swdata = overlay->hwdata;
-	stretch = 0;
+	display = swdata->display;
+	scale = 0;
 	scale_2x = 0;
 	if ( src->x || src->y || src->w < overlay->w || src->h < overlay->h ) {
 		/* The source rectangle has been clipped.
-		   Using a scratch surface is easier than adding clipped
-		   source support to all the blitters, plus that would
-		   slow them down in the general unclipped case.
+		   The scaler handles any source rectangle, which is easier
+		   than adding clipped source support to all the converters,
+		   plus that would slow them down in the general case.
 		*/
-		stretch = 1;
+		scale = 1;
 	} else if ( (src->w != dst->w) || (src->h != dst->h) ) {
 		if ( (dst->w == 2*src->w) &&
 		     (dst->h == 2*src->h) ) {
 			scale_2x = 1;
 		} else {
-			stretch = 1;
+			scale = 1;
 		}
 	}
-	if ( stretch ) {
-		if ( ! swdata->stretch ) {
-			display = swdata->display;
-			swdata->stretch = SDL_CreateRGBSurface(
-				SDL_SWSURFACE,
-				overlay->w, overlay->h,
-				display->format->BitsPerPixel,
-				display->format->Rmask,
-				display->format->Gmask,
-				display->format->Bmask, 0);
-			if ( ! swdata->stretch ) {
-				return(-1);
-			}
+	nthreads = SDL_BandThreads(SDL_BAND_YUV);
+	if ( scale ) {
+		if ( SDL_SetupYUVScale(swdata, overlay, src, dst, nthreads) < 0 ) {
+			return(-1);
 		}
-		display = swdata->stretch;
-	} else {
-		display = swdata->display;
 	}
 	switch (overlay->format) {
 	    case SDL_YV12_OVERLAY:
@@ -1245,31 +1662,62 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 			return(-1);
 		}
 	}
-	if ( stretch ) {
-		dstp = (Uint8 *)swdata->stretch->pixels;
-	} else {
-		dstp = (Uint8 *)display->pixels
-			+ dst->x * display->format->BytesPerPixel
-			+ dst->y * display->pitch;
+	dstp = (Uint8 *)display->pixels
+		+ dst->x * display->format->BytesPerPixel
+		+ dst->y * display->pitch;
+	if ( SDL_YUVHook ) {
+		start = SDL_GetTicksNS();
 	}
-	mod = (display->pitch / display->format->BytesPerPixel);
 
-	if ( scale_2x ) {
-		mod -= (overlay->w * 2);
-		swdata->Display2X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
-	} else {
-		mod -= overlay->w;
-		swdata->Display1X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
+	/* Split the target rows, or the overlay rows when not scaling,
+	   into bands of whole macroblocks for each thread.
+	 */
+	total = scale ? dst->h : overlay->h;
+	blocks = (total + SDL_YUV_BAND_ROWS-1) / SDL_YUV_BAND_ROWS;
+	nbands = SDL_min(nthreads, blocks);
+	first = 0;
+	for ( i=0; i<nbands; ++i ) {
+		band = &bands[i];
+		rows = (blocks/nbands + (i < blocks%nbands)) * SDL_YUV_BAND_ROWS;
+		rows = SDL_min(rows, total - first);
+		band->swdata = swdata;
+		band->overlay = overlay;
+		band->rows = rows;
+		band->cols = overlay->w;
+		band->pitch = display->pitch;
+		band->first = first;
+		if ( scale ) {
+			band->Display = NULL;
+			band->lum = lum;
+			band->cr = Cr;
+			band->cb = Cb;
+			band->out = dstp + first * display->pitch;
+			band->scaleband = &swdata->scale.bands[i];
+		} else {
+			if ( overlay->planes == 3 ) {
+				chroma = (first / 2) * overlay->pitches[1];
+			} else {
+				chroma = first * overlay->pitches[0];
+			}
+			band->Display = scale_2x ? swdata->Display2X
+			                         : swdata->Display1X;
+			band->lum = lum + first * overlay->pitches[0];
+			band->cr = Cr + chroma;
+			band->cb = Cb + chroma;
+			band->out = dstp + first * (scale_2x+1) * display->pitch;
+			band->scaleband = NULL;
+		}
+		first += rows;
+	}
+	SDL_RunBands(SDL_ConvertYUVBand, bands, sizeof(bands[0]), nbands);
+
+	if ( SDL_YUVHook ) {
+		SDL_YUVHook(SDL_YUVHookData, overlay,
+		            SDL_GetTicksNS() - start, nbands);
 	}
 	if ( SDL_MUSTLOCK(display) ) {
 		SDL_UnlockSurface(display);
 	}
-	if ( stretch ) {
-		display = swdata->display;
-		SDL_SoftStretch(swdata->stretch, src, display, dst);
-	}
 	SDL_UpdateRects(display, 1, dst);
 
 	return(0);
@@ -1281,8 +1729,8 @@ void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay)
 
 	swdata = overlay->hwdata;
 	if ( swdata ) {
-		if ( swdata->stretch ) {
-			SDL_FreeSurface(swdata->stretch);
+		if ( swdata->scale.mem ) {
+			SDL_free(swdata->scale.mem);
 		}
 		if ( swdata->pixels ) {
 			SDL_free(swdata->pixels);
@@ -35,3 +35,35 @@ extern void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay);
 extern int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst);
 
 extern void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay);
+
+/* The chroma factors used to build the RGB conversion tables */
+#define SDL_YUV_CR_R	 (0.419/0.299)
+#define SDL_YUV_CR_G	(-(0.299/0.419))
+#define SDL_YUV_CB_G	(-(0.114/0.331))
+#define SDL_YUV_CB_B	 (0.587/0.331)
+
+/* Converts a frame of YUV data to RGB pixels in the display format,
+   'pitch' bytes apart in the output.
+ */
+typedef void (*SDL_YUVDisplayFunc)(int *colortab, Uint32 *rgb_2_pix,
+                                   unsigned char *lum, unsigned char *cr,
+                                   unsigned char *cb, unsigned char *out,
+                                   int rows, int cols, int pitch);
+
+/* Blends two rows of samples using 'weight' 256ths of the second one */
+typedef void (*SDL_YUVBlendFunc)(Uint8 *out, const Uint8 *row0,
+                                 const Uint8 *row1, int n, int weight);
+
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/* Returns an SSE2 or AVX2 converter for planar (YV12/IYUV) or packed
+   (YUY2/UYVY/YVYU) data at 1X or 2X, or NULL if the CPU or the display
+   format isn't supported.
+ */
+extern SDL_YUVDisplayFunc SDL_GetYUVDisplaySIMD(int planar,
+                                  SDL_PixelFormat *format, int scale_2x);
+
+/* Returns an SSE2 or AVX2 row blender for scaling overlays, or NULL if
+   the CPU doesn't support them.
+ */
+extern SDL_YUVBlendFunc SDL_GetYUVBlendSIMD(void);
+#endif
@@ -31,13 +31,35 @@
  *  is a performance problem for a given platform, enable this driver, and
  *  then see if your application runs faster without video overhead.
  *
+ * For testing without a display, these environment variables are used:
+ *  SDL_VIDEO_DUMMY_FORMAT: the display pixel format, one of INDEX8, RGB555,
+ *   BGR555, RGB565, BGR565, RGB888, BGR888 (24-bit), XRGB8888, XBGR8888,
+ *   RGBX8888 or BGRX8888.  Modes with other formats get a shadow surface
+ *   that's converted on each update, unless SDL_ANYFORMAT is used.
+ *  SDL_VIDEO_DUMMY_STATS: a file to write a line for each update to, with
+ *   the time, the time since the last update and the time spent in the
+ *   driver in nanoseconds, and the number of rectangles and pixels, and
+ *   a summary when the video mode changes.
+ *  SDL_VIDEO_DUMMY_DUMP: a file to append the whole screen to on each
+ *   update, as raw pixels with no padding between rows.
+ *  SDL_VIDEO_DUMMY_MMAP: a file to map the screen pixels from, so it
+ *   always holds the current frame, with rows padded to the screen pitch.
+ *
  * Initial work by Ryan C. Gordon (icculus@icculus.org). A good portion
  *  of this was cut-and-pasted from Stephane Peter's work in the AAlib
  *  SDL video driver.  Renamed to "DUMMY" by Sam Lantinga.
  */
 
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "SDL_video.h"
 #include "SDL_mouse.h"
+#include "SDL_timer.h"
 #include "../SDL_sysvideo.h"
 #include "../SDL_pixels_c.h"
 #include "../../events/SDL_events_c.h"
@@ -48,6 +70,25 @@
 
 #define DUMMYVID_DRIVER_NAME "dummy"
 
+/* The display formats for SDL_VIDEO_DUMMY_FORMAT */
+static const struct {
+	const char *name;
+	int bpp;
+	Uint32 Rmask, Gmask, Bmask;
+} DUMMY_formats[] = {
+	{ "INDEX8", 8, 0, 0, 0 },
+	{ "RGB555", 15, 0x7C00, 0x03E0, 0x001F },
+	{ "BGR555", 15, 0x001F, 0x03E0, 0x7C00 },
+	{ "RGB565", 16, 0xF800, 0x07E0, 0x001F },
+	{ "BGR565", 16, 0x001F, 0x07E0, 0xF800 },
+	{ "RGB888", 24, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "BGR888", 24, 0x000000FF, 0x0000FF00, 0x00FF0000 },
+	{ "XRGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "XBGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000 },
+	{ "RGBX8888", 32, 0xFF000000, 0x00FF0000, 0x0000FF00 },
+	{ "BGRX8888", 32, 0x0000FF00, 0x00FF0000, 0xFF000000 }
+};
+
 /* Initialization/Query functions */
 static int DUMMY_VideoInit(_THIS, SDL_PixelFormat *vformat);
 static SDL_Rect **DUMMY_ListModes(_THIS, SDL_PixelFormat *format, Uint32 flags);
@@ -140,6 +181,9 @@ VideoBootStrap DUMMY_bootstrap = {
 
 int DUMMY_VideoInit(_THIS, SDL_PixelFormat *vformat)
 {
+	const char *env;
+	int i;
+
 	/*
 	fprintf(stderr, "WARNING: You are using the SDL dummy video driver!\n");
 	*/
@@ -149,6 +193,43 @@ int DUMMY_VideoInit(_THIS, SDL_PixelFormat *vformat)
 	vformat->BitsPerPixel = 8;
 	vformat->BytesPerPixel = 1;
 
+	env = SDL_getenv("SDL_VIDEO_DUMMY_FORMAT");
+	if ( env && *env ) {
+		for ( i=0; i<(int)SDL_arraysize(DUMMY_formats); ++i ) {
+			if ( SDL_strcasecmp(env, DUMMY_formats[i].name) == 0 ) {
+				break;
+			}
+		}
+		if ( i == (int)SDL_arraysize(DUMMY_formats) ) {
+			SDL_SetError("Unknown SDL_VIDEO_DUMMY_FORMAT %s", env);
+			return(-1);
+		}
+		this->hidden->bpp = DUMMY_formats[i].bpp;
+		this->hidden->Rmask = DUMMY_formats[i].Rmask;
+		this->hidden->Gmask = DUMMY_formats[i].Gmask;
+		this->hidden->Bmask = DUMMY_formats[i].Bmask;
+		vformat->BitsPerPixel = this->hidden->bpp;
+		vformat->BytesPerPixel = (this->hidden->bpp+7) / 8;
+		vformat->Rmask = this->hidden->Rmask;
+		vformat->Gmask = this->hidden->Gmask;
+		vformat->Bmask = this->hidden->Bmask;
+	}
+
+	env = SDL_getenv("SDL_VIDEO_DUMMY_STATS");
+	if ( env && *env ) {
+		this->hidden->stats = SDL_RWFromFile(env, "w");
+		if ( !this->hidden->stats ) {
+			return(-1);
+		}
+	}
+	env = SDL_getenv("SDL_VIDEO_DUMMY_DUMP");
+	if ( env && *env ) {
+		this->hidden->dump = SDL_RWFromFile(env, "wb");
+		if ( !this->hidden->dump ) {
+			return(-1);
+		}
+	}
+
 	/* We're done! */
 	return(0);
 }
@@ -158,27 +239,114 @@ SDL_Rect **DUMMY_ListModes(_THIS, SDL_PixelFormat *format, Uint32 flags)
    	 return (SDL_Rect **) -1;
 }
 
-SDL_Surface *DUMMY_SetVideoMode(_THIS, SDL_Surface *current,
-				int width, int height, int bpp, Uint32 flags)
+/* Write a line of text to the statistics file */
+static void DUMMY_PrintStats(_THIS, const char *fmt, ...)
+{
+	char line[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	SDL_vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	SDL_RWwrite(this->hidden->stats, line, 1, SDL_strlen(line));
+}
+
+/* Summarize the frames drawn in the current video mode */
+static void DUMMY_FinishStats(_THIS)
+{
+	struct SDL_PrivateVideoData *data = this->hidden;
+	Uint64 elapsed;
+
+	if ( !data->stats || !data->frames ) {
+		return;
+	}
+	elapsed = data->last_time - data->first_time;
+	DUMMY_PrintStats(this,
+		"# %u frames, %.1f rects and %.0f pixels per frame\n",
+		data->frames, (double)(Sint64)data->rects / data->frames,
+		(double)(Sint64)data->pixels / data->frames);
+	if ( data->frames > 1 ) {
+		DUMMY_PrintStats(this,
+			"# %.2f fps, frame time %.3f ms (min %.3f, max %.3f)\n",
+			(double)(data->frames-1) * 1e9 / (Sint64)elapsed,
+			(double)(Sint64)elapsed / 1e6 / (data->frames-1),
+			(double)(Sint64)data->min_interval / 1e6,
+			(double)(Sint64)data->max_interval / 1e6);
+	}
+	DUMMY_PrintStats(this, "# %.3f ms per frame in the driver\n",
+		(double)(Sint64)data->update_time / 1e6 / data->frames);
+	data->frames = 0;
+	data->rects = 0;
+	data->pixels = 0;
+	data->update_time = 0;
+}
+
+static void DUMMY_FreeBuffer(_THIS)
 {
 	if ( this->hidden->buffer ) {
-		SDL_free( this->hidden->buffer );
+#ifdef HAVE_MMAP
+		if ( this->hidden->mapped ) {
+			munmap(this->hidden->buffer, this->hidden->mapped);
+		} else
+#endif
+		SDL_free(this->hidden->buffer);
+		this->hidden->buffer = NULL;
+		this->hidden->mapped = 0;
 	}
+}
 
-	this->hidden->buffer = SDL_malloc(width * height * (bpp / 8));
-	if ( ! this->hidden->buffer ) {
-		SDL_SetError("Couldn't allocate buffer for requested mode");
+/* Map the screen pixels from the file named by SDL_VIDEO_DUMMY_MMAP */
+static void *DUMMY_MapBuffer(_THIS, size_t size)
+{
+#ifdef HAVE_MMAP
+	const char *file = SDL_getenv("SDL_VIDEO_DUMMY_MMAP");
+	void *buffer;
+	int fd;
+
+	if ( !file || !*file || !size ) {
 		return(NULL);
 	}
+	fd = open(file, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if ( fd < 0 ) {
+		return(NULL);
+	}
+	buffer = NULL;
+	if ( ftruncate(fd, (off_t)size) == 0 ) {
+		buffer = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		if ( buffer == MAP_FAILED ) {
+			buffer = NULL;
+		}
+	}
+	/* The mapping stays valid after the file is closed */
+	close(fd);
+	if ( buffer ) {
+		this->hidden->mapped = size;
+	}
+	return(buffer);
+#else
+	return(NULL);
+#endif /* HAVE_MMAP */
+}
 
-/* 	printf("Setting mode %dx%d\n", width, height); */
+SDL_Surface *DUMMY_SetVideoMode(_THIS, SDL_Surface *current,
+				int width, int height, int bpp, Uint32 flags)
+{
+	size_t size;
+
+	DUMMY_FinishStats(this);
+	DUMMY_FreeBuffer(this);
+	current->pixels = NULL;
+
+	/* Use the display format, SDL converts to it if needed */
+	if ( this->hidden->bpp ) {
+		bpp = this->hidden->bpp;
+	}
 
-	SDL_memset(this->hidden->buffer, 0, width * height * (bpp / 8));
+/* 	printf("Setting mode %dx%d\n", width, height); */
 
 	/* Allocate the new pixel format for the screen */
-	if ( ! SDL_ReallocFormat(current, bpp, 0, 0, 0, 0) ) {
-		SDL_free(this->hidden->buffer);
-		this->hidden->buffer = NULL;
+	if ( ! SDL_ReallocFormat(current, bpp, this->hidden->Rmask,
+	                         this->hidden->Gmask, this->hidden->Bmask, 0) ) {
 		SDL_SetError("Couldn't allocate new pixel format for requested mode");
 		return(NULL);
 	}
@@ -187,9 +355,29 @@ SDL_Surface *DUMMY_SetVideoMode(_THIS, SDL_Surface *current,
 	current->flags = flags & SDL_FULLSCREEN;
 	this->hidden->w = current->w = width;
 	this->hidden->h = current->h = height;
-	current->pitch = current->w * (bpp / 8);
+	current->pitch = SDL_CalculatePitch(current);
+
+	size = (size_t)current->h * current->pitch;
+	this->hidden->buffer = DUMMY_MapBuffer(this, size);
+	if ( ! this->hidden->buffer ) {
+		this->hidden->buffer = SDL_malloc(size ? size : 1);
+		if ( ! this->hidden->buffer ) {
+			SDL_SetError("Couldn't allocate buffer for requested mode");
+			return(NULL);
+		}
+	}
+	SDL_memset(this->hidden->buffer, 0, size);
 	current->pixels = this->hidden->buffer;
 
+	if ( this->hidden->stats ) {
+		DUMMY_PrintStats(this, "# %dx%d, %d bpp, R %08x G %08x B %08x\n",
+			width, height, current->format->BitsPerPixel,
+			current->format->Rmask, current->format->Gmask,
+			current->format->Bmask);
+		DUMMY_PrintStats(this,
+			"frame,time_ns,interval_ns,update_ns,rects,pixels\n");
+	}
+
 	/* We're done */
 	return(current);
 }
@@ -217,7 +405,63 @@ static void DUMMY_UnlockHWSurface(_THIS, SDL_Surface *surface)
 
 static void DUMMY_UpdateRects(_THIS, int numrects, SDL_Rect *rects)
 {
-	/* do nothing. */
+	struct SDL_PrivateVideoData *data = this->hidden;
+	SDL_Surface *screen = this->screen;
+	Uint64 now, interval, elapsed;
+	Uint32 pixels;
+	int i, row, len;
+	Uint8 *src;
+
+	if ( !data->buffer || (!data->stats && !data->dump) ) {
+		return;
+	}
+	now = SDL_GetTicksNS();
+
+	if ( data->dump ) {
+		len = screen->w * screen->format->BytesPerPixel;
+		src = (Uint8 *)screen->pixels;
+		if ( len == screen->pitch ) {
+			SDL_RWwrite(data->dump, src, len, screen->h);
+		} else {
+			for ( row=0; row<screen->h; ++row ) {
+				SDL_RWwrite(data->dump, src, len, 1);
+				src += screen->pitch;
+			}
+		}
+	}
+
+	elapsed = SDL_GetTicksNS() - now;
+
+	if ( data->stats ) {
+		pixels = 0;
+		for ( i=0; i<numrects; ++i ) {
+			pixels += (Uint32)rects[i].w * rects[i].h;
+		}
+		if ( data->frames == 0 ) {
+			data->first_time = now;
+			data->last_time = now;
+			data->min_interval = (Uint64)-1;
+			data->max_interval = 0;
+		}
+		interval = now - data->last_time;
+		if ( data->frames > 0 ) {
+			if ( interval < data->min_interval ) {
+				data->min_interval = interval;
+			}
+			if ( interval > data->max_interval ) {
+				data->max_interval = interval;
+			}
+		}
+		data->last_time = now;
+		++data->frames;
+		data->rects += numrects;
+		data->pixels += pixels;
+		data->update_time += elapsed;
+		DUMMY_PrintStats(this, "%u,%llu,%llu,%llu,%d,%u\n",
+			data->frames, (unsigned long long)now,
+			(unsigned long long)interval,
+			(unsigned long long)elapsed, numrects, pixels);
+	}
 }
 
 int DUMMY_SetColors(_THIS, int firstcolor, int ncolors, SDL_Color *colors)
@@ -231,9 +475,17 @@ int DUMMY_SetColors(_THIS, int firstcolor, int ncolors, SDL_Color *colors)
 */
 void DUMMY_VideoQuit(_THIS)
 {
-	if (this->screen->pixels != NULL)
-	{
-		SDL_free(this->screen->pixels);
+	DUMMY_FinishStats(this);
+	if ( this->hidden->stats ) {
+		SDL_RWclose(this->hidden->stats);
+		this->hidden->stats = NULL;
+	}
+	if ( this->hidden->dump ) {
+		SDL_RWclose(this->hidden->dump);
+		this->hidden->dump = NULL;
+	}
+	DUMMY_FreeBuffer(this);
+	if ( this->screen ) {
 		this->screen->pixels = NULL;
 	}
 }
@@ -35,6 +35,25 @@
 struct SDL_PrivateVideoData {
     int w, h;
     void *buffer;
+    size_t mapped;		/* Size of the buffer if it's a mapped file */
+
+    /* The display format from SDL_VIDEO_DUMMY_FORMAT, if any */
+    int bpp;
+    Uint32 Rmask, Gmask, Bmask;
+
+    /* Frame statistics, written to SDL_VIDEO_DUMMY_STATS */
+    SDL_RWops *stats;
+    Uint32 frames;
+    Uint64 rects;
+    Uint64 pixels;
+    Uint64 first_time;
+    Uint64 last_time;
+    Uint64 min_interval;
+    Uint64 max_interval;
+    Uint64 update_time;
+
+    /* Updated frames are appended to SDL_VIDEO_DUMMY_DUMP */
+    SDL_RWops *dump;
 };
 
 #endif /* _SDL_nullvideo_h */
@@ -42,39 +42,120 @@ static int shm_errhandler(Display *d, XErrorEvent *e)
 		return(X_handler(d,e));
 }
 
-static void try_mitshm(_THIS, SDL_Surface *screen)
+/* Create a shared memory segment and attach it to the X server */
+static int attach_mitshm(_THIS, XShmSegmentInfo *info, int size)
 {
-	/* Dynamic X11 may not have SHM entry points on this box. */
-	if ((use_mitshm) && (!SDL_X11_HAVE_SHM))
-		use_mitshm = 0;
-
-	if(!use_mitshm)
-		return;
-	shminfo.shmid = shmget(IPC_PRIVATE, screen->h*screen->pitch,
-			       IPC_CREAT | 0777);
-	if ( shminfo.shmid >= 0 ) {
-		shminfo.shmaddr = (char *)shmat(shminfo.shmid, 0, 0);
-		shminfo.readOnly = False;
-		if ( shminfo.shmaddr != (char *)-1 ) {
+	info->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0777);
+	if ( info->shmid >= 0 ) {
+		info->shmaddr = (char *)shmat(info->shmid, 0, 0);
+		info->readOnly = False;
+		if ( info->shmaddr != (char *)-1 ) {
 			shm_error = False;
 			X_handler = XSetErrorHandler(shm_errhandler);
-			XShmAttach(SDL_Display, &shminfo);
+			XShmAttach(SDL_Display, info);
 			XSync(SDL_Display, True);
 			XSetErrorHandler(X_handler);
 			if ( shm_error )
-				shmdt(shminfo.shmaddr);
+				shmdt(info->shmaddr);
 		} else {
 			shm_error = True;
 		}
-		shmctl(shminfo.shmid, IPC_RMID, NULL);
+		shmctl(info->shmid, IPC_RMID, NULL);
 	} else {
 		shm_error = True;
 	}
-	if ( shm_error )
+	return(!shm_error);
+}
+
+static void try_mitshm(_THIS, SDL_Surface *screen)
+{
+	/* Dynamic X11 may not have SHM entry points on this box. */
+	if ((use_mitshm) && (!SDL_X11_HAVE_SHM))
+		use_mitshm = 0;
+
+	if(!use_mitshm)
+		return;
+	if ( !attach_mitshm(this, &shminfo, screen->h*screen->pitch) )
 		use_mitshm = 0;
 	if ( use_mitshm )
 		screen->pixels = shminfo.shmaddr;
 }
+
+/* Set up the shared images the screen flips between, the first of which
+   is the one already created by X11_SetupImage().  The number of images
+   is 2, or SDL_VIDEO_X11_BUFFERS from the environment, up to 3.
+ */
+static int setup_flip(_THIS, SDL_Surface *screen)
+{
+	const char *env;
+	int i, n;
+
+	env = SDL_getenv("SDL_VIDEO_X11_BUFFERS");
+	n = env ? SDL_atoi(env) : 2;
+	if ( n > (int)SDL_arraysize(shm_buffers) ) {
+		n = (int)SDL_arraysize(shm_buffers);
+	}
+	if ( n < 2 ) {
+		return(0);
+	}
+
+	shm_buffers[0].info = shminfo;
+	shm_buffers[0].image = SDL_Ximage;
+	shm_buffers[0].busy = 0;
+	for ( i=1; i<n; ++i ) {
+		if ( !attach_mitshm(this, &shm_buffers[i].info,
+		                    screen->h*SDL_Ximage->bytes_per_line) ) {
+			break;
+		}
+		shm_buffers[i].image = XShmCreateImage(SDL_Display, SDL_Visual,
+					this->hidden->depth, ZPixmap,
+					shm_buffers[i].info.shmaddr,
+					&shm_buffers[i].info,
+					screen->w, screen->h);
+		if ( !shm_buffers[i].image ) {
+			XShmDetach(SDL_Display, &shm_buffers[i].info);
+			XSync(SDL_Display, False);
+			shmdt(shm_buffers[i].info.shmaddr);
+			break;
+		}
+		shm_buffers[i].busy = 0;
+	}
+	if ( i < 2 ) {
+		return(0);
+	}
+	shm_nbuffers = i;
+	shm_back = 0;
+	shm_front = 0;
+	shm_completion = XShmGetEventBase(GFX_Display) + ShmCompletion;
+	return(1);
+}
+
+/* Wait until the X server has finished reading a shared image */
+static void wait_flip(_THIS, int buffer)
+{
+	XEvent event;
+	int i;
+
+	while ( shm_buffers[buffer].busy ) {
+		if ( !XCheckTypedEvent(GFX_Display, shm_completion, &event) ) {
+			/* After a round trip, all the events are in; if it
+			   still isn't done, its put failed and it never will be.
+			 */
+			XSync(GFX_Display, False);
+			if ( !XCheckTypedEvent(GFX_Display,
+			                       shm_completion, &event) ) {
+				shm_buffers[buffer].busy = 0;
+				break;
+			}
+		}
+		for ( i=0; i<shm_nbuffers; ++i ) {
+			if ( shm_buffers[i].info.shmseg ==
+			     ((XShmCompletionEvent *)&event)->shmseg ) {
+				shm_buffers[i].busy = 0;
+			}
+		}
+	}
+}
 #endif /* ! NO_SHARED_MEMORY */
 
 /* Various screen update functions available */
@@ -129,6 +210,23 @@ error:
 
 void X11_DestroyImage(_THIS, SDL_Surface *screen)
 {
+#ifndef NO_SHARED_MEMORY
+	int i;
+
+	if ( shm_nbuffers ) {
+		/* Any puts still in progress come before the detach */
+		for ( i=0; i<shm_nbuffers; ++i ) {
+			XDestroyImage(shm_buffers[i].image);
+			XShmDetach(GFX_Display, &shm_buffers[i].info);
+		}
+		XSync(GFX_Display, False);
+		for ( i=0; i<shm_nbuffers; ++i ) {
+			shmdt(shm_buffers[i].info.shmaddr);
+		}
+		shm_nbuffers = 0;
+		SDL_Ximage = NULL;
+	}
+#endif /* ! NO_SHARED_MEMORY */
 	if ( SDL_Ximage ) {
 		XDestroyImage(SDL_Ximage);
 #ifndef NO_SHARED_MEMORY
@@ -142,6 +240,7 @@ void X11_DestroyImage(_THIS, SDL_Surface *screen)
 	}
 	if ( screen ) {
 		screen->pixels = NULL;
+		screen->flags &= ~SDL_DOUBLEBUF;
 	}
 }
 
@@ -187,6 +286,15 @@ int X11_ResizeImage(_THIS, SDL_Surface *screen, Uint32 flags)
         	retval = 0;
         } else {
 		retval = X11_SetupImage(this, screen);
+#ifndef NO_SHARED_MEMORY
+		/* Flip between shared images without waiting for the
+		   X server to finish with the last one.
+		 */
+		if ( (retval == 0) && (flags & SDL_DOUBLEBUF) &&
+		     use_mitshm && setup_flip(this, screen) ) {
+			screen->flags |= SDL_DOUBLEBUF;
+		}
+#endif
 		/* We support asynchronous blitting on the display */
 		if ( flags & SDL_ASYNCBLIT ) {
 			/* This is actually slower on single-CPU systems,
@@ -227,6 +335,22 @@ void X11_UnlockHWSurface(_THIS, SDL_Surface *surface)
 
 int X11_FlipHWSurface(_THIS, SDL_Surface *surface)
 {
+#ifndef NO_SHARED_MEMORY
+	if ( shm_nbuffers ) {
+		/* Show the back image, the server says when it's done */
+		XShmPutImage(GFX_Display, SDL_Window, SDL_GC, SDL_Ximage,
+				0, 0, 0, 0, surface->w, surface->h, True);
+		XFlush(GFX_Display);
+		shm_buffers[shm_back].busy = 1;
+		shm_front = shm_back;
+
+		/* Draw into the next one once the server has read it */
+		shm_back = (shm_back + 1) % shm_nbuffers;
+		wait_flip(this, shm_back);
+		SDL_Ximage = shm_buffers[shm_back].image;
+		surface->pixels = SDL_Ximage->data;
+	}
+#endif /* ! NO_SHARED_MEMORY */
 	return(0);
 }
 
@@ -301,6 +425,13 @@ void X11_RefreshDisplay(_THIS)
 		return;
 	}
 #ifndef NO_SHARED_MEMORY
+	if ( shm_nbuffers ) {
+		/* The back image may be half drawn, show the last flip */
+		XShmPutImage(SDL_Display, SDL_Window, SDL_GC,
+				shm_buffers[shm_front].image,
+				0, 0, 0, 0, this->screen->w, this->screen->h,
+				False);
+	} else
 	if ( this->UpdateRects == X11_MITSHMUpdate ) {
 		XShmPutImage(SDL_Display, SDL_Window, SDL_GC, SDL_Ximage,
 				0, 0, 0, 0, this->screen->w, this->screen->h,
@@ -1216,7 +1216,8 @@ SDL_Surface *X11_SetVideoMode(_THIS, SDL_Surface *current,
 
 	/* Set up the new mode framebuffer */
 	if ( ((current->w != width) || (current->h != height)) ||
-             ((saved_flags&SDL_OPENGL) != (flags&SDL_OPENGL)) ) {
+             ((saved_flags&SDL_OPENGL) != (flags&SDL_OPENGL)) ||
+             ((saved_flags&SDL_DOUBLEBUF) != (flags&SDL_DOUBLEBUF)) ) {
 		current->w = width;
 		current->h = height;
 		current->pitch = SDL_CalculatePitch(current);
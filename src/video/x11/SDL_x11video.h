@@ -75,6 +75,17 @@ struct SDL_PrivateVideoData {
     /* MIT shared memory extension information */
     int use_mitshm;
     XShmSegmentInfo shminfo;
+
+    /* Shared images the screen flips between with SDL_DOUBLEBUF */
+    int shm_nbuffers;		/* 0 if the screen isn't flipped */
+    int shm_back;		/* The image being drawn */
+    int shm_front;		/* The image last shown */
+    int shm_completion;		/* The XShmCompletionEvent type */
+    struct {
+        XShmSegmentInfo info;
+        XImage *image;
+        int busy;		/* Flag: the server may still read it */
+    } shm_buffers[3];
 #endif
 
     /* The variables used for displaying graphics */
@@ -174,6 +185,11 @@ struct SDL_PrivateVideoData {
 #define using_dga		(this->hidden->using_dga)
 #define use_mitshm		(this->hidden->use_mitshm)
 #define shminfo			(this->hidden->shminfo)
+#define shm_nbuffers		(this->hidden->shm_nbuffers)
+#define shm_back		(this->hidden->shm_back)
+#define shm_front		(this->hidden->shm_front)
+#define shm_completion		(this->hidden->shm_completion)
+#define shm_buffers		(this->hidden->shm_buffers)
 #define SDL_Ximage		(this->hidden->Ximage)
 #define SDL_GC			(this->hidden->gc)
 #define window_w		(this->hidden->window_w)
@@ -0,0 +1,475 @@
+/*
+ * Benchmarks the MS-ADPCM and IMA-ADPCM decoders of SDL_LoadWAV_RW()
+ * against a copy of the original sample at a time decoders, and checks
+ * that they produce the same audio.
+ *
+ * Usage: testadpcm [--blocks n] [--loops n] [--threads n]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define BLOCKALIGN	1024
+
+static int numblocks = 2048;
+static int loops = 10;
+static int maxthreads = 4;
+
+static const Sint16 MS_coeff[7][2] = {
+	{ 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 },
+	{ 240, 0 }, { 460, -208 }, { 392, -232 }
+};
+
+static void PutLE16(Uint8 **p, Uint16 value)
+{
+	(*p)[0] = value & 0xFF;
+	(*p)[1] = value >> 8;
+	*p += 2;
+}
+
+static void PutLE32(Uint8 **p, Uint32 value)
+{
+	PutLE16(p, value & 0xFFFF);
+	PutLE16(p, value >> 16);
+}
+
+/* Build a WAVE file of random ADPCM blocks with valid block headers */
+static Uint8 *MakeWAV(int encoding, int channels, int *wavlen,
+					int *samplesperblock)
+{
+	Uint8 *wav, *p;
+	int fmtlen, datalen, spb;
+	int i, c;
+
+	if ( encoding == 2 ) {
+		spb = (BLOCKALIGN-7*channels)*2/channels+2;
+		fmtlen = 16+2+2+2+7*4;
+	} else {
+		spb = (BLOCKALIGN-4*channels)*8/(4*channels)+1;
+		fmtlen = 16+2+2;
+	}
+	datalen = numblocks*BLOCKALIGN;
+	*wavlen = 12+8+fmtlen+8+datalen;
+	*samplesperblock = spb;
+	wav = (Uint8 *)malloc(*wavlen);
+	if ( wav == NULL ) {
+		return(NULL);
+	}
+
+	p = wav;
+	memcpy(p, "RIFF", 4); p += 4;
+	PutLE32(&p, *wavlen-8);
+	memcpy(p, "WAVEfmt ", 8); p += 8;
+	PutLE32(&p, fmtlen);
+	PutLE16(&p, encoding);
+	PutLE16(&p, channels);
+	PutLE32(&p, 22050);
+	PutLE32(&p, 22050*BLOCKALIGN/spb);
+	PutLE16(&p, BLOCKALIGN);
+	PutLE16(&p, 4);
+	if ( encoding == 2 ) {
+		PutLE16(&p, 32);
+		PutLE16(&p, spb);
+		PutLE16(&p, 7);
+		for ( i = 0; i < 7; ++i ) {
+			PutLE16(&p, MS_coeff[i][0]);
+			PutLE16(&p, MS_coeff[i][1]);
+		}
+	} else {
+		PutLE16(&p, 2);
+		PutLE16(&p, spb);
+	}
+	memcpy(p, "data", 4); p += 4;
+	PutLE32(&p, datalen);
+
+	for ( i = 0; i < numblocks; ++i ) {
+		Uint8 *block = p;
+
+		if ( encoding == 2 ) {
+			for ( c = 0; c < channels; ++c ) {
+				*p++ = rand() % 7;
+			}
+			for ( c = 0; c < channels; ++c ) {
+				PutLE16(&p, 16 + rand() % 2000);
+			}
+			for ( c = 0; c < 2*channels; ++c ) {
+				PutLE16(&p, rand());
+			}
+		} else {
+			for ( c = 0; c < channels; ++c ) {
+				PutLE16(&p, rand());
+				*p++ = rand() % 89;
+				*p++ = 0;
+			}
+		}
+		while ( p < block+BLOCKALIGN ) {
+			*p++ = rand();
+		}
+	}
+	return(wav);
+}
+
+/* The original MS-ADPCM decoder */
+struct MS_ADPCM_decodestate {
+	Uint8 hPredictor;
+	Uint16 iDelta;
+	Sint16 iSamp1;
+	Sint16 iSamp2;
+};
+
+static Sint32 MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
+					Uint8 nybble, const Sint16 *coeff)
+{
+	const Sint32 max_audioval = ((1<<(16-1))-1);
+	const Sint32 min_audioval = -(1<<(16-1));
+	const Sint32 adaptive[] = {
+		230, 230, 230, 230, 307, 409, 512, 614,
+		768, 614, 512, 409, 307, 230, 230, 230
+	};
+	Sint32 new_sample, delta;
+
+	new_sample = ((state->iSamp1 * coeff[0]) +
+		      (state->iSamp2 * coeff[1]))/256;
+	if ( nybble & 0x08 ) {
+		new_sample += state->iDelta * (nybble-0x10);
+	} else {
+		new_sample += state->iDelta * nybble;
+	}
+	if ( new_sample < min_audioval ) {
+		new_sample = min_audioval;
+	} else
+	if ( new_sample > max_audioval ) {
+		new_sample = max_audioval;
+	}
+	delta = ((Sint32)state->iDelta * adaptive[nybble])/256;
+	if ( delta < 16 ) {
+		delta = 16;
+	}
+	state->iDelta = (Uint16)delta;
+	state->iSamp2 = state->iSamp1;
+	state->iSamp1 = (Sint16)new_sample;
+	return(new_sample);
+}
+
+static void MS_ADPCM_decode(const Uint8 *encoded, int encoded_len,
+			Uint8 *decoded, int channels, int samplesperblock)
+{
+	struct MS_ADPCM_decodestate states[2], *state[2];
+	Sint32 samplesleft;
+	Sint8 nybble, stereo;
+	const Sint16 *coeff[2];
+	Sint32 new_sample;
+
+	stereo = (channels == 2);
+	state[0] = &states[0];
+	state[1] = &states[stereo];
+	while ( encoded_len >= BLOCKALIGN ) {
+		const Uint8 *block = encoded;
+
+		state[0]->hPredictor = *encoded++;
+		if ( stereo ) {
+			state[1]->hPredictor = *encoded++;
+		}
+		state[0]->iDelta = ((encoded[1]<<8)|encoded[0]);
+		encoded += sizeof(Sint16);
+		if ( stereo ) {
+			state[1]->iDelta = ((encoded[1]<<8)|encoded[0]);
+			encoded += sizeof(Sint16);
+		}
+		state[0]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
+		encoded += sizeof(Sint16);
+		if ( stereo ) {
+			state[1]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
+			encoded += sizeof(Sint16);
+		}
+		state[0]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
+		encoded += sizeof(Sint16);
+		if ( stereo ) {
+			state[1]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
+			encoded += sizeof(Sint16);
+		}
+		coeff[0] = MS_coeff[state[0]->hPredictor];
+		coeff[1] = MS_coeff[state[1]->hPredictor];
+
+		decoded[0] = state[0]->iSamp2&0xFF;
+		decoded[1] = state[0]->iSamp2>>8;
+		decoded += 2;
+		if ( stereo ) {
+			decoded[0] = state[1]->iSamp2&0xFF;
+			decoded[1] = state[1]->iSamp2>>8;
+			decoded += 2;
+		}
+		decoded[0] = state[0]->iSamp1&0xFF;
+		decoded[1] = state[0]->iSamp1>>8;
+		decoded += 2;
+		if ( stereo ) {
+			decoded[0] = state[1]->iSamp1&0xFF;
+			decoded[1] = state[1]->iSamp1>>8;
+			decoded += 2;
+		}
+
+		samplesleft = (samplesperblock-2)*channels;
+		while ( samplesleft > 0 ) {
+			nybble = (*encoded)>>4;
+			new_sample = MS_ADPCM_nibble(state[0],nybble,coeff[0]);
+			decoded[0] = new_sample&0xFF;
+			new_sample >>= 8;
+			decoded[1] = new_sample&0xFF;
+			decoded += 2;
+
+			nybble = (*encoded)&0x0F;
+			new_sample = MS_ADPCM_nibble(state[1],nybble,coeff[1]);
+			decoded[0] = new_sample&0xFF;
+			new_sample >>= 8;
+			decoded[1] = new_sample&0xFF;
+			decoded += 2;
+
+			++encoded;
+			samplesleft -= 2;
+		}
+		encoded = block + BLOCKALIGN;
+		encoded_len -= BLOCKALIGN;
+	}
+}
+
+/* The original IMA-ADPCM decoder */
+struct IMA_ADPCM_decodestate {
+	Sint32 sample;
+	Sint8 index;
+};
+
+static Sint32 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,Uint8 nybble)
+{
+	const Sint32 max_audioval = ((1<<(16-1))-1);
+	const Sint32 min_audioval = -(1<<(16-1));
+	const int index_table[16] = {
+		-1, -1, -1, -1,
+		 2,  4,  6,  8,
+		-1, -1, -1, -1,
+		 2,  4,  6,  8
+	};
+	const Sint32 step_table[89] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+		34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
+		143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
+		449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
+		1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+		3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+		9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+		22385, 24623, 27086, 29794, 32767
+	};
+	Sint32 delta, step;
+
+	step = step_table[state->index];
+	delta = step >> 3;
+	if ( nybble & 0x04 ) delta += step;
+	if ( nybble & 0x02 ) delta += (step >> 1);
+	if ( nybble & 0x01 ) delta += (step >> 2);
+	if ( nybble & 0x08 ) delta = -delta;
+	state->sample += delta;
+
+	state->index += index_table[nybble];
+	if ( state->index > 88 ) {
+		state->index = 88;
+	} else
+	if ( state->index < 0 ) {
+		state->index = 0;
+	}
+
+	if ( state->sample > max_audioval ) {
+		state->sample = max_audioval;
+	} else
+	if ( state->sample < min_audioval ) {
+		state->sample = min_audioval;
+	}
+	return(state->sample);
+}
+
+static void Fill_IMA_ADPCM_block(Uint8 *decoded, const Uint8 *encoded,
+	int channel, int numchannels, struct IMA_ADPCM_decodestate *state)
+{
+	int i;
+	Sint8 nybble;
+	Sint32 new_sample;
+
+	decoded += (channel * 2);
+	for ( i=0; i<4; ++i ) {
+		nybble = (*encoded)&0x0F;
+		new_sample = IMA_ADPCM_nibble(state, nybble);
+		decoded[0] = new_sample&0xFF;
+		new_sample >>= 8;
+		decoded[1] = new_sample&0xFF;
+		decoded += 2 * numchannels;
+
+		nybble = (*encoded)>>4;
+		new_sample = IMA_ADPCM_nibble(state, nybble);
+		decoded[0] = new_sample&0xFF;
+		new_sample >>= 8;
+		decoded[1] = new_sample&0xFF;
+		decoded += 2 * numchannels;
+
+		++encoded;
+	}
+}
+
+static void IMA_ADPCM_decode(const Uint8 *encoded, int encoded_len,
+			Uint8 *decoded, int channels, int samplesperblock)
+{
+	struct IMA_ADPCM_decodestate state[2];
+	Sint32 samplesleft;
+	int c;
+
+	while ( encoded_len >= BLOCKALIGN ) {
+		const Uint8 *block = encoded;
+
+		for ( c=0; c<channels; ++c ) {
+			state[c].sample = ((encoded[1]<<8)|encoded[0]);
+			encoded += 2;
+			if ( state[c].sample & 0x8000 ) {
+				state[c].sample -= 0x10000;
+			}
+			state[c].index = *encoded++;
+			++encoded;
+
+			decoded[0] = (Uint8)(state[c].sample&0xFF);
+			decoded[1] = (Uint8)(state[c].sample>>8);
+			decoded += 2;
+		}
+
+		samplesleft = (samplesperblock-1)*channels;
+		while ( samplesleft > 0 ) {
+			for ( c=0; c<channels; ++c ) {
+				Fill_IMA_ADPCM_block(decoded, encoded,
+						c, channels, &state[c]);
+				encoded += 4;
+				samplesleft -= 8;
+			}
+			decoded += (channels * 8 * 2);
+		}
+		encoded = block + BLOCKALIGN;
+		encoded_len -= BLOCKALIGN;
+	}
+}
+
+static double MSamplesPerSecond(Uint64 ns, int samples)
+{
+	return ((double)samples * loops * 1000.0) / (double)ns;
+}
+
+static int RunTest(int encoding, int channels)
+{
+	Uint8 *wav, *reference, *audio_buf;
+	Uint32 audio_len;
+	SDL_AudioSpec spec;
+	int wavlen, spb, samples, i, n;
+	char env[64];
+	Uint64 start, elapsed;
+	int failed = 0;
+
+	wav = MakeWAV(encoding, channels, &wavlen, &spb);
+	if ( wav == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		return(1);
+	}
+	samples = numblocks*spb*channels;
+	reference = (Uint8 *)malloc(samples*2);
+	if ( reference == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		free(wav);
+		return(1);
+	}
+
+	printf("%s %s, %d blocks of %d samples:\n",
+	       encoding == 2 ? "MS-ADPCM" : "IMA-ADPCM",
+	       channels == 2 ? "stereo" : "mono", numblocks, spb);
+
+	start = SDL_GetTicksNS();
+	for ( i = 0; i < loops; ++i ) {
+		if ( encoding == 2 ) {
+			MS_ADPCM_decode(wav+wavlen-numblocks*BLOCKALIGN,
+			                numblocks*BLOCKALIGN, reference,
+			                channels, spb);
+		} else {
+			IMA_ADPCM_decode(wav+wavlen-numblocks*BLOCKALIGN,
+			                 numblocks*BLOCKALIGN, reference,
+			                 channels, spb);
+		}
+	}
+	elapsed = SDL_GetTicksNS() - start;
+	printf("  original decoder:     %8.2f Msamples/s\n",
+	       MSamplesPerSecond(elapsed, samples));
+
+	for ( n = 1; n <= maxthreads; n *= 2 ) {
+		sprintf(env, "SDL_WAVE_THREADS=%d", n);
+		SDL_putenv(env);
+		start = SDL_GetTicksNS();
+		for ( i = 0; i < loops; ++i ) {
+			if ( !SDL_LoadWAV_RW(SDL_RWFromConstMem(wav, wavlen), 1,
+			                     &spec, &audio_buf, &audio_len) ) {
+				fprintf(stderr, "SDL_LoadWAV_RW failed: %s\n",
+				        SDL_GetError());
+				free(reference);
+				free(wav);
+				return(1);
+			}
+			if ( i == 0 && (audio_len != (Uint32)samples*2 ||
+			     memcmp(audio_buf, reference, audio_len) != 0) ) {
+				failed = 1;
+			}
+			SDL_FreeWAV(audio_buf);
+		}
+		elapsed = SDL_GetTicksNS() - start;
+		printf("  SDL, %2d thread%s:      %8.2f Msamples/s%s\n",
+		       n, n == 1 ? " " : "s",
+		       MSamplesPerSecond(elapsed, samples),
+		       failed ? "  MISMATCH" : "");
+	}
+
+	free(reference);
+	free(wav);
+	return(failed);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, failed;
+
+	for ( i = 1; i < argc; ++i ) {
+		if ( strcmp(argv[i], "--blocks") == 0 && argv[i+1] ) {
+			numblocks = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "--loops") == 0 && argv[i+1] ) {
+			loops = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "--threads") == 0 && argv[i+1] ) {
+			maxthreads = atoi(argv[++i]);
+		} else {
+			fprintf(stderr,
+			"Usage: %s [--blocks n] [--loops n] [--threads n]\n",
+			        argv[0]);
+			return(1);
+		}
+	}
+	if ( numblocks < 1 || loops < 1 ) {
+		fprintf(stderr, "Nothing to do\n");
+		return(1);
+	}
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	srand(42);
+	failed = 0;
+	failed |= RunTest(2, 1);
+	failed |= RunTest(2, 2);
+	failed |= RunTest(0x11, 1);
+	failed |= RunTest(0x11, 2);
+	SDL_Quit();
+
+	if ( failed ) {
+		printf("The decoders don't agree!\n");
+	}
+	return(failed);
+}
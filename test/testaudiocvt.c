@@ -0,0 +1,156 @@
+/* Test that float audio keeps its precision through SDL_ConvertAudio()
+   and SDL_AudioStream rate and channel changes.
+
+   The test signal is a sine wave quieter than one step of 16 bit audio,
+   so a conversion that goes through 16 bit samples loses it entirely.
+   It's the same on every channel, so mixing channels doesn't change it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "SDL.h"
+
+#define FRAMES		4800
+#define LEVEL		(1.0 / (1 << 18))
+#define FREQ		440.0
+#define EDGE		64	/* Frames at either end left out of the check */
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
+
+static double Wave(int frame, int rate)
+{
+	return LEVEL * sin(2.0 * M_PI * FREQ * frame / rate);
+}
+
+static void MakeWave(float *buf, int rate, int channels)
+{
+	int i, c;
+
+	for ( i = 0; i < FRAMES; ++i ) {
+		for ( c = 0; c < channels; ++c ) {
+			*buf++ = (float)Wave(i, rate);
+		}
+	}
+}
+
+/* Compare the first output channel with the wave it should carry */
+static int CheckWave(const char *name, const float *buf, int frames,
+                     int rate, int channels, int expected)
+{
+	double error, maxerr = 0.0;
+	int i;
+
+	if ( frames < expected - 1 || frames > expected + 1 ) {
+		printf("%s: got %d frames instead of %d\n", name, frames, expected);
+		return(1);
+	}
+	for ( i = EDGE; i < frames - EDGE; ++i ) {
+		error = fabs(buf[i*channels] - Wave(i, rate));
+		if ( error > maxerr ) {
+			maxerr = error;
+		}
+	}
+	printf("%s: error %.3f%% of the signal\n", name, 100.0 * maxerr / LEVEL);
+	return(maxerr > LEVEL / 100.0);
+}
+
+static int TestConvert(const char *name, int src_channels, int src_rate,
+                       int dst_channels, int dst_rate)
+{
+	SDL_AudioCVT cvt;
+	int expected, error;
+
+	if ( SDL_BuildAudioCVT(&cvt, AUDIO_F32SYS, src_channels, src_rate,
+	                       AUDIO_F32SYS, dst_channels, dst_rate) < 0 ) {
+		printf("%s: %s\n", name, SDL_GetError());
+		return(1);
+	}
+	cvt.len = FRAMES * src_channels * sizeof(float);
+	cvt.buf = (Uint8 *)malloc(cvt.len * cvt.len_mult);
+	if ( cvt.buf == NULL ) {
+		printf("%s: out of memory\n", name);
+		return(1);
+	}
+	MakeWave((float *)cvt.buf, src_rate, src_channels);
+	SDL_ConvertAudio(&cvt);
+
+	expected = (int)((double)FRAMES * dst_rate / src_rate);
+	error = CheckWave(name, (float *)cvt.buf,
+	                  cvt.len_cvt / (dst_channels * sizeof(float)),
+	                  dst_rate, dst_channels, expected);
+	free(cvt.buf);
+	return(error);
+}
+
+static int TestStream(const char *name, int src_channels, int src_rate,
+                      int dst_channels, int dst_rate)
+{
+	SDL_AudioStream *stream;
+	float *in, *out;
+	int i, len, chunk, expected, error;
+
+	stream = SDL_NewAudioStream(AUDIO_F32SYS, src_channels, src_rate,
+	                            AUDIO_F32SYS, dst_channels, dst_rate);
+	if ( stream == NULL ) {
+		printf("%s: %s\n", name, SDL_GetError());
+		return(1);
+	}
+	expected = (int)((double)FRAMES * dst_rate / src_rate);
+	in = (float *)malloc(FRAMES * src_channels * sizeof(float));
+	out = (float *)malloc((expected + 16) * dst_channels * sizeof(float));
+	if ( in == NULL || out == NULL ) {
+		printf("%s: out of memory\n", name);
+		free(in);
+		free(out);
+		SDL_FreeAudioStream(stream);
+		return(1);
+	}
+	MakeWave(in, src_rate, src_channels);
+
+	/* Put it in uneven pieces, to check there are no seams */
+	len = FRAMES * src_channels * sizeof(float);
+	for ( i = 0; i < len; i += chunk ) {
+		chunk = 1000 + i % 333;
+		if ( chunk > len - i ) {
+			chunk = len - i;
+		}
+		SDL_AudioStreamPut(stream, (Uint8 *)in + i, chunk);
+	}
+	SDL_AudioStreamFlush(stream);
+	len = SDL_AudioStreamGet(stream, out,
+	                         (expected + 16) * dst_channels * sizeof(float));
+
+	error = CheckWave(name, out, len / (dst_channels * sizeof(float)),
+	                  dst_rate, dst_channels, expected);
+	free(in);
+	free(out);
+	SDL_FreeAudioStream(stream);
+	return(error);
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+
+	error += TestConvert("Convert 44100 to 48000 Hz", 2, 44100, 2, 48000);
+	error += TestConvert("Convert 48000 to 22050 Hz", 1, 48000, 1, 22050);
+	error += TestConvert("Convert 22050 to 48000 Hz, mono to stereo", 1, 22050, 2, 48000);
+	error += TestConvert("Convert 44100 to 32000 Hz, stereo to mono", 2, 44100, 1, 32000);
+	error += TestConvert("Convert stereo to 5.1", 2, 44100, 6, 44100);
+	error += TestStream("Stream 44100 to 48000 Hz", 2, 44100, 2, 48000);
+	error += TestStream("Stream 48000 to 44100 Hz, stereo to mono", 2, 48000, 1, 44100);
+	error += TestStream("Stream 22050 to 48000 Hz, mono to stereo", 1, 22050, 2, 48000);
+	printf("%s\n", error ? "Float audio test FAILED" : "Float audio test passed");
+
+	SDL_Quit();
+	return(error ? 1 : 0);
+}
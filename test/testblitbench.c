@@ -0,0 +1,416 @@
+/*
+ * Benchmarks the software blitters for every pair of pixel formats in
+ * each blit mode, reporting the blitter SDL chose and its speed as CSV.
+ *
+ * Set SDL_CPU_DISABLE (for example to "sse2,avx2") to measure the code
+ * used on CPUs without those features.
+ *
+ * With --scale, a source of half the size is scaled up with SDL_BlitScaled()
+ * using the given filter, and the speed is counted in destination pixels.
+ *
+ * Usage: testblitbench [--ms n] [--sizes WxH,...] [--src format]
+ *                      [--dst format] [--mode mode] [--scale filter]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static const struct {
+	const char *name;
+	int bpp;
+	Uint32 Rmask, Gmask, Bmask, Amask;
+} formats[] = {
+	{ "INDEX8", 8, 0, 0, 0, 0 },
+	{ "RGB555", 15, 0x7C00, 0x03E0, 0x001F, 0 },
+	{ "RGB565", 16, 0xF800, 0x07E0, 0x001F, 0 },
+	{ "BGR565", 16, 0x001F, 0x07E0, 0xF800, 0 },
+	{ "RGB888", 24, 0x00FF0000, 0x0000FF00, 0x000000FF, 0 },
+	{ "BGR888", 24, 0x000000FF, 0x0000FF00, 0x00FF0000, 0 },
+	{ "XRGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0 },
+	{ "XBGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0 },
+	{ "ARGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 },
+	{ "ABGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 },
+	{ "RGBA8888", 32, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "BGRA8888", 32, 0x0000FF00, 0x00FF0000, 0xFF000000, 0x000000FF }
+};
+#define NUM_FORMATS	(sizeof(formats)/sizeof(formats[0]))
+
+enum { OPAQUE, COLORKEY, SURFACEALPHA, PIXELALPHA, RLE, NUM_MODES };
+static const char *modes[NUM_MODES] = {
+	"opaque", "colorkey", "surfacealpha", "pixelalpha", "rle"
+};
+
+static int testms = 50;
+static const char *sizes = "16x16,256x256,1024x768";
+static const char *srcname = NULL;
+static const char *dstname = NULL;
+static const char *modename = NULL;
+
+static const char *scales[] = { "nearest", "bilinear", "box" };
+#define NUM_SCALES	(sizeof(scales)/sizeof(scales[0]))
+static int scale = -1;
+
+static SDL_Surface *CreateSurface(int format, int w, int h)
+{
+	SDL_Surface *surface;
+	SDL_Color colors[256];
+	int i;
+
+	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h,
+	                               formats[format].bpp,
+	                               formats[format].Rmask,
+	                               formats[format].Gmask,
+	                               formats[format].Bmask,
+	                               formats[format].Amask);
+	if ( surface && surface->format->palette ) {
+		/* A 3-3-2 palette, with magenta for the color key */
+		for ( i = 0; i < 256; ++i ) {
+			colors[i].r = (i >> 5) * 255 / 7;
+			colors[i].g = ((i >> 2) & 7) * 255 / 7;
+			colors[i].b = (i & 3) * 255 / 3;
+		}
+		SDL_SetColors(surface, colors, 0, 256);
+	}
+	return(surface);
+}
+
+static void PutPixel(SDL_Surface *surface, int x, int y, Uint32 pixel)
+{
+	Uint8 *p = (Uint8 *)surface->pixels + y * surface->pitch
+	                    + x * surface->format->BytesPerPixel;
+
+	switch (surface->format->BytesPerPixel) {
+	    case 1:
+		*p = (Uint8)pixel;
+		break;
+	    case 2:
+		*(Uint16 *)p = (Uint16)pixel;
+		break;
+	    case 3:
+		if ( SDL_BYTEORDER == SDL_LIL_ENDIAN ) {
+			p[0] = pixel & 0xFF;
+			p[1] = (pixel >> 8) & 0xFF;
+			p[2] = (pixel >> 16) & 0xFF;
+		} else {
+			p[0] = (pixel >> 16) & 0xFF;
+			p[1] = (pixel >> 8) & 0xFF;
+			p[2] = pixel & 0xFF;
+		}
+		break;
+	    case 4:
+		*(Uint32 *)p = pixel;
+		break;
+	}
+}
+
+/* Fill a source surface with runs of key colored transparent pixels,
+   opaque pixels and translucent pixels, so every mode has work to do.
+   Returns the color key.
+ */
+static Uint32 FillSource(SDL_Surface *surface)
+{
+	Uint32 key, pixel;
+	Uint8 r, g, b, a;
+	int x, y, run, kind;
+
+	key = SDL_MapRGBA(surface->format, 255, 0, 255, 0);
+	kind = 0;
+	run = 0;
+	for ( y = 0; y < surface->h; ++y ) {
+		for ( x = 0; x < surface->w; ++x ) {
+			if ( run == 0 ) {
+				kind = rand() % 3;
+				run = 1 + rand() % 32;
+			}
+			--run;
+			if ( kind == 0 ) {
+				pixel = key;
+			} else {
+				r = rand() & 0x7F;
+				g = rand() & 0xFF;
+				b = rand() & 0xFF;
+				a = (kind == 1) ? 255 : rand() & 0xFF;
+				pixel = SDL_MapRGBA(surface->format, r, g, b, a);
+				if ( pixel == key ) {
+					pixel = SDL_MapRGBA(surface->format,
+					                    0, 0, 0, a);
+				}
+			}
+			PutPixel(surface, x, y, pixel);
+		}
+	}
+	return(key);
+}
+
+/* Set up the source surface for a blit mode, returns 0 if it doesn't
+   apply to the source format.
+ */
+static int SetMode(SDL_Surface *src, int mode, Uint32 key)
+{
+	int has_alpha = (src->format->Amask != 0);
+
+	SDL_SetColorKey(src, 0, 0);
+	SDL_SetAlpha(src, 0, 0);
+	switch (mode) {
+	    case OPAQUE:
+		break;
+	    case COLORKEY:
+		SDL_SetColorKey(src, SDL_SRCCOLORKEY, key);
+		break;
+	    case SURFACEALPHA:
+		if ( has_alpha ) {
+			return(0);
+		}
+		SDL_SetAlpha(src, SDL_SRCALPHA, 128);
+		break;
+	    case PIXELALPHA:
+		if ( !has_alpha ) {
+			return(0);
+		}
+		SDL_SetAlpha(src, SDL_SRCALPHA, 255);
+		break;
+	    case RLE:
+		if ( has_alpha ) {
+			SDL_SetAlpha(src, SDL_SRCALPHA|SDL_RLEACCEL, 255);
+		} else {
+			SDL_SetColorKey(src, SDL_SRCCOLORKEY|SDL_RLEACCEL, key);
+		}
+		break;
+	}
+	return(1);
+}
+
+static void GetCPUName(char *name, size_t maxlen)
+{
+	name[0] = '\0';
+	if ( SDL_HasMMX() ) strcat(name, "+mmx");
+	if ( SDL_Has3DNow() ) strcat(name, "+3dnow");
+	if ( SDL_HasSSE() ) strcat(name, "+sse");
+	if ( SDL_HasSSE2() ) strcat(name, "+sse2");
+	if ( SDL_HasAVX2() ) strcat(name, "+avx2");
+	if ( SDL_HasAltiVec() ) strcat(name, "+altivec");
+	if ( name[0] ) {
+		memmove(name, name+1, strlen(name));
+	} else {
+		strcpy(name, "none");
+	}
+}
+
+static void Blit(SDL_Surface *src, SDL_Surface *dst)
+{
+	if ( scale >= 0 ) {
+		SDL_BlitScaled(src, NULL, dst, NULL, (SDL_ScaleMode)scale);
+	} else {
+		SDL_BlitSurface(src, NULL, dst, NULL);
+	}
+}
+
+static void RunBench(const char *cpu, int s, int d, int mode, int w, int h)
+{
+	static SDL_Surface *src = NULL;
+	static int src_format = -1, src_w, src_h;
+	static Uint32 key;
+	SDL_Surface *dst;
+	const char *blitter;
+	char name[128];
+	Uint64 start, now;
+	Uint32 blits, i, batch;
+	double mpps;
+	int sw = w, sh = h;
+
+	if ( scale >= 0 ) {
+		sw = (w > 1) ? w / 2 : 1;
+		sh = (h > 1) ? h / 2 : 1;
+	}
+
+	/* The source is reused for each destination and mode */
+	if ( !src || src_format != s || src_w != sw || src_h != sh ) {
+		if ( src ) {
+			SDL_FreeSurface(src);
+		}
+		src = CreateSurface(s, sw, sh);
+		if ( !src ) {
+			fprintf(stderr, "Couldn't create surface: %s\n",
+			        SDL_GetError());
+			exit(1);
+		}
+		key = FillSource(src);
+		src_format = s;
+		src_w = sw;
+		src_h = sh;
+	}
+	if ( !SetMode(src, mode, key) ) {
+		return;
+	}
+
+	dst = CreateSurface(d, w, h);
+	if ( !dst ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",
+		        SDL_GetError());
+		exit(1);
+	}
+	SDL_FillRect(dst, NULL, SDL_MapRGB(dst->format, 64, 128, 192));
+
+	blitter = SDL_GetBlitName(src, dst);
+	if ( !blitter ) {
+		printf("%s,%s,%s,%s,%d,%d,unsupported,0\n", cpu,
+		       formats[s].name, formats[d].name, modes[mode], w, h);
+		SDL_FreeSurface(dst);
+		return;
+	}
+	if ( scale >= 0 ) {
+		sprintf(name, "%.100s+%s", blitter, scales[scale]);
+		blitter = name;
+	}
+
+	/* Warm up, then blit until the time is up */
+	Blit(src, dst);
+	blits = 0;
+	batch = 1;
+	start = SDL_GetTicksNS();
+	do {
+		for ( i = 0; i < batch; ++i ) {
+			Blit(src, dst);
+		}
+		blits += batch;
+		if ( batch < 1024 ) {
+			batch *= 2;
+		}
+		now = SDL_GetTicksNS();
+	} while ( (now - start) < (Uint64)testms * 1000000 );
+
+	mpps = (double)blits * w * h * 1000.0 / (double)(Sint64)(now - start);
+	printf("%s,%s,%s,%s,%d,%d,%s,%.1f\n", cpu,
+	       formats[s].name, formats[d].name, modes[mode], w, h,
+	       blitter, mpps);
+	fflush(stdout);
+	SDL_FreeSurface(dst);
+}
+
+static int FindFormat(const char *name)
+{
+	int i;
+
+	for ( i = 0; i < (int)NUM_FORMATS; ++i ) {
+		if ( strcmp(name, formats[i].name) == 0 ) {
+			return(i);
+		}
+	}
+	fprintf(stderr, "Unknown format %s\n", name);
+	exit(1);
+	return(-1);
+}
+
+int main(int argc, char *argv[])
+{
+	char cpu[64];
+	const char *size;
+	int i, s, d, mode, w, h;
+	int src_format = -1, dst_format = -1, only_mode = -1;
+
+	for ( i = 1; i < argc; ++i ) {
+		if ( strcmp(argv[i], "--ms") == 0 && argv[i+1] ) {
+			testms = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "--sizes") == 0 && argv[i+1] ) {
+			sizes = argv[++i];
+		} else if ( strcmp(argv[i], "--src") == 0 && argv[i+1] ) {
+			srcname = argv[++i];
+		} else if ( strcmp(argv[i], "--dst") == 0 && argv[i+1] ) {
+			dstname = argv[++i];
+		} else if ( strcmp(argv[i], "--mode") == 0 && argv[i+1] ) {
+			modename = argv[++i];
+		} else if ( strcmp(argv[i], "--scale") == 0 && argv[i+1] ) {
+			++i;
+			for ( scale = 0; scale < (int)NUM_SCALES; ++scale ) {
+				if ( strcmp(argv[i], scales[scale]) == 0 ) {
+					break;
+				}
+			}
+			if ( scale == (int)NUM_SCALES ) {
+				fprintf(stderr, "Unknown filter %s\n", argv[i]);
+				return(1);
+			}
+		} else {
+			fprintf(stderr,
+"Usage: %s [--ms n] [--sizes WxH,...] [--src format] [--dst format] [--mode mode] [--scale filter]\n",
+			        argv[0]);
+			fprintf(stderr, "Formats:");
+			for ( s = 0; s < (int)NUM_FORMATS; ++s ) {
+				fprintf(stderr, " %s", formats[s].name);
+			}
+			fprintf(stderr, "\nModes:");
+			for ( mode = 0; mode < NUM_MODES; ++mode ) {
+				fprintf(stderr, " %s", modes[mode]);
+			}
+			fprintf(stderr, "\nFilters:");
+			for ( s = 0; s < (int)NUM_SCALES; ++s ) {
+				fprintf(stderr, " %s", scales[s]);
+			}
+			fprintf(stderr, "\n");
+			return(1);
+		}
+	}
+	if ( srcname ) {
+		src_format = FindFormat(srcname);
+	}
+	if ( dstname ) {
+		dst_format = FindFormat(dstname);
+	}
+	if ( modename ) {
+		for ( mode = 0; mode < NUM_MODES; ++mode ) {
+			if ( strcmp(modename, modes[mode]) == 0 ) {
+				only_mode = mode;
+			}
+		}
+		if ( only_mode < 0 ) {
+			fprintf(stderr, "Unknown mode %s\n", modename);
+			return(1);
+		}
+	}
+
+	/* No window is needed, but the video subsystem starts the blit
+	   threads if SDL_BLIT_THREADS is set.
+	 */
+	if ( !getenv("SDL_VIDEODRIVER") ) {
+		SDL_putenv("SDL_VIDEODRIVER=dummy");
+	}
+	if ( SDL_Init(SDL_INIT_VIDEO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	GetCPUName(cpu, sizeof(cpu));
+	srand(42);
+
+	printf("cpu,src,dst,mode,width,height,blitter,mpixels_per_sec\n");
+	for ( size = sizes; size && *size; ) {
+		if ( sscanf(size, "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0 ) {
+			fprintf(stderr, "Bad size %s\n", size);
+			break;
+		}
+		for ( s = 0; s < (int)NUM_FORMATS; ++s ) {
+			if ( src_format >= 0 && s != src_format ) {
+				continue;
+			}
+			for ( d = 0; d < (int)NUM_FORMATS; ++d ) {
+				if ( dst_format >= 0 && d != dst_format ) {
+					continue;
+				}
+				for ( mode = 0; mode < NUM_MODES; ++mode ) {
+					if ( only_mode >= 0 && mode != only_mode ) {
+						continue;
+					}
+					RunBench(cpu, s, d, mode, w, h);
+				}
+			}
+		}
+		size = strchr(size, ',');
+		if ( size ) {
+			++size;
+		}
+	}
+	SDL_Quit();
+	return(0);
+}
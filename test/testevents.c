@@ -0,0 +1,135 @@
+/* Test the event queue: events taken out with a mask from behind an event
+   nobody asks for must not use up the queue, and the order of the events
+   left must be kept.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define KEPT_EVENT	SDL_USEREVENT
+#define TAKEN_EVENT	(SDL_USEREVENT+1)
+
+static int PushEvent(Uint8 type, int code)
+{
+	SDL_Event event;
+
+	event.type = type;
+	event.user.code = code;
+	event.user.data1 = NULL;
+	event.user.data2 = NULL;
+	return(SDL_PushEvent(&event));
+}
+
+/* Push and take out many more events than the queue holds, with one event
+   left at the head all the time */
+static int TestMaskedGets(void)
+{
+	SDL_Event event;
+	int i, error = 0;
+
+	if ( PushEvent(KEPT_EVENT, 0) < 0 ) {
+		printf("Couldn't push the first event\n");
+		return(1);
+	}
+	for ( i = 0; i < 1000; ++i ) {
+		if ( PushEvent(TAKEN_EVENT, i) < 0 ) {
+			printf("Push %d failed, the queue filled up\n", i);
+			++error;
+			break;
+		}
+		if ( SDL_PeepEvents(&event, 1, SDL_GETEVENT,
+		                    SDL_EVENTMASK(TAKEN_EVENT)) != 1 ||
+		     event.user.code != i ) {
+			printf("Event %d wasn't taken out\n", i);
+			++error;
+			break;
+		}
+	}
+	if ( SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_ALLEVENTS) != 1 ||
+	     event.type != KEPT_EVENT ) {
+		printf("The first event was lost\n");
+		++error;
+	}
+	return(error);
+}
+
+/* Take every other event out of a full queue, then fill it up again */
+static int TestOrder(void)
+{
+	SDL_Event event;
+	int i, pushed, code, error = 0;
+
+	for ( pushed = 0; PushEvent((pushed & 1) ? TAKEN_EVENT : KEPT_EVENT,
+	                            pushed) == 0; ++pushed ) {
+		continue;
+	}
+	code = 1;
+	while ( SDL_PeepEvents(&event, 1, SDL_GETEVENT,
+	                       SDL_EVENTMASK(TAKEN_EVENT)) == 1 ) {
+		if ( event.user.code != code ) {
+			printf("Got event %d instead of %d\n",
+			       event.user.code, code);
+			++error;
+		}
+		code += 2;
+	}
+	if ( code < pushed ) {
+		printf("Only got %d of %d events\n", code/2, pushed/2);
+		++error;
+	}
+
+	/* The freed half of the queue must be usable again */
+	for ( i = 0; i < pushed/2; ++i ) {
+		if ( PushEvent(TAKEN_EVENT, pushed+i) < 0 ) {
+			printf("Only %d of %d events fit back\n", i, pushed/2);
+			++error;
+			break;
+		}
+	}
+	/* The even events are left, followed by the new ones */
+	code = 0;
+	while ( SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_ALLEVENTS) == 1 ) {
+		if ( event.user.code != code ) {
+			printf("Got event %d instead of %d\n",
+			       event.user.code, code);
+			++error;
+			break;
+		}
+		if ( code < pushed-2 ) {
+			code += 2;
+		} else if ( code < pushed ) {
+			code = pushed;
+		} else {
+			++code;
+		}
+	}
+	return(error);
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+
+	/* No window is needed, only the event queue */
+	if ( !getenv("SDL_VIDEODRIVER") ) {
+		SDL_putenv("SDL_VIDEODRIVER=dummy");
+	}
+	if ( SDL_Init(SDL_INIT_VIDEO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+
+	error += TestMaskedGets();
+	error += TestOrder();
+	if ( SDL_GetDroppedEvents() != 1 ) {
+		printf("%u events dropped, expected only the one that found the queue full\n",
+		       (unsigned)SDL_GetDroppedEvents());
+		++error;
+	}
+	printf("%s\n", error ? "Event queue test FAILED" : "Event queue test passed");
+
+	SDL_Quit();
+	return(error ? 1 : 0);
+}
@@ -270,12 +270,122 @@ static void PrintUsage(char *argv0)
     fprintf(stderr, "	-fps <frames per second>\n");
     fprintf(stderr, "	-format <fmt> (one of the: YV12, IYUV, YUY2, UYVY, YVYU)\n");
     fprintf(stderr, "	-scale <scale factor> (initial scale of the overlay)\n");
+    fprintf(stderr, "	-benchmark <frames> (time the conversion at 1X, 2X and 1.5X instead)\n");
+    fprintf(stderr, "	-size <w>x<h> (overlay size for the benchmark, default 1920x1080)\n");
     fprintf(stderr, "	-help (shows this help)\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Press ESC to exit, or SPACE to freeze the movie while application running.\n");
     fprintf(stderr, "\n");
 }
 
+static const char *FormatName(int format)
+{
+    switch (format)
+    {
+        case SDL_YV12_OVERLAY:
+             return "YV12";
+        case SDL_IYUV_OVERLAY:
+             return "IYUV";
+        case SDL_YUY2_OVERLAY:
+             return "YUY2";
+        case SDL_UYVY_OVERLAY:
+             return "UYVY";
+        case SDL_YVYU_OVERLAY:
+             return "YVYU";
+    }
+    return "Unknown";
+}
+
+/* The conversion time reported by SDL for software overlays */
+static Uint64 convert_ns;
+static int convert_threads;
+
+static void SDLCALL ConvertHook(void *userdata, SDL_Overlay *overlay, Uint64 ns, int threads)
+{
+    convert_ns+=ns;
+    convert_threads=threads;
+}
+
+/* Display a still overlay as fast as possible at 1X, 2X and 1.5X.
+   Run with SDL_VIDEODRIVER=dummy to measure only the conversion, and
+   set SDL_YUV_THREADS to convert with several threads. */
+static void Benchmark(int format, int w, int h, int frames)
+{
+    SDL_Surface* screen;
+    SDL_Overlay* overlay;
+    SDL_Rect rect;
+    Uint64 start, elapsed;
+    double ms;
+    /* Normal and double size, then a scaled window, in halves */
+    static const int scales[]={ 2, 4, 3 };
+    int scale;
+    int i, p, x, y, rows;
+
+    for (scale=0; scale<(int)(sizeof(scales)/sizeof(scales[0])); scale++)
+    {
+        screen=SDL_SetVideoMode(w*scales[scale]/2, h*scales[scale]/2, 0, SDL_SWSURFACE);
+        if (screen==NULL)
+        {
+            fprintf(stderr, "Couldn't set video mode: %s\n", SDL_GetError());
+            quit(4);
+        }
+        overlay=SDL_CreateYUVOverlay(w, h, format, screen);
+        if (!overlay)
+        {
+            fprintf(stderr, "Couldn't create overlay: %s\n", SDL_GetError());
+            quit(7);
+        }
+
+        /* The picture doesn't change the speed, any pattern will do */
+        SDL_LockYUVOverlay(overlay);
+        for (p=0; p<overlay->planes; p++)
+        {
+            rows=((overlay->planes==3) && (p>0)) ? h/2 : h;
+            for (y=0; y<rows; y++)
+            {
+                for (x=0; x<overlay->pitches[p]; x++)
+                {
+                    overlay->pixels[p][y*overlay->pitches[p]+x]=(Uint8)(x*3+y*5);
+                }
+            }
+        }
+        SDL_UnlockYUVOverlay(overlay);
+
+        rect.x=0;
+        rect.y=0;
+        rect.w=screen->w;
+        rect.h=screen->h;
+        SDL_DisplayYUVOverlay(overlay, &rect);
+        convert_ns=0;
+        convert_threads=0;
+        SDL_SetYUVConvertHook(ConvertHook, NULL);
+        start=SDL_GetTicksNS();
+        for (i=0; i<frames; i++)
+        {
+            SDL_DisplayYUVOverlay(overlay, &rect);
+        }
+        elapsed=SDL_GetTicksNS()-start;
+        SDL_SetYUVConvertHook(NULL, NULL);
+        if (elapsed==0)
+        {
+            elapsed=1;
+        }
+
+        ms=(double)(Sint64)elapsed/1000000.0/frames;
+        printf("%s %s %dx%d to %dx%d at %d bpp: %.3f ms/frame, %.1f frames/s, %.1f Mpixels/s\n",
+               overlay->hw_overlay?"hardware":"software", FormatName(format),
+               w, h, rect.w, rect.h, screen->format->BitsPerPixel,
+               ms, 1000.0/ms, (double)rect.w*rect.h/ms/1000.0);
+        if (convert_threads)
+        {
+            printf("    conversion %.3f ms/frame on %d thread%s\n",
+                   (double)(Sint64)convert_ns/1000000.0/frames,
+                   convert_threads, (convert_threads>1)?"s":"");
+        }
+        SDL_FreeYUVOverlay(overlay);
+    }
+}
+
 int main(int argc, char **argv)
 {
     Uint8* RawMooseData;
@@ -293,6 +403,9 @@ int main(int argc, char **argv)
     int fpsdelay;
     int overlay_format=SDL_YUY2_OVERLAY;
     int scale=5;
+    int benchmark=0;
+    int bench_w=1920;
+    int bench_h=1080;
 
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_NOPARACHUTE) < 0)
     {
@@ -378,6 +491,34 @@ int main(int argc, char **argv)
                 quit(10);
             }
         } else
+        if (strcmp(argv[1], "-benchmark") == 0)
+        {
+            if ((argv[2]) && (atoi(argv[2])>0))
+            {
+                benchmark = atoi(argv[2]);
+                argv += 2;
+                argc -= 2;
+            }
+            else
+            {
+                fprintf(stderr, "The -benchmark option requires a number of frames.\n");
+                quit(10);
+            }
+        } else
+        if (strcmp(argv[1], "-size") == 0)
+        {
+            if ((argv[2]) && (sscanf(argv[2], "%dx%d", &bench_w, &bench_h)==2) &&
+                (bench_w>0) && (bench_h>0))
+            {
+                argv += 2;
+                argc -= 2;
+            }
+            else
+            {
+                fprintf(stderr, "The -size option requires an argument like 1920x1080.\n");
+                quit(10);
+            }
+        } else
         if ((strcmp(argv[1], "-help") == 0 ) || (strcmp(argv[1], "-h") == 0))
         {
             PrintUsage(argv[0]);
@@ -387,7 +528,12 @@ int main(int argc, char **argv)
             fprintf(stderr, "Unrecognized option: %s.\n", argv[1]);
             quit(10);
         }
-        break;
+    }
+
+    if (benchmark)
+    {
+        Benchmark(overlay_format, bench_w, bench_h, benchmark);
+        quit(0);
     }
    
     RawMooseData=(Uint8*)malloc(MOOSEFRAME_SIZE * MOOSEFRAMES_COUNT);